@@ -0,0 +1,122 @@
+// Measures throughput of readers which take snapshots of a shared value while one writer replaces it. The readers
+// are started in groups of 1, 2, 4, ... up to the given count, so the table shows how the throughput scales.
+// Usage: atomic_optional_benchmark [maximal reader count] [duration in milliseconds]
+#include <cow/atomic_optional.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using value_type = std::vector<int>;
+
+// the readers write the checksums of the snapshots here, so the compiler does not remove the reads
+volatile std::size_t checksum_sink = 0;
+
+template<typename Storage>
+class locked_optional {
+public:
+	using optional_type = cow::optional<value_type, false, Storage>;
+
+	explicit locked_optional(optional_type value)
+		: value_{std::move(value)}
+	{}
+
+	optional_type load() const
+	{
+		const std::lock_guard<std::mutex> lock{mutex_};
+		return value_;
+	}
+
+	void store(optional_type value)
+	{
+		const std::lock_guard<std::mutex> lock{mutex_};
+		value_.swap(value);
+	}
+
+private:
+	mutable std::mutex mutex_;
+	optional_type value_;
+};
+
+// returns the number of loads per second made by all readers
+template<typename Cell, typename Storage>
+double run(const unsigned reader_count, const std::chrono::milliseconds duration)
+{
+	using optional_type = cow::optional<value_type, false, Storage>;
+
+	Cell cell{optional_type{cow::in_place, 16U, 0}};
+	std::atomic<bool> done{false};
+	std::atomic<std::size_t> load_count{0};
+
+	std::vector<std::thread> readers;
+	for (unsigned i = 0; i != reader_count; ++i) {
+		readers.emplace_back([&]() {
+			std::size_t count = 0;
+			std::size_t checksum = 0;
+			while (!done.load(std::memory_order_relaxed)) {
+				const optional_type snapshot = cell.load();
+				if (snapshot)
+					checksum += snapshot->size();
+				++count;
+			}
+			checksum_sink = checksum;
+			load_count += count;
+		});
+	}
+
+	std::thread writer{[&]() {
+		for (int i = 0; !done.load(std::memory_order_relaxed); ++i) {
+			cell.store(optional_type{cow::in_place, 16U, i});
+			std::this_thread::sleep_for(std::chrono::microseconds{100});
+		}
+	}};
+
+	const auto start = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(duration);
+	done = true;
+	const auto finish = std::chrono::steady_clock::now();
+
+	writer.join();
+	for (std::thread& reader : readers)
+		reader.join();
+
+	return static_cast<double>(load_count.load()) / std::chrono::duration<double>(finish - start).count();
+}
+
+} // namespace
+
+int main(const int argc, char* argv[])
+{
+	const unsigned max_reader_count = argc > 1 ? static_cast<unsigned>(std::stoul(argv[1])) : 4;
+	const std::chrono::milliseconds duration{argc > 2 ? std::stol(argv[2]) : 1000};
+
+	std::cout << "loads/s by readers\n"
+		<< std::setw(8) << "readers" << std::setw(16) << "snapshot" << std::setw(16) << "atomic" << std::setw(16)
+		<< "deferred" << std::setw(16) << "mutex" << '\n';
+
+	for (unsigned reader_count = 1; reader_count <= max_reader_count; reader_count *= 2) {
+		const double snapshot_rate =
+			run<cow::atomic_optional<value_type>, cow::snapshot_storage>(reader_count, duration);
+		cow::snapshot_ref_count::release_kept();
+		const double atomic_rate =
+			run<cow::atomic_optional<value_type, cow::intrusive_storage>, cow::intrusive_storage>(reader_count, duration);
+		const double deferred_rate =
+			run<cow::atomic_optional<value_type, cow::deferred_storage>, cow::deferred_storage>(reader_count, duration);
+		static_cast<void>(cow::reclamation_domain::global().collect());
+		const double locked_rate =
+			run<locked_optional<cow::intrusive_storage>, cow::intrusive_storage>(reader_count, duration);
+
+		std::cout << std::setw(8) << reader_count << std::setw(16) << snapshot_rate << std::setw(16) << atomic_rate
+			<< std::setw(16) << deferred_rate << std::setw(16) << locked_rate << '\n';
+	}
+
+	return EXIT_SUCCESS;
+}
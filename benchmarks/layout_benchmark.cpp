@@ -0,0 +1,95 @@
+// Measures throughput of threads which read the fields of a shared value while other threads copy the value.
+// Usage: layout_benchmark [reader count] [copier count] [duration in milliseconds]
+#include <cow/optional.h>
+#include <cow/storage.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// the fields are kept in the first cache line of the value
+constexpr std::size_t field_count = 8;
+
+struct value_type {
+	int fields[field_count];
+};
+
+struct result {
+	double reads;
+	double copies;
+};
+
+// returns the number of reads and copies per second made by all threads
+template<typename Storage>
+result run(const unsigned reader_count, const unsigned copier_count, const std::chrono::milliseconds duration)
+{
+	using optional_type = cow::optional<value_type, false, Storage>;
+
+	const optional_type value{cow::in_place, value_type{{1, 2, 3, 4, 5, 6, 7, 8}}};
+	// the fields are read through the volatile pointer, so the reads are not moved out of the loop
+	const volatile int* const fields = value.value().fields;
+	std::atomic<bool> done{false};
+	std::atomic<std::size_t> read_count{0};
+	std::atomic<std::size_t> copy_count{0};
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i != reader_count; ++i) {
+		threads.emplace_back([&]() {
+			std::size_t count = 0;
+			int checksum = 0;
+			while (!done.load(std::memory_order_relaxed)) {
+				for (std::size_t j = 0; j != field_count; ++j)
+					checksum += fields[j];
+				++count;
+			}
+			read_count += count + static_cast<std::size_t>(checksum % 2);
+		});
+	}
+	for (unsigned i = 0; i != copier_count; ++i) {
+		threads.emplace_back([&]() {
+			std::size_t count = 0;
+			while (!done.load(std::memory_order_relaxed)) {
+				const optional_type copy = value;
+				++count;
+			}
+			copy_count += count;
+		});
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(duration);
+	done = true;
+	const auto finish = std::chrono::steady_clock::now();
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	const double seconds = std::chrono::duration<double>(finish - start).count();
+	return {static_cast<double>(read_count.load()) / seconds, static_cast<double>(copy_count.load()) / seconds};
+}
+
+void print(const char* const name, const result& value)
+{
+	std::cout << name << ": " << value.reads << " reads/s, " << value.copies << " copies/s\n";
+}
+
+} // namespace
+
+int main(const int argc, char* argv[])
+{
+	const unsigned reader_count = argc > 1 ? static_cast<unsigned>(std::stoul(argv[1])) : 3;
+	const unsigned copier_count = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : 1;
+	const std::chrono::milliseconds duration{argc > 3 ? std::stol(argv[3]) : 1000};
+
+	std::cout << "readers: " << reader_count << ", copiers: " << copier_count << '\n';
+	print("intrusive_storage", run<cow::intrusive_storage>(reader_count, copier_count, duration));
+	print("padded_storage", run<cow::padded_storage>(reader_count, copier_count, duration));
+
+	return EXIT_SUCCESS;
+}
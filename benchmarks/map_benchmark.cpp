@@ -0,0 +1,105 @@
+// Measures the time of taking snapshots of a map and changing one entry of each snapshot and the time of filling a map.
+// Usage: map_benchmark [entry count] [snapshot count]
+#include <cow/map.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+void set(std::unordered_map<int, int>& value, const int key, const int element)
+{
+	value[key] = element;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Storage>
+void set(cow::map<Key, T, Hash, KeyEqual, Storage>& value, const int key, const int element)
+{
+	value.set(key, element);
+}
+
+template<typename Map>
+Map fill(const std::size_t entry_count)
+{
+	Map value;
+	for (std::size_t i = 0; i != entry_count; ++i)
+		set(value, static_cast<int>(i), static_cast<int>(i));
+	return value;
+}
+
+template<typename Map>
+Map fill_transient(const std::size_t entry_count)
+{
+	typename Map::transient_type builder;
+	for (std::size_t i = 0; i != entry_count; ++i)
+		builder.set(static_cast<int>(i), static_cast<int>(i));
+	return builder.persistent();
+}
+
+// returns the number of snapshots per second, each snapshot is copied from the previous one and one entry is changed
+template<typename Map>
+double run_snapshots(const std::size_t entry_count, const std::size_t snapshot_count)
+{
+	Map value = fill<Map>(entry_count);
+
+	std::vector<Map> snapshots;
+	snapshots.reserve(snapshot_count);
+
+	const auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i != snapshot_count; ++i) {
+		snapshots.push_back(value);
+		const std::size_t key = i * 7919 % entry_count;
+		set(value, static_cast<int>(key), -static_cast<int>(i));
+	}
+	const auto finish = std::chrono::steady_clock::now();
+
+	const double seconds = std::chrono::duration<double>(finish - start).count();
+	return static_cast<double>(snapshot_count) / seconds;
+}
+
+// returns the number of inserted entries per second
+template<typename Map, typename Fill>
+double run_fill(const std::size_t entry_count, Fill fill)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const Map value = fill(entry_count);
+	const auto finish = std::chrono::steady_clock::now();
+
+	const double seconds = std::chrono::duration<double>(finish - start).count();
+	return static_cast<double>(value.size()) / seconds;
+}
+
+void print(const char* const name, const double count, const char* const unit)
+{
+	std::cout << name << ": " << count << ' ' << unit << '\n';
+}
+
+} // namespace
+
+int main(const int argc, char* argv[])
+{
+	using std_map = std::unordered_map<int, int>;
+	using cow_map = cow::map<int, int>;
+	using single_thread_map = cow::map<int, int, std::hash<int>, std::equal_to<int>, cow::single_thread_storage>;
+
+	const std::size_t entry_count = argc > 1 ? std::stoul(argv[1]) : 100000;
+	const std::size_t snapshot_count = argc > 2 ? std::stoul(argv[2]) : 1000;
+
+	std::cout << "entries: " << entry_count << ", snapshots: " << snapshot_count << '\n';
+	print("std::unordered_map", run_snapshots<std_map>(entry_count, snapshot_count), "snapshots/s");
+	print("cow::map", run_snapshots<cow_map>(entry_count, snapshot_count), "snapshots/s");
+	print(
+		"cow::map with single_thread_storage",
+		run_snapshots<single_thread_map>(entry_count, snapshot_count),
+		"snapshots/s");
+
+	print("std::unordered_map fill", run_fill<std_map>(entry_count, &fill<std_map>), "entries/s");
+	print("cow::map fill", run_fill<cow_map>(entry_count, &fill<cow_map>), "entries/s");
+	print("cow::map transient fill", run_fill<cow_map>(entry_count, &fill_transient<cow_map>), "entries/s");
+
+	return EXIT_SUCCESS;
+}
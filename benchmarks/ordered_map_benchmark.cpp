@@ -0,0 +1,99 @@
+// Measures the time of taking snapshots of an ordered map and changing one entry of each snapshot and the time of
+// scanning ranges of the snapshots.
+// Usage: ordered_map_benchmark [entry count] [snapshot count] [range size]
+#include <cow/ordered_map.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+void set(std::map<int, int>& value, const int key, const int element)
+{
+	value[key] = element;
+}
+
+template<typename Key, typename T, typename Compare, std::size_t NodeSize, typename Storage>
+void set(cow::ordered_map<Key, T, Compare, NodeSize, Storage>& value, const int key, const int element)
+{
+	value.set(key, element);
+}
+
+template<typename Map>
+std::vector<Map> take_snapshots(const std::size_t entry_count, const std::size_t snapshot_count, double& rate)
+{
+	Map value;
+	for (std::size_t i = 0; i != entry_count; ++i)
+		set(value, static_cast<int>(i), static_cast<int>(i));
+
+	std::vector<Map> snapshots;
+	snapshots.reserve(snapshot_count);
+
+	const auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i != snapshot_count; ++i) {
+		snapshots.push_back(value);
+		const std::size_t key = i * 7919 % entry_count;
+		set(value, static_cast<int>(key), -static_cast<int>(i));
+	}
+	const auto finish = std::chrono::steady_clock::now();
+
+	const double seconds = std::chrono::duration<double>(finish - start).count();
+	rate = static_cast<double>(snapshot_count) / seconds;
+	return snapshots;
+}
+
+// returns the number of scanned entries per second, every snapshot is scanned from a key to the next `range_size` keys
+template<typename Map>
+double scan(const std::vector<Map>& snapshots, const std::size_t entry_count, const std::size_t range_size)
+{
+	long long sum = 0;
+	std::size_t count = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i != snapshots.size(); ++i) {
+		const Map& snapshot = snapshots[i];
+		const int first = static_cast<int>(i * 104729 % entry_count);
+		const auto last = snapshot.lower_bound(first + static_cast<int>(range_size));
+		for (auto it = snapshot.lower_bound(first); it != last; ++it) {
+			sum += it->second;
+			++count;
+		}
+	}
+	const auto finish = std::chrono::steady_clock::now();
+
+	const double seconds = std::chrono::duration<double>(finish - start).count();
+	return static_cast<double>(count) / seconds + static_cast<double>(sum % 2);
+}
+
+template<typename Map>
+void run(
+	const char* const name, const std::size_t entry_count, const std::size_t snapshot_count, const std::size_t range_size)
+{
+	double snapshot_rate = 0;
+	const std::vector<Map> snapshots = take_snapshots<Map>(entry_count, snapshot_count, snapshot_rate);
+	const double scan_rate = scan(snapshots, entry_count, range_size);
+
+	std::cout << name << ": " << snapshot_rate << " snapshots/s, " << scan_rate << " scanned entries/s\n";
+}
+
+} // namespace
+
+int main(const int argc, char* argv[])
+{
+	const std::size_t entry_count = argc > 1 ? std::stoul(argv[1]) : 100000;
+	const std::size_t snapshot_count = argc > 2 ? std::stoul(argv[2]) : 1000;
+	const std::size_t range_size = argc > 3 ? std::stoul(argv[3]) : 1000;
+
+	std::cout << "entries: " << entry_count << ", snapshots: " << snapshot_count;
+	std::cout << ", range size: " << range_size << '\n';
+	run<std::map<int, int>>("std::map", entry_count, snapshot_count, range_size);
+	run<cow::ordered_map<int, int>>("cow::ordered_map", entry_count, snapshot_count, range_size);
+	run<cow::ordered_map<int, int, std::less<int>, 64, cow::single_thread_storage>>(
+		"cow::ordered_map with single_thread_storage", entry_count, snapshot_count, range_size);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+// Measures throughput of threads which copy and release one shared value at once. Each thread keeps one copy of the
+// value all the time like a thread which keeps a snapshot of the global configuration between requests.
+// Usage: ref_count_benchmark [max thread count] [duration in milliseconds]
+#include <cow/optional.h>
+#include <cow/storage.h>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using value_type = std::vector<int>;
+
+// returns the number of copies per second made by all threads
+template<typename Storage>
+double run(const unsigned thread_count, const std::chrono::milliseconds duration)
+{
+	using optional_type = cow::optional<value_type, false, Storage>;
+
+	const optional_type value{cow::in_place, 16U, 0};
+	std::atomic<bool> done{false};
+	std::atomic<std::size_t> copy_count{0};
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i != thread_count; ++i) {
+		threads.emplace_back([&]() {
+			const optional_type snapshot = value;
+			std::size_t count = 0;
+			std::size_t checksum = 0;
+			while (!done.load(std::memory_order_relaxed)) {
+				const optional_type copy = value;
+				if (copy)
+					checksum += copy->size();
+				++count;
+			}
+			copy_count += count + checksum % 2;
+		});
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(duration);
+	done = true;
+	const auto finish = std::chrono::steady_clock::now();
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	return static_cast<double>(copy_count.load()) / std::chrono::duration<double>(finish - start).count();
+}
+
+} // namespace
+
+int main(const int argc, char* argv[])
+{
+	const unsigned max_thread_count =
+		argc > 1 ? static_cast<unsigned>(std::stoul(argv[1])) : std::max(std::thread::hardware_concurrency(), 1U);
+	const std::chrono::milliseconds duration{argc > 2 ? std::stol(argv[2]) : 500};
+
+	std::cout << "threads\tintrusive_storage\tshared_ptr_storage\tsharded_storage (copies/s)\n";
+	for (unsigned thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+		std::cout << thread_count
+			<< '\t' << run<cow::intrusive_storage>(thread_count, duration)
+			<< '\t' << run<cow::shared_ptr_storage>(thread_count, duration)
+			<< '\t' << run<cow::sharded_storage>(thread_count, duration) << '\n';
+	}
+
+	return EXIT_SUCCESS;
+}
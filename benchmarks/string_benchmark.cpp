@@ -0,0 +1,57 @@
+// Measures the time of copying and reading `optional` objects which keep short and long strings.
+// Usage: string_benchmark [copy count] [long string size]
+#include <cow/optional.h>
+#include <cow/string.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// returns the number of copies per second, each copy reads the size of the string
+template<typename String>
+double run(const std::string& text, const std::size_t copy_count)
+{
+	using optional_type = cow::optional<String>;
+
+	const optional_type value{cow::in_place, text.c_str()};
+	std::vector<optional_type> copies(copy_count);
+	std::size_t size = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (optional_type& copy : copies) {
+		copy = value;
+		size += copy.value().size();
+	}
+	const auto finish = std::chrono::steady_clock::now();
+
+	const double seconds = std::chrono::duration<double>(finish - start).count();
+	return static_cast<double>(copy_count) / seconds + static_cast<double>(size % 2);
+}
+
+void print(const char* const name, const double copies)
+{
+	std::cout << name << ": " << copies << " copies/s\n";
+}
+
+} // namespace
+
+int main(const int argc, char* argv[])
+{
+	const std::size_t copy_count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	const std::size_t long_size = argc > 2 ? std::stoul(argv[2]) : 100;
+
+	const std::string short_text(8, 's');
+	const std::string long_text(long_size, 'l');
+
+	std::cout << "copies: " << copy_count << ", long string size: " << long_size << '\n';
+	print("optional<std::string> short", run<std::string>(short_text, copy_count));
+	print("optional<cow::string> short", run<cow::string>(short_text, copy_count));
+	print("optional<std::string> long", run<std::string>(long_text, copy_count));
+	print("optional<cow::string> long", run<cow::string>(long_text, copy_count));
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+// Measures the time of taking snapshots of a vector and changing one element of each snapshot.
+// Usage: vector_benchmark [element count] [snapshot count]
+#include <cow/flex_vector.h>
+#include <cow/vector.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void set(std::vector<int>& value, const std::size_t pos, const int element)
+{
+	value[pos] = element;
+}
+
+template<typename T, std::size_t ChunkSize, typename Storage>
+void set(cow::vector<T, ChunkSize, Storage>& value, const std::size_t pos, const int element)
+{
+	value.set(pos, element);
+}
+
+template<typename T, std::size_t Bits, typename Storage>
+void set(cow::flex_vector<T, Bits, Storage>& value, const std::size_t pos, const int element)
+{
+	value.set(pos, element);
+}
+
+// returns the number of snapshots per second, each snapshot is copied from the previous one and one element is changed
+template<typename Vector>
+double run(const std::size_t element_count, const std::size_t snapshot_count)
+{
+	Vector value;
+	for (std::size_t i = 0; i != element_count; ++i)
+		value.push_back(static_cast<int>(i));
+
+	std::vector<Vector> snapshots;
+	snapshots.reserve(snapshot_count);
+
+	const auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i != snapshot_count; ++i) {
+		snapshots.push_back(value);
+		const std::size_t pos = i * 7919 % element_count;
+		set(value, pos, static_cast<int>(i));
+	}
+	const auto finish = std::chrono::steady_clock::now();
+
+	const double seconds = std::chrono::duration<double>(finish - start).count();
+	return static_cast<double>(snapshot_count) / seconds;
+}
+
+void print(const char* const name, const double snapshots)
+{
+	std::cout << name << ": " << snapshots << " snapshots/s\n";
+}
+
+} // namespace
+
+int main(const int argc, char* argv[])
+{
+	const std::size_t element_count = argc > 1 ? std::stoul(argv[1]) : 100000;
+	const std::size_t snapshot_count = argc > 2 ? std::stoul(argv[2]) : 1000;
+
+	std::cout << "elements: " << element_count << ", snapshots: " << snapshot_count << '\n';
+	print("std::vector", run<std::vector<int>>(element_count, snapshot_count));
+	print("cow::vector", run<cow::vector<int>>(element_count, snapshot_count));
+	print(
+		"cow::vector with single_thread_storage",
+		run<cow::vector<int, 256, cow::single_thread_storage>>(element_count, snapshot_count));
+	print("cow::flex_vector", run<cow::flex_vector<int>>(element_count, snapshot_count));
+
+	return EXIT_SUCCESS;
+}
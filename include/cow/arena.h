@@ -0,0 +1,284 @@
+#pragma once
+#include "detail/compatibility/compile_features.h"
+#include "optional.h"
+#include "storage.h"
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+synopsis
+
+namespace cow {
+
+/// Monotonic memory arena. It allocates memory by moving the pointer inside big chunks and frees all chunks at once
+/// when it is destroyed. The memory of freed objects is not reused. The arena can not be used by several threads
+/// at once.
+class arena {
+public:
+	/// Makes `arena` the current arena of the thread until the scope is destroyed.
+	class scope {
+	public:
+		explicit scope(arena& arena) noexcept;
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+		~scope();
+	};
+
+	/// \param chunk_size The size of the chunks requested from `operator new`. Bigger allocations get their own
+	///                   chunks.
+	explicit arena(std::size_t chunk_size = 64 * 1024);
+	arena(const arena&) = delete;
+	arena& operator=(const arena&) = delete;
+
+	/// Frees all memory allocated by the arena. The destructors of the objects kept in the arena are not called,
+	/// so the values with non-trivial destructors must be destroyed before. The values of `monotonic_arena_storage`
+	/// with trivial destructors do not have to be released.
+	~arena();
+
+	void* allocate(std::size_t size, std::size_t alignment);
+
+	/// \return The total size of the chunks allocated by the arena.
+	std::size_t capacity() const noexcept;
+
+	/// \return The current arena of the thread or nullptr if there is no arena scope.
+	static arena* current() noexcept;
+};
+
+/// Allocator which allocates memory from `arena` and does not free it. The default constructed allocator uses
+/// the current arena of the thread. If the arena is nullptr, the memory is allocated and freed by `std::allocator`.
+template<typename T>
+class arena_allocator {
+public:
+	using value_type = T;
+
+	arena_allocator() noexcept;
+	explicit arena_allocator(arena* arena) noexcept;
+	template<typename U>
+	arena_allocator(const arena_allocator<U>& other) noexcept;
+
+	T* allocate(std::size_t n);
+	void deallocate(T* p, std::size_t n) noexcept;
+
+	arena* get_arena() const noexcept;
+};
+
+template<typename T, typename U>
+bool operator==(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) noexcept;
+template<typename T, typename U>
+bool operator!=(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) noexcept;
+
+/// Storage policy which allocates shared values from the arena. The arena must outlive the values.
+/// The values created without an allocator (for example by `make_optional`) are allocated from the current arena of
+/// the thread.
+using arena_storage = basic_intrusive_storage<atomic_ref_count, arena_allocator<char>>;
+
+template<typename T>
+using arena_optional = basic_optional<T, arena_storage>;
+
+/// Storage policy for values which are thrown away with their arena. The values of trivially destructible types are
+/// never released: releasing them does not change the reference counter and does not call the destructor, only
+/// copies change the counter. So a value which has been copied once is copied by the next writes even if its copies
+/// are destroyed. These values must be allocated from an arena (by the allocator or in an arena scope), the values of
+/// other types are kept as with `arena_storage`.
+struct monotonic_arena_storage;
+
+template<typename T>
+using monotonic_arena_optional = basic_optional<T, monotonic_arena_storage>;
+
+} // namespace cow
+*/
+
+namespace cow {
+
+class arena {
+	struct chunk {
+		chunk* next;
+		std::size_t size;
+	};
+
+public:
+	class scope {
+	public:
+		explicit scope(arena& arena) noexcept
+			: previous_{std::exchange(current_ref(), &arena)}
+		{}
+
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+
+		~scope()
+		{
+			current_ref() = previous_;
+		}
+
+	private:
+		arena* const previous_;
+	};
+
+	explicit arena(const std::size_t chunk_size = 64 * 1024)
+		: chunk_size_{chunk_size}
+	{}
+
+	arena(const arena&) = delete;
+	arena& operator=(const arena&) = delete;
+
+	~arena()
+	{
+		while (chunks_) {
+			chunk* const next = chunks_->next;
+			::operator delete(chunks_);
+			chunks_ = next;
+		}
+	}
+
+	COW_NODISCARD void* allocate(const std::size_t size, const std::size_t alignment)
+	{
+		void* result = position_;
+		std::size_t space = static_cast<std::size_t>(end_ - position_);
+		if (!std::align(alignment, size, result, space)) {
+			add_chunk(size + alignment);
+			result = position_;
+			space = static_cast<std::size_t>(end_ - position_);
+			static_cast<void>(std::align(alignment, size, result, space));
+		}
+
+		position_ = static_cast<char*>(result) + size;
+		return result;
+	}
+
+	COW_NODISCARD std::size_t capacity() const noexcept
+	{
+		return capacity_;
+	}
+
+	COW_NODISCARD static arena* current() noexcept
+	{
+		return current_ref();
+	}
+
+private:
+	static arena*& current_ref() noexcept
+	{
+		static thread_local arena* current = nullptr;
+		return current;
+	}
+
+	void add_chunk(const std::size_t min_size)
+	{
+		const std::size_t size = sizeof(chunk) + (min_size < chunk_size_ ? chunk_size_ : min_size);
+		chunks_ = ::new (::operator new(size)) chunk{chunks_, size};
+		capacity_ += size;
+		position_ = reinterpret_cast<char*>(chunks_ + 1); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		end_ = reinterpret_cast<char*>(chunks_) + size; // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	}
+
+	std::size_t chunk_size_;
+	std::size_t capacity_ = 0;
+	chunk* chunks_ = nullptr;
+	char* position_ = nullptr;
+	char* end_ = nullptr;
+};
+
+template<typename T>
+class arena_allocator {
+	template<typename>
+	friend class arena_allocator;
+
+public:
+	using value_type = T;
+
+	arena_allocator() noexcept
+		: arena_{arena::current()}
+	{}
+
+	explicit arena_allocator(arena* const arena) noexcept
+		: arena_{arena}
+	{}
+
+	template<typename U>
+	arena_allocator(const arena_allocator<U>& other) noexcept // NOLINT: Allow implicit conversion
+		: arena_{other.arena_}
+	{}
+
+	COW_NODISCARD T* allocate(const std::size_t n)
+	{
+		if (!arena_)
+			return std::allocator<T>{}.allocate(n);
+
+		if (n > static_cast<std::size_t>(-1) / sizeof(T))
+			throw std::bad_alloc{};
+
+		return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* const p, const std::size_t n) noexcept
+	{
+		// the memory of the arena is freed only by the arena
+		if (!arena_)
+			std::allocator<T>{}.deallocate(p, n);
+	}
+
+	COW_NODISCARD arena* get_arena() const noexcept
+	{
+		return arena_;
+	}
+
+private:
+	arena* arena_;
+};
+
+template<typename T, typename U>
+COW_NODISCARD bool operator==(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) noexcept
+{
+	return lhs.get_arena() == rhs.get_arena();
+}
+
+template<typename T, typename U>
+COW_NODISCARD bool operator!=(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) noexcept
+{
+	return !(lhs == rhs);
+}
+
+using arena_storage = basic_intrusive_storage<atomic_ref_count, arena_allocator<char>>;
+
+template<typename T>
+using arena_optional = basic_optional<T, arena_storage>;
+
+namespace detail {
+
+// the memory of the values which are never released must be freed by the arena
+template<typename T>
+class monotonic_arena_allocator : public arena_allocator<T> {
+public:
+	using arena_allocator<T>::arena_allocator;
+
+	template<typename U>
+	monotonic_arena_allocator(const monotonic_arena_allocator<U>& other) noexcept // NOLINT: Allow implicit conversion
+		: arena_allocator<T>{other}
+	{}
+
+	COW_NODISCARD T* allocate(const std::size_t n)
+	{
+		assert(this->get_arena() && "The value which is never released must be allocated from an arena");
+		return arena_allocator<T>::allocate(n);
+	}
+};
+
+} // namespace detail
+
+struct monotonic_arena_storage {
+	template<typename T>
+	using pointer = std::conditional_t<
+		std::is_trivially_destructible<T>::value,
+		detail::intrusive_ptr<T, detail::monotonic_ref_count, detail::monotonic_arena_allocator<char>>,
+		arena_storage::pointer<T>>;
+};
+
+template<typename T>
+using monotonic_arena_optional = basic_optional<T, monotonic_arena_storage>;
+
+} // namespace cow
@@ -0,0 +1,265 @@
+#pragma once
+#include "detail/compatibility/compile_features.h"
+#include "optional.h"
+#include "storage.h"
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+/*
+synopsis
+
+namespace cow {
+
+/// The class `atomic_optional` keeps the shared value of `optional` which can be loaded and replaced by several
+/// threads at once without locks. `load` returns a snapshot which is not affected by following stores.
+/// With `snapshot_ref_count` (the default) and `deferred_ref_count` the thread reuses the references of the snapshots
+/// it has released, so the threads which repeatedly load the same value do not write to shared memory. With
+/// `atomic_ref_count` each load changes the cell and each released snapshot changes the reference counter of the value.
+/// \tparam T Value type.
+/// \tparam Storage Storage policy of the shared value. It must be `basic_intrusive_storage` with `snapshot_ref_count`,
+///                 `deferred_ref_count` or `atomic_ref_count` (optionally wrapped in `cache_line_padded`).
+template<typename T, typename Storage = snapshot_storage>
+class atomic_optional {
+public:
+	using value_type = optional<T, false, Storage>;
+
+	constexpr atomic_optional() noexcept;
+	atomic_optional(value_type value) noexcept;
+	atomic_optional(const atomic_optional&) = delete;
+	atomic_optional& operator=(const atomic_optional&) = delete;
+	~atomic_optional();
+
+	/// Same as `store(value)`.
+	atomic_optional& operator=(value_type value) noexcept;
+
+	/// Same as `load()`.
+	operator value_type() const noexcept;
+
+	value_type load() const noexcept;
+	void store(value_type value) noexcept;
+	value_type exchange(value_type value) noexcept;
+
+	/// Replaces the value by `desired` if this object shares the value with `expected` or both are empty.
+	/// Otherwise loads the value to `expected`.
+	/// \return true if the value is replaced.
+	bool compare_exchange(value_type& expected, value_type desired) noexcept;
+
+	bool is_lock_free() const noexcept;
+};
+
+} // namespace cow
+*/
+
+namespace cow {
+
+template<typename T, typename Storage = snapshot_storage>
+class atomic_optional {
+	using pointer = typename Storage::template pointer<T>;
+	using block_pointer = typename pointer::block_pointer;
+
+	static_assert(
+		std::is_base_of<atomic_ref_count, typename pointer::ref_count_type>::value
+			|| std::is_base_of<snapshot_ref_count, typename pointer::ref_count_type>::value
+			|| std::is_base_of<deferred_ref_count, typename pointer::ref_count_type>::value,
+		"atomic_optional requires intrusive storage with atomic_ref_count, snapshot_ref_count or deferred_ref_count");
+	static_assert(sizeof(block_pointer) <= sizeof(std::uint64_t), "Unsupported size of pointer");
+
+public:
+	using value_type = optional<T, false, Storage>;
+
+	constexpr atomic_optional() noexcept = default;
+
+	atomic_optional(value_type value) noexcept // NOLINT: Allow implicit conversion
+		: cell_{make_word(std::move(value))}
+	{}
+
+	atomic_optional(const atomic_optional&) = delete;
+	atomic_optional& operator=(const atomic_optional&) = delete;
+
+	~atomic_optional()
+	{
+		release_word(cell_.load(std::memory_order_relaxed));
+	}
+
+	atomic_optional& operator=(value_type value) noexcept
+	{
+		store(std::move(value));
+		return *this;
+	}
+
+	operator value_type() const noexcept // NOLINT: Allow implicit conversion
+	{
+		return load();
+	}
+
+	COW_NODISCARD value_type load() const noexcept
+	{
+		// the local count of the empty cell is not used, so it is not increased without need
+		const block_pointer current = get_block(cell_.load(std::memory_order_acquire));
+		if (current == nullptr)
+			return value_type{};
+
+		// the reference released by this thread keeps the block alive, so it is the value of the cell
+		if (reuse_released(current))
+			return make_value(pointer::adopt_block(current));
+
+		const word_type word = cell_.fetch_add(count_unit, std::memory_order_acquire);
+		const block_pointer block = get_block(word);
+		if (!block)
+			return value_type{};
+
+		if (get_count(word) + 1 >= refill_threshold)
+			refill(block);
+
+		keep_released(block, block);
+		return make_value(pointer::adopt_block(block));
+	}
+
+	void store(value_type value) noexcept
+	{
+		static_cast<void>(exchange(std::move(value)));
+	}
+
+	COW_NODISCARD value_type exchange(value_type value) noexcept
+	{
+		return take_word(cell_.exchange(make_word(std::move(value)), std::memory_order_acq_rel));
+	}
+
+	bool compare_exchange(value_type& expected, value_type desired) noexcept
+	{
+		const word_type desired_word = make_word(std::move(desired));
+		word_type word = cell_.load(std::memory_order_relaxed);
+		do {
+			if (get_block(word) != expected.data_.get_block()) {
+				release_word(desired_word);
+				expected = load();
+				return false;
+			}
+		} while (!cell_.compare_exchange_weak(word, desired_word, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+		release_word(word);
+		return true;
+	}
+
+	COW_NODISCARD bool is_lock_free() const noexcept
+	{
+		return cell_.is_lock_free();
+	}
+
+private:
+	// The cell keeps the pointer to the block in the low bits and the local count of references in the high bits.
+	// Pointers must fit into 48 bits, it is true for user space addresses on x86-64 and AArch64.
+	// The cell owns `batch_size - local count` references to the block. A reader takes one of them by the increment
+	// of the local count, so readers do not change the reference counter of the block. When the local count becomes
+	// large, the reader adds the local count to the reference counter and resets it.
+	using word_type = std::uint64_t;
+
+	static constexpr unsigned count_shift = 48;
+	static constexpr word_type count_unit = word_type{1} << count_shift;
+	static constexpr word_type pointer_mask = count_unit - 1;
+	static constexpr std::size_t batch_size = 0xFFFF;
+	static constexpr std::size_t refill_threshold = 0x1000;
+
+	static block_pointer get_block(const word_type word) noexcept
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+		return reinterpret_cast<block_pointer>(static_cast<std::uintptr_t>(word & pointer_mask));
+	}
+
+	static std::size_t get_count(const word_type word) noexcept
+	{
+		return static_cast<std::size_t>(word >> count_shift);
+	}
+
+	static word_type make_word(const block_pointer block) noexcept
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		const auto word = static_cast<word_type>(reinterpret_cast<std::uintptr_t>(block));
+		assert((word & ~pointer_mask) == 0 && "The pointer does not fit into 48 bits");
+		return word;
+	}
+
+	// takes the reference of `value` and adds other references owned by the cell
+	static word_type make_word(value_type&& value) noexcept
+	{
+		const block_pointer block = value.data_.release_block();
+		if (block)
+			pointer::add_block_refs(block, batch_size - 1);
+
+		return make_word(block);
+	}
+
+	// releases the references owned by the cell
+	static void release_word(const word_type word) noexcept
+	{
+		if (const block_pointer block = get_block(word))
+			pointer::release_block_refs(block, batch_size - get_count(word));
+	}
+
+	// passes one of the references owned by the cell to the result and releases the others
+	static value_type take_word(const word_type word) noexcept
+	{
+		const block_pointer block = get_block(word);
+		if (!block)
+			return value_type{};
+
+		const std::size_t references = batch_size - get_count(word);
+		if (references > 1)
+			pointer::release_block_refs(block, references - 1);
+
+		return make_value(pointer::adopt_block(block));
+	}
+
+	// `snapshot_ref_count` and `deferred_ref_count` let the thread keep the references of the snapshots it releases.
+	// The loads of the thread reuse them, so the reading thread does not change the cell and the counter while the value
+	// is the same.
+	static void keep_released(block_pointer /*block*/, atomic_ref_count* /*counter*/) noexcept
+	{}
+
+	static bool reuse_released(const atomic_ref_count* /*counter*/) noexcept
+	{
+		return false;
+	}
+
+	template<typename Counter>
+	static void keep_released(const block_pointer block, detail::kept_ref_count<Counter>* /*counter*/) noexcept
+	{
+		pointer::keep_released_block_refs(block);
+	}
+
+	template<typename Counter>
+	static bool reuse_released(const detail::kept_ref_count<Counter>* const counter) noexcept
+	{
+		return detail::kept_ref_count<Counter>::reuse_released(counter);
+	}
+
+	static value_type make_value(pointer data) noexcept
+	{
+		value_type value;
+		value.data_ = std::move(data);
+		return value;
+	}
+
+	// moves the local count of the cell to the reference counter of the block
+	void refill(const block_pointer block) const noexcept
+	{
+		word_type word = cell_.load(std::memory_order_relaxed);
+		while (get_block(word) == block && get_count(word) >= refill_threshold) {
+			const std::size_t count = get_count(word);
+			pointer::add_block_refs(block, count);
+			if (cell_.compare_exchange_weak(word, make_word(block), std::memory_order_release, std::memory_order_relaxed))
+				return;
+
+			// the reader holds the reference to the block, so it is not destroyed here
+			pointer::release_block_refs(block, count);
+		}
+	}
+
+	mutable std::atomic<word_type> cell_{0};
+};
+
+} // namespace cow
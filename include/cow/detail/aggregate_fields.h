@@ -0,0 +1,134 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include "compatibility/type_traits.h"
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace cow {
+namespace detail {
+
+/// The aggregates with more fields are not inspected.
+constexpr std::size_t max_aggregate_fields = 32;
+
+template<typename>
+struct accept_any : std::true_type {};
+
+template<template<typename> class Predicate>
+struct negation_of {
+	template<typename U>
+	using type = compatibility::bool_constant<!Predicate<U>::value>;
+};
+
+// Converts to the types accepted by `Accept`. The conversion to other types is deleted instead of being excluded, so
+// the field of an aggregate type is not initialized through brace elision. The field can not be copied, so it is not
+// accepted by converting constructors of the field types which require a copyable argument (like `std::any`).
+template<template<typename> class Accept>
+struct field {
+	field() = default;
+	field(const field&) = delete;
+	field& operator=(const field&) = delete;
+	~field() = default;
+
+	template<typename U, std::enable_if_t<Accept<U>::value, int> = 0>
+	operator U() const noexcept; // NOLINT: Allow implicit conversion
+
+	template<typename U, std::enable_if_t<!Accept<U>::value, int> = 0>
+	operator U() const = delete; // NOLINT: Allow implicit conversion
+};
+
+template<typename... Fields>
+struct field_list {};
+
+// GCC warns when a converting constructor of the field type is chosen over the conversion function of the field,
+// but such constructors are expected here
+#if defined(__GNUC__) && !defined(__clang__)
+#	pragma GCC diagnostic push
+#	pragma GCC diagnostic ignored "-Wconversion"
+#endif
+
+template<typename T, typename Fields, typename = void>
+struct is_initializable_by : std::false_type {};
+
+template<typename T, typename... Fields>
+struct is_initializable_by<T, field_list<Fields...>, compatibility::void_t<decltype(T{Fields{}...})>>
+	: std::true_type {};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#	pragma GCC diagnostic pop
+#endif
+
+template<typename Field, std::size_t>
+using indexed_field = Field;
+
+template<typename T, typename Field, typename Indices>
+struct is_initializable_by_fields;
+
+template<typename T, typename Field, std::size_t... Indices>
+struct is_initializable_by_fields<T, Field, std::index_sequence<Indices...>>
+	: is_initializable_by<T, field_list<indexed_field<Field, Indices>...>> {};
+
+// The greatest N not greater than `Count` such that T can be initialized by N fields of any type. It is the number
+// of fields of the aggregate (the elements of arrays are counted as fields).
+template<
+	typename T,
+	std::size_t Count,
+	bool = is_initializable_by_fields<T, field<accept_any>, std::make_index_sequence<Count>>::value>
+struct aggregate_field_count : std::integral_constant<std::size_t, Count> {};
+
+template<typename T, std::size_t Count>
+struct aggregate_field_count<T, Count, false> : aggregate_field_count<T, Count - 1> {};
+
+template<typename T>
+struct aggregate_field_count<T, 0, false> : std::integral_constant<std::size_t, 0> {};
+
+// true if the field `Index` can be initialized by an object which converts only to the types which do not satisfy
+// `Predicate`, it catches the field types with converting constructor templates (like `std::variant`)
+template<template<typename> class Predicate, typename T, std::size_t Index, typename Indices>
+struct accepts_violating_field;
+
+template<template<typename> class Predicate, typename T, std::size_t Index, std::size_t... Indices>
+struct accepts_violating_field<Predicate, T, Index, std::index_sequence<Indices...>>
+	: is_initializable_by<
+		T,
+		field_list<std::conditional_t<
+			Indices == Index,
+			field<negation_of<Predicate>::template type>,
+			field<accept_any>>...>> {};
+
+template<template<typename> class Predicate, typename T, typename Indices>
+struct all_fields_satisfy;
+
+template<template<typename> class Predicate, typename T, std::size_t... Indices>
+struct all_fields_satisfy<Predicate, T, std::index_sequence<Indices...>>
+	: compatibility::conjunction<
+		is_initializable_by_fields<T, field<Predicate>, std::index_sequence<Indices...>>,
+		compatibility::bool_constant<!accepts_violating_field<
+			Predicate, T, Indices, std::index_sequence<Indices...>>::value>...> {};
+
+template<
+	template<typename> class Predicate,
+	typename T,
+	std::size_t Count = aggregate_field_count<T, max_aggregate_fields + 1>::value,
+	bool = Count != 0 && Count <= max_aggregate_fields>
+struct inspected_fields_satisfy : std::false_type {};
+
+template<template<typename> class Predicate, typename T, std::size_t Count>
+struct inspected_fields_satisfy<Predicate, T, Count, true>
+	: all_fields_satisfy<Predicate, T, std::make_index_sequence<Count>> {};
+
+/// It is true if T is a copyable aggregate (but not a union) and the types of all its fields satisfy `Predicate`.
+/// The fields are found by the aggregate initialization of T, so the fields of base classes are inspected as one field
+/// of the base class type. If the compiler does not support `is_aggregate`, the value is always false.
+template<
+	template<typename> class Predicate,
+	typename T,
+	bool = compatibility::is_aggregate<T>::value && !std::is_union<T>::value && std::is_copy_constructible<T>::value
+		&& std::is_copy_assignable<T>::value>
+struct aggregate_fields_satisfy : std::false_type {};
+
+template<template<typename> class Predicate, typename T>
+struct aggregate_fields_satisfy<Predicate, T, true> : inspected_fields_satisfy<Predicate, T> {};
+
+} // namespace detail
+} // namespace cow
@@ -0,0 +1,39 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include <type_traits>
+
+namespace cow {
+namespace detail {
+
+/// Keeps a copy of the allocator. Empty allocators take no space in derived classes.
+template<typename Allocator, bool = std::is_empty<Allocator>::value && !std::is_final<Allocator>::value>
+class allocator_holder : private Allocator {
+public:
+	explicit allocator_holder(const Allocator& allocator) noexcept
+		: Allocator(allocator)
+	{}
+
+	COW_NODISCARD const Allocator& get_allocator() const noexcept
+	{
+		return *this;
+	}
+};
+
+template<typename Allocator>
+class allocator_holder<Allocator, false> {
+public:
+	explicit allocator_holder(const Allocator& allocator) noexcept
+		: allocator_(allocator)
+	{}
+
+	COW_NODISCARD const Allocator& get_allocator() const noexcept
+	{
+		return allocator_;
+	}
+
+private:
+	Allocator allocator_;
+};
+
+} // namespace detail
+} // namespace cow
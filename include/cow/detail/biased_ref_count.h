@@ -0,0 +1,295 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace cow {
+namespace detail {
+
+class biased_ref_count;
+
+/// The record of a thread which owns biased reference counters.
+/// It keeps the queue of counters which must be merged by the owner thread.
+class biased_owner {
+public:
+	biased_owner(const biased_owner&) = delete;
+	biased_owner& operator=(const biased_owner&) = delete;
+
+	/// \return The record of the current thread or nullptr if the thread has not created biased counters yet.
+	COW_NODISCARD static biased_owner* current() noexcept
+	{
+		return current_ref();
+	}
+
+	/// Adds a reference to the record of the current thread. The record is created if it does not exist.
+	/// \return The record of the current thread or nullptr if the thread is finishing.
+	static biased_owner* acquire();
+
+	void release() noexcept
+	{
+		if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			delete this;
+	}
+
+	/// Passes the counter to the owner thread to merge. The counter is merged immediately if the owner thread has
+	/// finished.
+	void enqueue(biased_ref_count* counter) noexcept;
+
+	/// \return true if the owner thread has finished, so biased parts of its counters can not change anymore.
+	COW_NODISCARD bool has_finished() const noexcept
+	{
+		return queue_.load(std::memory_order_acquire) == finished();
+	}
+
+	/// Merges all queued counters. It must be called by the owner thread.
+	void merge_queued() noexcept
+	{
+		if (queue_.load(std::memory_order_relaxed))
+			merge(queue_.exchange(nullptr, std::memory_order_acquire));
+	}
+
+private:
+	struct thread_guard;
+
+	biased_owner() = default;
+	~biased_owner() = default;
+
+	static biased_owner*& current_ref() noexcept
+	{
+		static thread_local biased_owner* current = nullptr;
+		return current;
+	}
+
+	// the queue head of the finished thread, it is never a valid address of a counter
+	static biased_ref_count* finished() noexcept;
+
+	static void merge(biased_ref_count* counters) noexcept;
+
+	void finish() noexcept
+	{
+		merge_queued();
+		merge(queue_.exchange(finished(), std::memory_order_acq_rel));
+		release();
+	}
+
+	// one reference is held by the thread and one by each counter
+	std::atomic<std::size_t> refs_{1};
+	std::atomic<biased_ref_count*> queue_{nullptr};
+};
+
+struct biased_owner::thread_guard {
+	thread_guard() = default;
+	thread_guard(const thread_guard&) = delete;
+	thread_guard& operator=(const thread_guard&) = delete;
+
+	~thread_guard()
+	{
+		finishing = true;
+		biased_owner*& current = current_ref();
+		if (current)
+			std::exchange(current, nullptr)->finish();
+	}
+
+	bool finishing = false;
+};
+
+/// Biased reference counter of a shared block.
+/// The thread which creates the counter (the owner) changes the biased part of the counter without atomic
+/// read-modify-write operations. Other threads change the shared part atomically. When the biased part becomes zero
+/// the owner merges it into the shared part and after that the counter works as an ordinary atomic counter.
+/// If other threads release more references than they added, the counter is queued to the owner thread which merges
+/// it when it releases any of its own references, calls `merge_queued()` or finishes.
+class biased_ref_count {
+	friend class biased_owner;
+
+public:
+	using disposer = void (*)(biased_ref_count*);
+
+	biased_ref_count()
+		: owner_{biased_owner::acquire()}
+	{
+		if (owner_)
+			biased_.store(1, std::memory_order_relaxed);
+		else
+			shared_.store(unit | merged_flag, std::memory_order_relaxed);
+	}
+
+	biased_ref_count(const biased_ref_count&) = delete;
+	biased_ref_count& operator=(const biased_ref_count&) = delete;
+
+	~biased_ref_count()
+	{
+		if (owner_)
+			owner_->release();
+	}
+
+	void add_ref() noexcept
+	{
+		if (owned())
+			biased_.store(biased_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		else
+			shared_.fetch_add(unit, std::memory_order_relaxed);
+	}
+
+	void release(const disposer dispose) noexcept
+	{
+		if (!owned()) {
+			release_shared(dispose);
+			return;
+		}
+
+		biased_owner* const owner = owner_;
+		const std::size_t biased = biased_.load(std::memory_order_relaxed) - 1;
+		biased_.store(biased, std::memory_order_relaxed);
+		if (biased == 0)
+			merge(dispose, false);
+
+		owner->merge_queued();
+	}
+
+	COW_NODISCARD bool unique() const noexcept
+	{
+		const std::intptr_t shared = shared_.load(std::memory_order_acquire);
+		if ((shared & merged_flag) != 0)
+			return count(shared) == 1;
+
+		// references released by the owner thread are visible to other threads only after the merge
+		// or after the owner thread has finished
+		if (owned() || owner_->has_finished())
+			return static_cast<std::intptr_t>(biased_.load(std::memory_order_relaxed)) + count(shared) == 1;
+
+		return false;
+	}
+
+	COW_NODISCARD std::size_t use_count() const noexcept
+	{
+		const std::intptr_t shared = shared_.load(std::memory_order_acquire);
+		const std::intptr_t biased = static_cast<std::intptr_t>(biased_.load(std::memory_order_relaxed));
+		return static_cast<std::size_t>(biased + count(shared));
+	}
+
+	/// Merges the counters which were queued to the current thread by other threads.
+	static void merge_queued() noexcept
+	{
+		if (biased_owner* const owner = biased_owner::current())
+			owner->merge_queued();
+	}
+
+private:
+	static constexpr std::intptr_t merged_flag = 1;
+	static constexpr std::intptr_t queued_flag = 2;
+	static constexpr std::intptr_t flags_mask = merged_flag | queued_flag;
+	static constexpr std::intptr_t unit = 4;
+
+	static std::intptr_t count(const std::intptr_t shared) noexcept
+	{
+		return (shared - (shared & flags_mask)) / unit;
+	}
+
+	COW_NODISCARD bool owned() const noexcept
+	{
+		return owner_ && owner_ == biased_owner::current() && !owner_merged_;
+	}
+
+	// Moves the biased part to the shared part. If `force` is false and the counter is queued, the merge is left to
+	// the queue processing.
+	void merge(const disposer dispose, const bool force) noexcept
+	{
+		owner_merged_ = true;
+		const auto biased = static_cast<std::intptr_t>(biased_.load(std::memory_order_relaxed));
+		biased_.store(0, std::memory_order_relaxed);
+
+		std::intptr_t shared = shared_.load(std::memory_order_relaxed);
+		std::intptr_t desired = 0;
+		do {
+			if (!force && (shared & queued_flag) != 0)
+				return;
+
+			desired = (shared + biased * unit) | merged_flag;
+		} while (!shared_.compare_exchange_weak(
+			shared, desired, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+		if (count(desired) == 0)
+			dispose(this);
+	}
+
+	void release_shared(const disposer dispose) noexcept
+	{
+		std::intptr_t shared = shared_.load(std::memory_order_relaxed);
+		std::intptr_t desired = 0;
+		do {
+			desired = shared - unit;
+			// the owner thread holds more references than it counts, it has to merge the counter
+			if ((desired & flags_mask) == 0 && count(desired) < 0)
+				desired |= queued_flag;
+		} while (!shared_.compare_exchange_weak(
+			shared, desired, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+		if ((desired & merged_flag) != 0) {
+			if (count(desired) == 0)
+				dispose(this);
+		}
+		else if ((desired & queued_flag) != 0 && (shared & queued_flag) == 0) {
+			dispose_ = dispose;
+			owner_->enqueue(this);
+		}
+	}
+
+	biased_owner* const owner_;
+	// the fields below are changed only by the owner thread (or by any thread after the owner has finished)
+	std::atomic<std::size_t> biased_{0};
+	bool owner_merged_ = false;
+	biased_ref_count* next_queued_ = nullptr;
+	disposer dispose_ = nullptr;
+	// the shared part: the count multiplied by `unit` and the flags
+	std::atomic<std::intptr_t> shared_{0};
+};
+
+inline biased_ref_count* biased_owner::finished() noexcept
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+	return reinterpret_cast<biased_ref_count*>(alignof(biased_ref_count));
+}
+
+inline biased_owner* biased_owner::acquire()
+{
+	biased_owner*& current = current_ref();
+	if (!current) {
+		static thread_local thread_guard guard;
+		if (guard.finishing)
+			return nullptr;
+
+		current = new biased_owner;
+	}
+
+	current->refs_.fetch_add(1, std::memory_order_relaxed);
+	return current;
+}
+
+inline void biased_owner::enqueue(biased_ref_count* const counter) noexcept
+{
+	biased_ref_count* head = queue_.load(std::memory_order_acquire);
+	do {
+		if (head == finished()) {
+			// the owner thread has finished, so the biased part can not be changed anymore
+			counter->merge(counter->dispose_, true);
+			return;
+		}
+
+		counter->next_queued_ = head;
+	} while (!queue_.compare_exchange_weak(head, counter, std::memory_order_release, std::memory_order_acquire));
+}
+
+inline void biased_owner::merge(biased_ref_count* counters) noexcept
+{
+	while (counters) {
+		biased_ref_count* const counter = counters;
+		counters = counter->next_queued_;
+		counter->merge(counter->dispose_, true);
+	}
+}
+
+} // namespace detail
+} // namespace cow
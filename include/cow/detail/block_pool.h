@@ -0,0 +1,282 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace cow {
+namespace detail {
+
+/// The list of all pools which allows to return the memory cached by them to the system.
+class pool_registry {
+public:
+	using trimmer = void (*)();
+
+	pool_registry(const pool_registry&) = delete;
+	pool_registry& operator=(const pool_registry&) = delete;
+
+	static pool_registry& instance()
+	{
+		static pool_registry registry;
+		return registry;
+	}
+
+	void add(const trimmer trim)
+	{
+		const std::lock_guard<std::mutex> lock{mutex_};
+		trimmers_.push_back(trim);
+	}
+
+	/// Calls `trim` of all pools.
+	void trim() noexcept
+	{
+		const std::lock_guard<std::mutex> lock{mutex_};
+		for (const trimmer trim : trimmers_)
+			trim();
+	}
+
+private:
+	pool_registry() = default;
+	~pool_registry() = default;
+
+	std::mutex mutex_;
+	std::vector<trimmer> trimmers_;
+};
+
+/// Pool of memory blocks of `Size` bytes. Each thread keeps up to `CacheSize` freed blocks in its own cache and
+/// reuses them without synchronization. When the cache is full, half of it is moved to the depot shared by all
+/// threads, and an empty cache takes the blocks from the depot, so the blocks freed by one thread can be reused by
+/// another one. The depot keeps up to `DepotSize` blocks, other blocks are returned to `operator delete`.
+template<std::size_t Size, std::size_t CacheSize, std::size_t DepotSize = 16 * CacheSize>
+class block_pool {
+	static_assert(CacheSize > 1, "The cache must keep at least two blocks");
+
+	struct node {
+		node* next;
+	};
+
+	static constexpr std::size_t block_size = Size < sizeof(node) ? sizeof(node) : Size;
+	static constexpr std::size_t batch_size = CacheSize / 2;
+
+	// the list of free blocks
+	struct free_list {
+		node* head = nullptr;
+		std::size_t size = 0;
+
+		void push(void* const block) noexcept
+		{
+			head = ::new (block) node{head};
+			++size;
+		}
+
+		void* pop() noexcept
+		{
+			node* const block = head;
+			head = block->next;
+			--size;
+			return block;
+		}
+
+		// moves up to `count` blocks to `other`
+		void move_to(free_list& other, const std::size_t count) noexcept
+		{
+			for (std::size_t i = 0; i != count && head; ++i)
+				other.push(pop());
+		}
+
+		void clear() noexcept
+		{
+			while (head)
+				::operator delete(pop());
+		}
+	};
+
+	class depot {
+	public:
+		depot()
+		{
+			pool_registry::instance().add(&block_pool::trim);
+		}
+
+		depot(const depot&) = delete;
+		depot& operator=(const depot&) = delete;
+
+		~depot()
+		{
+			blocks_.clear();
+		}
+
+		// returns the blocks of the cache which do not fit into the depot to `operator delete`
+		void put(free_list& cache, const std::size_t count) noexcept
+		{
+			const std::lock_guard<std::mutex> lock{mutex_};
+			const std::size_t free_space = DepotSize - blocks_.size;
+			cache.move_to(blocks_, count < free_space ? count : free_space);
+		}
+
+		void take(free_list& cache, const std::size_t count) noexcept
+		{
+			const std::lock_guard<std::mutex> lock{mutex_};
+			blocks_.move_to(cache, count);
+		}
+
+		void clear() noexcept
+		{
+			const std::lock_guard<std::mutex> lock{mutex_};
+			blocks_.clear();
+		}
+
+	private:
+		std::mutex mutex_;
+		free_list blocks_;
+	};
+
+	class thread_cache {
+	public:
+		thread_cache()
+			: depot_{get_depot()}
+		{}
+
+		thread_cache(const thread_cache&) = delete;
+		thread_cache& operator=(const thread_cache&) = delete;
+
+		// the blocks of the finished thread can be reused by other threads
+		~thread_cache()
+		{
+			destroyed() = true;
+			depot_.put(blocks_, blocks_.size);
+			blocks_.clear();
+		}
+
+		// the blocks which are freed by destructors of other thread local objects after the cache are not cached
+		static bool& destroyed() noexcept
+		{
+			static thread_local bool value = false;
+			return value;
+		}
+
+		void* allocate()
+		{
+			if (!blocks_.head)
+				depot_.take(blocks_, batch_size);
+
+			return blocks_.head ? blocks_.pop() : ::operator new(block_size);
+		}
+
+		void deallocate(void* const block) noexcept
+		{
+			if (blocks_.size == CacheSize)
+				depot_.put(blocks_, batch_size);
+			if (blocks_.size == CacheSize)
+				::operator delete(blocks_.pop());
+
+			blocks_.push(block);
+		}
+
+		void trim() noexcept
+		{
+			blocks_.clear();
+			depot_.clear();
+		}
+
+	private:
+		// the depot is created before the cache of any thread, so it is destroyed after the cache of the main thread
+		depot& depot_;
+		free_list blocks_;
+	};
+
+	static depot& get_depot()
+	{
+		static depot instance;
+		return instance;
+	}
+
+	static thread_cache& get_cache()
+	{
+		static thread_local thread_cache cache;
+		return cache;
+	}
+
+public:
+	COW_NODISCARD static void* allocate()
+	{
+		return thread_cache::destroyed() ? ::operator new(block_size) : get_cache().allocate();
+	}
+
+	static void deallocate(void* const block) noexcept
+	{
+		if (thread_cache::destroyed())
+			::operator delete(block);
+		else
+			get_cache().deallocate(block);
+	}
+
+	/// Returns the blocks kept by the cache of the current thread and by the depot to `operator delete`.
+	static void trim() noexcept
+	{
+		if (!thread_cache::destroyed())
+			get_cache().trim();
+	}
+};
+
+/// Allocator which allocates single objects from `block_pool` and arrays from `operator new`.
+/// It is stateless, so all its instances are equal.
+template<typename T, std::size_t CacheSize = 64>
+class pool_allocator {
+	using pool = block_pool<sizeof(T), CacheSize>;
+
+	static_assert(
+		alignof(T) <= alignof(std::max_align_t), "pool_allocator does not support over-aligned types");
+
+public:
+	using value_type = T;
+
+	template<typename U>
+	struct rebind {
+		using other = pool_allocator<U, CacheSize>;
+	};
+
+	pool_allocator() noexcept = default;
+
+	template<typename U>
+	pool_allocator(const pool_allocator<U, CacheSize>& /*other*/) noexcept // NOLINT: Allow implicit conversion
+	{}
+
+	COW_NODISCARD T* allocate(const std::size_t n)
+	{
+		return static_cast<T*>(n == 1 ? pool::allocate() : std::allocator<T>{}.allocate(n));
+	}
+
+	void deallocate(T* const p, const std::size_t n) noexcept
+	{
+		if (n == 1)
+			pool::deallocate(p);
+		else
+			std::allocator<T>{}.deallocate(p, n);
+	}
+
+	/// Returns the memory of the freed objects of all types cached by the current thread and by the depots of all
+	/// pools to the system.
+	static void trim() noexcept
+	{
+		pool_registry::instance().trim();
+	}
+
+	template<typename U>
+	constexpr bool operator==(const pool_allocator<U, CacheSize>& /*other*/) const noexcept
+	{
+		return true;
+	}
+
+	template<typename U>
+	constexpr bool operator!=(const pool_allocator<U, CacheSize>& /*other*/) const noexcept
+	{
+		return false;
+	}
+};
+
+} // namespace detail
+} // namespace cow
@@ -0,0 +1,632 @@
+#pragma once
+#include "child_array.h"
+#include "chunk.h"
+#include "compatibility/compile_features.h"
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace cow {
+namespace detail {
+
+/// The number of values in the node of about 512 bytes, but not less than 8 and not greater than 64.
+template<typename T>
+struct default_node_size
+	: std::integral_constant<std::size_t, sizeof(T) <= 512 / 64 ? 64 : (sizeof(T) >= 512 / 8 ? 8 : 512 / sizeof(T))> {};
+
+/// The greatest height of the B+ tree which nodes have at least `min_size` children or values, except the root which
+/// has at least 2 children. The tree of height `h` keeps at least `2 * min_size^(h - 1)` values.
+constexpr std::size_t btree_max_height(const std::size_t min_size) noexcept
+{
+	std::size_t height = 1;
+	for (std::size_t count = 2; count <= std::numeric_limits<std::size_t>::max() / min_size; count *= min_size)
+		++height;
+	return height;
+}
+
+/// B+ tree which keeps the values ordered by their keys in the leaves, the inner nodes keep the keys which separate
+/// their children. The nodes keep up to `NodeSize` values or children and at least a half of them, except the root.
+/// The nodes are kept by the storage policy `Storage` and shared between the copies of the tree. The modifications copy
+/// the shared nodes on the path to the changed value and the siblings which are merged with them or give them values,
+/// the nodes which are owned only by this tree are changed in place. The reading functions do not copy nodes.
+template<typename Key, typename Value, typename KeyOfValue, typename Compare, std::size_t NodeSize, typename Storage>
+class btree {
+	static_assert(NodeSize >= 4, "The node of the B-tree must keep at least 4 values");
+
+public:
+	using size_type = std::size_t;
+
+private:
+	static constexpr size_type min_size = NodeSize / 2;
+	static constexpr size_type max_height = btree_max_height(min_size);
+
+	// the nodes of height 1 keep leaves, the higher nodes keep inner nodes
+	struct inner_node;
+	using leaf_node = chunk<Value, NodeSize>;
+	using leaf_pointer = typename Storage::template pointer<leaf_node>;
+	using inner_pointer = typename Storage::template pointer<inner_node>;
+
+	struct inner_node : child_array<leaf_pointer, inner_pointer, NodeSize> {
+		using child_array<leaf_pointer, inner_pointer, NodeSize>::child_array;
+
+		// the keys of the child `i` are less than `keys[i]`, the keys of the child `i + 1` are not less than it
+		chunk<Key, NodeSize - 1> keys;
+	};
+
+public:
+	class const_iterator {
+		friend class btree;
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = Value;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Value*;
+		using reference = const Value&;
+
+		const_iterator() noexcept = default;
+
+		COW_NODISCARD reference operator*() const noexcept
+		{
+			return (*leaf_)[index_];
+		}
+
+		COW_NODISCARD pointer operator->() const noexcept
+		{
+			return std::addressof(**this);
+		}
+
+		// the next leaf is found by the path to the current leaf
+		const_iterator& operator++() noexcept
+		{
+			if (index_ + 1 < leaf_->size()) {
+				++index_;
+				return *this;
+			}
+
+			for (size_type level = height_; level != 0; --level) {
+				frame& parent = path_[level - 1];
+				if (parent.child + 1 < parent.node->child_count()) {
+					++parent.child;
+					descend(level, false);
+					return *this;
+				}
+			}
+
+			// the end keeps the root, so it can be decremented
+			path_[0].child = path_[0].node->child_count();
+			leaf_ = nullptr;
+			index_ = 0;
+			return *this;
+		}
+
+		const_iterator operator++(int) noexcept
+		{
+			const_iterator result{*this};
+			++*this;
+			return result;
+		}
+
+		const_iterator& operator--() noexcept
+		{
+			if (leaf_ == nullptr) {
+				// the end of the empty tree has no root, it is left as is
+				const inner_node* const root = path_[0].node;
+				if (root == nullptr)
+					return *this;
+
+				path_[0].child = root->child_count() - 1;
+				descend(1, true);
+				return *this;
+			}
+			if (index_ != 0) {
+				--index_;
+				return *this;
+			}
+
+			size_type level = height_;
+			while (path_[level - 1].child == 0)
+				--level;
+			--path_[level - 1].child;
+			descend(level, true);
+			return *this;
+		}
+
+		const_iterator operator--(int) noexcept
+		{
+			const_iterator result{*this};
+			--*this;
+			return result;
+		}
+
+		COW_NODISCARD friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.leaf_ == rhs.leaf_ && lhs.index_ == rhs.index_;
+		}
+
+		COW_NODISCARD friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return !(lhs == rhs);
+		}
+
+	private:
+		// the child of the node on the path to the leaf
+		struct frame {
+			const inner_node* node;
+			size_type child;
+		};
+
+		// the end of the tree of height `height` with the root `root`
+		const_iterator(const inner_node* const root, const size_type height) noexcept
+			: height_{height}
+		{
+			if (root != nullptr)
+				path_[0] = frame{root, root->child_count()};
+		}
+
+		// the nodes of the path below `level` go to the first or the last children of the chosen child of `level - 1`
+		void descend(size_type level, const bool last) noexcept
+		{
+			for (; level != height_; ++level) {
+				const frame& parent = path_[level - 1];
+				const inner_node& node = *parent.node->inners[parent.child];
+				path_[level] = frame{&node, last ? node.child_count() - 1 : 0};
+			}
+
+			const frame& parent = path_[height_ - 1];
+			leaf_ = &*parent.node->leaves[parent.child];
+			index_ = last ? leaf_->size() - 1 : 0;
+		}
+
+		// the path does not depend on the address of the tree, so the iterator is valid after the tree is moved
+		frame path_[max_height]{};
+		size_type height_ = 0;
+		const leaf_node* leaf_ = nullptr;
+		size_type index_ = 0;
+	};
+
+	btree() = default;
+	btree(const btree&) = default;
+
+	btree(btree&& other) noexcept
+		: root_{std::move(other.root_)}
+		, height_{other.height_}
+		, size_{other.size_}
+		, compare_{std::move(other.compare_)}
+	{
+		other.root_.reset();
+		other.height_ = 0;
+		other.size_ = 0;
+	}
+
+	btree& operator=(const btree&) = default;
+
+	btree& operator=(btree&& other) noexcept
+	{
+		btree{std::move(other)}.swap(*this);
+		return *this;
+	}
+
+	~btree() = default;
+
+	// lookup
+
+	COW_NODISCARD const Value* find(const Key& key) const
+	{
+		if (size_ == 0)
+			return nullptr;
+
+		const inner_node* node = &*root_;
+		for (size_type height = height_; height != 1; --height)
+			node = &*node->inners[upper_child(*node, key)];
+		const leaf_node& leaf = *node->leaves[upper_child(*node, key)];
+		const size_type index = lower_index(leaf, key);
+
+		return index < leaf.size() && !compare_(key, KeyOfValue{}(leaf[index])) ? &leaf[index] : nullptr;
+	}
+
+	/// \return The first value which is not less than `key`.
+	COW_NODISCARD const_iterator lower_bound(const Key& key) const
+	{
+		return bound(key, false);
+	}
+
+	/// \return The first value which is greater than `key`.
+	COW_NODISCARD const_iterator upper_bound(const Key& key) const
+	{
+		return bound(key, true);
+	}
+
+	// iterators
+
+	COW_NODISCARD const_iterator begin() const noexcept
+	{
+		if (size_ == 0)
+			return end();
+
+		const_iterator result = end();
+		result.path_[0].child = 0;
+		result.descend(1, false);
+		return result;
+	}
+
+	COW_NODISCARD const_iterator end() const noexcept
+	{
+		return const_iterator{root_ ? &*root_ : nullptr, height_};
+	}
+
+	// capacity
+
+	COW_NODISCARD size_type size() const noexcept
+	{
+		return size_;
+	}
+
+	// modifiers
+
+	/// Inserts the value or assigns it to the value with the same key if `assign` is true.
+	/// \return true if the value is inserted.
+	bool insert(Value&& value, const bool assign)
+	{
+		if (!assign && find(KeyOfValue{}(value)) != nullptr)
+			return false;
+
+		return insert_from_root(std::move(value), assign);
+	}
+
+	/// Inserts the value which key is not in the tree, so the caller which has looked the key up does not search it
+	/// again.
+	void insert_missing(Value&& value)
+	{
+		insert_from_root(std::move(value), false);
+	}
+
+	/// \return The mutable value of the key which must be in the tree.
+	Value& mutable_value(const Key& key)
+	{
+		inner_node* node = &mutable_node(root_);
+		for (size_type height = height_; height != 1; --height)
+			node = &mutable_node(node->inners[upper_child(*node, key)]);
+		leaf_node& leaf = mutable_node(node->leaves[upper_child(*node, key)]);
+
+		return leaf[lower_index(leaf, key)];
+	}
+
+	/// \return true if the value is removed.
+	bool erase(const Key& key)
+	{
+		if (find(key) == nullptr)
+			return false;
+
+		erase(mutable_node(root_), height_, key);
+		if (--size_ == 0) {
+			clear();
+			return true;
+		}
+
+		// the root with one inner child is replaced by the child
+		while (height_ > 1 && (*root_).child_count() == 1) {
+			inner_pointer child = (*root_).inners[0];
+			root_ = std::move(child);
+			--height_;
+		}
+		return true;
+	}
+
+	void clear() noexcept
+	{
+		root_.reset();
+		height_ = 0;
+		size_ = 0;
+	}
+
+	void swap(btree& other) noexcept
+	{
+		using std::swap;
+		root_.swap(other.root_);
+		swap(height_, other.height_);
+		swap(size_, other.size_);
+		swap(compare_, other.compare_);
+	}
+
+	// observers
+
+	COW_NODISCARD const Compare& compare() const noexcept
+	{
+		return compare_;
+	}
+
+	COW_NODISCARD bool shares_storage_with(const btree& other) const noexcept
+	{
+		return root_ && root_.get() == other.root_.get();
+	}
+
+private:
+	// ## nodes
+
+	// the node which is not shared with other trees
+	template<typename Pointer>
+	static auto& mutable_node(Pointer& node)
+	{
+		if (!node.unique())
+			node = node.make_similar(*node);
+
+		return *node;
+	}
+
+	// the first index of `values` for which `less` is false
+	template<typename Chunk, typename Less>
+	static size_type partition_point(const Chunk& values, Less less)
+	{
+		size_type first = 0;
+		size_type count = values.size();
+		while (count != 0) {
+			const size_type step = count / 2;
+			if (less(values[first + step])) {
+				first += step + 1;
+				count -= step + 1;
+			}
+			else {
+				count = step;
+			}
+		}
+		return first;
+	}
+
+	// the child which keeps the values with `key`
+	size_type upper_child(const inner_node& node, const Key& key) const
+	{
+		return partition_point(node.keys, [this, &key](const Key& separator) { return !compare_(key, separator); });
+	}
+
+	size_type lower_index(const leaf_node& leaf, const Key& key) const
+	{
+		return partition_point(leaf, [this, &key](const Value& value) { return compare_(KeyOfValue{}(value), key); });
+	}
+
+	size_type upper_index(const leaf_node& leaf, const Key& key) const
+	{
+		return partition_point(leaf, [this, &key](const Value& value) { return !compare_(key, KeyOfValue{}(value)); });
+	}
+
+	// ## positions
+
+	// the value is in the leaf of the key or it is the first value of the next leaf
+	const_iterator bound(const Key& key, const bool upper) const
+	{
+		if (size_ == 0)
+			return end();
+
+		const_iterator result = end();
+		for (size_type level = 0;; ++level) {
+			typename const_iterator::frame& parent = result.path_[level];
+			parent.child = upper_child(*parent.node, key);
+			if (level + 1 == height_)
+				break;
+
+			result.path_[level + 1].node = &*parent.node->inners[parent.child];
+		}
+
+		const typename const_iterator::frame& parent = result.path_[height_ - 1];
+		const leaf_node& leaf = *parent.node->leaves[parent.child];
+		const size_type index = upper ? upper_index(leaf, key) : lower_index(leaf, key);
+		result.leaf_ = &leaf;
+		if (index < leaf.size()) {
+			result.index_ = index;
+			return result;
+		}
+
+		result.index_ = leaf.size() - 1;
+		return ++result;
+	}
+
+	// ## insertion
+
+	// the value is inserted by one walk from the root, the key is not looked up before it
+	bool insert_from_root(Value&& value, const bool assign)
+	{
+		if (!root_) {
+			inner_pointer root = inner_pointer::make(true);
+			(*root).leaves.emplace_back(leaf_pointer::make());
+			root_ = std::move(root);
+			height_ = 1;
+		}
+		// the full root is split under the new root, so the nodes on the path always have room for the new child
+		if ((*root_).child_count() == NodeSize) {
+			inner_pointer root = inner_pointer::make(false);
+			(*root).inners.emplace_back(root_);
+			root_ = std::move(root);
+			++height_;
+			split_child(*root_, height_, 0);
+		}
+
+		const bool inserted = insert(mutable_node(root_), height_, std::move(value), assign);
+		if (inserted)
+			++size_;
+		return inserted;
+	}
+
+	bool insert(inner_node& node, const size_type height, Value&& value, const bool assign)
+	{
+		const Key& key = KeyOfValue{}(value);
+		size_type child = upper_child(node, key);
+		const bool full = height == 1 ? (*node.leaves[child]).full() : (*node.inners[child]).child_count() == NodeSize;
+		if (full) {
+			split_child(node, height, child);
+			if (!compare_(key, node.keys[child]))
+				++child;
+		}
+
+		if (height != 1)
+			return insert(mutable_node(node.inners[child]), height - 1, std::move(value), assign);
+
+		leaf_node& leaf = mutable_node(node.leaves[child]);
+		const size_type index = lower_index(leaf, key);
+		if (index < leaf.size() && !compare_(key, KeyOfValue{}(leaf[index]))) {
+			if (assign)
+				leaf[index] = std::move(value);
+			return false;
+		}
+
+		leaf.emplace(index, std::move(value));
+		return true;
+	}
+
+	// moves the values [first, size) of `from` to the end of `to`, `from` is not changed if the copy of a value throws
+	template<typename Chunk>
+	static void move_values(Chunk& from, const size_type first, Chunk& to)
+	{
+		for (size_type i = first; i < from.size(); ++i)
+			to.emplace_back(std::move_if_noexcept(from[i]));
+		while (from.size() > first)
+			from.pop_back();
+	}
+
+	static void move_children(inner_node& from, const size_type first, inner_node& to) noexcept
+	{
+		if (from.keeps_leaves())
+			move_values(from.leaves, first, to.leaves);
+		else
+			move_values(from.inners, first, to.inners);
+	}
+
+	// splits the full child of the node `node` of height `height` to two halves
+	void split_child(inner_node& node, const size_type height, const size_type child)
+	{
+		if (height == 1) {
+			leaf_node& left = mutable_node(node.leaves[child]);
+			const size_type half = left.size() / 2;
+			leaf_pointer right = leaf_pointer::make();
+			node.keys.emplace(child, KeyOfValue{}(left[half]));
+			try {
+				move_values(left, half, *right);
+			}
+			catch (...) {
+				node.keys.erase(child);
+				throw;
+			}
+			node.leaves.emplace(child + 1, std::move(right));
+			return;
+		}
+
+		// the middle key of the child goes up to the node
+		inner_node& left = mutable_node(node.inners[child]);
+		const size_type half = left.child_count() / 2;
+		inner_pointer right = inner_pointer::make(left.keeps_leaves());
+		node.keys.emplace(child, left.keys[half - 1]);
+		try {
+			move_values(left.keys, half, (*right).keys);
+		}
+		catch (...) {
+			node.keys.erase(child);
+			throw;
+		}
+		left.keys.pop_back();
+		move_children(left, half, *right);
+		node.inners.emplace(child + 1, std::move(right));
+	}
+
+	// ## removal
+
+	// the key must be in the subtree of the node
+	void erase(inner_node& node, const size_type height, const Key& key)
+	{
+		const size_type child = upper_child(node, key);
+		if (height == 1) {
+			leaf_node& leaf = mutable_node(node.leaves[child]);
+			leaf.erase(lower_index(leaf, key));
+			if (leaf.size() < min_size)
+				rebalance_leaves(node, child);
+			return;
+		}
+
+		inner_node& child_node = mutable_node(node.inners[child]);
+		erase(child_node, height - 1, key);
+		if (child_node.child_count() < min_size)
+			rebalance_inners(node, child);
+	}
+
+	// the small child is merged with its sibling or takes a value from it
+	void rebalance_leaves(inner_node& node, const size_type child)
+	{
+		if (node.child_count() < 2)
+			return;
+
+		const size_type first = child == 0 ? 0 : child - 1;
+		leaf_node& left = mutable_node(node.leaves[first]);
+		leaf_node& right = mutable_node(node.leaves[first + 1]);
+		if (left.size() + right.size() <= NodeSize) {
+			move_values(right, 0, left);
+			node.keys.erase(first);
+			node.leaves.erase(first + 1);
+			return;
+		}
+
+		if (left.size() < right.size()) {
+			left.emplace_back(std::move_if_noexcept(right[0]));
+			right.erase(0);
+		}
+		else {
+			right.emplace(0, std::move_if_noexcept(left[left.size() - 1]));
+			left.pop_back();
+		}
+		node.keys[first] = KeyOfValue{}(right[0]);
+	}
+
+	void rebalance_inners(inner_node& node, const size_type child)
+	{
+		if (node.child_count() < 2)
+			return;
+
+		const size_type first = child == 0 ? 0 : child - 1;
+		inner_node& left = mutable_node(node.inners[first]);
+		inner_node& right = mutable_node(node.inners[first + 1]);
+		if (left.child_count() + right.child_count() <= NodeSize) {
+			left.keys.emplace_back(node.keys[first]);
+			move_values(right.keys, 0, left.keys);
+			move_children(right, 0, left);
+			node.keys.erase(first);
+			node.inners.erase(first + 1);
+			return;
+		}
+
+		// the separator goes down to the small child and the key of the sibling replaces it
+		if (left.child_count() < right.child_count()) {
+			left.keys.emplace_back(std::move_if_noexcept(node.keys[first]));
+			node.keys[first] = std::move_if_noexcept(right.keys[0]);
+			right.keys.erase(0);
+			if (right.keeps_leaves()) {
+				left.leaves.emplace_back(std::move(right.leaves[0]));
+				right.leaves.erase(0);
+			}
+			else {
+				left.inners.emplace_back(std::move(right.inners[0]));
+				right.inners.erase(0);
+			}
+		}
+		else {
+			right.keys.emplace(0, std::move_if_noexcept(node.keys[first]));
+			node.keys[first] = std::move_if_noexcept(left.keys[left.keys.size() - 1]);
+			left.keys.pop_back();
+			if (left.keeps_leaves()) {
+				right.leaves.emplace(0, std::move(left.leaves[left.leaves.size() - 1]));
+				left.leaves.pop_back();
+			}
+			else {
+				right.inners.emplace(0, std::move(left.inners[left.inners.size() - 1]));
+				left.inners.pop_back();
+			}
+		}
+	}
+
+	inner_pointer root_;
+	size_type height_ = 0;
+	size_type size_ = 0;
+	Compare compare_;
+};
+
+} // namespace detail
+} // namespace cow
@@ -0,0 +1,68 @@
+#pragma once
+#include "chunk.h"
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace cow {
+namespace detail {
+
+/// The children of an inner node of a tree: the pointers to the leaves or the pointers to the inner nodes. The kind
+/// of the children is chosen by the constructor, and only the chunk of this kind is constructed, so both kinds share
+/// one array of pointers.
+template<typename LeafPointer, typename InnerPointer, std::size_t Capacity>
+class child_array {
+	using leaf_chunk = chunk<LeafPointer, Capacity>;
+	using inner_chunk = chunk<InnerPointer, Capacity>;
+
+public:
+	explicit child_array(const bool keeps_leaves) noexcept
+		: keeps_leaves_{keeps_leaves}
+	{
+		if (keeps_leaves_)
+			::new (static_cast<void*>(std::addressof(leaves))) leaf_chunk{};
+		else
+			::new (static_cast<void*>(std::addressof(inners))) inner_chunk{};
+	}
+
+	child_array(const child_array& other)
+		: keeps_leaves_{other.keeps_leaves_}
+	{
+		if (keeps_leaves_)
+			::new (static_cast<void*>(std::addressof(leaves))) leaf_chunk{other.leaves};
+		else
+			::new (static_cast<void*>(std::addressof(inners))) inner_chunk{other.inners};
+	}
+
+	child_array& operator=(const child_array&) = delete;
+
+	~child_array()
+	{
+		if (keeps_leaves_)
+			leaves.~leaf_chunk();
+		else
+			inners.~inner_chunk();
+	}
+
+	COW_NODISCARD bool keeps_leaves() const noexcept
+	{
+		return keeps_leaves_;
+	}
+
+	COW_NODISCARD std::size_t child_count() const noexcept
+	{
+		return keeps_leaves_ ? leaves.size() : inners.size();
+	}
+
+	// only the member chosen by the constructor is alive
+	union {
+		leaf_chunk leaves;
+		inner_chunk inners;
+	};
+
+private:
+	bool keeps_leaves_;
+};
+
+} // namespace detail
+} // namespace cow
@@ -0,0 +1,131 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cow {
+namespace detail {
+
+/// The number of values in the chunk of about 1 KiB.
+template<typename T>
+struct default_chunk_size : std::integral_constant<std::size_t, sizeof(T) < 1024 ? 1024 / sizeof(T) : 1> {};
+
+/// Array of up to `Capacity` values of T which are kept inside the object. The values are moved only by the insertions
+/// and the removals which are not at the end, so the references to them are valid until the chunk is changed by them.
+template<typename T, std::size_t Capacity>
+class chunk {
+	static_assert(Capacity > 0, "The chunk must keep at least one value");
+
+public:
+	chunk() noexcept = default;
+
+	chunk(const chunk& other)
+	{
+		try {
+			for (std::size_t i = 0; i != other.size_; ++i)
+				emplace_back(other[i]);
+		}
+		catch (...) {
+			clear();
+			throw;
+		}
+	}
+
+	chunk& operator=(const chunk&) = delete;
+
+	~chunk()
+	{
+		clear();
+	}
+
+	COW_NODISCARD std::size_t size() const noexcept
+	{
+		return size_;
+	}
+
+	COW_NODISCARD bool full() const noexcept
+	{
+		return size_ == Capacity;
+	}
+
+	COW_NODISCARD const T& operator[](const std::size_t pos) const noexcept
+	{
+		return slots_[pos].value;
+	}
+
+	COW_NODISCARD T& operator[](const std::size_t pos) noexcept
+	{
+		return slots_[pos].value;
+	}
+
+	template<typename... Args>
+	T& emplace_back(Args&&... args)
+	{
+		T* const value = ::new (static_cast<void*>(std::addressof(slots_[size_].value))) T(std::forward<Args>(args)...);
+		++size_;
+		return *value;
+	}
+
+	/// Inserts the value before the value `pos`, the next values are moved. The chunk must not be full.
+	template<typename... Args>
+	T& emplace(const std::size_t pos, Args&&... args)
+	{
+		if (pos == size_)
+			return emplace_back(std::forward<Args>(args)...);
+
+		// the arguments may refer to the values of the chunk
+		T value(std::forward<Args>(args)...);
+		emplace_back(std::move(slots_[size_ - 1].value));
+		for (std::size_t i = size_ - 2; i != pos; --i)
+			slots_[i].value = std::move(slots_[i - 1].value);
+		slots_[pos].value = std::move(value);
+		return slots_[pos].value;
+	}
+
+	void pop_back() noexcept
+	{
+		--size_;
+		slots_[size_].value.~T();
+	}
+
+	void clear() noexcept
+	{
+		while (size_ != 0)
+			pop_back();
+	}
+
+	/// Removes the first `count` values, the other values are moved to the beginning of the chunk.
+	void erase_front(const std::size_t count) noexcept
+	{
+		for (std::size_t i = count; i != size_; ++i)
+			slots_[i - count].value = std::move(slots_[i].value);
+		for (std::size_t i = 0; i != count; ++i)
+			pop_back();
+	}
+
+	/// Removes the value `pos`, the next values are moved to its place.
+	void erase(const std::size_t pos) noexcept
+	{
+		for (std::size_t i = pos + 1; i != size_; ++i)
+			slots_[i - 1].value = std::move(slots_[i].value);
+		pop_back();
+	}
+
+private:
+	// the value is constructed and destroyed by `chunk`
+	union slot {
+		slot() noexcept {} // NOLINT(modernize-use-equals-default)
+		~slot() {} // NOLINT(modernize-use-equals-default)
+
+		T value;
+	};
+
+	std::size_t size_ = 0;
+	slot slots_[Capacity];
+};
+
+} // namespace detail
+} // namespace cow
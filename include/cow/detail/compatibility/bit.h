@@ -0,0 +1,30 @@
+#pragma once
+#include "compile_features.h"
+#include <cstdint>
+
+#ifdef COW_CPP_LIB_BITOPS
+#	include <bit>
+#endif
+
+namespace cow {
+namespace detail {
+namespace compatibility {
+
+#ifdef COW_CPP_LIB_BITOPS
+using std::popcount; // NOLINT(misc-unused-using-decls)
+#else
+constexpr int popcount(const std::uint32_t x) noexcept
+{
+#	if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcount(x);
+#	else
+	const std::uint32_t pairs = x - ((x >> 1) & 0x55555555U);
+	const std::uint32_t quads = (pairs & 0x33333333U) + ((pairs >> 2) & 0x33333333U);
+	return static_cast<int>((((quads + (quads >> 4)) & 0x0F0F0F0FU) * 0x01010101U) >> 24);
+#	endif
+}
+#endif
+
+} // namespace compatibility
+} // namespace detail
+} // namespace cow
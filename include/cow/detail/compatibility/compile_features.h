@@ -18,3 +18,37 @@
 #if (defined(__cpp_lib_optional) && __cpp_lib_optional >= 201606) || __cplusplus >= 201703L
 #	define COW_CPP_LIB_OPTIONAL
 #endif
+
+#if defined(__cpp_lib_memory_resource) && __cpp_lib_memory_resource >= 201603
+#	define COW_CPP_LIB_MEMORY_RESOURCE
+#endif
+
+#if (defined(__cpp_lib_string_view) && __cpp_lib_string_view >= 201606) || __cplusplus >= 201703L
+#	define COW_CPP_LIB_STRING_VIEW
+#endif
+
+#if defined(__cpp_lib_bitops) && __cpp_lib_bitops >= 201907
+#	define COW_CPP_LIB_BITOPS
+#endif
+
+#if (defined(__cpp_lib_logical_traits) && __cpp_lib_logical_traits >= 201510) || __cplusplus >= 201703L
+#	define COW_CPP_LIB_LOGICAL_TRAITS
+#endif
+
+#if (defined(__cpp_lib_is_swappable) && __cpp_lib_is_swappable >= 201603) || __cplusplus >= 201703L
+#	define COW_CPP_LIB_IS_SWAPPABLE
+#endif
+
+#if (defined(__cpp_lib_void_t) && __cpp_lib_void_t >= 201411) || __cplusplus >= 201703L
+#	define COW_CPP_LIB_VOID_T
+#endif
+
+#if (defined(__cpp_lib_is_aggregate) && __cpp_lib_is_aggregate >= 201703) || __cplusplus >= 201703L
+#	define COW_CPP_LIB_IS_AGGREGATE
+#endif
+
+#ifdef __has_builtin
+#	if __has_builtin(__is_aggregate)
+#		define COW_HAS_BUILTIN_IS_AGGREGATE
+#	endif
+#endif
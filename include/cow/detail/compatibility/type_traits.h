@@ -0,0 +1,91 @@
+#pragma once
+#include "compile_features.h"
+#include <type_traits>
+#include <utility>
+
+namespace cow {
+namespace detail {
+namespace compatibility {
+
+#ifdef COW_CPP_LIB_LOGICAL_TRAITS
+using std::bool_constant; // NOLINT(misc-unused-using-decls)
+using std::conjunction; // NOLINT(misc-unused-using-decls)
+using std::disjunction; // NOLINT(misc-unused-using-decls)
+#else
+template<bool B>
+using bool_constant = std::integral_constant<bool, B>;
+
+template<typename... Bs>
+struct conjunction : std::true_type {};
+
+template<typename B>
+struct conjunction<B> : B {};
+
+template<typename B, typename... Bs>
+struct conjunction<B, Bs...> : std::conditional_t<static_cast<bool>(B::value), conjunction<Bs...>, B> {};
+
+template<typename... Bs>
+struct disjunction : std::false_type {};
+
+template<typename B>
+struct disjunction<B> : B {};
+
+template<typename B, typename... Bs>
+struct disjunction<B, Bs...> : std::conditional_t<static_cast<bool>(B::value), B, disjunction<Bs...>> {};
+#endif
+
+#ifdef COW_CPP_LIB_VOID_T
+using std::void_t; // NOLINT(misc-unused-using-decls)
+#else
+template<typename... Ts>
+struct make_void {
+	using type = void;
+};
+
+template<typename... Ts>
+using void_t = typename make_void<Ts...>::type;
+#endif
+
+// `is_aggregate` is false for all types if neither the library nor the compiler provides it
+#if defined(COW_CPP_LIB_IS_AGGREGATE)
+using std::is_aggregate; // NOLINT(misc-unused-using-decls)
+#elif defined(COW_HAS_BUILTIN_IS_AGGREGATE)
+template<typename T>
+struct is_aggregate : bool_constant<__is_aggregate(T)> {};
+#else
+template<typename T>
+struct is_aggregate : std::false_type {};
+#endif
+
+#ifdef COW_CPP_LIB_IS_SWAPPABLE
+using std::is_swappable; // NOLINT(misc-unused-using-decls)
+using std::is_nothrow_swappable; // NOLINT(misc-unused-using-decls)
+#else
+namespace swappable_detail {
+
+using std::swap;
+
+template<typename T>
+auto is_swappable(int) -> decltype(swap(std::declval<T&>(), std::declval<T&>()), std::true_type{});
+
+template<typename T>
+std::false_type is_swappable(...);
+
+template<typename T, bool = decltype(is_swappable<T>(0))::value>
+struct is_nothrow_swappable : bool_constant<noexcept(swap(std::declval<T&>(), std::declval<T&>()))> {};
+
+template<typename T>
+struct is_nothrow_swappable<T, false> : std::false_type {};
+
+} // namespace swappable_detail
+
+template<typename T>
+struct is_swappable : decltype(swappable_detail::is_swappable<T>(0)) {};
+
+template<typename T>
+struct is_nothrow_swappable : swappable_detail::is_nothrow_swappable<T> {};
+#endif
+
+} // namespace compatibility
+} // namespace detail
+} // namespace cow
@@ -0,0 +1,111 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include "snapshot_ref_count.h"
+#include <atomic>
+#include <cstddef>
+
+namespace cow {
+namespace detail {
+
+class deferred_ref_count;
+
+/// The queue of shared blocks which reference counters have dropped to zero. The blocks are destroyed by `collect()`,
+/// so the thread which releases the last reference does not pay for the destruction of the value.
+class reclamation_domain {
+public:
+	reclamation_domain() = default;
+	reclamation_domain(const reclamation_domain&) = delete;
+	reclamation_domain& operator=(const reclamation_domain&) = delete;
+
+	~reclamation_domain()
+	{
+		// the references kept by the threads are already subtracted when the domain is destroyed
+		static_cast<void>(destroy_retired());
+	}
+
+	/// \return The domain of all `deferred_ref_count` counters.
+	static reclamation_domain& global() noexcept
+	{
+		static reclamation_domain domain;
+		return domain;
+	}
+
+	/// Adds the block to the queue. It is called when the last reference to the block is released.
+	void retire(deferred_ref_count* counter) noexcept;
+
+	/// Destroys the retired blocks including the blocks retired by the destructors of the destroyed values.
+	/// The references kept by the current thread are subtracted before.
+	/// \return The number of destroyed blocks.
+	std::size_t collect() noexcept;
+
+	/// \return true if there are blocks waiting for destruction.
+	COW_NODISCARD bool has_retired() const noexcept
+	{
+		return retired_.load(std::memory_order_relaxed) != nullptr;
+	}
+
+private:
+	std::size_t destroy_retired() noexcept;
+
+	std::atomic<deferred_ref_count*> retired_{nullptr};
+};
+
+/// Thread-safe reference counter which passes the block to `reclamation_domain::global()` instead of destroying it
+/// when the last reference is released.
+/// A thread can keep the references to one counter which it releases (see `kept_ref_count`). They are subtracted
+/// when the thread keeps the references to another counter, calls `reclamation_domain::collect()` or finishes.
+class deferred_ref_count : public kept_ref_count<deferred_ref_count> {
+	friend class kept_ref_count<deferred_ref_count>;
+	friend class reclamation_domain;
+
+public:
+	deferred_ref_count() noexcept
+	{
+		// the domain is created before the first owner of the block, so it is destroyed after the owner
+		static_cast<void>(reclamation_domain::global());
+	}
+
+private:
+	void dispose_last(const disposer dispose) noexcept
+	{
+		dispose_ = dispose;
+		reclamation_domain::global().retire(this);
+	}
+
+	// the fields below are used only after the last reference is released
+	deferred_ref_count* next_retired_ = nullptr;
+	disposer dispose_ = nullptr;
+};
+
+inline void reclamation_domain::retire(deferred_ref_count* const counter) noexcept
+{
+	deferred_ref_count* head = retired_.load(std::memory_order_relaxed);
+	do {
+		counter->next_retired_ = head;
+	} while (!retired_.compare_exchange_weak(head, counter, std::memory_order_release, std::memory_order_relaxed));
+}
+
+inline std::size_t reclamation_domain::collect() noexcept
+{
+	deferred_ref_count::release_kept();
+	return destroy_retired();
+}
+
+inline std::size_t reclamation_domain::destroy_retired() noexcept
+{
+	std::size_t count = 0;
+	while (has_retired()) {
+		deferred_ref_count* counters = retired_.exchange(nullptr, std::memory_order_acquire);
+		while (counters) {
+			deferred_ref_count* const counter = counters;
+			counters = counter->next_retired_;
+			counter->dispose_(counter);
+			++count;
+		}
+	}
+
+	return count;
+}
+
+} // namespace detail
+} // namespace cow
@@ -0,0 +1,284 @@
+#pragma once
+#include "allocator_holder.h"
+#include "compatibility/compile_features.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cow {
+namespace detail {
+
+/// Node of a hash array mapped trie. The reference counter, the allocator, the bitmaps and the compact arrays of the
+/// entries and of the children are kept in one allocation which has room only for the used slots, so the slots are
+/// read without additional indirections and the node is copied by one allocation. The capacities of the slots are
+/// fixed when the node is allocated, the nodes with other capacities are built by `make`.
+template<typename Value, typename RefCount, typename Allocator>
+class hamt_node : public RefCount, allocator_holder<Allocator> {
+public:
+	class pointer;
+
+	std::uint32_t entry_map = 0;
+	std::uint32_t child_map = 0;
+
+	hamt_node(const hamt_node&) = delete;
+	hamt_node& operator=(const hamt_node&) = delete;
+
+	/// Allocates the node with room for `entry_capacity` entries and `child_capacity` children. The slots are
+	/// constructed by `push_entry` and `push_child`.
+	COW_NODISCARD static pointer make(
+		const Allocator& allocator, const std::size_t entry_capacity, const std::size_t child_capacity)
+	{
+		unit_allocator allocator_of_units{allocator};
+		const std::size_t units = unit_count(entry_capacity, child_capacity);
+		void* const memory = unit_allocator_traits::allocate(allocator_of_units, units);
+		return pointer{::new (memory) hamt_node(allocator, entry_capacity, child_capacity)};
+	}
+
+	COW_NODISCARD std::size_t entry_count() const noexcept
+	{
+		return entry_count_;
+	}
+
+	COW_NODISCARD std::size_t child_count() const noexcept
+	{
+		return child_count_;
+	}
+
+	COW_NODISCARD std::size_t entry_capacity() const noexcept
+	{
+		return entry_capacity_;
+	}
+
+	COW_NODISCARD const Value& entry(const std::size_t index) const noexcept
+	{
+		return entries()[index];
+	}
+
+	COW_NODISCARD Value& entry(const std::size_t index) noexcept
+	{
+		return entries()[index];
+	}
+
+	COW_NODISCARD const pointer& child(const std::size_t index) const noexcept
+	{
+		return children()[index];
+	}
+
+	COW_NODISCARD pointer& child(const std::size_t index) noexcept
+	{
+		return children()[index];
+	}
+
+	// the entries are constructed before the children
+	template<typename... Args>
+	Value& push_entry(Args&&... args)
+	{
+		Value* const value = ::new (static_cast<void*>(entries() + entry_count_)) Value(std::forward<Args>(args)...);
+		++entry_count_;
+		return *value;
+	}
+
+	// The entries are shifted by the move, so the functions below are called only if the move of `Value` does not
+	// throw.
+
+	/// Inserts the entry before `index`. The node must have room for it.
+	void insert_entry(const std::size_t index, Value&& value) noexcept
+	{
+		Value* const first = entries();
+		for (std::size_t i = entry_count_; i != index; --i)
+			relocate(first[i - 1], first + i);
+		::new (static_cast<void*>(first + index)) Value(std::move(value));
+		++entry_count_;
+	}
+
+	void erase_entry(const std::size_t index) noexcept
+	{
+		Value* const first = entries();
+		first[index].~Value();
+		for (std::size_t i = index + 1; i != entry_count_; ++i)
+			relocate(first[i], first + i - 1);
+		--entry_count_;
+	}
+
+	void push_child(pointer child) noexcept
+	{
+		::new (static_cast<void*>(children() + child_count_)) pointer(std::move(child));
+		++child_count_;
+	}
+
+private:
+	// the slots are kept after the node in the units of the allocation
+	struct alignas(alignof(hamt_node) > alignof(Value) ? alignof(hamt_node) : alignof(Value)) unit {
+		unsigned char bytes[alignof(hamt_node) > alignof(Value) ? alignof(hamt_node) : alignof(Value)];
+	};
+
+	using unit_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<unit>;
+	using unit_allocator_traits = std::allocator_traits<unit_allocator>;
+
+	static_assert(
+		std::is_same<typename unit_allocator_traits::pointer, unit*>::value,
+		"Allocators with fancy pointers are not supported");
+
+	static constexpr std::size_t align(const std::size_t offset, const std::size_t alignment) noexcept
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	static constexpr std::size_t entries_offset() noexcept
+	{
+		return align(sizeof(hamt_node), alignof(Value));
+	}
+
+	static constexpr std::size_t children_offset(const std::size_t entry_capacity) noexcept
+	{
+		return align(entries_offset() + entry_capacity * sizeof(Value), alignof(pointer));
+	}
+
+	static constexpr std::size_t unit_count(const std::size_t entry_capacity, const std::size_t child_capacity) noexcept
+	{
+		return (children_offset(entry_capacity) + child_capacity * sizeof(pointer) + sizeof(unit) - 1) / sizeof(unit);
+	}
+
+	hamt_node(const Allocator& allocator, const std::size_t entry_capacity, const std::size_t child_capacity) noexcept
+		: allocator_holder<Allocator>{allocator}
+		, entry_capacity_{static_cast<std::uint32_t>(entry_capacity)}
+		, child_capacity_{static_cast<std::uint32_t>(child_capacity)}
+	{}
+
+	~hamt_node()
+	{
+		for (std::size_t i = 0; i != child_count_; ++i)
+			children()[i].~pointer();
+		for (std::size_t i = 0; i != entry_count_; ++i)
+			entries()[i].~Value();
+	}
+
+	// moves the entry to the raw memory and destroys the source
+	static void relocate(Value& from, Value* const to) noexcept
+	{
+		::new (static_cast<void*>(to)) Value(std::move(from));
+		from.~Value();
+	}
+
+	Value* entries() const noexcept
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		return reinterpret_cast<Value*>(const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(this)) +
+			entries_offset());
+	}
+
+	pointer* children() const noexcept
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		return reinterpret_cast<pointer*>(const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(this)) +
+			children_offset(entry_capacity_));
+	}
+
+	// the counter can be a base class of `RefCount` which calls the disposer with the pointer to itself
+	template<typename Counter>
+	static void dispose(Counter* const ref_count) noexcept
+	{
+		hamt_node* const node = static_cast<hamt_node*>(static_cast<RefCount*>(ref_count));
+		unit_allocator allocator_of_units{node->get_allocator()};
+		const std::size_t units = unit_count(node->entry_capacity_, node->child_capacity_);
+		node->~hamt_node();
+		unit_allocator_traits::deallocate(allocator_of_units, reinterpret_cast<unit*>(node), units); // NOLINT
+	}
+
+	std::uint32_t entry_capacity_;
+	std::uint32_t child_capacity_;
+	std::uint32_t entry_count_ = 0;
+	std::uint32_t child_count_ = 0;
+};
+
+/// Owner of a reference to `hamt_node`. It has the size of a raw pointer.
+template<typename Value, typename RefCount, typename Allocator>
+class hamt_node<Value, RefCount, Allocator>::pointer {
+	friend class hamt_node;
+
+public:
+	constexpr pointer() noexcept = default;
+
+	pointer(const pointer& other) noexcept
+		: node_{other.node_}
+	{
+		if (node_)
+			node_->add_ref();
+	}
+
+	pointer(pointer&& other) noexcept
+		: node_{std::exchange(other.node_, nullptr)}
+	{}
+
+	pointer& operator=(const pointer& other) noexcept
+	{
+		pointer{other}.swap(*this);
+		return *this;
+	}
+
+	pointer& operator=(pointer&& other) noexcept
+	{
+		pointer{std::move(other)}.swap(*this);
+		return *this;
+	}
+
+	~pointer()
+	{
+		reset();
+	}
+
+	COW_NODISCARD hamt_node* get() const noexcept
+	{
+		return node_;
+	}
+
+	COW_NODISCARD hamt_node& operator*() const noexcept
+	{
+		return *node_;
+	}
+
+	COW_NODISCARD hamt_node* operator->() const noexcept
+	{
+		return node_;
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return node_ != nullptr;
+	}
+
+	/// \return true if this pointer is the only owner of the node.
+	COW_NODISCARD bool unique() const noexcept
+	{
+		return node_ && node_->unique();
+	}
+
+	COW_NODISCARD Allocator get_allocator() const noexcept
+	{
+		return node_ ? node_->get_allocator() : Allocator{};
+	}
+
+	void reset() noexcept
+	{
+		if (hamt_node* const node = std::exchange(node_, nullptr))
+			node->release(&hamt_node::dispose);
+	}
+
+	void swap(pointer& other) noexcept
+	{
+		std::swap(node_, other.node_);
+	}
+
+private:
+	explicit pointer(hamt_node* const node) noexcept
+		: node_{node}
+	{}
+
+	hamt_node* node_ = nullptr;
+};
+
+} // namespace detail
+} // namespace cow
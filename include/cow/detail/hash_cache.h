@@ -0,0 +1,82 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+
+namespace cow {
+
+template<typename T>
+struct cache_hash : std::false_type {};
+
+namespace detail {
+
+template<typename T>
+std::size_t compute_hash(const T& value) noexcept(noexcept(std::hash<std::remove_const_t<T>>{}(value)))
+{
+	return std::hash<std::remove_const_t<T>>{}(value);
+}
+
+/// Keeps the hash of the shared value. The hash is computed once by the first call of `get_hash` and it is reset by
+/// `invalidate_hash` when the only owner changes the value.
+template<bool CacheHash>
+class hash_cache {
+public:
+	template<typename T>
+	COW_NODISCARD std::size_t get_hash(const T& value) const noexcept(noexcept(compute_hash(value)))
+	{
+		return compute_hash(value);
+	}
+
+	COW_NODISCARD bool try_get_hash(std::size_t& /*hash*/) const noexcept
+	{
+		return false;
+	}
+
+	void invalidate_hash() noexcept {}
+};
+
+template<>
+class hash_cache<true> {
+public:
+	hash_cache() = default;
+	hash_cache(const hash_cache&) = delete;
+	hash_cache& operator=(const hash_cache&) = delete;
+	~hash_cache() = default;
+
+	template<typename T>
+	COW_NODISCARD std::size_t get_hash(const T& value) const noexcept(noexcept(compute_hash(value)))
+	{
+		if (computed_.load(std::memory_order_acquire))
+			return hash_.load(std::memory_order_relaxed);
+
+		// several threads can compute the same hash at once, they store the same value
+		const std::size_t hash = compute_hash(value);
+		hash_.store(hash, std::memory_order_relaxed);
+		computed_.store(true, std::memory_order_release);
+		return hash;
+	}
+
+	/// \return true if the hash is computed.
+	COW_NODISCARD bool try_get_hash(std::size_t& hash) const noexcept
+	{
+		if (!computed_.load(std::memory_order_acquire))
+			return false;
+
+		hash = hash_.load(std::memory_order_relaxed);
+		return true;
+	}
+
+	void invalidate_hash() noexcept
+	{
+		computed_.store(false, std::memory_order_relaxed);
+	}
+
+private:
+	mutable std::atomic<std::size_t> hash_{0};
+	mutable std::atomic<bool> computed_{false};
+};
+
+} // namespace detail
+} // namespace cow
@@ -0,0 +1,250 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include "compatibility/utility.h"
+#include "hash_cache.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace cow {
+namespace detail {
+
+/// Pointer which keeps the value inside itself while it is the only owner of the value. The first copy publishes a copy
+/// of the value in the block of `SharedPointer` and then the copies share this block. The pointer keeps its own value
+/// until it is changed, so the references to the value are not invalidated by the copies. The block is published once
+/// by an atomic state, so a pointer with the inline value can be copied by several threads at once.
+template<typename T, typename SharedPointer>
+class hybrid_ptr {
+	static_assert(
+		std::is_nothrow_move_constructible<T>::value, "hybrid_ptr requires nothrow move constructible value type");
+
+public:
+	hybrid_ptr() noexcept = default;
+
+	hybrid_ptr(const hybrid_ptr& other)
+		: shared_{other.publish()}
+	{}
+
+	hybrid_ptr(hybrid_ptr&& other) noexcept
+	{
+		take(other);
+	}
+
+	hybrid_ptr& operator=(const hybrid_ptr& other)
+	{
+		hybrid_ptr{other}.swap(*this);
+		return *this;
+	}
+
+	hybrid_ptr& operator=(hybrid_ptr&& other) noexcept
+	{
+		hybrid_ptr{std::move(other)}.swap(*this);
+		return *this;
+	}
+
+	~hybrid_ptr()
+	{
+		destroy();
+	}
+
+	template<typename... Args>
+	COW_NODISCARD static hybrid_ptr make(Args&&... args)
+	{
+		return hybrid_ptr{compatibility::in_place, std::forward<Args>(args)...};
+	}
+
+	template<typename... Args>
+	COW_NODISCARD hybrid_ptr make_similar(Args&&... args) const
+	{
+		return make(std::forward<Args>(args)...);
+	}
+
+	/// Replaces the value by the value constructed from `args`. It must be called only by the only owner of the value.
+	/// If the constructor throws, the pointer becomes empty.
+	template<typename... Args>
+	void emplace(Args&&... args)
+	{
+		if (!inline_) {
+			shared_.emplace(std::forward<Args>(args)...);
+			return;
+		}
+
+		unpublish();
+		value_.value.~T();
+		try {
+			::new (static_cast<void*>(std::addressof(value_.value))) T(std::forward<Args>(args)...);
+		}
+		catch (...) {
+			inline_ = false;
+			throw;
+		}
+	}
+
+	/// \return The hash of the value. The hash of the inline value is cached in its published copy.
+	COW_NODISCARD std::size_t hash() const
+	{
+		return inline_ && !is_published() ? compute_hash(value_.value) : shared_.hash();
+	}
+
+	COW_NODISCARD bool try_get_hash(std::size_t& hash) const noexcept
+	{
+		return (!inline_ || is_published()) && shared_.try_get_hash(hash);
+	}
+
+	/// Resets the cached hash. It must be called by the only owner of the value when the value is changed, so the
+	/// published copy of the inline value is forgotten too.
+	void invalidate_hash() noexcept
+	{
+		if (inline_)
+			unpublish();
+		else
+			shared_.invalidate_hash();
+	}
+
+	COW_NODISCARD T* get() const noexcept
+	{
+		return inline_ ? std::addressof(value_.value) : shared_.get();
+	}
+
+	COW_NODISCARD T& operator*() const noexcept
+	{
+		return inline_ ? value_.value : *shared_;
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return inline_ || static_cast<bool>(shared_);
+	}
+
+	/// \return true if this pointer is the only owner of the value. The inline value is unique if its published copy is
+	///         not shared.
+	COW_NODISCARD bool unique() const noexcept
+	{
+		return (inline_ && !is_published()) || shared_.unique();
+	}
+
+	COW_NODISCARD std::size_t use_count() const noexcept
+	{
+		return inline_ && !is_published() ? 1 : shared_.use_count();
+	}
+
+	void reset() noexcept
+	{
+		destroy();
+		inline_ = false;
+		shared_.reset();
+		publication_.store(unpublished, std::memory_order_relaxed);
+	}
+
+	void swap(hybrid_ptr& other) noexcept
+	{
+		hybrid_ptr temp{std::move(other)};
+		other.take(*this);
+		take(temp);
+	}
+
+private:
+	// the states of the copy of the inline value in the shared block
+	static constexpr unsigned char unpublished = 0;
+	static constexpr unsigned char publishing = 1;
+	static constexpr unsigned char published = 2;
+
+	// the value of the only owner
+	union value_type {
+		value_type() noexcept {} // NOLINT(modernize-use-equals-default)
+
+		template<typename... Args>
+		explicit value_type(compatibility::in_place_t, Args&&... args)
+			: value(std::forward<Args>(args)...)
+		{}
+
+		value_type(const value_type&) = delete;
+		value_type& operator=(const value_type&) = delete;
+
+		// the value is destroyed by `hybrid_ptr`
+		~value_type() {} // NOLINT(modernize-use-equals-default)
+
+		T value;
+	};
+
+	template<typename... Args>
+	explicit hybrid_ptr(compatibility::in_place_t, Args&&... args)
+		: value_{compatibility::in_place, std::forward<Args>(args)...}
+		, inline_{true}
+	{}
+
+	bool is_published() const noexcept
+	{
+		return publication_.load(std::memory_order_acquire) == published;
+	}
+
+	// returns the block shared by the copies, the first copy of the inline value creates it
+	SharedPointer publish() const
+	{
+		if (!inline_)
+			return shared_;
+
+		unsigned char state = publication_.load(std::memory_order_acquire);
+		while (state != published) {
+			if (state == publishing) {
+				std::this_thread::yield();
+				state = publication_.load(std::memory_order_acquire);
+			}
+			else if (publication_.compare_exchange_weak(state, publishing, std::memory_order_acquire)) {
+				try {
+					shared_ = SharedPointer::make(value_.value);
+				}
+				catch (...) {
+					publication_.store(unpublished, std::memory_order_release);
+					throw;
+				}
+
+				publication_.store(published, std::memory_order_release);
+				return shared_;
+			}
+		}
+
+		return shared_;
+	}
+
+	// forgets the published copy of the inline value before the value is changed
+	void unpublish() noexcept
+	{
+		shared_.reset();
+		publication_.store(unpublished, std::memory_order_relaxed);
+	}
+
+	// takes the value of `other` and makes it empty, this pointer must be empty
+	void take(hybrid_ptr& other) noexcept
+	{
+		if (other.inline_) {
+			::new (static_cast<void*>(std::addressof(value_.value))) T(std::move(other.value_.value));
+			inline_ = true;
+			publication_.store(other.publication_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		shared_ = std::move(other.shared_);
+		other.reset();
+	}
+
+	void destroy() noexcept
+	{
+		if (inline_)
+			value_.value.~T();
+	}
+
+	// the pointer gives access to the value from const methods like other pointers
+	mutable value_type value_;
+	// the owner of the shared value or the published copy of the inline value, it is written by the copy of
+	// the inline value only once
+	mutable SharedPointer shared_;
+	mutable std::atomic<unsigned char> publication_{unpublished};
+	bool inline_ = false;
+};
+
+} // namespace detail
+} // namespace cow
@@ -0,0 +1,208 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include "compatibility/utility.h"
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cow {
+namespace detail {
+
+// The value of T in the buffer of the object and the flag which shows that the value is constructed.
+// The destructor is trivial if T is trivially destructible.
+template<typename T, bool = std::is_trivially_destructible<T>::value>
+class inline_value_base {
+public:
+	constexpr inline_value_base() noexcept
+		: empty_{}
+	{}
+
+	template<typename... Args>
+	constexpr explicit inline_value_base(compatibility::in_place_t, Args&&... args)
+		: value_(std::forward<Args>(args)...)
+		, engaged_{true}
+	{}
+
+	inline_value_base(const inline_value_base&) = default;
+	inline_value_base(inline_value_base&&) = default;
+	inline_value_base& operator=(const inline_value_base&) = default;
+	inline_value_base& operator=(inline_value_base&&) = default;
+	~inline_value_base() = default;
+
+protected:
+	void destroy() noexcept
+	{
+		engaged_ = false;
+	}
+
+	union {
+		char empty_;
+		T value_;
+	};
+	bool engaged_ = false;
+};
+
+template<typename T>
+class inline_value_base<T, false> {
+public:
+	constexpr inline_value_base() noexcept
+		: empty_{}
+	{}
+
+	template<typename... Args>
+	constexpr explicit inline_value_base(compatibility::in_place_t, Args&&... args)
+		: value_(std::forward<Args>(args)...)
+		, engaged_{true}
+	{}
+
+	inline_value_base(const inline_value_base&) = delete;
+	inline_value_base& operator=(const inline_value_base&) = delete;
+
+	~inline_value_base()
+	{
+		if (engaged_)
+			value_.~T();
+	}
+
+protected:
+	void destroy() noexcept
+	{
+		value_.~T();
+		engaged_ = false;
+	}
+
+	union {
+		char empty_;
+		T value_;
+	};
+	bool engaged_ = false;
+};
+
+// The operations which do not depend on triviality of T.
+template<typename T>
+class inline_value_operations : public inline_value_base<T> {
+	using base = inline_value_base<T>;
+
+public:
+	using base::base;
+
+	COW_NODISCARD constexpr bool has_value() const noexcept
+	{
+		return this->engaged_;
+	}
+
+	COW_NODISCARD constexpr const T& get() const noexcept
+	{
+		return this->value_;
+	}
+
+	COW_NODISCARD T& get() noexcept
+	{
+		return this->value_;
+	}
+
+	template<typename... Args>
+	T& emplace(Args&&... args)
+	{
+		reset();
+		construct(std::forward<Args>(args)...);
+		return this->value_;
+	}
+
+	void reset() noexcept
+	{
+		if (this->engaged_)
+			this->destroy();
+	}
+
+	template<typename U>
+	void assign(U&& value)
+	{
+		if (this->engaged_)
+			this->value_ = std::forward<U>(value);
+		else
+			construct(std::forward<U>(value));
+	}
+
+	void swap(inline_value_operations& other)
+	{
+		if (this->engaged_ && other.engaged_) {
+			using std::swap;
+			swap(this->value_, other.value_);
+		}
+		else if (this->engaged_) {
+			other.construct(std::move(this->value_));
+			this->destroy();
+		}
+		else if (other.engaged_) {
+			construct(std::move(other.value_));
+			other.destroy();
+		}
+	}
+
+protected:
+	template<typename... Args>
+	void construct(Args&&... args)
+	{
+		::new (static_cast<void*>(std::addressof(this->value_))) T(std::forward<Args>(args)...);
+		this->engaged_ = true;
+	}
+};
+
+/// Storage of an optional value of T inside the object. It is trivially copyable if T is trivially copyable.
+template<
+	typename T,
+	bool = std::is_trivially_copy_constructible<T>::value && std::is_trivially_copy_assignable<T>::value
+		&& std::is_trivially_move_constructible<T>::value && std::is_trivially_move_assignable<T>::value
+		&& std::is_trivially_destructible<T>::value>
+class inline_value : public inline_value_operations<T> {
+public:
+	using inline_value_operations<T>::inline_value_operations;
+};
+
+template<typename T>
+class inline_value<T, false> : public inline_value_operations<T> {
+	using base = inline_value_operations<T>;
+
+public:
+	using base::base;
+
+	inline_value(const inline_value& other) noexcept(std::is_nothrow_copy_constructible<T>::value)
+	{
+		if (other.engaged_)
+			this->construct(other.value_);
+	}
+
+	inline_value(inline_value&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+	{
+		if (other.engaged_)
+			this->construct(std::move(other.value_));
+	}
+
+	inline_value& operator=(const inline_value& other)
+	{
+		if (other.engaged_)
+			this->assign(other.value_);
+		else
+			this->reset();
+
+		return *this;
+	}
+
+	inline_value& operator=(inline_value&& other)
+		noexcept(std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value)
+	{
+		if (other.engaged_)
+			this->assign(std::move(other.value_));
+		else
+			this->reset();
+
+		return *this;
+	}
+
+	~inline_value() = default;
+};
+
+} // namespace detail
+} // namespace cow
@@ -0,0 +1,251 @@
+#pragma once
+#include "allocator_holder.h"
+#include "compatibility/compile_features.h"
+#include "hash_cache.h"
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cow {
+namespace detail {
+
+/// The block keeps a reference counter, an allocator, the hash cache (if `cache_hash<T>` is true) and a value in one
+/// allocation. The reference counter is a base class, so the block can be restored from the pointer to the counter.
+template<typename T, typename RefCount, typename Allocator>
+struct intrusive_block : RefCount, allocator_holder<Allocator>, hash_cache<cache_hash<std::remove_const_t<T>>::value> {
+	template<typename... Args>
+	explicit intrusive_block(const Allocator& allocator, Args&&... args)
+		: allocator_holder<Allocator>{allocator}
+		, value(std::forward<Args>(args)...)
+	{}
+
+	intrusive_block(const intrusive_block&) = delete;
+	intrusive_block& operator=(const intrusive_block&) = delete;
+
+	// the value is destroyed by `intrusive_ptr`, so it can be replaced without releasing the block
+	~intrusive_block() {} // NOLINT(modernize-use-equals-default)
+
+	union {
+		T value;
+	};
+};
+
+/// Pointer to the `intrusive_block`. It has the size of a raw pointer and has no weak references and deleters.
+/// The block is allocated by `Allocator` rebound to the block type.
+template<typename T, typename RefCount, typename Allocator = std::allocator<char>>
+class intrusive_ptr {
+	using block_type = intrusive_block<T, RefCount, Allocator>;
+	using block_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<block_type>;
+	using block_allocator_traits = std::allocator_traits<block_allocator>;
+
+	static_assert(
+		std::is_same<typename block_allocator_traits::pointer, block_type*>::value,
+		"Allocators with fancy pointers are not supported");
+
+public:
+	using allocator_type = Allocator;
+	using ref_count_type = RefCount;
+	using block_pointer = block_type*;
+
+	constexpr intrusive_ptr() noexcept = default;
+
+	intrusive_ptr(const intrusive_ptr& other) noexcept
+		: block_{other.block_}
+	{
+		if (block_)
+			block_->add_ref();
+	}
+
+	intrusive_ptr(intrusive_ptr&& other) noexcept
+		: block_{std::exchange(other.block_, nullptr)}
+	{}
+
+	intrusive_ptr& operator=(const intrusive_ptr& other) noexcept
+	{
+		intrusive_ptr{other}.swap(*this);
+		return *this;
+	}
+
+	intrusive_ptr& operator=(intrusive_ptr&& other) noexcept
+	{
+		intrusive_ptr{std::move(other)}.swap(*this);
+		return *this;
+	}
+
+	~intrusive_ptr()
+	{
+		reset();
+	}
+
+	template<typename... Args>
+	COW_NODISCARD static intrusive_ptr make(Args&&... args)
+	{
+		return allocate(allocator_type{}, std::forward<Args>(args)...);
+	}
+
+	template<typename... Args>
+	COW_NODISCARD static intrusive_ptr allocate(const allocator_type& allocator, Args&&... args)
+	{
+		block_allocator allocator_of_block{allocator};
+		block_type* const block = block_allocator_traits::allocate(allocator_of_block, 1);
+		try {
+			::new (static_cast<void*>(block)) block_type(allocator, std::forward<Args>(args)...);
+		}
+		catch (...) {
+			block_allocator_traits::deallocate(allocator_of_block, block, 1);
+			throw;
+		}
+
+		return intrusive_ptr{block};
+	}
+
+	/// Creates a new value with the allocator of this pointer.
+	template<typename... Args>
+	COW_NODISCARD intrusive_ptr make_similar(Args&&... args) const
+	{
+		return allocate(get_allocator(), std::forward<Args>(args)...);
+	}
+
+	/// \return The allocator of the value or the default constructed allocator if the pointer is empty.
+	COW_NODISCARD allocator_type get_allocator() const noexcept
+	{
+		return block_ ? block_->get_allocator() : allocator_type{};
+	}
+
+	/// Replaces the value by the value constructed from `args` in the same block. It must be called only by the only
+	/// owner of the value. If the constructor throws, the block is released and the pointer becomes empty.
+	template<typename... Args>
+	void emplace(Args&&... args)
+	{
+		block_->value.~T();
+		try {
+			::new (static_cast<void*>(std::addressof(block_->value))) T(std::forward<Args>(args)...);
+		}
+		catch (...) {
+			deallocate(std::exchange(block_, nullptr));
+			throw;
+		}
+
+		block_->invalidate_hash();
+	}
+
+	/// \return The hash of the value. It is cached in the block if `cache_hash<T>` is true.
+	COW_NODISCARD std::size_t hash() const
+	{
+		return block_->get_hash(block_->value);
+	}
+
+	/// \return true if the hash of the value is cached.
+	COW_NODISCARD bool try_get_hash(std::size_t& hash) const noexcept
+	{
+		return block_->try_get_hash(hash);
+	}
+
+	/// Resets the cached hash. It must be called by the only owner of the value when the value is changed.
+	void invalidate_hash() noexcept
+	{
+		block_->invalidate_hash();
+	}
+
+	COW_NODISCARD T* get() const noexcept
+	{
+		return block_ ? &block_->value : nullptr;
+	}
+
+	COW_NODISCARD T& operator*() const noexcept
+	{
+		return block_->value;
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return block_ != nullptr;
+	}
+
+	/// \return true if this pointer is the only owner of the value.
+	COW_NODISCARD bool unique() const noexcept
+	{
+		return block_ && block_->unique();
+	}
+
+	COW_NODISCARD std::size_t use_count() const noexcept
+	{
+		return block_ ? block_->use_count() : 0;
+	}
+
+	void reset() noexcept
+	{
+		if (block_type* const block = std::exchange(block_, nullptr))
+			block->release(&dispose);
+	}
+
+	void swap(intrusive_ptr& other) noexcept
+	{
+		std::swap(block_, other.block_);
+	}
+
+	// The functions below allow to keep references to the block without `intrusive_ptr` objects.
+
+	COW_NODISCARD block_pointer get_block() const noexcept
+	{
+		return block_;
+	}
+
+	/// Makes the pointer empty without releasing the reference to the block.
+	COW_NODISCARD block_pointer release_block() noexcept
+	{
+		return std::exchange(block_, nullptr);
+	}
+
+	/// Takes one of the references to the block which are not owned by other pointers.
+	COW_NODISCARD static intrusive_ptr adopt_block(const block_pointer block) noexcept
+	{
+		return intrusive_ptr{block};
+	}
+
+	static void add_block_refs(const block_pointer block, const std::size_t count) noexcept
+	{
+		block->add_ref(count);
+	}
+
+	static void release_block_refs(const block_pointer block, const std::size_t count) noexcept
+	{
+		block->release(count, &dispose);
+	}
+
+	/// Makes the current thread keep the references to the block which it releases. It is supported by reference
+	/// counters which provide `keep_released` only.
+	static void keep_released_block_refs(const block_pointer block) noexcept
+	{
+		block->keep_released(&dispose);
+	}
+
+private:
+	explicit intrusive_ptr(block_type* const block) noexcept
+		: block_{block}
+	{}
+
+	// the counter can be a base class of `RefCount` which calls the disposer with the pointer to itself
+	template<typename Counter>
+	static void dispose(Counter* const ref_count) noexcept
+	{
+		block_type* const block = static_cast<block_type*>(static_cast<RefCount*>(ref_count));
+		block->value.~T();
+		deallocate(block);
+	}
+
+	// releases the block which value is already destroyed
+	static void deallocate(block_type* const block) noexcept
+	{
+		block_allocator allocator_of_block{block->get_allocator()};
+		block->~block_type();
+		block_allocator_traits::deallocate(allocator_of_block, block, 1);
+	}
+
+	block_type* block_ = nullptr;
+};
+
+} // namespace detail
+} // namespace cow
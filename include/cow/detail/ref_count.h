@@ -0,0 +1,140 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include <atomic>
+#include <cstddef>
+
+namespace cow {
+namespace detail {
+
+// A reference counter is a base class of a shared block. A new counter holds one reference.
+// The `release` method calls the `disposer` function to destroy the block when the last reference is released.
+
+/// The size of the cache line which is assumed to avoid false sharing.
+constexpr std::size_t cache_line_size = 64;
+
+/// Thread-safe reference counter of a shared block.
+class atomic_ref_count {
+public:
+	using disposer = void (*)(atomic_ref_count*);
+
+	atomic_ref_count() = default;
+	atomic_ref_count(const atomic_ref_count&) = delete;
+	atomic_ref_count& operator=(const atomic_ref_count&) = delete;
+	~atomic_ref_count() = default;
+
+	void add_ref(const std::size_t count = 1) noexcept
+	{
+		count_.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void release(const disposer dispose) noexcept
+	{
+		release(1, dispose);
+	}
+
+	void release(const std::size_t count, const disposer dispose) noexcept
+	{
+		if (count_.fetch_sub(count, std::memory_order_acq_rel) == count)
+			dispose(this);
+	}
+
+	COW_NODISCARD bool unique() const noexcept
+	{
+		return count_.load(std::memory_order_acquire) == 1;
+	}
+
+	COW_NODISCARD std::size_t use_count() const noexcept
+	{
+		return count_.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<std::size_t> count_{1};
+};
+
+/// Reference counter of a shared block which is not synchronized between threads.
+/// All copies of the shared block owner must be used by one thread.
+class plain_ref_count {
+public:
+	using disposer = void (*)(plain_ref_count*);
+
+	plain_ref_count() = default;
+	plain_ref_count(const plain_ref_count&) = delete;
+	plain_ref_count& operator=(const plain_ref_count&) = delete;
+	~plain_ref_count() = default;
+
+	void add_ref() noexcept
+	{
+		++count_;
+	}
+
+	void release(const disposer dispose) noexcept
+	{
+		if (--count_ == 0)
+			dispose(this);
+	}
+
+	COW_NODISCARD bool unique() const noexcept
+	{
+		return count_ == 1;
+	}
+
+	COW_NODISCARD std::size_t use_count() const noexcept
+	{
+		return count_;
+	}
+
+private:
+	std::size_t count_ = 1;
+};
+
+/// Reference counter of a shared block which is never released: its memory is freed with the arena it is allocated
+/// from and the value has no destructor to call. Only copies change the counter, so the value stops being unique when
+/// it is copied for the first time and the next writes copy it.
+class monotonic_ref_count {
+public:
+	using disposer = void (*)(monotonic_ref_count*);
+
+	monotonic_ref_count() = default;
+	monotonic_ref_count(const monotonic_ref_count&) = delete;
+	monotonic_ref_count& operator=(const monotonic_ref_count&) = delete;
+	~monotonic_ref_count() = default;
+
+	void add_ref() noexcept
+	{
+		count_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void release(disposer /*dispose*/) noexcept
+	{}
+
+	COW_NODISCARD bool unique() const noexcept
+	{
+		return count_.load(std::memory_order_acquire) == 1;
+	}
+
+	COW_NODISCARD std::size_t use_count() const noexcept
+	{
+		return count_.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<std::size_t> count_{1};
+};
+
+/// Reference counter which is followed by the padding of the cache line size, so the changes of the counter do not
+/// invalidate the cache lines of the value kept after it in the shared block.
+template<typename RefCount>
+class cache_line_padded : public RefCount {
+public:
+	cache_line_padded() = default;
+	cache_line_padded(const cache_line_padded&) = delete;
+	cache_line_padded& operator=(const cache_line_padded&) = delete;
+	~cache_line_padded() = default;
+
+private:
+	char padding_[cache_line_size]{};
+};
+
+} // namespace detail
+} // namespace cow
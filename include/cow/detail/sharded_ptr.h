@@ -0,0 +1,238 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include "intrusive_ptr.h"
+#include "ref_count.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace cow {
+namespace detail {
+
+/// \return The sequential number of the current thread. It is used to choose the shard of a counter.
+inline std::size_t current_thread_number() noexcept
+{
+	static std::atomic<std::size_t> next_number{0};
+	static thread_local const std::size_t number = next_number.fetch_add(1, std::memory_order_relaxed);
+	return number;
+}
+
+/// Reference counter which is split into shards, each one in its own cache line. Threads copy and release references
+/// in their own shards, so the threads which copy the value at once do not write to the same cache line.
+/// The central part of the counter counts the shards which have references, so it is changed only when a shard
+/// becomes empty or stops being empty. A reference must be released in the shard where it was added.
+template<std::size_t ShardCount>
+class sharded_ref_count {
+	static_assert(ShardCount > 0, "There must be at least one shard");
+
+public:
+	/// Creates the counter with one reference in the shard of the current thread.
+	sharded_ref_count() noexcept
+	{
+		shards_[current_shard()].count.store(1, std::memory_order_relaxed);
+	}
+
+	sharded_ref_count(const sharded_ref_count&) = delete;
+	sharded_ref_count& operator=(const sharded_ref_count&) = delete;
+	~sharded_ref_count() = default;
+
+	/// \return The shard of the current thread.
+	COW_NODISCARD static std::size_t current_shard() noexcept
+	{
+		return current_thread_number() % ShardCount;
+	}
+
+	/// Adds a reference to `shard`. The caller must own another reference.
+	void add_ref(const std::size_t shard) noexcept
+	{
+		if (shards_[shard].count.fetch_add(1, std::memory_order_relaxed) == 0)
+			central_.fetch_add(version_unit + 1, std::memory_order_relaxed);
+	}
+
+	/// Releases a reference which was added to `shard`.
+	/// \return true if it was the last reference.
+	COW_NODISCARD bool release(const std::size_t shard) noexcept
+	{
+		if (shards_[shard].count.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return false;
+
+		const word_type central = central_.fetch_add(version_unit - 1, std::memory_order_acq_rel) + version_unit - 1;
+		return (central & count_mask) == 0;
+	}
+
+	/// \return true if the reference of the caller which was added to `shard` is the only one.
+	COW_NODISCARD bool unique(const std::size_t shard) const noexcept
+	{
+		// Only the shard of the caller has references and it has one reference. The version of the central part
+		// is checked again because other references could leave the shard through other shards while it is read.
+		const word_type central = central_.load(std::memory_order_acquire);
+		return (central & count_mask) == 1 && shards_[shard].count.load(std::memory_order_acquire) == 1
+			&& central_.load(std::memory_order_acquire) == central;
+	}
+
+	/// \return The approximate number of references. It is exact if the references are not changed at the moment.
+	COW_NODISCARD std::size_t use_count() const noexcept
+	{
+		std::size_t count = 0;
+		for (const shard_type& shard : shards_)
+			count += shard.count.load(std::memory_order_relaxed);
+
+		return count;
+	}
+
+private:
+	// the central part keeps the number of shards with references in the low bits and the version in the high bits
+	using word_type = std::uint64_t;
+
+	static constexpr word_type version_unit = word_type{1} << 32U;
+	static constexpr word_type count_mask = version_unit - 1;
+
+	// the shards are padded instead of aligned, so the block does not need an over-aligned allocation
+	struct shard_type {
+		std::atomic<std::size_t> count{0};
+		char padding[cache_line_size - sizeof(std::atomic<std::size_t>)]{};
+	};
+
+	std::atomic<word_type> central_{1};
+	shard_type shards_[ShardCount];
+};
+
+/// Pointer to the `intrusive_block` with `sharded_ref_count`. It keeps the shard where its reference is counted, so
+/// it has the size of two pointers.
+template<typename T, std::size_t ShardCount>
+class sharded_ptr {
+	using ref_count_type = sharded_ref_count<ShardCount>;
+	using block_type = intrusive_block<T, ref_count_type, std::allocator<char>>;
+
+public:
+	constexpr sharded_ptr() noexcept = default;
+
+	sharded_ptr(const sharded_ptr& other) noexcept
+		: block_{other.block_}
+		, shard_{ref_count_type::current_shard()}
+	{
+		if (block_)
+			block_->add_ref(shard_);
+	}
+
+	sharded_ptr(sharded_ptr&& other) noexcept
+		: block_{std::exchange(other.block_, nullptr)}
+		, shard_{other.shard_}
+	{}
+
+	sharded_ptr& operator=(const sharded_ptr& other) noexcept
+	{
+		sharded_ptr{other}.swap(*this);
+		return *this;
+	}
+
+	sharded_ptr& operator=(sharded_ptr&& other) noexcept
+	{
+		sharded_ptr{std::move(other)}.swap(*this);
+		return *this;
+	}
+
+	~sharded_ptr()
+	{
+		reset();
+	}
+
+	template<typename... Args>
+	COW_NODISCARD static sharded_ptr make(Args&&... args)
+	{
+		return sharded_ptr{new block_type(std::allocator<char>{}, std::forward<Args>(args)...)};
+	}
+
+	template<typename... Args>
+	COW_NODISCARD sharded_ptr make_similar(Args&&... args) const
+	{
+		return make(std::forward<Args>(args)...);
+	}
+
+	/// Replaces the value by the value constructed from `args` in the same block. It must be called only by the only
+	/// owner of the value. If the constructor throws, the block is released and the pointer becomes empty.
+	template<typename... Args>
+	void emplace(Args&&... args)
+	{
+		block_->value.~T();
+		try {
+			::new (static_cast<void*>(std::addressof(block_->value))) T(std::forward<Args>(args)...);
+		}
+		catch (...) {
+			delete std::exchange(block_, nullptr);
+			throw;
+		}
+
+		block_->invalidate_hash();
+	}
+
+	COW_NODISCARD std::size_t hash() const
+	{
+		return block_->get_hash(block_->value);
+	}
+
+	COW_NODISCARD bool try_get_hash(std::size_t& hash) const noexcept
+	{
+		return block_->try_get_hash(hash);
+	}
+
+	void invalidate_hash() noexcept
+	{
+		block_->invalidate_hash();
+	}
+
+	COW_NODISCARD T* get() const noexcept
+	{
+		return block_ ? &block_->value : nullptr;
+	}
+
+	COW_NODISCARD T& operator*() const noexcept
+	{
+		return block_->value;
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return block_ != nullptr;
+	}
+
+	COW_NODISCARD bool unique() const noexcept
+	{
+		return block_ && block_->unique(shard_);
+	}
+
+	COW_NODISCARD std::size_t use_count() const noexcept
+	{
+		return block_ ? block_->use_count() : 0;
+	}
+
+	void reset() noexcept
+	{
+		block_type* const block = std::exchange(block_, nullptr);
+		if (block && block->release(shard_)) {
+			block->value.~T();
+			delete block;
+		}
+	}
+
+	void swap(sharded_ptr& other) noexcept
+	{
+		std::swap(block_, other.block_);
+		std::swap(shard_, other.shard_);
+	}
+
+private:
+	explicit sharded_ptr(block_type* const block) noexcept
+		: block_{block}
+		, shard_{ref_count_type::current_shard()}
+	{}
+
+	block_type* block_ = nullptr;
+	std::size_t shard_ = 0;
+};
+
+} // namespace detail
+} // namespace cow
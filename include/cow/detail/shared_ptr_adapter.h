@@ -0,0 +1,110 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include "hash_cache.h"
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace cow {
+namespace detail {
+
+/// Adapts `std::shared_ptr` to the pointer interface of the storage policies.
+template<typename T>
+class shared_ptr_adapter {
+	template<typename>
+	friend class shared_ptr_adapter;
+
+public:
+	constexpr shared_ptr_adapter() noexcept = default;
+
+	template<typename U, typename = std::enable_if_t<std::is_convertible<U*, T*>::value>>
+	shared_ptr_adapter(const shared_ptr_adapter<U>& other) noexcept // NOLINT: Allow implicit conversion
+		: data_{other.data_}
+	{}
+
+	template<typename U, typename = std::enable_if_t<std::is_convertible<U*, T*>::value>>
+	shared_ptr_adapter(shared_ptr_adapter<U>&& other) noexcept // NOLINT: Allow implicit conversion
+		: data_{std::move(other.data_)}
+	{}
+
+	template<typename... Args>
+	COW_NODISCARD static shared_ptr_adapter make(Args&&... args)
+	{
+		return shared_ptr_adapter{std::make_shared<T>(std::forward<Args>(args)...)};
+	}
+
+	/// Creates a new value. `std::shared_ptr` does not keep the allocator, so the default allocator is used.
+	template<typename... Args>
+	COW_NODISCARD shared_ptr_adapter make_similar(Args&&... args) const
+	{
+		return make(std::forward<Args>(args)...);
+	}
+
+	/// Replaces the value by the value constructed from `args`. The value can have a type derived from T, so it can not
+	/// be reconstructed in the same memory and a new value is always created.
+	template<typename... Args>
+	void emplace(Args&&... args)
+	{
+		data_ = std::make_shared<T>(std::forward<Args>(args)...);
+	}
+
+	/// \return The hash of the value. `std::shared_ptr` has no place for the hash, so it is not cached.
+	COW_NODISCARD std::size_t hash() const
+	{
+		return compute_hash(*data_);
+	}
+
+	COW_NODISCARD bool try_get_hash(std::size_t& /*hash*/) const noexcept
+	{
+		return false;
+	}
+
+	void invalidate_hash() noexcept {}
+
+	COW_NODISCARD T* get() const noexcept
+	{
+		return data_.get();
+	}
+
+	COW_NODISCARD T& operator*() const noexcept
+	{
+		return *data_;
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return static_cast<bool>(data_);
+	}
+
+	/// \return true if this pointer is the only owner of the value.
+	COW_NODISCARD bool unique() const noexcept
+	{
+		return data_.use_count() == 1;
+	}
+
+	COW_NODISCARD std::size_t use_count() const noexcept
+	{
+		return static_cast<std::size_t>(data_.use_count());
+	}
+
+	void reset() noexcept
+	{
+		data_.reset();
+	}
+
+	void swap(shared_ptr_adapter& other) noexcept
+	{
+		data_.swap(other.data_);
+	}
+
+private:
+	explicit shared_ptr_adapter(std::shared_ptr<T> data) noexcept
+		: data_{std::move(data)}
+	{}
+
+	std::shared_ptr<T> data_;
+};
+
+} // namespace detail
+} // namespace cow
@@ -0,0 +1,149 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace cow {
+namespace detail {
+
+/// Thread-safe reference counter which lets a thread keep the references to one counter which it releases without
+/// subtracting them from the counter and reuse them for new references to the same block (see `keep_released`).
+/// The thread holds one more reference to this counter, so the block is not destroyed and its address is not reused
+/// while the thread keeps the references. They are subtracted when the thread keeps the references to another counter
+/// of the same type, calls `release_kept()` or finishes.
+/// \tparam Counter The derived class. Its method `dispose_last(disposer)` is called when the last reference is
+///                 subtracted.
+template<typename Counter>
+class kept_ref_count {
+public:
+	using disposer = void (*)(Counter*);
+
+	kept_ref_count() = default;
+	kept_ref_count(const kept_ref_count&) = delete;
+	kept_ref_count& operator=(const kept_ref_count&) = delete;
+	~kept_ref_count() = default;
+
+	void add_ref(const std::size_t count = 1) noexcept
+	{
+		count_.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void release(const disposer dispose) noexcept
+	{
+		release(1, dispose);
+	}
+
+	void release(const std::size_t count, const disposer dispose) noexcept
+	{
+		released_refs& released = thread_released();
+		if (released.counter == this && released.count + count <= max_released_count) {
+			released.count += count;
+			return;
+		}
+
+		subtract(count, dispose);
+	}
+
+	COW_NODISCARD bool unique() const noexcept
+	{
+		// the references kept by the current thread and its own reference are not owned by anyone
+		const released_refs& released = thread_released();
+		const std::size_t kept = released.counter == this ? released.count + 1 : 0;
+		return count_.load(std::memory_order_acquire) == kept + 1;
+	}
+
+	COW_NODISCARD std::size_t use_count() const noexcept
+	{
+		return count_.load(std::memory_order_relaxed);
+	}
+
+	/// Makes the current thread keep the references to this counter which it releases. The references kept for another
+	/// counter are subtracted from it. The caller must own a reference to this counter.
+	/// \param dispose The disposer of the block which is called if the thread releases the last reference.
+	void keep_released(const disposer dispose) noexcept
+	{
+		released_refs& released = thread_released();
+		if (released.counter != this) {
+			released.flush();
+			add_ref();
+			released.counter = this;
+			released.dispose = dispose;
+		}
+	}
+
+	/// Takes one of the references to `counter` kept by the current thread.
+	/// \return false if the thread does not keep references to `counter`.
+	COW_NODISCARD static bool reuse_released(const kept_ref_count* const counter) noexcept
+	{
+		released_refs& released = thread_released();
+		if (released.counter != counter || released.count == 0)
+			return false;
+
+		--released.count;
+		return true;
+	}
+
+	/// Subtracts the references kept by the current thread.
+	static void release_kept() noexcept
+	{
+		thread_released().flush();
+	}
+
+private:
+	// the references kept by a thread, they are subtracted from the counter by the thread only
+	struct released_refs {
+		released_refs() = default;
+		released_refs(const released_refs&) = delete;
+		released_refs& operator=(const released_refs&) = delete;
+
+		~released_refs()
+		{
+			flush();
+		}
+
+		void flush() noexcept
+		{
+			// the reference of the thread is subtracted too, so the counter is forgotten
+			if (counter)
+				std::exchange(counter, nullptr)->subtract(std::exchange(count, 0) + 1, dispose);
+		}
+
+		kept_ref_count* counter = nullptr;
+		std::size_t count = 0;
+		disposer dispose = nullptr;
+	};
+
+	// the kept references can delay the destruction of the block, so their number is limited
+	static constexpr std::size_t max_released_count = 0x1000;
+
+	static released_refs& thread_released() noexcept
+	{
+		static thread_local released_refs released;
+		return released;
+	}
+
+	void subtract(const std::size_t count, const disposer dispose) noexcept
+	{
+		if (count_.fetch_sub(count, std::memory_order_acq_rel) == count)
+			static_cast<Counter*>(this)->dispose_last(dispose);
+	}
+
+	std::atomic<std::size_t> count_{1};
+};
+
+/// Thread-safe reference counter of the values loaded from `atomic_optional`. The thread which loads the value keeps
+/// the references it releases to the value and reuses them for the next loads of the same value. The block is destroyed
+/// by the thread which subtracts the last reference.
+class snapshot_ref_count : public kept_ref_count<snapshot_ref_count> {
+	friend class kept_ref_count<snapshot_ref_count>;
+
+private:
+	void dispose_last(const disposer dispose) noexcept
+	{
+		dispose(this);
+	}
+};
+
+} // namespace detail
+} // namespace cow
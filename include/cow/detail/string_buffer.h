@@ -0,0 +1,94 @@
+#pragma once
+#include "compatibility/compile_features.h"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace cow {
+namespace detail {
+
+/// Shared block of a string. The characters and the terminating null character are kept in the same allocation right
+/// after the block, so the string is reached through one pointer.
+template<typename CharT, typename RefCount>
+class string_buffer : public RefCount {
+	static_assert(alignof(CharT) <= alignof(std::size_t), "The characters must be aligned by the block");
+
+public:
+	string_buffer(const string_buffer&) = delete;
+	string_buffer& operator=(const string_buffer&) = delete;
+
+	/// \return The new buffer with one reference and the empty string. The capacity must not exceed `max_capacity()`.
+	COW_NODISCARD static string_buffer* allocate(const std::size_t capacity)
+	{
+		void* const memory = ::operator new(sizeof(string_buffer) + (capacity + 1) * sizeof(CharT));
+		// the constructor of the counter can throw (`biased_ref_count` allocates the record of its owner thread)
+		try {
+			return ::new (memory) string_buffer{capacity};
+		}
+		catch (...) {
+			::operator delete(memory);
+			throw;
+		}
+	}
+
+	COW_NODISCARD static constexpr std::size_t max_capacity() noexcept
+	{
+		return (static_cast<std::size_t>(-1) - sizeof(string_buffer)) / sizeof(CharT) - 1;
+	}
+
+	void release() noexcept
+	{
+		RefCount::release(&dispose);
+	}
+
+	COW_NODISCARD CharT* data() noexcept
+	{
+		return reinterpret_cast<CharT*>(this + 1); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	}
+
+	COW_NODISCARD const CharT* data() const noexcept
+	{
+		return reinterpret_cast<const CharT*>(this + 1); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	}
+
+	COW_NODISCARD std::size_t size() const noexcept
+	{
+		return size_;
+	}
+
+	COW_NODISCARD std::size_t capacity() const noexcept
+	{
+		return capacity_;
+	}
+
+	/// Changes the size and writes the terminating null character.
+	void set_size(const std::size_t size) noexcept
+	{
+		size_ = size;
+		data()[size] = CharT();
+	}
+
+private:
+	explicit string_buffer(const std::size_t capacity) noexcept(std::is_nothrow_default_constructible<RefCount>::value)
+		: capacity_{capacity}
+	{
+		data()[0] = CharT();
+	}
+
+	~string_buffer() = default;
+
+	// the counter can be a base class of `RefCount` which calls the disposer with the pointer to itself
+	template<typename Counter>
+	static void dispose(Counter* const ref_count) noexcept
+	{
+		string_buffer* const buffer = static_cast<string_buffer*>(static_cast<RefCount*>(ref_count));
+		buffer->~string_buffer();
+		::operator delete(buffer);
+	}
+
+	std::size_t size_ = 0;
+	std::size_t capacity_;
+};
+
+} // namespace detail
+} // namespace cow
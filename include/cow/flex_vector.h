@@ -0,0 +1,1161 @@
+#pragma once
+#include "detail/child_array.h"
+#include "detail/chunk.h"
+#include "detail/compatibility/compile_features.h"
+#include "optional.h"
+#include "storage.h"
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+synopsis
+
+namespace cow {
+
+/// Sequence of values kept in a relaxed radix balanced tree (RRB-tree). The leaves of the tree keep up to `2^Bits`
+/// values and the inner nodes keep up to `2^Bits` children with the table of their sizes, so the leaves and the inner
+/// nodes may be not full. The copy of the vector shares the tree, so it is O(1). The modifications copy only the nodes
+/// on the path to the changed values if they are shared, the nodes which are owned only by this vector are changed in
+/// place. Writing an element, `push_back`, `take`, `drop` and `concat` are O(log n). The nodes are kept by the storage
+/// policy `Storage`. The references to the elements and the iterators are invalidated by any modification.
+template<typename T, std::size_t Bits = 5, typename Storage = intrusive_storage>
+class flex_vector {
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = const T&;
+	using const_reference = const T&;
+	class const_iterator; // random access iterator
+	using iterator = const_iterator;
+	using transient_type = flex_vector_transient<T, Bits, Storage>;
+
+	// constructors
+
+	flex_vector() noexcept;
+	flex_vector(size_type count, const T& value);
+	template<typename InputIt>
+	flex_vector(InputIt first, InputIt last);
+	flex_vector(std::initializer_list<T> ilist);
+
+	flex_vector(const flex_vector& other) noexcept;
+	flex_vector(flex_vector&& other) noexcept;
+
+	flex_vector& operator=(const flex_vector& other) noexcept;
+	flex_vector& operator=(flex_vector&& other) noexcept;
+
+	~flex_vector();
+
+	// element access
+
+	const T& operator[](size_type pos) const noexcept;
+	const T& at(size_type pos) const;
+	const T& front() const noexcept;
+	const T& back() const noexcept;
+
+	// iterators
+
+	const_iterator begin() const noexcept;
+	const_iterator cbegin() const noexcept;
+	const_iterator end() const noexcept;
+	const_iterator cend() const noexcept;
+
+	// capacity
+
+	bool empty() const noexcept;
+	size_type size() const noexcept;
+
+	// modifiers
+	// `pos` must be less than `size()`.
+
+	/// Gives mutable access to the element `pos`. The vector must not be copied while the session is used.
+	write_session<T> write(size_type pos);
+	template<typename F>
+	decltype(auto) modify(size_type pos, F&& f);
+	template<typename U>
+	void set(size_type pos, U&& value);
+
+	void push_back(const T& value);
+	void push_back(T&& value);
+	template<typename... Args>
+	const T& emplace_back(Args&&... args);
+
+	/// Keeps the first `count` elements.
+	void take(size_type count);
+	/// Removes the first `count` elements.
+	void drop(size_type count);
+	/// Appends the elements of `other`, the nodes of `other` are shared with this vector.
+	void append(const flex_vector& other);
+
+	void clear() noexcept;
+	void swap(flex_vector& other) noexcept;
+
+	/// \return The builder which changes the elements of the vector without the copies of the vector. It collects
+	///         the appended elements in a leaf and puts the whole leaf to the tree.
+	transient_type transient() const&;
+	transient_type transient() &&;
+
+	// observers
+
+	/// \return true if the vectors share the tree, so they are equal.
+	bool shares_storage_with(const flex_vector& other) const noexcept;
+};
+
+/// Builder of `flex_vector`. It can not be copied, so its leaf for the appended elements is changed without checks.
+template<typename T, std::size_t Bits, typename Storage>
+class flex_vector_transient {
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+
+	flex_vector_transient() noexcept;
+	flex_vector_transient(flex_vector_transient&& other) noexcept;
+	flex_vector_transient& operator=(flex_vector_transient&& other) noexcept;
+
+	const T& operator[](size_type pos) const noexcept;
+	bool empty() const noexcept;
+	size_type size() const noexcept;
+
+	write_session<T> write(size_type pos);
+	template<typename F>
+	decltype(auto) modify(size_type pos, F&& f);
+	template<typename U>
+	void set(size_type pos, U&& value);
+
+	void push_back(const T& value);
+	void push_back(T&& value);
+	template<typename... Args>
+	const T& emplace_back(Args&&... args);
+	void take(size_type count);
+	void drop(size_type count);
+	void append(const flex_vector<T, Bits, Storage>& other);
+
+	/// \return The vector with the elements of the builder. The builder becomes empty.
+	flex_vector<T, Bits, Storage> persistent();
+};
+
+// relational operations
+// The vectors which share the tree are equal without comparison of values.
+
+template<typename T, std::size_t Bits, typename Storage>
+bool operator==(const flex_vector<T, Bits, Storage>& lhs, const flex_vector<T, Bits, Storage>& rhs);
+template<typename T, std::size_t Bits, typename Storage>
+bool operator!=(const flex_vector<T, Bits, Storage>& lhs, const flex_vector<T, Bits, Storage>& rhs);
+template<typename T, std::size_t Bits, typename Storage>
+bool operator<(const flex_vector<T, Bits, Storage>& lhs, const flex_vector<T, Bits, Storage>& rhs);
+template<typename T, std::size_t Bits, typename Storage>
+bool operator>(const flex_vector<T, Bits, Storage>& lhs, const flex_vector<T, Bits, Storage>& rhs);
+template<typename T, std::size_t Bits, typename Storage>
+bool operator<=(const flex_vector<T, Bits, Storage>& lhs, const flex_vector<T, Bits, Storage>& rhs);
+template<typename T, std::size_t Bits, typename Storage>
+bool operator>=(const flex_vector<T, Bits, Storage>& lhs, const flex_vector<T, Bits, Storage>& rhs);
+
+// concatenation
+
+template<typename T, std::size_t Bits, typename Storage>
+flex_vector<T, Bits, Storage> concat(flex_vector<T, Bits, Storage> lhs, const flex_vector<T, Bits, Storage>& rhs);
+template<typename T, std::size_t Bits, typename Storage>
+flex_vector<T, Bits, Storage> operator+(flex_vector<T, Bits, Storage> lhs, const flex_vector<T, Bits, Storage>& rhs);
+
+// specialized algorithms
+
+template<typename T, std::size_t Bits, typename Storage>
+void swap(flex_vector<T, Bits, Storage>& lhs, flex_vector<T, Bits, Storage>& rhs) noexcept;
+
+} // namespace cow
+*/
+
+namespace cow {
+
+template<typename T, std::size_t Bits, typename Storage>
+class flex_vector_transient;
+
+template<typename T, std::size_t Bits = 5, typename Storage = intrusive_storage>
+class flex_vector {
+	static_assert(
+		!std::is_reference<T>::value, "Instantiation of flex_vector with a reference type is ill-formed");
+	static_assert(
+		std::is_destructible<T>::value, "Instantiation of flex_vector with a non-destructible type is ill-formed");
+	static_assert(Bits > 0 && Bits < 16, "The number of bits of the node index must be in [1, 16)");
+
+	friend class flex_vector_transient<T, Bits, Storage>;
+
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = const T&;
+	using const_reference = const T&;
+	using transient_type = flex_vector_transient<T, Bits, Storage>;
+
+private:
+	static constexpr size_type branching = size_type{1} << Bits;
+
+	// the nodes of height 1 keep leaves, the higher nodes keep inner nodes
+	struct inner_node;
+	using leaf_node = detail::chunk<T, branching>;
+	using leaf_pointer = typename Storage::template pointer<leaf_node>;
+	using inner_pointer = typename Storage::template pointer<inner_node>;
+
+	struct inner_node : detail::child_array<leaf_pointer, inner_pointer, branching> {
+		using detail::child_array<leaf_pointer, inner_pointer, branching>::child_array;
+
+		// `sizes[i]` is the number of values in the children [0, i]
+		size_type sizes[branching]{};
+	};
+
+public:
+	class const_iterator {
+		friend class flex_vector;
+
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		const_iterator() noexcept = default;
+
+		// the leaf of the last dereferenced element is cached, so the sequential access does not walk the tree
+		COW_NODISCARD reference operator*() const noexcept
+		{
+			if (pos_ < leaf_first_ || pos_ >= leaf_last_) {
+				size_type offset = pos_;
+				leaf_ = &find_leaf(root_, height_, offset);
+				leaf_first_ = pos_ - offset;
+				leaf_last_ = leaf_first_ + leaf_->size();
+			}
+
+			return (*leaf_)[pos_ - leaf_first_];
+		}
+
+		COW_NODISCARD pointer operator->() const noexcept
+		{
+			return std::addressof(**this);
+		}
+
+		COW_NODISCARD reference operator[](const difference_type n) const noexcept
+		{
+			return *(*this + n);
+		}
+
+		const_iterator& operator++() noexcept
+		{
+			++pos_;
+			return *this;
+		}
+
+		const_iterator operator++(int) noexcept
+		{
+			const_iterator result{*this};
+			++pos_;
+			return result;
+		}
+
+		const_iterator& operator--() noexcept
+		{
+			--pos_;
+			return *this;
+		}
+
+		const_iterator operator--(int) noexcept
+		{
+			const_iterator result{*this};
+			--pos_;
+			return result;
+		}
+
+		const_iterator& operator+=(const difference_type n) noexcept
+		{
+			pos_ = static_cast<size_type>(static_cast<difference_type>(pos_) + n);
+			return *this;
+		}
+
+		const_iterator& operator-=(const difference_type n) noexcept
+		{
+			return *this += -n;
+		}
+
+		COW_NODISCARD friend const_iterator operator+(const_iterator it, const difference_type n) noexcept
+		{
+			return it += n;
+		}
+
+		COW_NODISCARD friend const_iterator operator+(const difference_type n, const_iterator it) noexcept
+		{
+			return it += n;
+		}
+
+		COW_NODISCARD friend const_iterator operator-(const_iterator it, const difference_type n) noexcept
+		{
+			return it -= n;
+		}
+
+		COW_NODISCARD friend difference_type operator-(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return static_cast<difference_type>(lhs.pos_) - static_cast<difference_type>(rhs.pos_);
+		}
+
+		COW_NODISCARD friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ == rhs.pos_;
+		}
+
+		COW_NODISCARD friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ != rhs.pos_;
+		}
+
+		COW_NODISCARD friend bool operator<(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ < rhs.pos_;
+		}
+
+		COW_NODISCARD friend bool operator>(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ > rhs.pos_;
+		}
+
+		COW_NODISCARD friend bool operator<=(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ <= rhs.pos_;
+		}
+
+		COW_NODISCARD friend bool operator>=(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ >= rhs.pos_;
+		}
+
+	private:
+		const_iterator(const inner_node* const root, const size_type height, const size_type pos) noexcept
+			: root_{root}
+			, height_{height}
+			, pos_{pos}
+		{}
+
+		// the iterator keeps the root instead of the vector, so it is valid after the vector is moved
+		const inner_node* root_ = nullptr;
+		size_type height_ = 0;
+		size_type pos_ = 0;
+		mutable const leaf_node* leaf_ = nullptr;
+		mutable size_type leaf_first_ = 0;
+		mutable size_type leaf_last_ = 0;
+	};
+
+	using iterator = const_iterator;
+
+	// constructors
+
+	flex_vector() noexcept = default;
+
+	flex_vector(const size_type count, const T& value)
+	{
+		transient_type builder;
+		for (size_type i = 0; i != count; ++i)
+			builder.push_back(value);
+		*this = builder.persistent();
+	}
+
+	template<
+		typename InputIt,
+		typename = std::enable_if_t<std::is_convertible<
+			typename std::iterator_traits<InputIt>::iterator_category, std::input_iterator_tag>::value>>
+	flex_vector(InputIt first, const InputIt last)
+	{
+		transient_type builder;
+		for (; first != last; ++first)
+			builder.emplace_back(*first);
+		*this = builder.persistent();
+	}
+
+	flex_vector(const std::initializer_list<T> ilist)
+		: flex_vector(ilist.begin(), ilist.end())
+	{}
+
+	flex_vector(const flex_vector&) = default;
+
+	flex_vector(flex_vector&& other) noexcept
+		: root_{std::move(other.root_)}
+		, height_{other.height_}
+		, size_{other.size_}
+	{
+		other.root_.reset();
+		other.height_ = 0;
+		other.size_ = 0;
+	}
+
+	flex_vector& operator=(const flex_vector&) = default;
+
+	flex_vector& operator=(flex_vector&& other) noexcept
+	{
+		flex_vector{std::move(other)}.swap(*this);
+		return *this;
+	}
+
+	~flex_vector() = default;
+
+	// element access
+
+	COW_NODISCARD const T& operator[](size_type pos) const noexcept
+	{
+		const leaf_node& leaf = find_leaf(root_.get(), height_, pos);
+		return leaf[pos];
+	}
+
+	COW_NODISCARD const T& at(const size_type pos) const
+	{
+		if (pos >= size_)
+			throw std::out_of_range{"cow::flex_vector::at"};
+
+		return (*this)[pos];
+	}
+
+	COW_NODISCARD const T& front() const noexcept
+	{
+		return (*this)[0];
+	}
+
+	COW_NODISCARD const T& back() const noexcept
+	{
+		return (*this)[size_ - 1];
+	}
+
+	// iterators
+
+	COW_NODISCARD const_iterator begin() const noexcept
+	{
+		return const_iterator{root_.get(), height_, 0};
+	}
+
+	COW_NODISCARD const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+
+	COW_NODISCARD const_iterator end() const noexcept
+	{
+		return const_iterator{root_.get(), height_, size_};
+	}
+
+	COW_NODISCARD const_iterator cend() const noexcept
+	{
+		return end();
+	}
+
+	// capacity
+
+	COW_NODISCARD bool empty() const noexcept
+	{
+		return size_ == 0;
+	}
+
+	COW_NODISCARD size_type size() const noexcept
+	{
+		return size_;
+	}
+
+	// modifiers
+
+	COW_NODISCARD write_session<T> write(size_type pos)
+	{
+		inner_node* node = &mutable_node(root_);
+		for (size_type height = height_; height != 1; --height)
+			node = &mutable_node(node->inners[find_child(*node, height, pos)]);
+		leaf_node& leaf = mutable_node(node->leaves[find_child(*node, 1, pos)]);
+
+		return detail::write_session_access::make(leaf[pos]);
+	}
+
+	template<typename F>
+	decltype(auto) modify(const size_type pos, F&& f)
+	{
+		return std::forward<F>(f)(*write(pos));
+	}
+
+	template<typename U>
+	void set(const size_type pos, U&& value)
+	{
+		*write(pos) = std::forward<U>(value);
+	}
+
+	void push_back(const T& value)
+	{
+		emplace_back(value);
+	}
+
+	void push_back(T&& value)
+	{
+		emplace_back(std::move(value));
+	}
+
+	// The new element is constructed before the old nodes are released, so `args` may refer to the elements of
+	// the vector.
+	template<typename... Args>
+	const T& emplace_back(Args&&... args)
+	{
+		if (root_ && !last_leaf().full()) {
+			const T& value = emplace_in_last_leaf(mutable_node(root_), height_, std::forward<Args>(args)...);
+			++size_;
+			return value;
+		}
+
+		leaf_pointer leaf = leaf_pointer::make();
+		const T& value = (*leaf).emplace_back(std::forward<Args>(args)...);
+		push_leaf(std::move(leaf));
+		return value;
+	}
+
+	void take(const size_type count)
+	{
+		if (count >= size_)
+			return;
+		if (count == 0) {
+			clear();
+			return;
+		}
+
+		take_values(mutable_node(root_), height_, count);
+		size_ = count;
+		shrink();
+	}
+
+	void drop(const size_type count)
+	{
+		if (count == 0)
+			return;
+		if (count >= size_) {
+			clear();
+			return;
+		}
+
+		drop_values(mutable_node(root_), height_, count);
+		size_ -= count;
+		shrink();
+	}
+
+	void append(const flex_vector& other)
+	{
+		if (other.empty())
+			return;
+		if (empty()) {
+			*this = other;
+			return;
+		}
+
+		inner_pointer root = concat_nodes(root_, height_, other.root_, other.height_);
+		root_ = std::move(root);
+		height_ = std::max(height_, other.height_) + 1;
+		size_ += other.size_;
+		shrink();
+	}
+
+	void clear() noexcept
+	{
+		root_.reset();
+		height_ = 0;
+		size_ = 0;
+	}
+
+	void swap(flex_vector& other) noexcept
+	{
+		root_.swap(other.root_);
+		std::swap(height_, other.height_);
+		std::swap(size_, other.size_);
+	}
+
+	COW_NODISCARD transient_type transient() const&
+	{
+		return transient_type{flex_vector{*this}};
+	}
+
+	COW_NODISCARD transient_type transient() &&
+	{
+		return transient_type{std::move(*this)};
+	}
+
+	// observers
+
+	COW_NODISCARD bool shares_storage_with(const flex_vector& other) const noexcept
+	{
+		return root_ && root_.get() == other.root_.get();
+	}
+
+	// relational operations
+
+	COW_NODISCARD friend bool operator==(const flex_vector& lhs, const flex_vector& rhs)
+	{
+		if (lhs.size_ != rhs.size_)
+			return false;
+		if (lhs.shares_storage_with(rhs))
+			return true;
+
+		return std::equal(lhs.begin(), lhs.end(), rhs.begin());
+	}
+
+	COW_NODISCARD friend bool operator!=(const flex_vector& lhs, const flex_vector& rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+	COW_NODISCARD friend bool operator<(const flex_vector& lhs, const flex_vector& rhs)
+	{
+		if (lhs.shares_storage_with(rhs))
+			return false;
+
+		return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	}
+
+	COW_NODISCARD friend bool operator>(const flex_vector& lhs, const flex_vector& rhs)
+	{
+		return rhs < lhs;
+	}
+
+	COW_NODISCARD friend bool operator<=(const flex_vector& lhs, const flex_vector& rhs)
+	{
+		return !(rhs < lhs);
+	}
+
+	COW_NODISCARD friend bool operator>=(const flex_vector& lhs, const flex_vector& rhs)
+	{
+		return !(lhs < rhs);
+	}
+
+private:
+	// ## nodes
+
+	static size_type child_count(const inner_node& node) noexcept
+	{
+		return node.child_count();
+	}
+
+	static size_type value_count(const leaf_node& node) noexcept
+	{
+		return node.size();
+	}
+
+	static size_type value_count(const inner_node& node) noexcept
+	{
+		const size_type count = child_count(node);
+		return count == 0 ? 0 : node.sizes[count - 1];
+	}
+
+	static size_type slot_count(const leaf_pointer& node) noexcept
+	{
+		return (*node).size();
+	}
+
+	static size_type slot_count(const inner_pointer& node) noexcept
+	{
+		return child_count(*node);
+	}
+
+	// the node which is not shared with other vectors
+	template<typename Pointer>
+	static auto& mutable_node(Pointer& node)
+	{
+		if (!node.unique())
+			node = node.make_similar(*node);
+
+		return *node;
+	}
+
+	// the empty node which keeps the slots of the same kind as `node`
+	static leaf_pointer make_empty_like(const leaf_node&)
+	{
+		return leaf_pointer::make();
+	}
+
+	static inner_pointer make_empty_like(const inner_node& node)
+	{
+		return inner_pointer::make(node.keeps_leaves());
+	}
+
+	static void append_child(inner_node& node, leaf_pointer child)
+	{
+		const size_type count = child_count(node);
+		const size_type size = value_count(*child);
+		node.leaves.emplace_back(std::move(child));
+		node.sizes[count] = (count == 0 ? 0 : node.sizes[count - 1]) + size;
+	}
+
+	static void append_child(inner_node& node, inner_pointer child)
+	{
+		const size_type count = child_count(node);
+		const size_type size = value_count(*child);
+		node.inners.emplace_back(std::move(child));
+		node.sizes[count] = (count == 0 ? 0 : node.sizes[count - 1]) + size;
+	}
+
+	// the branch of nodes of height [1, `height`] which keeps only `leaf`
+	static inner_pointer make_path(const size_type height, leaf_pointer leaf)
+	{
+		inner_pointer node = inner_pointer::make(height == 1);
+		if (height == 1)
+			append_child(*node, std::move(leaf));
+		else
+			append_child(*node, make_path(height - 1, std::move(leaf)));
+
+		return node;
+	}
+
+	// ## search
+
+	// The child of a node of height h keeps at most 2^(Bits * h) values, so the index of the child which keeps the value
+	// `pos` is not less than pos >> (Bits * h). The search starts from this index and it is exact for the full nodes.
+	// `pos` becomes the position of the value in the child.
+	static size_type find_child(const inner_node& node, const size_type height, size_type& pos) noexcept
+	{
+		const size_type shift = Bits * height;
+		size_type i = shift < std::numeric_limits<size_type>::digits ? pos >> shift : 0;
+		i = std::min(i, child_count(node) - 1);
+		while (node.sizes[i] <= pos)
+			++i;
+		if (i != 0)
+			pos -= node.sizes[i - 1];
+
+		return i;
+	}
+
+	// `pos` becomes the position of the value in the leaf of the tree with the root `root` of height `root_height`
+	static const leaf_node& find_leaf(const inner_node* node, const size_type root_height, size_type& pos) noexcept
+	{
+		for (size_type height = root_height; height != 1; --height)
+			node = node->inners[find_child(*node, height, pos)].get();
+
+		return *node->leaves[find_child(*node, 1, pos)];
+	}
+
+	const leaf_node& last_leaf() const noexcept
+	{
+		const inner_node* node = root_.get();
+		for (size_type height = height_; height != 1; --height)
+			node = node->inners[node->inners.size() - 1].get();
+
+		return *node->leaves[node->leaves.size() - 1];
+	}
+
+	// ## push_back
+
+	template<typename... Args>
+	static const T& emplace_in_last_leaf(inner_node& node, const size_type height, Args&&... args)
+	{
+		const size_type last = child_count(node) - 1;
+		const T& value = height == 1
+			? mutable_node(node.leaves[last]).emplace_back(std::forward<Args>(args)...)
+			: emplace_in_last_leaf(mutable_node(node.inners[last]), height - 1, std::forward<Args>(args)...);
+		++node.sizes[last];
+		return value;
+	}
+
+	// true if a leaf can be added to the rightmost branch of the node
+	static bool has_room(const inner_node& node, const size_type height) noexcept
+	{
+		if (child_count(node) != branching)
+			return true;
+
+		return height != 1 && has_room(*node.inners[branching - 1], height - 1);
+	}
+
+	static void push_leaf(inner_node& node, const size_type height, leaf_pointer leaf, const size_type size)
+	{
+		if (height == 1) {
+			append_child(node, std::move(leaf));
+			return;
+		}
+
+		const size_type last = child_count(node) - 1;
+		if (has_room(*node.inners[last], height - 1)) {
+			push_leaf(mutable_node(node.inners[last]), height - 1, std::move(leaf), size);
+			node.sizes[last] += size;
+		}
+		else
+			append_child(node, make_path(height - 1, std::move(leaf)));
+	}
+
+	void push_leaf(leaf_pointer leaf)
+	{
+		const size_type size = value_count(*leaf);
+		if (!root_) {
+			root_ = make_path(1, std::move(leaf));
+			height_ = 1;
+		}
+		else if (has_room(*root_, height_))
+			push_leaf(mutable_node(root_), height_, std::move(leaf), size);
+		else {
+			inner_pointer root = inner_pointer::make(false);
+			append_child(*root, root_);
+			append_child(*root, make_path(height_, std::move(leaf)));
+			root_ = std::move(root);
+			++height_;
+		}
+
+		size_ += size;
+	}
+
+	// ## take and drop
+
+	static void take_values(inner_node& node, const size_type height, const size_type count)
+	{
+		size_type pos = count - 1;
+		const size_type i = find_child(node, height, pos);
+		if (height == 1) {
+			while (node.leaves.size() != i + 1)
+				node.leaves.pop_back();
+			if (pos + 1 != value_count(*node.leaves[i])) {
+				leaf_node& leaf = mutable_node(node.leaves[i]);
+				while (leaf.size() != pos + 1)
+					leaf.pop_back();
+			}
+		}
+		else {
+			while (node.inners.size() != i + 1)
+				node.inners.pop_back();
+			if (pos + 1 != value_count(*node.inners[i]))
+				take_values(mutable_node(node.inners[i]), height - 1, pos + 1);
+		}
+
+		node.sizes[i] = count;
+	}
+
+	static void drop_values(inner_node& node, const size_type height, const size_type count)
+	{
+		size_type pos = count;
+		const size_type i = find_child(node, height, pos);
+		if (height == 1) {
+			if (pos != 0)
+				mutable_node(node.leaves[i]).erase_front(pos);
+			node.leaves.erase_front(i);
+		}
+		else {
+			if (pos != 0)
+				drop_values(mutable_node(node.inners[i]), height - 1, pos);
+			node.inners.erase_front(i);
+		}
+
+		const size_type child_count_after = child_count(node);
+		for (size_type j = 0; j != child_count_after; ++j)
+			node.sizes[j] = node.sizes[j + i] - count;
+	}
+
+	// removes the roots which have only one child
+	void shrink()
+	{
+		while (height_ > 1 && child_count(*root_) == 1) {
+			inner_pointer child = (*root_).inners[0];
+			root_ = std::move(child);
+			--height_;
+		}
+	}
+
+	// ## concatenation
+
+	static void append_slots(leaf_node& to, const leaf_node& from, const size_type first, const size_type last)
+	{
+		for (size_type i = first; i != last; ++i)
+			to.emplace_back(from[i]);
+	}
+
+	static void append_slots(inner_node& to, const inner_node& from, const size_type first, const size_type last)
+	{
+		for (size_type i = first; i != last; ++i) {
+			if (from.keeps_leaves())
+				append_child(to, from.leaves[i]);
+			else
+				append_child(to, from.inners[i]);
+		}
+	}
+
+	// The numbers of slots of the rebalanced nodes. The nodes are merged until their count exceeds the optimal count
+	// by at most `extra_nodes`, so the search in the parent does not look through many not full nodes. The nodes
+	// which are almost full are not changed.
+	static void plan_rebalance(std::vector<size_type>& sizes)
+	{
+		constexpr size_type extra_nodes = 2;
+
+		size_type total = 0;
+		for (const size_type size : sizes)
+			total += size;
+		const size_type optimal = (total + branching - 1) / branching;
+
+		size_type count = sizes.size();
+		while (count > optimal + extra_nodes) {
+			size_type i = 0;
+			while (sizes[i] + extra_nodes / 2 > branching)
+				++i;
+
+			// the slots of the node i are distributed over the next nodes
+			size_type remaining = sizes[i];
+			while (remaining != 0) {
+				const size_type size = std::min(remaining + sizes[i + 1], branching + 0);
+				remaining = remaining + sizes[i + 1] - size;
+				sizes[i] = size;
+				++i;
+			}
+
+			for (; i + 1 < count; ++i)
+				sizes[i] = sizes[i + 1];
+			--count;
+		}
+
+		sizes.resize(count);
+	}
+
+	// redistributes the slots of the nodes by `plan_rebalance`, the nodes which are not changed stay shared
+	template<typename Pointer>
+	static std::vector<Pointer> rebalance_nodes(const std::vector<Pointer>& nodes)
+	{
+		std::vector<size_type> sizes;
+		sizes.reserve(nodes.size());
+		for (const Pointer& node : nodes)
+			sizes.push_back(slot_count(node));
+		plan_rebalance(sizes);
+
+		std::vector<Pointer> result;
+		result.reserve(sizes.size());
+		size_type from = 0;
+		size_type offset = 0;
+		for (const size_type size : sizes) {
+			if (offset == 0 && slot_count(nodes[from]) == size) {
+				result.push_back(nodes[from]);
+				++from;
+				continue;
+			}
+
+			Pointer node = make_empty_like(*nodes[from]);
+			for (size_type filled = 0; filled != size;) {
+				const size_type count = std::min(size - filled, slot_count(nodes[from]) - offset);
+				append_slots(*node, *nodes[from], offset, offset + count);
+				filled += count;
+				offset += count;
+				if (offset == slot_count(nodes[from])) {
+					++from;
+					offset = 0;
+				}
+			}
+			result.push_back(std::move(node));
+		}
+
+		return result;
+	}
+
+	// the node of height h + 1 which keeps the nodes of height h with `children`
+	template<typename Pointer>
+	static inner_pointer make_parents(const std::vector<Pointer>& children)
+	{
+		inner_pointer parent = inner_pointer::make(false);
+		for (size_type first = 0; first < children.size(); first += branching) {
+			inner_pointer node = inner_pointer::make(std::is_same<Pointer, leaf_pointer>::value);
+			const size_type last = std::min(first + branching, children.size());
+			for (size_type i = first; i != last; ++i)
+				append_child(*node, children[i]);
+			append_child(*parent, std::move(node));
+		}
+
+		return parent;
+	}
+
+	static void append_children(std::vector<inner_pointer>& to, const inner_node& from, size_type first, size_type last)
+	{
+		for (; first < last; ++first)
+			to.push_back(from.inners[first]);
+	}
+
+	// The node of height max(left_height, right_height) + 1 which keeps the values of `left` and then the values of
+	// `right`. The rightmost branch of `left` and the leftmost branch of `right` are merged and rebalanced, the other
+	// nodes are shared.
+	static inner_pointer concat_nodes(
+		const inner_pointer& left, const size_type left_height, const inner_pointer& right, const size_type right_height)
+	{
+		if (left_height == 1 && right_height == 1) {
+			std::vector<leaf_pointer> leaves;
+			for (size_type i = 0; i != (*left).leaves.size(); ++i)
+				leaves.push_back((*left).leaves[i]);
+			for (size_type i = 0; i != (*right).leaves.size(); ++i)
+				leaves.push_back((*right).leaves[i]);
+			return make_parents(rebalance_nodes(leaves));
+		}
+
+		const inner_node& left_node = *left;
+		const inner_node& right_node = *right;
+		const size_type left_count = child_count(left_node);
+		const size_type right_count = child_count(right_node);
+		const size_type height = std::max(left_height, right_height);
+
+		std::vector<inner_pointer> children;
+		if (left_height > right_height) {
+			const inner_pointer middle =
+				concat_nodes(left_node.inners[left_count - 1], left_height - 1, right, right_height);
+			append_children(children, left_node, 0, left_count - 1);
+			append_children(children, *middle, 0, child_count(*middle));
+		}
+		else if (left_height < right_height) {
+			const inner_pointer middle = concat_nodes(left, left_height, right_node.inners[0], right_height - 1);
+			append_children(children, *middle, 0, child_count(*middle));
+			append_children(children, right_node, 1, right_count);
+		}
+		else {
+			const inner_pointer middle =
+				concat_nodes(left_node.inners[left_count - 1], height - 1, right_node.inners[0], height - 1);
+			append_children(children, left_node, 0, left_count - 1);
+			append_children(children, *middle, 0, child_count(*middle));
+			append_children(children, right_node, 1, right_count);
+		}
+
+		return make_parents(rebalance_nodes(children));
+	}
+
+	inner_pointer root_;
+	size_type height_ = 0;
+	size_type size_ = 0;
+};
+
+template<typename T, std::size_t Bits, typename Storage>
+class flex_vector_transient {
+	friend class flex_vector<T, Bits, Storage>;
+
+	using vector_type = flex_vector<T, Bits, Storage>;
+	using leaf_pointer = typename vector_type::leaf_pointer;
+
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+
+	flex_vector_transient() noexcept = default;
+	flex_vector_transient(const flex_vector_transient&) = delete;
+	flex_vector_transient(flex_vector_transient&&) noexcept = default;
+	flex_vector_transient& operator=(const flex_vector_transient&) = delete;
+	flex_vector_transient& operator=(flex_vector_transient&&) noexcept = default;
+	~flex_vector_transient() = default;
+
+	COW_NODISCARD const T& operator[](const size_type pos) const noexcept
+	{
+		const size_type size = vector_.size();
+		return pos < size ? vector_[pos] : (*tail_)[pos - size];
+	}
+
+	COW_NODISCARD bool empty() const noexcept
+	{
+		return size() == 0;
+	}
+
+	COW_NODISCARD size_type size() const noexcept
+	{
+		return vector_.size() + (tail_ ? (*tail_).size() : 0);
+	}
+
+	COW_NODISCARD write_session<T> write(const size_type pos)
+	{
+		const size_type size = vector_.size();
+		return pos < size ? vector_.write(pos) : detail::write_session_access::make((*tail_)[pos - size]);
+	}
+
+	template<typename F>
+	decltype(auto) modify(const size_type pos, F&& f)
+	{
+		return std::forward<F>(f)(*write(pos));
+	}
+
+	template<typename U>
+	void set(const size_type pos, U&& value)
+	{
+		*write(pos) = std::forward<U>(value);
+	}
+
+	void push_back(const T& value)
+	{
+		emplace_back(value);
+	}
+
+	void push_back(T&& value)
+	{
+		emplace_back(std::move(value));
+	}
+
+	// the tail is owned only by the transient, so it is changed without the check of the reference counter
+	template<typename... Args>
+	const T& emplace_back(Args&&... args)
+	{
+		if (tail_ && (*tail_).full())
+			flush();
+		if (!tail_)
+			tail_ = leaf_pointer::make();
+
+		return (*tail_).emplace_back(std::forward<Args>(args)...);
+	}
+
+	void take(const size_type count)
+	{
+		flush();
+		vector_.take(count);
+	}
+
+	void drop(const size_type count)
+	{
+		flush();
+		vector_.drop(count);
+	}
+
+	void append(const vector_type& other)
+	{
+		flush();
+		vector_.append(other);
+	}
+
+	COW_NODISCARD vector_type persistent()
+	{
+		flush();
+		return std::move(vector_);
+	}
+
+private:
+	explicit flex_vector_transient(vector_type&& vector) noexcept
+		: vector_{std::move(vector)}
+	{}
+
+	// puts the tail to the tree of the vector
+	void flush()
+	{
+		if (tail_)
+			vector_.push_leaf(std::move(tail_));
+		tail_.reset();
+	}
+
+	vector_type vector_;
+	leaf_pointer tail_;
+};
+
+// concatenation
+
+template<typename T, std::size_t Bits, typename Storage>
+COW_NODISCARD flex_vector<T, Bits, Storage> concat(
+	flex_vector<T, Bits, Storage> lhs, const flex_vector<T, Bits, Storage>& rhs)
+{
+	lhs.append(rhs);
+	return lhs;
+}
+
+template<typename T, std::size_t Bits, typename Storage>
+COW_NODISCARD flex_vector<T, Bits, Storage> operator+(
+	flex_vector<T, Bits, Storage> lhs, const flex_vector<T, Bits, Storage>& rhs)
+{
+	lhs.append(rhs);
+	return lhs;
+}
+
+// specialized algorithms
+
+template<typename T, std::size_t Bits, typename Storage>
+void swap(flex_vector<T, Bits, Storage>& lhs, flex_vector<T, Bits, Storage>& rhs) noexcept
+{
+	lhs.swap(rhs);
+}
+
+} // namespace cow
@@ -0,0 +1,1005 @@
+#pragma once
+#include "detail/compatibility/bit.h"
+#include "detail/compatibility/compile_features.h"
+#include "detail/hamt_node.h"
+#include "optional.h"
+#include "storage.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/*
+synopsis
+
+namespace cow {
+
+/// Unordered associative container kept in a hash array mapped trie (HAMT). Every level of the trie takes 5 bits of the
+/// hash of the key, the node keeps the bitmaps of its entries and its children and the compact arrays of them, so it
+/// has up to 32 slots and keeps only the used ones. The keys with the same hash are kept in the collision nodes after
+/// all bits of the hash are used. The copy of the map shares the trie, so it is O(1). The modifications copy only the
+/// nodes on the path to the changed entry if they are shared, it is O(log32 n), the nodes which are owned only by this
+/// map are changed in place. The node keeps its slots in one allocation, so the nodes use the reference counter and
+/// the allocator of `Storage` if it is `basic_intrusive_storage`, and `atomic_ref_count` and `std::allocator` with
+/// other storage policies. The references to the entries and the iterators are invalidated by any modification.
+template<
+	typename Key,
+	typename T,
+	typename Hash = std::hash<Key>,
+	typename KeyEqual = std::equal_to<Key>,
+	typename Storage = intrusive_storage>
+class map {
+public:
+	using key_type = Key;
+	using mapped_type = T;
+	using value_type = std::pair<Key, T>;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using hasher = Hash;
+	using key_equal = KeyEqual;
+	using reference = const value_type&;
+	using const_reference = const value_type&;
+	class const_iterator; // forward iterator
+	using iterator = const_iterator;
+	using transient_type = map_transient<Key, T, Hash, KeyEqual, Storage>;
+
+	// constructors
+
+	map();
+	template<typename InputIt>
+	map(InputIt first, InputIt last);
+	map(std::initializer_list<value_type> ilist);
+
+	map(const map& other);
+	map(map&& other);
+
+	map& operator=(const map& other);
+	map& operator=(map&& other);
+
+	~map();
+
+	// lookup
+
+	/// \return The pointer to the value of the key or `nullptr` if the map does not contain the key.
+	const T* find(const Key& key) const;
+	const T& at(const Key& key) const;
+	size_type count(const Key& key) const;
+	bool contains(const Key& key) const;
+
+	// iterators
+
+	const_iterator begin() const noexcept;
+	const_iterator cbegin() const noexcept;
+	const_iterator end() const noexcept;
+	const_iterator cend() const noexcept;
+
+	// capacity
+
+	bool empty() const noexcept;
+	size_type size() const noexcept;
+
+	// modifiers
+	// The shared nodes are not copied if the modification does not change the map.
+
+	/// Inserts the entry if the map does not contain its key.
+	/// \return true if the entry is inserted.
+	bool insert(const value_type& value);
+	bool insert(value_type&& value);
+	/// Inserts the entry or assigns the value to the existing entry.
+	/// \return true if the entry is inserted.
+	template<typename K, typename V>
+	bool set(K&& key, V&& value);
+
+	// `key` must be in the map, otherwise `std::out_of_range` is thrown.
+
+	/// Gives mutable access to the value of `key`. The map must not be copied while the session is used.
+	write_session<T> write(const Key& key);
+	template<typename F>
+	decltype(auto) modify(const Key& key, F&& f);
+
+	/// \return The number of the removed entries (0 or 1).
+	size_type erase(const Key& key);
+
+	void clear() noexcept;
+	void swap(map& other) noexcept;
+
+	/// \return The builder which changes the entries of the map without the copies of the map.
+	transient_type transient() const&;
+	transient_type transient() &&;
+
+	// observers
+
+	hasher hash_function() const;
+	key_equal key_eq() const;
+	/// \return true if the maps share the trie, so they are equal.
+	bool shares_storage_with(const map& other) const noexcept;
+};
+
+/// Builder of `map`. The builder does not look the key up before the modification, so every modification walks the
+/// trie once. It copies the shared nodes on the path even if the modification does not change the map.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Storage>
+class map_transient {
+public:
+	using key_type = Key;
+	using mapped_type = T;
+	using value_type = std::pair<Key, T>;
+	using size_type = std::size_t;
+
+	map_transient();
+	map_transient(map_transient&& other);
+	map_transient& operator=(map_transient&& other);
+
+	const T* find(const Key& key) const;
+	bool contains(const Key& key) const;
+	bool empty() const noexcept;
+	size_type size() const noexcept;
+
+	bool insert(const value_type& value);
+	bool insert(value_type&& value);
+	template<typename K, typename V>
+	bool set(K&& key, V&& value);
+	write_session<T> write(const Key& key);
+	template<typename F>
+	decltype(auto) modify(const Key& key, F&& f);
+	size_type erase(const Key& key);
+
+	/// \return The map with the entries of the builder. The builder becomes empty.
+	map<Key, T, Hash, KeyEqual, Storage> persistent();
+};
+
+// relational operations
+// The trie of the keys does not depend on the order of the insertions, so the maps are compared node by node and
+// the shared subtries are equal without comparison of entries.
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Storage>
+bool operator==(const map<Key, T, Hash, KeyEqual, Storage>& lhs, const map<Key, T, Hash, KeyEqual, Storage>& rhs);
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Storage>
+bool operator!=(const map<Key, T, Hash, KeyEqual, Storage>& lhs, const map<Key, T, Hash, KeyEqual, Storage>& rhs);
+
+// specialized algorithms
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Storage>
+void swap(map<Key, T, Hash, KeyEqual, Storage>& lhs, map<Key, T, Hash, KeyEqual, Storage>& rhs) noexcept;
+
+} // namespace cow
+*/
+
+namespace cow {
+namespace detail {
+
+// the reference counter and the allocator of the nodes of the map with the storage policy
+template<typename Storage>
+struct map_node_storage {
+	using ref_count = atomic_ref_count;
+	using allocator = std::allocator<char>;
+};
+
+template<typename RefCount, typename Allocator>
+struct map_node_storage<basic_intrusive_storage<RefCount, Allocator>> {
+	using ref_count = RefCount;
+	using allocator = Allocator;
+};
+
+} // namespace detail
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Storage>
+class map_transient;
+
+template<
+	typename Key,
+	typename T,
+	typename Hash = std::hash<Key>,
+	typename KeyEqual = std::equal_to<Key>,
+	typename Storage = intrusive_storage>
+class map {
+	static_assert(
+		!std::is_reference<Key>::value && !std::is_reference<T>::value,
+		"Instantiation of map with a reference type is ill-formed");
+	static_assert(
+		std::is_destructible<Key>::value && std::is_destructible<T>::value,
+		"Instantiation of map with a non-destructible type is ill-formed");
+
+	friend class map_transient<Key, T, Hash, KeyEqual, Storage>;
+
+public:
+	using key_type = Key;
+	using mapped_type = T;
+	using value_type = std::pair<Key, T>;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using hasher = Hash;
+	using key_equal = KeyEqual;
+	using reference = const value_type&;
+	using const_reference = const value_type&;
+	using transient_type = map_transient<Key, T, Hash, KeyEqual, Storage>;
+
+private:
+	static constexpr size_type bits = 5;
+	static constexpr size_type hash_digits = std::numeric_limits<size_type>::digits;
+	// the number of the levels with the parts of the hash and the level of the collision nodes
+	static constexpr size_type max_depth = hash_digits / bits + 2;
+
+	// The entries and the children are ordered by the parts of the hash, so the index of the slot is the number of
+	// the lower bits in the bitmap. The collision nodes do not use the bitmaps and keep only the entries.
+	using node_allocator = typename detail::map_node_storage<Storage>::allocator;
+	using node = detail::hamt_node<value_type, typename detail::map_node_storage<Storage>::ref_count, node_allocator>;
+	using node_pointer = typename node::pointer;
+
+public:
+	class const_iterator {
+		friend class map;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair<Key, T>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const value_type*;
+		using reference = const value_type&;
+
+		const_iterator() noexcept = default;
+
+		COW_NODISCARD reference operator*() const noexcept
+		{
+			const frame& top = stack_[depth_ - 1];
+			return top.current->entry(top.entry);
+		}
+
+		COW_NODISCARD pointer operator->() const noexcept
+		{
+			return std::addressof(**this);
+		}
+
+		const_iterator& operator++() noexcept
+		{
+			++stack_[depth_ - 1].entry;
+			settle();
+			return *this;
+		}
+
+		const_iterator operator++(int) noexcept
+		{
+			const_iterator result{*this};
+			++*this;
+			return result;
+		}
+
+		COW_NODISCARD friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			if (lhs.depth_ != rhs.depth_)
+				return false;
+			if (lhs.depth_ == 0)
+				return true;
+
+			const frame& lhs_top = lhs.stack_[lhs.depth_ - 1];
+			const frame& rhs_top = rhs.stack_[rhs.depth_ - 1];
+			return lhs_top.current == rhs_top.current && lhs_top.entry == rhs_top.entry;
+		}
+
+		COW_NODISCARD friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return !(lhs == rhs);
+		}
+
+	private:
+		// the entries of the node are visited before its children
+		struct frame {
+			const node* current;
+			size_type entry;
+			size_type child;
+		};
+
+		explicit const_iterator(const node* const root) noexcept
+		{
+			if (root == nullptr)
+				return;
+
+			stack_[0] = frame{root, 0, 0};
+			depth_ = 1;
+			settle();
+		}
+
+		// goes to the next entry if the current node has no more entries
+		void settle() noexcept
+		{
+			while (depth_ != 0) {
+				frame& top = stack_[depth_ - 1];
+				if (top.entry < top.current->entry_count())
+					return;
+
+				if (top.child < top.current->child_count())
+					stack_[depth_++] = frame{top.current->child(top.child++).get(), 0, 0};
+				else
+					--depth_;
+			}
+		}
+
+		frame stack_[max_depth]{};
+		size_type depth_ = 0;
+	};
+
+	using iterator = const_iterator;
+
+	// constructors
+
+	map() = default;
+
+	template<
+		typename InputIt,
+		typename = std::enable_if_t<std::is_convertible<
+			typename std::iterator_traits<InputIt>::iterator_category, std::input_iterator_tag>::value>>
+	map(InputIt first, const InputIt last)
+	{
+		transient_type builder;
+		for (; first != last; ++first)
+			builder.insert(*first);
+		*this = builder.persistent();
+	}
+
+	map(const std::initializer_list<value_type> ilist)
+		: map(ilist.begin(), ilist.end())
+	{}
+
+	map(const map&) = default;
+
+	map(map&& other) noexcept
+		: root_{std::move(other.root_)}
+		, size_{other.size_}
+		, hash_{std::move(other.hash_)}
+		, key_eq_{std::move(other.key_eq_)}
+	{
+		other.root_.reset();
+		other.size_ = 0;
+	}
+
+	map& operator=(const map&) = default;
+
+	map& operator=(map&& other) noexcept
+	{
+		map{std::move(other)}.swap(*this);
+		return *this;
+	}
+
+	~map() = default;
+
+	// lookup
+
+	COW_NODISCARD const T* find(const Key& key) const
+	{
+		const value_type* const entry = find_entry(key);
+		return entry != nullptr ? &entry->second : nullptr;
+	}
+
+	COW_NODISCARD const T& at(const Key& key) const
+	{
+		const T* const value = find(key);
+		if (value == nullptr)
+			throw std::out_of_range{"cow::map::at"};
+
+		return *value;
+	}
+
+	COW_NODISCARD size_type count(const Key& key) const
+	{
+		return find_entry(key) != nullptr ? 1 : 0;
+	}
+
+	COW_NODISCARD bool contains(const Key& key) const
+	{
+		return find_entry(key) != nullptr;
+	}
+
+	// iterators
+
+	COW_NODISCARD const_iterator begin() const noexcept
+	{
+		return const_iterator{root_.get()};
+	}
+
+	COW_NODISCARD const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+
+	COW_NODISCARD const_iterator end() const noexcept
+	{
+		return const_iterator{};
+	}
+
+	COW_NODISCARD const_iterator cend() const noexcept
+	{
+		return end();
+	}
+
+	// capacity
+
+	COW_NODISCARD bool empty() const noexcept
+	{
+		return size_ == 0;
+	}
+
+	COW_NODISCARD size_type size() const noexcept
+	{
+		return size_;
+	}
+
+	// modifiers
+
+	bool insert(const value_type& value)
+	{
+		return !contains(value.first) && put(value_type{value}, false);
+	}
+
+	bool insert(value_type&& value)
+	{
+		return !contains(value.first) && put(std::move(value), false);
+	}
+
+	template<typename K, typename V>
+	bool set(K&& key, V&& value)
+	{
+		return put(value_type{std::forward<K>(key), std::forward<V>(value)}, true);
+	}
+
+	COW_NODISCARD write_session<T> write(const Key& key)
+	{
+		if (!contains(key))
+			throw std::out_of_range{"cow::map::write"};
+
+		return detail::write_session_access::make(mutable_entry(key).second);
+	}
+
+	template<typename F>
+	decltype(auto) modify(const Key& key, F&& f)
+	{
+		return std::forward<F>(f)(*write(key));
+	}
+
+	size_type erase(const Key& key)
+	{
+		return contains(key) && remove(key) ? 1 : 0;
+	}
+
+	void clear() noexcept
+	{
+		root_.reset();
+		size_ = 0;
+	}
+
+	void swap(map& other) noexcept
+	{
+		using std::swap;
+		root_.swap(other.root_);
+		swap(size_, other.size_);
+		swap(hash_, other.hash_);
+		swap(key_eq_, other.key_eq_);
+	}
+
+	COW_NODISCARD transient_type transient() const&
+	{
+		return transient_type{map{*this}};
+	}
+
+	COW_NODISCARD transient_type transient() &&
+	{
+		return transient_type{std::move(*this)};
+	}
+
+	// observers
+
+	COW_NODISCARD hasher hash_function() const
+	{
+		return hash_;
+	}
+
+	COW_NODISCARD key_equal key_eq() const
+	{
+		return key_eq_;
+	}
+
+	COW_NODISCARD bool shares_storage_with(const map& other) const noexcept
+	{
+		return root_ && root_.get() == other.root_.get();
+	}
+
+	// relational operations
+
+	COW_NODISCARD friend bool operator==(const map& lhs, const map& rhs)
+	{
+		if (lhs.size_ != rhs.size_)
+			return false;
+		if (lhs.size_ == 0 || lhs.shares_storage_with(rhs))
+			return true;
+
+		return lhs.equal_nodes(*lhs.root_, *rhs.root_, 0);
+	}
+
+	COW_NODISCARD friend bool operator!=(const map& lhs, const map& rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+private:
+	// ## nodes
+
+	static std::uint32_t hash_bit(const size_type hash, const size_type shift) noexcept
+	{
+		return std::uint32_t{1} << ((hash >> shift) & ((size_type{1} << bits) - 1));
+	}
+
+	// the index of the slot of `bit` in the array of the slots of `bitmap`
+	static size_type slot_index(const std::uint32_t bitmap, const std::uint32_t bit) noexcept
+	{
+		return static_cast<size_type>(detail::compatibility::popcount(bitmap & (bit - 1)));
+	}
+
+	// the slots of the node which is not shared are moved to the rebuilt node unless the move can throw
+	static bool movable(const node_pointer& pointer) noexcept
+	{
+		return pointer.unique() && std::is_nothrow_move_constructible<value_type>::value;
+	}
+
+	static void append_entries(node& to, node& from, size_type first, const size_type last, const bool move)
+	{
+		for (; first != last; ++first) {
+			if (move)
+				to.push_entry(std::move(from.entry(first)));
+			else
+				to.push_entry(from.entry(first));
+		}
+	}
+
+	static void append_children(node& to, node& from, size_type first, const size_type last, const bool move)
+	{
+		for (; first != last; ++first)
+			to.push_child(move ? std::move(from.child(first)) : from.child(first));
+	}
+
+	// the node which is not shared with other maps
+	static node& mutable_node(node_pointer& pointer)
+	{
+		if (!pointer.unique()) {
+			node& from = *pointer;
+			node_pointer copy = node::make(pointer.get_allocator(), from.entry_count(), from.child_count());
+			append_entries(*copy, from, 0, from.entry_count(), false);
+			append_children(*copy, from, 0, from.child_count(), false);
+			copy->entry_map = from.entry_map;
+			copy->child_map = from.child_map;
+			pointer = std::move(copy);
+		}
+
+		return *pointer;
+	}
+
+	// the capacity of the entries of the node which is owned by the map and has `count` entries
+	static size_type grown_capacity(const size_type count) noexcept
+	{
+		return std::max(count + 1, std::min(count * 2, size_type{1} << bits));
+	}
+
+	// The functions below change the numbers of the slots of the node. `bit` is the bit of the changed slot in the
+	// bitmaps, it is 0 in the collision nodes.
+
+	// The node which is owned only by this map is changed in place if it has room for the entry, otherwise it is
+	// rebuilt with the room for the next entries, so the entries of the transient are inserted in amortized O(1). The
+	// copies of the shared nodes have room only for their slots.
+	static void insert_entry(node_pointer& pointer, const size_type index, const std::uint32_t bit, value_type&& value)
+	{
+		node& from = *pointer;
+		const bool move = movable(pointer);
+		if (move && from.entry_count() != from.entry_capacity()) {
+			from.insert_entry(index, std::move(value));
+			from.entry_map |= bit;
+			return;
+		}
+
+		const size_type entry_capacity = move ? grown_capacity(from.entry_count()) : from.entry_count() + 1;
+		node_pointer result = node::make(pointer.get_allocator(), entry_capacity, from.child_count());
+		append_entries(*result, from, 0, index, move);
+		result->push_entry(std::move(value));
+		append_entries(*result, from, index, from.entry_count(), move);
+		append_children(*result, from, 0, from.child_count(), move);
+		result->entry_map = from.entry_map | bit;
+		result->child_map = from.child_map;
+		pointer = std::move(result);
+	}
+
+	static void erase_entry(node_pointer& pointer, const size_type index, const std::uint32_t bit)
+	{
+		node& from = *pointer;
+		const bool move = movable(pointer);
+		if (move) {
+			from.erase_entry(index);
+			from.entry_map &= ~bit;
+			return;
+		}
+
+		node_pointer result = node::make(pointer.get_allocator(), from.entry_count() - 1, from.child_count());
+		append_entries(*result, from, 0, index, move);
+		append_entries(*result, from, index + 1, from.entry_count(), move);
+		append_children(*result, from, 0, from.child_count(), move);
+		result->entry_map = from.entry_map & ~bit;
+		result->child_map = from.child_map;
+		pointer = std::move(result);
+	}
+
+	static void replace_entry_by_child(
+		node_pointer& pointer, const size_type index, const std::uint32_t bit, node_pointer&& child)
+	{
+		node& from = *pointer;
+		const bool move = movable(pointer);
+		const size_type child_index = slot_index(from.child_map, bit);
+		node_pointer result = node::make(pointer.get_allocator(), from.entry_count() - 1, from.child_count() + 1);
+		append_entries(*result, from, 0, index, move);
+		append_entries(*result, from, index + 1, from.entry_count(), move);
+		append_children(*result, from, 0, child_index, move);
+		result->push_child(std::move(child));
+		append_children(*result, from, child_index, from.child_count(), move);
+		result->entry_map = from.entry_map & ~bit;
+		result->child_map = from.child_map | bit;
+		pointer = std::move(result);
+	}
+
+	// the child keeps only one entry
+	static void replace_child_by_entry(node_pointer& pointer, const size_type child_index, const std::uint32_t bit)
+	{
+		node& from = *pointer;
+		const bool move = movable(pointer);
+		const node_pointer& child = from.child(child_index);
+		const size_type index = slot_index(from.entry_map, bit);
+		node_pointer result = node::make(pointer.get_allocator(), from.entry_count() + 1, from.child_count() - 1);
+		append_entries(*result, from, 0, index, move);
+		append_entries(*result, *child, 0, 1, movable(child));
+		append_entries(*result, from, index, from.entry_count(), move);
+		append_children(*result, from, 0, child_index, move);
+		append_children(*result, from, child_index + 1, from.child_count(), move);
+		result->entry_map = from.entry_map | bit;
+		result->child_map = from.child_map & ~bit;
+		pointer = std::move(result);
+	}
+
+	// ## lookup
+
+	const value_type* find_entry(const Key& key) const
+	{
+		const node* current = root_.get();
+		if (current == nullptr)
+			return nullptr;
+
+		const size_type hash = hash_(key);
+		for (size_type shift = 0; shift < hash_digits; shift += bits) {
+			const std::uint32_t bit = hash_bit(hash, shift);
+			if ((current->entry_map & bit) != 0) {
+				const value_type& entry = current->entry(slot_index(current->entry_map, bit));
+				return key_eq_(entry.first, key) ? &entry : nullptr;
+			}
+			if ((current->child_map & bit) == 0)
+				return nullptr;
+
+			current = &*current->child(slot_index(current->child_map, bit));
+		}
+
+		return find_collision(*current, key);
+	}
+
+	const value_type* find_collision(const node& current, const Key& key) const
+	{
+		for (size_type i = 0; i != current.entry_count(); ++i) {
+			if (key_eq_(current.entry(i).first, key))
+				return &current.entry(i);
+		}
+		return nullptr;
+	}
+
+	// the key must be in the map
+	value_type& mutable_entry(const Key& key)
+	{
+		node* current = &mutable_node(root_);
+		const size_type hash = hash_(key);
+		for (size_type shift = 0; shift < hash_digits; shift += bits) {
+			const std::uint32_t bit = hash_bit(hash, shift);
+			if ((current->entry_map & bit) != 0)
+				return current->entry(slot_index(current->entry_map, bit));
+
+			current = &mutable_node(current->child(slot_index(current->child_map, bit)));
+		}
+
+		return const_cast<value_type&>(*find_collision(*current, key)); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+	}
+
+	// ## insertion
+
+	// \return true if the entry is inserted, false if the key is found
+	bool put(value_type&& value, const bool assign)
+	{
+		const size_type hash = hash_(value.first);
+		if (!root_) {
+			node_pointer root = node::make(node_allocator{}, 1, 0);
+			root->push_entry(std::move(value));
+			root->entry_map = hash_bit(hash, 0);
+			root_ = std::move(root);
+			size_ = 1;
+			return true;
+		}
+
+		const bool inserted = put(root_, hash, 0, std::move(value), assign);
+		if (inserted)
+			++size_;
+		return inserted;
+	}
+
+	bool put(node_pointer& pointer, const size_type hash, const size_type shift, value_type&& value, const bool assign)
+	{
+		if (shift >= hash_digits)
+			return put_collision(pointer, std::move(value), assign);
+
+		const node& current = *pointer;
+		const std::uint32_t bit = hash_bit(hash, shift);
+		if ((current.child_map & bit) != 0) {
+			const size_type child_index = slot_index(current.child_map, bit);
+			return put(mutable_node(pointer).child(child_index), hash, shift + bits, std::move(value), assign);
+		}
+
+		const size_type index = slot_index(current.entry_map, bit);
+		if ((current.entry_map & bit) == 0) {
+			insert_entry(pointer, index, bit, std::move(value));
+			return true;
+		}
+
+		const value_type& entry = current.entry(index);
+		if (key_eq_(entry.first, value.first)) {
+			if (assign)
+				mutable_node(pointer).entry(index).second = std::move(value.second);
+			return false;
+		}
+
+		// the entries with the same part of the hash are moved to the new child, the entry is copied, so the map is
+		// not changed if the child is not created
+		node_pointer child =
+			make_pair_node(pointer.get_allocator(), shift + bits, entry, hash_(entry.first), std::move(value), hash);
+		replace_entry_by_child(pointer, index, bit, std::move(child));
+		return true;
+	}
+
+	bool put_collision(node_pointer& pointer, value_type&& value, const bool assign)
+	{
+		const node& current = *pointer;
+		for (size_type i = 0; i != current.entry_count(); ++i) {
+			if (key_eq_(current.entry(i).first, value.first)) {
+				if (assign)
+					mutable_node(pointer).entry(i).second = std::move(value.second);
+				return false;
+			}
+		}
+
+		insert_entry(pointer, current.entry_count(), 0, std::move(value));
+		return true;
+	}
+
+	static node_pointer make_pair_node(
+		const node_allocator& allocator,
+		const size_type shift,
+		const value_type& first,
+		const size_type first_hash,
+		value_type&& second,
+		const size_type second_hash)
+	{
+		if (shift >= hash_digits) {
+			node_pointer result = node::make(allocator, 2, 0);
+			result->push_entry(first);
+			result->push_entry(std::move(second));
+			return result;
+		}
+
+		const std::uint32_t first_bit = hash_bit(first_hash, shift);
+		const std::uint32_t second_bit = hash_bit(second_hash, shift);
+		if (first_bit == second_bit) {
+			node_pointer result = node::make(allocator, 0, 1);
+			result->push_child(make_pair_node(allocator, shift + bits, first, first_hash, std::move(second), second_hash));
+			result->child_map = first_bit;
+			return result;
+		}
+
+		node_pointer result = node::make(allocator, 2, 0);
+		if (first_bit < second_bit) {
+			result->push_entry(first);
+			result->push_entry(std::move(second));
+		}
+		else {
+			result->push_entry(std::move(second));
+			result->push_entry(first);
+		}
+		result->entry_map = first_bit | second_bit;
+		return result;
+	}
+
+	// ## removal
+
+	// \return true if the entry is removed
+	bool remove(const Key& key)
+	{
+		if (!root_ || !remove(root_, hash_(key), 0, key))
+			return false;
+
+		if (--size_ == 0)
+			root_.reset();
+		return true;
+	}
+
+	bool remove(node_pointer& pointer, const size_type hash, const size_type shift, const Key& key)
+	{
+		const node& current = *pointer;
+		if (shift >= hash_digits) {
+			const value_type* const entry = find_collision(current, key);
+			if (entry == nullptr)
+				return false;
+
+			erase_entry(pointer, static_cast<size_type>(entry - &current.entry(0)), 0);
+			return true;
+		}
+
+		const std::uint32_t bit = hash_bit(hash, shift);
+		if ((current.entry_map & bit) != 0) {
+			const size_type index = slot_index(current.entry_map, bit);
+			if (!key_eq_(current.entry(index).first, key))
+				return false;
+
+			erase_entry(pointer, index, bit);
+			return true;
+		}
+		if ((current.child_map & bit) == 0)
+			return false;
+
+		const size_type child_index = slot_index(current.child_map, bit);
+		node_pointer& child = mutable_node(pointer).child(child_index);
+		if (!remove(child, hash, shift + bits, key))
+			return false;
+
+		// the child with one entry is replaced by the entry, so the trie of the same keys has the same shape
+		if (child->child_count() == 0 && child->entry_count() == 1)
+			replace_child_by_entry(pointer, child_index, bit);
+		return true;
+	}
+
+	// ## comparison
+
+	bool equal_nodes(const node& lhs, const node& rhs, const size_type shift) const
+	{
+		if (&lhs == &rhs)
+			return true;
+		if (lhs.entry_map != rhs.entry_map || lhs.child_map != rhs.child_map ||
+			lhs.entry_count() != rhs.entry_count())
+			return false;
+
+		if (shift >= hash_digits) {
+			for (size_type i = 0; i != lhs.entry_count(); ++i) {
+				const value_type* const other = find_collision(rhs, lhs.entry(i).first);
+				if (other == nullptr || !(lhs.entry(i).second == other->second))
+					return false;
+			}
+			return true;
+		}
+
+		for (size_type i = 0; i != lhs.entry_count(); ++i) {
+			if (!key_eq_(lhs.entry(i).first, rhs.entry(i).first) || !(lhs.entry(i).second == rhs.entry(i).second))
+				return false;
+		}
+		for (size_type i = 0; i != lhs.child_count(); ++i) {
+			if (!equal_nodes(*lhs.child(i), *rhs.child(i), shift + bits))
+				return false;
+		}
+		return true;
+	}
+
+	node_pointer root_;
+	size_type size_ = 0;
+	Hash hash_;
+	KeyEqual key_eq_;
+};
+
+#ifndef __cpp_inline_variables
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Storage>
+constexpr std::size_t map<Key, T, Hash, KeyEqual, Storage>::bits;
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Storage>
+constexpr std::size_t map<Key, T, Hash, KeyEqual, Storage>::hash_digits;
+#endif
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Storage>
+class map_transient {
+	friend class map<Key, T, Hash, KeyEqual, Storage>;
+
+	using map_type = map<Key, T, Hash, KeyEqual, Storage>;
+
+public:
+	using key_type = Key;
+	using mapped_type = T;
+	using value_type = std::pair<Key, T>;
+	using size_type = std::size_t;
+
+	map_transient() = default;
+	map_transient(const map_transient&) = delete;
+	map_transient(map_transient&&) noexcept = default;
+	map_transient& operator=(const map_transient&) = delete;
+	map_transient& operator=(map_transient&&) noexcept = default;
+	~map_transient() = default;
+
+	COW_NODISCARD const T* find(const Key& key) const
+	{
+		return map_.find(key);
+	}
+
+	COW_NODISCARD bool contains(const Key& key) const
+	{
+		return map_.contains(key);
+	}
+
+	COW_NODISCARD bool empty() const noexcept
+	{
+		return map_.empty();
+	}
+
+	COW_NODISCARD size_type size() const noexcept
+	{
+		return map_.size();
+	}
+
+	bool insert(const value_type& value)
+	{
+		return map_.put(value_type{value}, false);
+	}
+
+	bool insert(value_type&& value)
+	{
+		return map_.put(std::move(value), false);
+	}
+
+	template<typename K, typename V>
+	bool set(K&& key, V&& value)
+	{
+		return map_.put(value_type{std::forward<K>(key), std::forward<V>(value)}, true);
+	}
+
+	COW_NODISCARD write_session<T> write(const Key& key)
+	{
+		return map_.write(key);
+	}
+
+	template<typename F>
+	decltype(auto) modify(const Key& key, F&& f)
+	{
+		return map_.modify(key, std::forward<F>(f));
+	}
+
+	size_type erase(const Key& key)
+	{
+		return map_.remove(key) ? 1 : 0;
+	}
+
+	COW_NODISCARD map_type persistent()
+	{
+		return std::move(map_);
+	}
+
+private:
+	explicit map_transient(map_type&& map) noexcept
+		: map_{std::move(map)}
+	{}
+
+	map_type map_;
+};
+
+// specialized algorithms
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Storage>
+void swap(map<Key, T, Hash, KeyEqual, Storage>& lhs, map<Key, T, Hash, KeyEqual, Storage>& rhs) noexcept
+{
+	lhs.swap(rhs);
+}
+
+} // namespace cow
@@ -1,6 +1,10 @@
 #pragma once
+#include "detail/aggregate_fields.h"
 #include "detail/compatibility/compile_features.h"
+#include "detail/compatibility/type_traits.h"
 #include "detail/compatibility/utility.h"
+#include "detail/inline_value.h"
+#include "storage.h"
 #include <array>
 #include <cstddef>
 #include <exception>
@@ -20,12 +24,41 @@ synopsis
 
 namespace cow {
 
-#if __cpp_lib_optional
 /// If an object of type T Is more efficient to copy than `std::shared_ptr`,
-/// then this template allows not to use copy-on-write optimization for this type
+/// then this template allows not to use copy-on-write optimization for this type.
+/// It is true for trivially copyable types and for aggregates (with up to 32 fields) which fields allow inplace
+/// placement. The fields of aggregates are inspected if the compiler supports `std::is_aggregate` or its builtin.
 template<typename T>
 struct allow_inplace_placement;
-#endif
+
+/// Storage policy which keeps the value inside the `optional` object, so each copy of the object has own copy of the
+/// value.
+struct inline_storage {};
+
+/// Selects the storage policy of `optional<T>`. It is `inline_storage` if `allow_inplace_placement<T>` is true and
+/// the size and the alignment of T are not greater than `MaxInlineStorageSize` and `MaxInlineStorageAlignment`,
+/// otherwise it is `intrusive_storage`. It can be specialized to choose another policy (for example
+/// `pooled_storage`) for a user type.
+template<
+	typename T,
+	std::size_t MaxInlineStorageSize = sizeof(std::shared_ptr<T>),
+	std::size_t MaxInlineStorageAlignment = alignof(std::max_align_t)>
+struct select_storage {
+	using type = ...;
+};
+
+template<
+	typename T,
+	std::size_t MaxInlineStorageSize = sizeof(std::shared_ptr<T>),
+	std::size_t MaxInlineStorageAlignment = alignof(std::max_align_t)>
+using select_storage_t = typename select_storage<T, MaxInlineStorageSize, MaxInlineStorageAlignment>::type;
+
+/// true if `select_storage<T, MaxInlineStorageSize>` selects `inline_storage`.
+template<typename T, std::size_t MaxInlineStorageSize = sizeof(std::shared_ptr<T>)>
+struct use_inline_storage;
+
+template<typename T, std::size_t MaxInlineStorageSize = sizeof(std::shared_ptr<T>)>
+constexpr bool use_inline_storage_v = use_inline_storage<T, MaxInlineStorageSize>::value;
 
 /// The struct `nullopt_t` is an empty structure type used to indicate `optional` type with uninitialized state.
 struct nullopt_t;
@@ -36,123 +69,167 @@ constexpr nullopt_t nullopt;
 /// attempt is made to access the value of an `optional` object that does not contain a value.
 class bad_optional_access;
 
-// relational operations
-
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
-constexpr bool operator==(const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs);
-
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
-constexpr bool operator!=(const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs);
-
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
-constexpr bool operator<(const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs);
-
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
-constexpr bool operator>(const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs);
+/// The class `write_session` gives mutable access to the value of `optional` which is not shared with other objects.
+/// The `optional` object must not be copied or hashed while the session is used.
+template<typename T>
+class write_session {
+public:
+	write_session(write_session&&) noexcept;
+	write_session& operator=(write_session&&) noexcept;
 
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
-constexpr bool operator<=(const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs);
+	T* operator->() const noexcept;
+	T& operator*() const noexcept;
+	T& get() const noexcept;
+};
 
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
-constexpr bool operator>=(const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs);
+// relational operations
+// If the objects share one value, they are equal without comparison of values. If both shared values have cached
+// hashes (see `cache_hash`) and the hashes are different, the objects are not equal without comparison of values.
+
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
+constexpr bool operator==(
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs);
+
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
+constexpr bool operator!=(
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs);
+
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
+constexpr bool operator<(
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs);
+
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
+constexpr bool operator>(
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs);
+
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
+constexpr bool operator<=(
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs);
+
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
+constexpr bool operator>=(
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs);
 
 // comparison with nullopt
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator==(const optional<T, UseInlineStorage>& lhs, nullopt_t) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator==(const optional<T, UseInlineStorage, Storage>& lhs, nullopt_t) noexcept;
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator==(nullopt_t, const optional<T, UseInlineStorage>& rhs) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator==(nullopt_t, const optional<T, UseInlineStorage, Storage>& rhs) noexcept;
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator!=(const optional<T, UseInlineStorage>& lhs, nullopt_t) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator!=(const optional<T, UseInlineStorage, Storage>& lhs, nullopt_t) noexcept;
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator!=(nullopt_t, const optional<T, UseInlineStorage>& rhs) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator!=(nullopt_t, const optional<T, UseInlineStorage, Storage>& rhs) noexcept;
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator<(const optional<T, UseInlineStorage>&, nullopt_t) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator<(const optional<T, UseInlineStorage, Storage>&, nullopt_t) noexcept;
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator<(nullopt_t, const optional<T, UseInlineStorage>& rhs) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator<(nullopt_t, const optional<T, UseInlineStorage, Storage>& rhs) noexcept;
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator<=(const optional<T, UseInlineStorage>& lhs, nullopt_t) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator<=(const optional<T, UseInlineStorage, Storage>& lhs, nullopt_t) noexcept;
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator<=(nullopt_t, const optional<T, UseInlineStorage>&) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator<=(nullopt_t, const optional<T, UseInlineStorage, Storage>&) noexcept;
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator>(const optional<T, UseInlineStorage>& lhs, nullopt_t) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator>(const optional<T, UseInlineStorage, Storage>& lhs, nullopt_t) noexcept;
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator>(nullopt_t, const optional<T, UseInlineStorage>&) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator>(nullopt_t, const optional<T, UseInlineStorage, Storage>&) noexcept;
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator>=(const optional<T, UseInlineStorage>&, nullopt_t) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator>=(const optional<T, UseInlineStorage, Storage>&, nullopt_t) noexcept;
 
-template<typename T, bool UseInlineStorage>
-constexpr bool operator>=(nullopt_t, const optional<T, UseInlineStorage>& rhs) noexcept;
+template<typename T, bool UseInlineStorage, typename Storage>
+constexpr bool operator>=(nullopt_t, const optional<T, UseInlineStorage, Storage>& rhs) noexcept;
 
 // comparison with T
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator==(const optional<T, UseInlineStorage>& lhs, const U& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator==(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs);
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator==(const U& lhs, const optional<T, UseInlineStorage>& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator==(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs);
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator!=(const optional<T, UseInlineStorage>& lhs, const U& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator!=(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs);
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator!=(const U& lhs, const optional<T, UseInlineStorage>& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator!=(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs);
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator<(const optional<T, UseInlineStorage>& lhs, const U& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator<(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs);
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator<(const U& lhs, const optional<T, UseInlineStorage>& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator<(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs);
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator<=(const optional<T, UseInlineStorage>& lhs, const U& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator<=(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs);
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator<=(const U& lhs, const optional<T, UseInlineStorage>& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator<=(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs);
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator>(const optional<T, UseInlineStorage>& lhs, const U& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator>(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs);
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator>(const U& lhs, const optional<T, UseInlineStorage>& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator>(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs);
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator>=(const optional<T, UseInlineStorage>& lhs, const U& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator>=(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs);
 
-template<typename T, bool UseInlineStorage, typename U>
-constexpr bool operator>=(const U& lhs, const optional<T, UseInlineStorage>& rhs);
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+constexpr bool operator>=(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs);
 
 // specialized algorithms
 
-template<typename T>
-void swap(optional<T>& lhs, optional<T>& rhs)
+template<typename T, bool UseInlineStorage, typename Storage>
+void swap(optional<T, UseInlineStorage, Storage>& lhs, optional<T, UseInlineStorage, Storage>& rhs)
 	noexcept(std::is_nothrow_move_constructible<T>::value && std::is_nothrow_swappable<T>::value);
 
-template<typename T, bool UseInlineStorage = use_inline_storage_v<T>>
-constexpr optional<std::decay_t<T>, UseInlineStorage> make_optional(T&& v);
-
-template<typename T, bool UseInlineStorage = use_inline_storage_v<T>, typename...Args>
-constexpr optional<T, UseInlineStorage> make_optional(Args&&... args);
-
-template<typename T, bool UseInlineStorage = use_inline_storage_v<T>, typename U, typename... Args>
-constexpr optional<T, UseInlineStorage> make_optional(std::initializer_list<U> ilist, Args&&... args);
+// `default_shared_storage_t<T>` is `select_storage_t<T>` or `intrusive_storage` if it is `inline_storage`.
+
+template<
+	typename T,
+	bool UseInlineStorage = use_inline_storage_v<std::decay_t<T>>,
+	typename Storage = default_shared_storage_t<std::decay_t<T>>>
+constexpr optional<std::decay_t<T>, UseInlineStorage, Storage> make_optional(T&& v);
+
+template<
+	typename T,
+	bool UseInlineStorage = use_inline_storage_v<T>,
+	typename Storage = default_shared_storage_t<T>,
+	typename... Args>
+constexpr optional<T, UseInlineStorage, Storage> make_optional(Args&&... args);
+
+template<
+	typename T,
+	bool UseInlineStorage = use_inline_storage_v<T>,
+	typename Storage = default_shared_storage_t<T>,
+	typename U,
+	typename... Args>
+constexpr optional<T, UseInlineStorage, Storage> make_optional(std::initializer_list<U> ilist, Args&&... args);
 
 /// The class `optional` implements copy-on-write storage and provides `std::optional` like interface.
 /// \tparam T Value type.
 /// \tparam UseInlineStorage If false one value of T shared between all copies of the `optional` object.
 ///                          If true each copy of the `optional` object keep own copy of value object (small
 ///                          buffer optimization).
-template<typename T, bool UseInlineStorage = use_inline_storage_v<T>>
+/// \tparam Storage Storage policy of the shared value (see storage.h). It is used if `UseInlineStorage` is false.
+/// By default both parameters are chosen by `select_storage<T>`.
+template<
+	typename T, bool UseInlineStorage = use_inline_storage_v<T>, typename Storage = default_shared_storage_t<T>>
 class optional
 {
 	using value_type = T;
@@ -170,14 +247,22 @@ class optional
 	template<typename U, typename... Args>
 	constexpr explicit optional(in_place_t, std::initializer_list<U> ilist, Args&&... args);
 
+	/// Creates the value in the storage allocated by `allocator`. The copies of the value made on write are
+	/// allocated by the same allocator. It is declared only if `UseInlineStorage` is false.
+	template<typename Allocator, typename... Args>
+	explicit optional(std::allocator_arg_t, const Allocator& allocator, in_place_t, Args&&... args);
+
 	template<typename U = T>
 	constexpr EXPLICIT optional(U&& value);
 
-	template<typename U>
-	EXPLICIT optional(const optional<U>& other);
+	/// Shares the value of `other` if the storage policy allows it, otherwise copies it.
+	template<typename U, bool UseInlineStorage2, typename Storage2>
+	EXPLICIT optional(const optional<U, UseInlineStorage2, Storage2>& other);
 
-	template<typename U>
-	EXPLICIT optional(optional<U>&& other);
+	/// Shares the value of `other` if the storage policy allows it, otherwise moves it if `other` is the only owner
+	/// of the value and copies it if not.
+	template<typename U, bool UseInlineStorage2, typename Storage2>
+	EXPLICIT optional(optional<U, UseInlineStorage2, Storage2>&& other);
 
 	// destructor
 
@@ -213,10 +298,19 @@ class optional
 	explicit operator bool() const noexcept;
 	constexpr bool has_value() const noexcept;
 
+	/// \return true if both objects are not empty and share one value. It is always false if `UseInlineStorage` of
+	///         any object is true.
+	template<typename U, bool UseInlineStorage2, typename Storage2>
+	bool shares_storage_with(const optional<U, UseInlineStorage2, Storage2>& other) const noexcept;
+
 	/// \throw bad_optional_access if `has_value() == false`.
 	constexpr const T& value() const&;
 	/// \throw bad_optional_access if `has_value() == false`.
 	constexpr const T&& value() const&&;
+	/// Moves the value out if it is not shared with other objects, otherwise copies it. The inline specialization
+	/// returns `T&&`.
+	/// \throw bad_optional_access if `has_value() == false`.
+	constexpr T value() &&;
 
 	template<typename U>
 	constexpr T value_or(U&& default_value) const&;
@@ -226,6 +320,41 @@ class optional
 
 	// modifiers
 
+	/// Copies the value if it is shared with other objects and gives mutable access to it.
+	/// \throw bad_optional_access if `has_value() == false`.
+	write_session<T> write();
+
+	/// Copies the value if it is shared with other objects and calls `f` with mutable reference to it.
+	/// \throw bad_optional_access if `has_value() == false`.
+	/// \return The result of `f`.
+	template<typename F>
+	decltype(auto) modify(F&& f);
+
+	/// Replaces the value by the result of `f` called with r-value reference to the value. If the value is shared with
+	/// other objects `f` is called with a copy of the value. Does nothing if `has_value() == false`.
+	template<typename F>
+	optional& transform_inplace(F&& f);
+
+	/// Destroys the value and constructs a new one from `args`. If `UseInlineStorage` is false and the value is not
+	/// shared, the new value is constructed in the same storage, otherwise a new storage is created.
+	/// `args` must not refer to the value of this object.
+	/// \return Reference to the new value.
+	template<typename... Args>
+	const T& emplace(Args&&... args);
+
+	template<typename U, typename... Args>
+	const T& emplace(std::initializer_list<U> ilist, Args&&... args);
+
+	/// Extracts the value and makes the object empty. The value is moved if it is not shared with other objects,
+	/// otherwise it is copied.
+	/// \throw bad_optional_access if `has_value() == false`.
+	T take();
+
+#if __cpp_lib_optional
+	/// Extracts the value (if any) like `take()` and makes the object empty.
+	std::optional<T> release();
+#endif
+
 	void reset() noexcept;
 };
 
@@ -234,23 +363,39 @@ template<typename T>
 optional(T) -> optional<T>;
 #endif
 
+/// The `optional` with one storage policy instead of two parameters: `inline_storage` or the policy of the shared
+/// value.
+template<typename T, typename Storage = select_storage_t<T>>
+using basic_optional = optional<T, std::is_same<Storage, inline_storage>::value, ...>;
+
+#if __cpp_lib_memory_resource
+namespace pmr {
+
+/// The `optional` which allocates the shared value from `std::pmr::memory_resource`.
+template<typename T>
+using optional = cow::optional<T, false, intrusive_storage>;
+
+} // namespace pmr
+#endif
+
 } // namespace cow
 
 namespace std {
 
-template<typename T, bool UseInlineStorage>
-struct hash<cow::optional<T, UseInlineStorage>>;
+template<typename T, bool UseInlineStorage, typename Storage>
+struct hash<cow::optional<T, UseInlineStorage, Storage>>;
 
 } // namespace std
 */
 
 namespace cow {
 
-#ifdef COW_CPP_LIB_OPTIONAL
 // allow_inplace_placement
 template<typename T>
 struct allow_inplace_placement
-	: std::conjunction<std::is_trivially_copy_constructible<T>, std::is_trivially_copy_assignable<T>> {};
+	: detail::compatibility::disjunction<
+		detail::compatibility::conjunction<std::is_trivially_copy_constructible<T>, std::is_trivially_copy_assignable<T>>,
+		detail::aggregate_fields_satisfy<allow_inplace_placement, T>> {};
 
 template<typename T>
 struct allow_inplace_placement<std::shared_ptr<T>> : std::true_type {};
@@ -262,26 +407,67 @@ template<>
 struct allow_inplace_placement<std::exception_ptr> : std::true_type {};
 
 template<typename... Ts>
-struct allow_inplace_placement<std::tuple<Ts...>> : std::conjunction<allow_inplace_placement<Ts>...> {};
+struct allow_inplace_placement<std::tuple<Ts...>>
+	: detail::compatibility::conjunction<allow_inplace_placement<Ts>...> {};
 
 template<typename... Ts>
-struct allow_inplace_placement<std::pair<Ts...>> : std::conjunction<allow_inplace_placement<Ts>...> {};
+struct allow_inplace_placement<std::pair<Ts...>> : detail::compatibility::conjunction<allow_inplace_placement<Ts>...> {};
 
 template<typename T, std::size_t N>
 struct allow_inplace_placement<std::array<T, N>> : allow_inplace_placement<T> {};
 
+// inline_storage
+struct inline_storage {};
+
+// select_storage
+// The fields of T are inspected only if T fits the limits.
+template<
+	typename T,
+	std::size_t MaxInlineStorageSize = sizeof(std::shared_ptr<T>),
+	std::size_t MaxInlineStorageAlignment = alignof(std::max_align_t)>
+struct select_storage {
+	using type = std::conditional_t<
+		detail::compatibility::conjunction<
+			detail::compatibility::bool_constant<sizeof(T) <= MaxInlineStorageSize>,
+			detail::compatibility::bool_constant<alignof(T) <= MaxInlineStorageAlignment>,
+			allow_inplace_placement<T>>::value,
+		inline_storage,
+		intrusive_storage>;
+};
+
+template<
+	typename T,
+	std::size_t MaxInlineStorageSize = sizeof(std::shared_ptr<T>),
+	std::size_t MaxInlineStorageAlignment = alignof(std::max_align_t)>
+using select_storage_t = typename select_storage<T, MaxInlineStorageSize, MaxInlineStorageAlignment>::type;
+
 // use_inline_storage
-template<typename T, std::size_t MaxInlineStorageSize>
-struct use_inline_storage :
-	std::bool_constant<allow_inplace_placement<T>::value && sizeof(T) <= MaxInlineStorageSize> {};
+template<typename T, std::size_t MaxInlineStorageSize = sizeof(std::shared_ptr<T>)>
+struct use_inline_storage : std::is_same<select_storage_t<T, MaxInlineStorageSize>, inline_storage> {};
+
+namespace optional_detail {
+
+// the policy of the shared value which is used by `optional<T, false>` when the policy is not specified
+template<typename Storage>
+struct shared_storage {
+	using type = Storage;
+};
+
+template<>
+struct shared_storage<inline_storage> {
+	using type = intrusive_storage;
+};
 
+template<typename T>
+using default_shared_storage_t = typename shared_storage<select_storage_t<T>>::type;
+
+} // namespace optional_detail
+
+#ifdef COW_CPP_LIB_OPTIONAL
 using std::nullopt_t;
 using std::nullopt;
 using std::bad_optional_access;
 #else
-template<typename T, std::size_t MaxInlineStorageSize>
-struct use_inline_storage : std::false_type {};
-
 struct nullopt_t {};
 constexpr nullopt_t nullopt;
 
@@ -303,9 +489,74 @@ constexpr bool use_inline_storage_v = use_inline_storage<T, MaxInlineStorageSize
 /// \tparam UseInlineStorage If false one value of T shared between all copies of the `optional` object.
 ///                          If true each copy of the `optional` object keep own copy of value object (small
 ///                          buffer optimization).
-template<typename T, bool UseInlineStorage = use_inline_storage_v<T>>
+/// \tparam Storage Storage policy of the shared value. It is used if `UseInlineStorage` is false.
+/// By default both parameters are chosen by `select_storage<T>`.
+template<
+	typename T,
+	bool UseInlineStorage = use_inline_storage_v<T>,
+	typename Storage = optional_detail::default_shared_storage_t<T>>
 class optional;
 
+template<typename T, typename Storage = select_storage_t<T>>
+using basic_optional = optional<
+	T, std::is_same<Storage, inline_storage>::value, typename optional_detail::shared_storage<Storage>::type>;
+
+template<typename T, typename Storage>
+class atomic_optional;
+
+namespace detail {
+
+struct write_session_access;
+
+} // namespace detail
+
+template<typename T>
+class write_session {
+	friend struct detail::write_session_access;
+
+public:
+	write_session(const write_session&) = delete;
+	write_session(write_session&&) noexcept = default;
+	write_session& operator=(const write_session&) = delete;
+	write_session& operator=(write_session&&) noexcept = default;
+	~write_session() = default;
+
+	COW_NODISCARD T* operator->() const noexcept
+	{
+		return value_;
+	}
+
+	COW_NODISCARD T& operator*() const noexcept
+	{
+		return *value_;
+	}
+
+	COW_NODISCARD T& get() const noexcept
+	{
+		return *value_;
+	}
+
+private:
+	explicit write_session(T& value) noexcept
+		: value_{std::addressof(value)}
+	{}
+
+	T* value_;
+};
+
+namespace detail {
+
+// creates the write sessions of `optional` and the containers
+struct write_session_access {
+	template<typename T>
+	COW_NODISCARD static write_session<T> make(T& value) noexcept
+	{
+		return write_session<T>{value};
+	}
+};
+
+} // namespace detail
+
 namespace optional_detail {
 
 template<typename ToOptional, typename U>
@@ -360,6 +611,20 @@ struct unwrapping {
 		&& allow_move;
 };
 
+template<typename T, typename Storage, typename U, typename FromStorage>
+struct sharing_conversation {
+	static constexpr bool allow = std::is_convertible<
+		const typename FromStorage::template pointer<U>&, typename Storage::template pointer<T>>::value;
+
+	// the value of the derived class which cannot be shared would be sliced by the copy to the base class
+	static constexpr bool slice = !allow
+		&& std::is_class<T>::value
+		&& std::is_base_of<std::remove_cv_t<T>, std::remove_cv_t<U>>::value
+		&& !std::is_same<std::remove_cv_t<T>, std::remove_cv_t<U>>::value;
+
+	static constexpr bool allow_copy = !allow && !slice;
+};
+
 template<typename ToOptional, typename U>
 struct assign_direct_conversation {
 	using to_value_type = typename ToOptional::value_type;
@@ -393,10 +658,40 @@ struct assing_unwrapping {
 		&& allow;
 };
 
+// computes the hash of the value, the shared value can keep it in the storage
+struct hash_access {
+	template<typename T, typename Storage>
+	static std::size_t hash(const optional<T, false, Storage>& co)
+	{
+		return co.data_.hash();
+	}
+
+	template<typename T, typename Storage>
+	static std::size_t hash(const optional<T, true, Storage>& co)
+	{
+		return detail::compute_hash(*co);
+	}
+
+	// returns true if the values are known to be different by their cached hashes
+	template<typename T, typename Storage1, typename Storage2>
+	static bool hashes_differ(const optional<T, false, Storage1>& lhs, const optional<T, false, Storage2>& rhs) noexcept
+	{
+		std::size_t lhs_hash = 0;
+		std::size_t rhs_hash = 0;
+		return lhs.data_.try_get_hash(lhs_hash) && rhs.data_.try_get_hash(rhs_hash) && lhs_hash != rhs_hash;
+	}
+
+	template<typename LhsOptional, typename RhsOptional>
+	static bool hashes_differ(const LhsOptional& /*lhs*/, const RhsOptional& /*rhs*/) noexcept
+	{
+		return false;
+	}
+};
+
 } // namespace optional_detail
 
-template<typename T>
-class optional<T, false> {
+template<typename T, typename Storage>
+class optional<T, false, Storage> {
 	static_assert(
 		!std::is_reference<T>::value, "Instantiation of optional with a reference type is ill-formed");
 	static_assert(
@@ -406,9 +701,16 @@ class optional<T, false> {
 	static_assert(
 		std::is_destructible<T>::value, "Instantiation of optional with a non-destructible type is ill-formed");
 
-	template<typename, bool>
+	template<typename, bool, typename>
 	friend class optional;
 
+	friend struct optional_detail::hash_access;
+
+	template<typename, typename>
+	friend class atomic_optional;
+
+	using pointer = typename Storage::template pointer<T>;
+
 public:
 	using value_type = T;
 
@@ -425,7 +727,7 @@ public:
 
 	template<typename... Args, typename = std::enable_if_t<std::is_constructible<T, Args...>::value>>
 	constexpr explicit optional(in_place_t, Args&&... args)
-		: data_{std::make_shared<value_type>(std::forward<Args>(args)...)}
+		: data_{pointer::make(std::forward<Args>(args)...)}
 	{}
 
 	template<
@@ -433,7 +735,15 @@ public:
 		typename... Args,
 		typename = std::enable_if_t<std::is_constructible<T, std::initializer_list<U>&, Args&&...>::value>>
 	constexpr explicit optional(in_place_t, std::initializer_list<U> ilist, Args&&... args)
-		: data_{std::make_shared<value_type>(ilist, std::forward<Args>(args)...)}
+		: data_{pointer::make(ilist, std::forward<Args>(args)...)}
+	{}
+
+	template<
+		typename Allocator,
+		typename... Args,
+		typename = std::enable_if_t<std::is_constructible<T, Args...>::value>>
+	explicit optional(std::allocator_arg_t, const Allocator& allocator, in_place_t, Args&&... args)
+		: data_{pointer::allocate(allocator, std::forward<Args>(args)...)}
 	{}
 
 	template<
@@ -450,54 +760,102 @@ public:
 
 	template<
 		typename U,
+		typename S,
 		std::enable_if_t<
-			std::is_convertible<U*, T*>::value && optional_detail::unwrapping<T, optional<U, false>>::allow_copy,
+			optional_detail::sharing_conversation<T, Storage, U, S>::allow
+				&& optional_detail::unwrapping<T, optional<U, false, S>>::allow_copy,
 			int> = 0>
-	optional(const optional<U, false>& other) noexcept // NOLINT: Allow implicit conversion
+	optional(const optional<U, false, S>& other) noexcept // NOLINT: Allow implicit conversion
 		: data_{other.data_}
 	{}
 
 	// non-cow constructor
 	template<
 		typename U,
+		typename S,
+		std::enable_if_t<
+			optional_detail::sharing_conversation<T, Storage, U, S>::allow_copy
+				&& optional_detail::unwrapping<T, optional<U, false, S>>::allow_copy_implicit,
+			int> = 0>
+	optional(const optional<U, false, S>& other) // NOLINT: Allow implicit conversion
+		: data_{other ? pointer::make(*other) : pointer{}}
+	{}
+
+	// non-cow constructor
+	template<
+		typename U,
+		typename S,
 		std::enable_if_t<
-			!std::is_convertible<U*, T*>::value && optional_detail::unwrapping<T, optional<U, false>>::allow_copy,
+			optional_detail::sharing_conversation<T, Storage, U, S>::allow_copy
+				&& optional_detail::unwrapping<T, optional<U, false, S>>::allow_copy_explicit,
 			int> = 0>
-	explicit optional(const optional<U, false>& other)
-		: data_{other ? std::make_shared<value_type>(*other) : nullptr}
+	explicit optional(const optional<U, false, S>& other)
+		: data_{other ? pointer::make(*other) : pointer{}}
 	{}
 
+	// the copy would slice the value of the derived class
+	template<
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::sharing_conversation<T, Storage, U, S>::slice, int> = 0>
+	optional(const optional<U, false, S>&) = delete;
 
-#ifdef COW_CPP_LIB_OPTIONAL
 	// non-cow constructor
-	template<typename U, std::enable_if_t<optional_detail::unwrapping<T, optional<U, true>>::allow_copy, int> = 0>
-	explicit optional(const optional<U, true>& other)
-		: data_{other ? std::make_shared<value_type>(*other) : nullptr}
+	template<
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::unwrapping<T, optional<U, true, S>>::allow_copy, int> = 0>
+	explicit optional(const optional<U, true, S>& other)
+		: data_{other ? pointer::make(*other) : pointer{}}
 	{}
-#endif
 
-	template<typename U, std::enable_if_t<std::is_convertible<U*, T*>::value, int> = 0>
-	optional(optional<U, false>&& other) noexcept // NOLINT: Allow implicit conversion
+	template<
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::sharing_conversation<T, Storage, U, S>::allow, int> = 0>
+	optional(optional<U, false, S>&& other) noexcept // NOLINT: Allow implicit conversion
 		: data_{std::move(other.data_)}
 	{}
 
 	// non-cow constructor
 	template<
 		typename U,
+		typename S,
 		std::enable_if_t<
-			!std::is_convertible<U*, T*>::value && optional_detail::unwrapping<T, optional<U, false>>::allow_move,
+			optional_detail::sharing_conversation<T, Storage, U, S>::allow_copy
+				&& optional_detail::unwrapping<T, optional<U, false, S>>::allow_move_implicit,
 			int> = 0>
-	explicit optional(optional<U, false>&& other)
-		: data_{other ? std::make_shared<value_type>(*std::move(other)) : nullptr}
+	optional(optional<U, false, S>&& other) // NOLINT: Allow implicit conversion
+		: data_{make_data(std::move(other))}
 	{}
 
-#ifdef COW_CPP_LIB_OPTIONAL
 	// non-cow constructor
-	template<typename U, std::enable_if_t<optional_detail::unwrapping<T, optional<U, true>>::allow_move, int> = 0>
-	explicit optional(optional<U, true>&& other)
-		: data_{other ? std::make_shared<value_type>(*std::move(other)) : nullptr}
+	template<
+		typename U,
+		typename S,
+		std::enable_if_t<
+			optional_detail::sharing_conversation<T, Storage, U, S>::allow_copy
+				&& optional_detail::unwrapping<T, optional<U, false, S>>::allow_move_explicit,
+			int> = 0>
+	explicit optional(optional<U, false, S>&& other)
+		: data_{make_data(std::move(other))}
+	{}
+
+	// the move would slice the value of the derived class
+	template<
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::sharing_conversation<T, Storage, U, S>::slice, int> = 0>
+	optional(optional<U, false, S>&&) = delete;
+
+	// non-cow constructor
+	template<
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::unwrapping<T, optional<U, true, S>>::allow_move, int> = 0>
+	explicit optional(optional<U, true, S>&& other)
+		: data_{other ? pointer::make(*std::move(other)) : pointer{}}
 	{}
-#endif
 
 	// destructor
 	~optional() = default;
@@ -523,10 +881,12 @@ public:
 
 	template<
 		typename U = T,
+		typename S = Storage,
 		std::enable_if_t<
-			std::is_convertible<U*, T*>::value && optional_detail::assing_unwrapping<T, optional<U, false>>::allow_copy,
+			optional_detail::sharing_conversation<T, Storage, U, S>::allow
+				&& optional_detail::assing_unwrapping<T, optional<U, false, S>>::allow_copy,
 			int> = 0>
-	optional& operator=(const optional<U, false>& other) noexcept
+	optional& operator=(const optional<U, false, S>& other) noexcept
 	{
 		data_ = other.data_;
 		return *this;
@@ -535,10 +895,12 @@ public:
 	// non-cow assignment
 	template<
 		typename U = T,
+		typename S = Storage,
 		std::enable_if_t<
-			!std::is_convertible<U*, T*>::value && optional_detail::assing_unwrapping<T, optional<U, false>>::allow_copy,
+			optional_detail::sharing_conversation<T, Storage, U, S>::allow_copy
+				&& optional_detail::assing_unwrapping<T, optional<U, false, S>>::allow_copy,
 			int> = 0>
-	optional& operator=(const optional<U, false>& other)
+	optional& operator=(const optional<U, false, S>& other)
 	{
 		if (other)
 			set_value(*other);
@@ -548,11 +910,19 @@ public:
 		return *this;
 	}
 
-#ifdef COW_CPP_LIB_OPTIONAL
+	// the copy would slice the value of the derived class
+	template<
+		typename U = T,
+		typename S = Storage,
+		std::enable_if_t<optional_detail::sharing_conversation<T, Storage, U, S>::slice, int> = 0>
+	optional& operator=(const optional<U, false, S>&) = delete;
+
 	// non-cow assignment
 	template<
-		typename U = T, std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, true>>::allow_copy, int> = 0>
-	optional& operator=(const optional<U, true>& other)
+		typename U = T,
+		typename S = Storage,
+		std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, true, S>>::allow_copy, int> = 0>
+	optional& operator=(const optional<U, true, S>& other)
 	{
 		if (other)
 			set_value(*other);
@@ -561,14 +931,15 @@ public:
 
 		return *this;
 	}
-#endif
 
 	template<
 		typename U = T,
+		typename S = Storage,
 		std::enable_if_t<
-			std::is_convertible<U*, T*>::value && optional_detail::assing_unwrapping<T, optional<U, false>>::allow_move,
+			optional_detail::sharing_conversation<T, Storage, U, S>::allow
+				&& optional_detail::assing_unwrapping<T, optional<U, false, S>>::allow_move,
 			int> = 0>
-	optional& operator=(optional<U, false>&& other) noexcept
+	optional& operator=(optional<U, false, S>&& other) noexcept
 	{
 		data_ = std::move(other.data_);
 		return *this;
@@ -577,25 +948,38 @@ public:
 	// non-cow assignment
 	template<
 		typename U = T,
+		typename S = Storage,
 		std::enable_if_t<
-			!std::is_convertible<U*, T*>::value
-			&& optional_detail::assing_unwrapping<T, optional<U, false>>::allow_move,
+			optional_detail::sharing_conversation<T, Storage, U, S>::allow_copy
+				&& optional_detail::assing_unwrapping<T, optional<U, false, S>>::allow_move,
 			int> = 0>
-	optional& operator=(optional<U, false>&& other)
+	optional& operator=(optional<U, false, S>&& other)
 	{
-		if (other)
-			set_value(*std::move(other));
-		else
+		if (!other)
 			reset();
+		else if (other.data_.unique()) {
+			other.data_.invalidate_hash();
+			set_value(std::move(*other.data_));
+		}
+		else
+			set_value(*other);
 
 		return *this;
 	}
 
-#ifdef COW_CPP_LIB_OPTIONAL
+	// the move would slice the value of the derived class
+	template<
+		typename U = T,
+		typename S = Storage,
+		std::enable_if_t<optional_detail::sharing_conversation<T, Storage, U, S>::slice, int> = 0>
+	optional& operator=(optional<U, false, S>&&) = delete;
+
 	// non-cow assignment
 	template<
-		typename U = T, std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, true>>::allow_move, int> = 0>
-	optional& operator=(optional<U, true>&& other)
+		typename U = T,
+		typename S = Storage,
+		std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, true, S>>::allow_move, int> = 0>
+	optional& operator=(optional<U, true, S>&& other)
 	{
 		if (other)
 			set_value(*std::move(other));
@@ -604,7 +988,6 @@ public:
 
 		return *this;
 	}
-#endif
 
 	// swap
 
@@ -640,6 +1023,18 @@ public:
 		return static_cast<bool>(data_);
 	}
 
+	template<typename U, typename S>
+	COW_NODISCARD bool shares_storage_with(const optional<U, false, S>& other) const noexcept
+	{
+		return data_ && static_cast<const void*>(data_.get()) == static_cast<const void*>(other.data_.get());
+	}
+
+	template<typename U, typename S>
+	COW_NODISCARD constexpr bool shares_storage_with(const optional<U, true, S>& /*other*/) const noexcept
+	{
+		return false;
+	}
+
 	COW_NODISCARD constexpr const T& value() const&
 	{
 		if (!data_)
@@ -656,6 +1051,19 @@ public:
 		return std::move(*data_);
 	}
 
+	COW_NODISCARD constexpr T value() &&
+	{
+		if (!data_)
+			throw bad_optional_access{};
+
+		if (data_.unique()) {
+			data_.invalidate_hash();
+			return std::move(*data_);
+		}
+
+		return *data_;
+	}
+
 	template<typename U>
 	COW_NODISCARD constexpr T value_or(U&& default_value) const&
 	{
@@ -671,45 +1079,146 @@ public:
 		if (!data_)
 			return static_cast<value_type>(std::forward<U>(default_value));
 
-		if (data_.use_count() == 1)
+		if (data_.unique()) {
+			data_.invalidate_hash();
 			return std::move(*data_);
+		}
 
 		return *data_;
 	}
 
 	// modifiers
 
+	COW_NODISCARD write_session<T> write()
+	{
+		if (!data_)
+			throw bad_optional_access{};
+
+		if (data_.unique())
+			data_.invalidate_hash();
+		else
+			data_ = data_.make_similar(*data_);
+
+		return detail::write_session_access::make(*data_);
+	}
+
+	template<typename F>
+	decltype(auto) modify(F&& f)
+	{
+		return std::forward<F>(f)(*write());
+	}
+
+	template<typename F>
+	optional& transform_inplace(F&& f)
+	{
+		if (data_.unique()) {
+			data_.invalidate_hash();
+			*data_ = std::forward<F>(f)(std::move(*data_));
+		}
+		else if (data_)
+			data_ = data_.make_similar(std::forward<F>(f)(T(*data_)));
+
+		return *this;
+	}
+
+	template<typename... Args, typename = std::enable_if_t<std::is_constructible<T, Args...>::value>>
+	const T& emplace(Args&&... args)
+	{
+		if (data_.unique())
+			data_.emplace(std::forward<Args>(args)...);
+		else
+			data_ = data_.make_similar(std::forward<Args>(args)...);
+
+		return *data_;
+	}
+
+	template<
+		typename U,
+		typename... Args,
+		typename = std::enable_if_t<std::is_constructible<T, std::initializer_list<U>&, Args&&...>::value>>
+	const T& emplace(std::initializer_list<U> ilist, Args&&... args)
+	{
+		if (data_.unique())
+			data_.emplace(ilist, std::forward<Args>(args)...);
+		else
+			data_ = data_.make_similar(ilist, std::forward<Args>(args)...);
+
+		return *data_;
+	}
+
+	COW_NODISCARD T take()
+	{
+		if (!data_)
+			throw bad_optional_access{};
+
+		const pointer data = std::move(data_);
+		if (data.unique())
+			return std::move(*data);
+
+		return *data;
+	}
+
+#ifdef COW_CPP_LIB_OPTIONAL
+	COW_NODISCARD std::optional<T> release()
+	{
+		const pointer data = std::move(data_);
+		if (!data)
+			return std::nullopt;
+
+		if (data.unique())
+			return std::optional<T>{std::in_place, std::move(*data)};
+
+		return std::optional<T>{std::in_place, *data};
+	}
+#endif
+
 	void reset() noexcept
 	{
 		data_.reset();
 	}
 
 private:
+	// moves the value out of `other` if it is the only owner, otherwise copies it
+	template<typename U, typename S>
+	static pointer make_data(optional<U, false, S>&& other)
+	{
+		if (!other)
+			return pointer{};
+
+		if (other.data_.unique()) {
+			other.data_.invalidate_hash();
+			return pointer::make(std::move(*other.data_));
+		}
+
+		return pointer::make(*other);
+	}
+
 	template<typename U>
 	void set_value(U&& value)
 	{
-		if (data_.use_count() == 1)
+		if (data_.unique()) {
+			data_.invalidate_hash();
 			*data_ = std::forward<U>(value);
+		}
 		else
-			data_ = std::make_shared<value_type>(std::forward<U>(value));
+			data_ = data_.make_similar(std::forward<U>(value));
 	}
 
-	std::shared_ptr<value_type> data_;
+	pointer data_;
 };
 
 
 // specialized algorithms
 
-template<typename T>
-void swap(optional<T, false>& lhs, optional<T, false>& rhs) noexcept
+template<typename T, typename Storage>
+void swap(optional<T, false, Storage>& lhs, optional<T, false, Storage>& rhs) noexcept
 {
 	lhs.swap(rhs);
 }
 
-#ifdef COW_CPP_LIB_OPTIONAL
-template<typename T>
-class optional<T, true> {
-	template<typename, bool>
+template<typename T, typename Storage>
+class optional<T, true, Storage> {
+	template<typename, bool, typename>
 	friend class optional;
 
 public:
@@ -720,7 +1229,7 @@ public:
 	optional() = default;
 
 	constexpr optional(nullopt_t) noexcept // NOLINT: Allow implicit conversion
-		: data_{std::nullopt}
+		: data_{}
 	{}
 
 	optional(const optional&) = default;
@@ -728,7 +1237,7 @@ public:
 
 	template<typename... Args, typename = std::enable_if_t<std::is_constructible<T, Args...>::value>>
 	constexpr explicit optional(in_place_t, Args&&... args)
-		: data_{std::in_place, std::forward<Args>(args)...}
+		: data_{in_place, std::forward<Args>(args)...}
 	{}
 
 	template<
@@ -736,68 +1245,100 @@ public:
 		typename... Args,
 		typename = std::enable_if_t<std::is_constructible<T, std::initializer_list<U>&, Args&&...>::value>>
 	constexpr explicit optional(in_place_t, std::initializer_list<U> ilist, Args&&... args)
-		: data_{std::in_place, ilist, std::forward<Args>(args)...}
+		: data_{in_place, ilist, std::forward<Args>(args)...}
 	{}
 
 	template<
 		typename U = T, std::enable_if_t<optional_detail::direct_conversation<optional, U>::allow_implicit, int> = 0>
 	constexpr optional(U&& value) // NOLINT: Allow implicit conversion
-		: data_{std::forward<U>(value)}
+		: data_{in_place, std::forward<U>(value)}
 	{}
 
 	template<
 		typename U = T, std::enable_if_t<optional_detail::direct_conversation<optional, U>::allow_explicit, int> = 0>
 	constexpr explicit optional(U&& value)
-		: data_{std::forward<U>(value)}
+		: data_{in_place, std::forward<U>(value)}
 	{}
 
 	template<
-		typename U, std::enable_if_t<optional_detail::unwrapping<T, optional<U, true>>::allow_copy_implicit, int> = 0>
-	optional(const optional<U, true>& other) // NOLINT: Allow implicit conversion
-		: data_{other.data_}
-	{}
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::unwrapping<T, optional<U, true, S>>::allow_copy_implicit, int> = 0>
+	optional(const optional<U, true, S>& other) // NOLINT: Allow implicit conversion
+	{
+		if (other)
+			data_.emplace(*other);
+	}
 
 	template<
-		typename U, std::enable_if_t<optional_detail::unwrapping<T, optional<U, false>>::allow_copy_implicit, int> = 0>
-	optional(const optional<U, false>& other) // NOLINT: Allow implicit conversion
-		: data_{other ? decltype(data_)(*other) : nullopt}
-	{}
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::unwrapping<T, optional<U, false, S>>::allow_copy_implicit, int> = 0>
+	optional(const optional<U, false, S>& other) // NOLINT: Allow implicit conversion
+	{
+		if (other)
+			data_.emplace(*other);
+	}
 
 	template<
-		typename U, std::enable_if_t<optional_detail::unwrapping<T, optional<U, true>>::allow_copy_explicit, int> = 0>
-	explicit optional(const optional<U, true>& other)
-		: data_{other.data_}
-	{}
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::unwrapping<T, optional<U, true, S>>::allow_copy_explicit, int> = 0>
+	explicit optional(const optional<U, true, S>& other)
+	{
+		if (other)
+			data_.emplace(*other);
+	}
 
 	template<
-		typename U, std::enable_if_t<optional_detail::unwrapping<T, optional<U, false>>::allow_copy_explicit, int> = 0>
-	explicit optional(const optional<U, false>& other)
-		: data_{other ? decltype(data_)(*other) : nullopt}
-	{}
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::unwrapping<T, optional<U, false, S>>::allow_copy_explicit, int> = 0>
+	explicit optional(const optional<U, false, S>& other)
+	{
+		if (other)
+			data_.emplace(*other);
+	}
 
 	template<
-		typename U, std::enable_if_t<optional_detail::unwrapping<T, optional<U, true>>::allow_move_implicit, int> = 0>
-	optional(optional<U, true>&& other) // NOLINT: Allow implicit conversion
-		: data_{std::move(other.data_)}
-	{}
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::unwrapping<T, optional<U, true, S>>::allow_move_implicit, int> = 0>
+	optional(optional<U, true, S>&& other) // NOLINT: Allow implicit conversion
+	{
+		if (other)
+			data_.emplace(*std::move(other));
+	}
 
 	template<
-		typename U, std::enable_if_t<optional_detail::unwrapping<T, optional<U, false>>::allow_move_implicit, int> = 0>
-	optional(optional<U, false>&& other) // NOLINT: Allow implicit conversion
-		: data_{other ? decltype(data_)(*std::move(other)) : nullopt}
-	{}
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::unwrapping<T, optional<U, false, S>>::allow_move_implicit, int> = 0>
+	optional(optional<U, false, S>&& other) // NOLINT: Allow implicit conversion
+	{
+		if (other)
+			data_.emplace(*std::move(other));
+	}
 
 	template<
-		typename U, std::enable_if_t<optional_detail::unwrapping<T, optional<U, true>>::allow_move_explicit, int> = 0>
-	explicit optional(optional<U, true>&& other)
-		: data_{std::move(other.data_)}
-	{}
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::unwrapping<T, optional<U, true, S>>::allow_move_explicit, int> = 0>
+	explicit optional(optional<U, true, S>&& other)
+	{
+		if (other)
+			data_.emplace(*std::move(other));
+	}
 
 	template<
-		typename U, std::enable_if_t<optional_detail::unwrapping<T, optional<U, false>>::allow_move_explicit, int> = 0>
-	explicit optional(optional<U, false>&& other)
-		: data_{other ? decltype(data_)(*std::move(other)) : nullopt}
-	{}
+		typename U,
+		typename S,
+		std::enable_if_t<optional_detail::unwrapping<T, optional<U, false, S>>::allow_move_explicit, int> = 0>
+	explicit optional(optional<U, false, S>&& other)
+	{
+		if (other)
+			data_.emplace(*std::move(other));
+	}
 
 	// destructor
 
@@ -807,7 +1348,7 @@ public:
 
 	optional& operator=(nullopt_t) noexcept
 	{
-		data_ = std::nullopt;
+		data_.reset();
 		return *this;
 	}
 
@@ -818,26 +1359,32 @@ public:
 		typename U = T, typename = std::enable_if_t<optional_detail::assign_direct_conversation<optional, U>::allow>>
 	optional& operator=(U&& value)
 	{
-		data_ = std::forward<U>(value);
+		data_.assign(std::forward<U>(value));
 		return *this;
 	}
 
 	template<
 		typename U = T,
-		typename = std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, true>>::allow_copy>>
-	optional& operator=(const optional<U, true>& other)
+		typename S = Storage,
+		typename = std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, true, S>>::allow_copy>>
+	optional& operator=(const optional<U, true, S>& other)
 	{
-		data_ = other.data_;
+		if (other)
+			data_.assign(*other);
+		else
+			reset();
+
 		return *this;
 	}
 
 	template<
 		typename U = T,
-		typename = std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, false>>::allow_copy>>
-	optional& operator=(const optional<U, false>& other)
+		typename S = Storage,
+		typename = std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, false, S>>::allow_copy>>
+	optional& operator=(const optional<U, false, S>& other)
 	{
 		if (other)
-			data_ = *other;
+			data_.assign(*other);
 		else
 			reset();
 
@@ -846,20 +1393,26 @@ public:
 
 	template<
 		typename U = T,
-		typename = std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, true>>::allow_move>>
-	optional& operator=(optional<U, true>&& other)
+		typename S = Storage,
+		typename = std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, true, S>>::allow_move>>
+	optional& operator=(optional<U, true, S>&& other)
 	{
-		data_ = std::move(other.data_);
+		if (other)
+			data_.assign(*std::move(other));
+		else
+			reset();
+
 		return *this;
 	}
 
 	template<
 		typename U = T,
-		typename = std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, false>>::allow_move>>
-	optional& operator=(optional<U, false>&& other)
+		typename S = Storage,
+		typename = std::enable_if_t<optional_detail::assing_unwrapping<T, optional<U, false, S>>::allow_move>>
+	optional& operator=(optional<U, false, S>&& other)
 	{
 		if (other)
-			data_ = *std::move(other);
+			data_.assign(*std::move(other));
 		else
 			reset();
 
@@ -869,7 +1422,9 @@ public:
 	// swap
 
 	void swap(optional& other)
-		noexcept(std::is_nothrow_move_constructible<T>::value && std::is_nothrow_swappable<T>::value)
+		noexcept(
+			std::is_nothrow_move_constructible<T>::value
+			&& detail::compatibility::is_nothrow_swappable<T>::value)
 	{
 		data_.swap(other.data_);
 	}
@@ -878,27 +1433,27 @@ public:
 
 	COW_NODISCARD constexpr const T* operator->() const
 	{
-		return data_.operator->();
+		return std::addressof(data_.get());
 	}
 
 	COW_NODISCARD constexpr const T& operator*() const&
 	{
-		return data_.operator*();
+		return data_.get();
 	}
 
 	COW_NODISCARD constexpr T&& operator*() &&
 	{
-		return std::move(data_).operator*();
+		return std::move(data_.get());
 	}
 
 	COW_NODISCARD constexpr const T&& operator*() const&&
 	{
-		return std::move(data_).operator*();
+		return std::move(data_.get());
 	}
 
 	constexpr explicit operator bool() const noexcept
 	{
-		return static_cast<bool>(data_);
+		return data_.has_value();
 	}
 
 	COW_NODISCARD constexpr bool has_value() const noexcept
@@ -906,53 +1461,121 @@ public:
 		return data_.has_value();
 	}
 
+	template<typename U, bool UseInlineStorage2, typename S>
+	COW_NODISCARD constexpr bool shares_storage_with(
+		const optional<U, UseInlineStorage2, S>& /*other*/) const noexcept
+	{
+		return false;
+	}
+
 	COW_NODISCARD constexpr const T& value() const&
 	{
-		return data_.value();
+		return data_.has_value() ? data_.get() : throw bad_optional_access{};
 	}
 
 	COW_NODISCARD constexpr T&& value() &&
 	{
-		return std::move(data_).value();
+		return std::move(mutable_value());
 	}
 
 	COW_NODISCARD constexpr const T&& value() const&&
 	{
-		return std::move(data_).value();
+		return std::move(value());
 	}
 
 	template<typename U>
 	COW_NODISCARD constexpr T value_or(U&& default_value) const&
 	{
-		return data_.value_or(std::forward<U>(default_value));
+		return data_.has_value() ? data_.get() : static_cast<T>(std::forward<U>(default_value));
 	}
 
 	template<typename U>
 	COW_NODISCARD constexpr T value_or(U&& default_value) &&
 	{
-		return std::move(data_).value_or(std::forward<U>(default_value));
+		return data_.has_value() ? std::move(data_.get()) : static_cast<T>(std::forward<U>(default_value));
 	}
 
 	// modifiers
 
+	COW_NODISCARD write_session<T> write()
+	{
+		return detail::write_session_access::make(mutable_value());
+	}
+
+	template<typename F>
+	decltype(auto) modify(F&& f)
+	{
+		return std::forward<F>(f)(mutable_value());
+	}
+
+	template<typename F>
+	optional& transform_inplace(F&& f)
+	{
+		if (data_.has_value())
+			data_.get() = std::forward<F>(f)(std::move(data_.get()));
+
+		return *this;
+	}
+
+	template<typename... Args, typename = std::enable_if_t<std::is_constructible<T, Args...>::value>>
+	const T& emplace(Args&&... args)
+	{
+		return data_.emplace(std::forward<Args>(args)...);
+	}
+
+	template<
+		typename U,
+		typename... Args,
+		typename = std::enable_if_t<std::is_constructible<T, std::initializer_list<U>&, Args&&...>::value>>
+	const T& emplace(std::initializer_list<U> ilist, Args&&... args)
+	{
+		return data_.emplace(ilist, std::forward<Args>(args)...);
+	}
+
+	COW_NODISCARD T take()
+	{
+		T value = std::move(mutable_value());
+		data_.reset();
+		return value;
+	}
+
+#ifdef COW_CPP_LIB_OPTIONAL
+	COW_NODISCARD std::optional<T> release()
+	{
+		if (!data_.has_value())
+			return std::nullopt;
+
+		std::optional<T> value{std::in_place, std::move(data_.get())};
+		data_.reset();
+		return value;
+	}
+#endif
+
 	void reset() noexcept
 	{
 		data_.reset();
 	}
 
 private:
-	std::optional<value_type> data_;
+	T& mutable_value()
+	{
+		if (!data_.has_value())
+			throw bad_optional_access{};
+
+		return data_.get();
+	}
+
+	detail::inline_value<value_type> data_;
 };
 
 // specialized algorithms
 
-template<typename T>
-std::enable_if_t<std::is_move_constructible<T>::value&& std::is_swappable<T>::value>
-swap(optional<T, true>& lhs, optional<T, true>& rhs) noexcept(noexcept(lhs.swap(rhs)))
+template<typename T, typename Storage>
+std::enable_if_t<std::is_move_constructible<T>::value && detail::compatibility::is_swappable<T>::value>
+swap(optional<T, true, Storage>& lhs, optional<T, true, Storage>& rhs) noexcept(noexcept(lhs.swap(rhs)))
 {
 	lhs.swap(rhs);
 }
-#endif
 
 #if __cpp_deduction_guides
 template<typename T>
@@ -963,35 +1586,44 @@ optional(T) -> optional<T>;
 
 // ## relational operations
 
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
 COW_NODISCARD constexpr bool operator==(
-	const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs)
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs)
 {
 	if (static_cast<bool>(lhs) != static_cast<bool>(rhs))
 		return false;
 
-	if (!lhs)
+	if (!lhs || lhs.shares_storage_with(rhs))
 		return true;
 
+	if (optional_detail::hash_access::hashes_differ(lhs, rhs))
+		return false;
+
 	return *lhs == *rhs;
 }
 
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
 COW_NODISCARD constexpr bool operator!=(
-	const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs)
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs)
 {
 	if (static_cast<bool>(lhs) != static_cast<bool>(rhs))
 		return true;
 
-	if (!lhs)
+	if (!lhs || lhs.shares_storage_with(rhs))
 		return false;
 
+	if (optional_detail::hash_access::hashes_differ(lhs, rhs))
+		return true;
+
 	return *lhs != *rhs;
 }
 
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
 COW_NODISCARD constexpr bool operator<(
-	const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs)
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs)
 {
 	if (!rhs)
 		return false;
@@ -999,12 +1631,16 @@ COW_NODISCARD constexpr bool operator<(
 	if (!lhs)
 		return true;
 
+	if (lhs.shares_storage_with(rhs))
+		return false;
+
 	return *lhs < *rhs;
 }
 
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
 COW_NODISCARD constexpr bool operator>(
-	const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs)
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs)
 {
 	if (!lhs)
 		return false;
@@ -1012,12 +1648,16 @@ COW_NODISCARD constexpr bool operator>(
 	if (!rhs)
 		return true;
 
+	if (lhs.shares_storage_with(rhs))
+		return false;
+
 	return *lhs > *rhs;
 }
 
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
 COW_NODISCARD constexpr bool operator<=(
-	const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs)
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs)
 {
 	if (!lhs)
 		return true;
@@ -1025,12 +1665,16 @@ COW_NODISCARD constexpr bool operator<=(
 	if (!rhs)
 		return false;
 
+	if (lhs.shares_storage_with(rhs))
+		return true;
+
 	return *lhs <= *rhs;
 }
 
-template<typename T, bool UseInlineStorage1, typename U, bool UseInlineStorage2>
+template<
+	typename T, bool UseInlineStorage1, typename Storage1, typename U, bool UseInlineStorage2, typename Storage2>
 COW_NODISCARD constexpr bool operator>=(
-	const optional<T, UseInlineStorage1>& lhs, const optional<U, UseInlineStorage2>& rhs)
+	const optional<T, UseInlineStorage1, Storage1>& lhs, const optional<U, UseInlineStorage2, Storage2>& rhs)
 {
 	if (!rhs)
 		return true;
@@ -1038,190 +1682,214 @@ COW_NODISCARD constexpr bool operator>=(
 	if (!lhs)
 		return false;
 
-	return *lhs >= * rhs;
+	if (lhs.shares_storage_with(rhs))
+		return true;
+
+	return *lhs >= *rhs;
 }
 
 // ### comparison with nullopt
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator==(const optional<T, UseInlineStorage>& lhs, nullopt_t) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator==(const optional<T, UseInlineStorage, Storage>& lhs, nullopt_t) noexcept
 {
 	return !lhs;
 }
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator==(nullopt_t, const optional<T, UseInlineStorage>& rhs) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator==(nullopt_t, const optional<T, UseInlineStorage, Storage>& rhs) noexcept
 {
 	return !rhs;
 }
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator!=(const optional<T, UseInlineStorage>& lhs, nullopt_t) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator!=(const optional<T, UseInlineStorage, Storage>& lhs, nullopt_t) noexcept
 {
 	return static_cast<bool>(lhs);
 }
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator!=(nullopt_t, const optional<T, UseInlineStorage>& rhs) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator!=(nullopt_t, const optional<T, UseInlineStorage, Storage>& rhs) noexcept
 {
 	return static_cast<bool>(rhs);
 }
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator<(const optional<T, UseInlineStorage>&, nullopt_t) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator<(const optional<T, UseInlineStorage, Storage>&, nullopt_t) noexcept
 {
 	return false;
 }
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator<(nullopt_t, const optional<T, UseInlineStorage>& rhs) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator<(nullopt_t, const optional<T, UseInlineStorage, Storage>& rhs) noexcept
 {
 	return static_cast<bool>(rhs);
 }
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator<=(const optional<T, UseInlineStorage>& lhs, nullopt_t) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator<=(const optional<T, UseInlineStorage, Storage>& lhs, nullopt_t) noexcept
 {
 	return !lhs;
 }
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator<=(nullopt_t, const optional<T, UseInlineStorage>&) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator<=(nullopt_t, const optional<T, UseInlineStorage, Storage>&) noexcept
 {
 	return true;
 }
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator>(const optional<T, UseInlineStorage>& lhs, nullopt_t) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator>(const optional<T, UseInlineStorage, Storage>& lhs, nullopt_t) noexcept
 {
 	return static_cast<bool>(lhs);
 }
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator>(nullopt_t, const optional<T, UseInlineStorage>&) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator>(nullopt_t, const optional<T, UseInlineStorage, Storage>&) noexcept
 {
 	return false;
 }
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator>=(const optional<T, UseInlineStorage>&, nullopt_t) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator>=(const optional<T, UseInlineStorage, Storage>&, nullopt_t) noexcept
 {
 	return true;
 }
 
-template<typename T, bool UseInlineStorage>
-COW_NODISCARD constexpr bool operator>=(nullopt_t, const optional<T, UseInlineStorage>& rhs) noexcept
+template<typename T, bool UseInlineStorage, typename Storage>
+COW_NODISCARD constexpr bool operator>=(nullopt_t, const optional<T, UseInlineStorage, Storage>& rhs) noexcept
 {
 	return !rhs;
 }
 
 // ### comparison with T
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator==(const optional<T, UseInlineStorage>& lhs, const U& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator==(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs)
 {
 	return static_cast<bool>(lhs) ? *lhs == rhs : false;
 }
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator==(const U& lhs, const optional<T, UseInlineStorage>& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator==(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs)
 {
 	return static_cast<bool>(rhs) ? lhs == *rhs : false;
 }
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator!=(const optional<T, UseInlineStorage>& lhs, const U& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator!=(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs)
 {
 	return static_cast<bool>(lhs) ? *lhs != rhs : true;
 }
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator!=(const U& lhs, const optional<T, UseInlineStorage>& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator!=(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs)
 {
 	return static_cast<bool>(rhs) ? lhs != *rhs : true;
 }
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator<(const optional<T, UseInlineStorage>& lhs, const U& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator<(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs)
 {
 	return static_cast<bool>(lhs) ? *lhs < rhs : true;
 }
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator<(const U& lhs, const optional<T, UseInlineStorage>& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator<(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs)
 {
 	return static_cast<bool>(rhs) ? lhs < *rhs : false;
 }
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator<=(const optional<T, UseInlineStorage>& lhs, const U& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator<=(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs)
 {
 	return static_cast<bool>(lhs) ? *lhs <= rhs : true;
 }
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator<=(const U& lhs, const optional<T, UseInlineStorage>& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator<=(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs)
 {
 	return static_cast<bool>(rhs) ? lhs <= *rhs : false;
 }
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator>(const optional<T, UseInlineStorage>& lhs, const U& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator>(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs)
 {
 	return static_cast<bool>(lhs) ? *lhs > rhs : false;
 }
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator>(const U& lhs, const optional<T, UseInlineStorage>& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator>(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs)
 {
 	return static_cast<bool>(rhs) ? lhs > *rhs : true;
 }
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator>=(const optional<T, UseInlineStorage>& lhs, const U& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator>=(const optional<T, UseInlineStorage, Storage>& lhs, const U& rhs)
 {
 	return static_cast<bool>(lhs) ? *lhs >= rhs : false;
 }
 
-template<typename T, bool UseInlineStorage, typename U>
-COW_NODISCARD constexpr bool operator>=(const U& lhs, const optional<T, UseInlineStorage>& rhs)
+template<typename T, bool UseInlineStorage, typename Storage, typename U>
+COW_NODISCARD constexpr bool operator>=(const U& lhs, const optional<T, UseInlineStorage, Storage>& rhs)
 {
 	return static_cast<bool>(rhs) ? lhs >= *rhs : true;
 }
 
 // ## specialized algorithms
 
-template<typename T, bool UseInlineStorage = use_inline_storage_v<T>>
-COW_NODISCARD constexpr optional<std::decay_t<T>, UseInlineStorage> make_optional(T&& v)
+template<
+	typename T,
+	bool UseInlineStorage = use_inline_storage_v<std::decay_t<T>>,
+	typename Storage = optional_detail::default_shared_storage_t<std::decay_t<T>>>
+COW_NODISCARD constexpr optional<std::decay_t<T>, UseInlineStorage, Storage> make_optional(T&& v)
 {
-	return optional<std::decay_t<T>, UseInlineStorage>(std::forward<T>(v));
+	return optional<std::decay_t<T>, UseInlineStorage, Storage>(std::forward<T>(v));
 }
 
-template<typename T, bool UseInlineStorage = use_inline_storage_v<T>, typename...Args>
-COW_NODISCARD constexpr optional<T, UseInlineStorage> make_optional(Args&&... args)
+template<
+	typename T,
+	bool UseInlineStorage = use_inline_storage_v<T>,
+	typename Storage = optional_detail::default_shared_storage_t<T>,
+	typename... Args>
+COW_NODISCARD constexpr optional<T, UseInlineStorage, Storage> make_optional(Args&&... args)
 {
-	return optional<T, UseInlineStorage>(in_place, std::forward<Args>(args)...);
+	return optional<T, UseInlineStorage, Storage>(in_place, std::forward<Args>(args)...);
 }
 
-template<typename T, bool UseInlineStorage = use_inline_storage_v<T>, typename U, typename... Args>
-COW_NODISCARD constexpr optional<T, UseInlineStorage> make_optional(
+template<
+	typename T,
+	bool UseInlineStorage = use_inline_storage_v<T>,
+	typename Storage = optional_detail::default_shared_storage_t<T>,
+	typename U,
+	typename... Args>
+COW_NODISCARD constexpr optional<T, UseInlineStorage, Storage> make_optional(
 	std::initializer_list<U> ilist, Args&&... args)
 {
-	return optional<T, UseInlineStorage>(in_place, ilist, std::forward<Args>(args)...);
+	return optional<T, UseInlineStorage, Storage>(in_place, ilist, std::forward<Args>(args)...);
 }
 
+#ifdef COW_CPP_LIB_MEMORY_RESOURCE
+namespace pmr {
+
+template<typename T>
+using optional = cow::optional<T, false, intrusive_storage>;
+
+} // namespace pmr
+#endif
+
 } // namespace cow
 
 namespace std {
 
-template<typename T, bool UseInlineStorage>
-struct hash<cow::optional<T, UseInlineStorage>> {
+template<typename T, bool UseInlineStorage, typename Storage>
+struct hash<cow::optional<T, UseInlineStorage, Storage>> {
 	static_assert(
 		std::is_default_constructible<std::hash<std::remove_const_t<T>>>::value, "For T must be declared hash");
 
-	COW_NODISCARD std::size_t operator()(const cow::optional<T, UseInlineStorage>& co) const noexcept
+	COW_NODISCARD std::size_t operator()(const cow::optional<T, UseInlineStorage, Storage>& co) const noexcept
 	{
-		return co ? hash<std::remove_const_t<T>>()(*co) : 0;
+		return co ? cow::optional_detail::hash_access::hash(co) : 0;
 	}
 };
 
@@ -0,0 +1,437 @@
+#pragma once
+#include "detail/btree.h"
+#include "detail/compatibility/compile_features.h"
+#include "optional.h"
+#include "storage.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/*
+synopsis
+
+namespace cow {
+
+/// Associative container which keeps the entries ordered by the keys in a wide B+ tree. The leaves keep up to
+/// `NodeSize` entries in one allocation, so the range scans read the entries sequentially, and the inner nodes keep up
+/// to `NodeSize` children. The copy of the map shares the tree, it costs one increment of the reference counter like
+/// the copy of `optional<T, false>`. The modifications copy only the shared nodes on the path to the changed entry and
+/// the siblings which are merged with them or give them entries, the nodes which are owned only by this map are
+/// changed in place. The lookups, the iteration and the range scans do not copy nodes. The nodes are kept by the
+/// storage policy `Storage`. The references to the entries and the iterators are invalidated by any modification.
+template<
+	typename Key,
+	typename T,
+	typename Compare = std::less<Key>,
+	std::size_t NodeSize = detail::default_node_size<std::pair<Key, T>>::value,
+	typename Storage = intrusive_storage>
+class ordered_map {
+public:
+	using key_type = Key;
+	using mapped_type = T;
+	using value_type = std::pair<Key, T>;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using key_compare = Compare;
+	using reference = const value_type&;
+	using const_reference = const value_type&;
+	class const_iterator; // bidirectional iterator
+	using iterator = const_iterator;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using reverse_iterator = const_reverse_iterator;
+
+	// constructors
+
+	ordered_map();
+	template<typename InputIt>
+	ordered_map(InputIt first, InputIt last);
+	ordered_map(std::initializer_list<value_type> ilist);
+
+	ordered_map(const ordered_map& other);
+	ordered_map(ordered_map&& other);
+
+	ordered_map& operator=(const ordered_map& other);
+	ordered_map& operator=(ordered_map&& other);
+
+	~ordered_map();
+
+	// lookup
+
+	/// \return The pointer to the value of the key or `nullptr` if the map does not contain the key.
+	const T* find(const Key& key) const;
+	const T& at(const Key& key) const;
+	size_type count(const Key& key) const;
+	bool contains(const Key& key) const;
+	const_iterator lower_bound(const Key& key) const;
+	const_iterator upper_bound(const Key& key) const;
+	std::pair<const_iterator, const_iterator> equal_range(const Key& key) const;
+
+	// iterators
+
+	const_iterator begin() const noexcept;
+	const_iterator cbegin() const noexcept;
+	const_iterator end() const noexcept;
+	const_iterator cend() const noexcept;
+	const_reverse_iterator rbegin() const noexcept;
+	const_reverse_iterator crbegin() const noexcept;
+	const_reverse_iterator rend() const noexcept;
+	const_reverse_iterator crend() const noexcept;
+
+	// capacity
+
+	bool empty() const noexcept;
+	size_type size() const noexcept;
+
+	// modifiers
+	// The shared nodes are not copied if the modification does not change the map.
+
+	/// Inserts the entry if the map does not contain its key.
+	/// \return true if the entry is inserted.
+	bool insert(const value_type& value);
+	bool insert(value_type&& value);
+	/// Inserts the entry or assigns the value to the existing entry.
+	/// \return true if the entry is inserted.
+	template<typename K, typename V>
+	bool set(K&& key, V&& value);
+
+	// `key` must be in the map, otherwise `std::out_of_range` is thrown.
+
+	/// Gives mutable access to the value of `key`. The map must not be copied while the session is used.
+	write_session<T> write(const Key& key);
+	template<typename F>
+	decltype(auto) modify(const Key& key, F&& f);
+
+	/// \return The number of the removed entries (0 or 1).
+	size_type erase(const Key& key);
+
+	void clear() noexcept;
+	void swap(ordered_map& other) noexcept;
+
+	// observers
+
+	key_compare key_comp() const;
+	/// \return true if the maps share the tree, so they are equal.
+	bool shares_storage_with(const ordered_map& other) const noexcept;
+};
+
+// relational operations
+// The maps which share the tree are equal without comparison of entries.
+
+template<typename Key, typename T, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator==(
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& lhs,
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& rhs);
+template<typename Key, typename T, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator!=(
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& lhs,
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& rhs);
+template<typename Key, typename T, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator<(
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& lhs,
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& rhs);
+template<typename Key, typename T, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator>(
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& lhs,
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& rhs);
+template<typename Key, typename T, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator<=(
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& lhs,
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& rhs);
+template<typename Key, typename T, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator>=(
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& lhs,
+	const ordered_map<Key, T, Compare, NodeSize, Storage>& rhs);
+
+// specialized algorithms
+
+template<typename Key, typename T, typename Compare, std::size_t NodeSize, typename Storage>
+void swap(
+	ordered_map<Key, T, Compare, NodeSize, Storage>& lhs,
+	ordered_map<Key, T, Compare, NodeSize, Storage>& rhs) noexcept;
+
+} // namespace cow
+*/
+
+namespace cow {
+
+template<
+	typename Key,
+	typename T,
+	typename Compare = std::less<Key>,
+	std::size_t NodeSize = detail::default_node_size<std::pair<Key, T>>::value,
+	typename Storage = intrusive_storage>
+class ordered_map {
+	static_assert(
+		!std::is_reference<Key>::value && !std::is_reference<T>::value,
+		"Instantiation of ordered_map with a reference type is ill-formed");
+	static_assert(
+		std::is_destructible<Key>::value && std::is_destructible<T>::value,
+		"Instantiation of ordered_map with a non-destructible type is ill-formed");
+
+	struct key_of_value {
+		const Key& operator()(const std::pair<Key, T>& value) const noexcept
+		{
+			return value.first;
+		}
+	};
+
+	using tree_type = detail::btree<Key, std::pair<Key, T>, key_of_value, Compare, NodeSize, Storage>;
+
+public:
+	using key_type = Key;
+	using mapped_type = T;
+	using value_type = std::pair<Key, T>;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using key_compare = Compare;
+	using reference = const value_type&;
+	using const_reference = const value_type&;
+	using const_iterator = typename tree_type::const_iterator;
+	using iterator = const_iterator;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using reverse_iterator = const_reverse_iterator;
+
+	// constructors
+
+	ordered_map() = default;
+
+	template<
+		typename InputIt,
+		typename = std::enable_if_t<std::is_convertible<
+			typename std::iterator_traits<InputIt>::iterator_category, std::input_iterator_tag>::value>>
+	ordered_map(InputIt first, const InputIt last)
+	{
+		for (; first != last; ++first)
+			insert(*first);
+	}
+
+	ordered_map(const std::initializer_list<value_type> ilist)
+		: ordered_map(ilist.begin(), ilist.end())
+	{}
+
+	ordered_map(const ordered_map&) = default;
+	ordered_map(ordered_map&&) noexcept = default;
+
+	ordered_map& operator=(const ordered_map&) = default;
+	ordered_map& operator=(ordered_map&&) noexcept = default;
+
+	~ordered_map() = default;
+
+	// lookup
+
+	COW_NODISCARD const T* find(const Key& key) const
+	{
+		const value_type* const entry = tree_.find(key);
+		return entry != nullptr ? &entry->second : nullptr;
+	}
+
+	COW_NODISCARD const T& at(const Key& key) const
+	{
+		const T* const value = find(key);
+		if (value == nullptr)
+			throw std::out_of_range{"cow::ordered_map::at"};
+
+		return *value;
+	}
+
+	COW_NODISCARD size_type count(const Key& key) const
+	{
+		return tree_.find(key) != nullptr ? 1 : 0;
+	}
+
+	COW_NODISCARD bool contains(const Key& key) const
+	{
+		return tree_.find(key) != nullptr;
+	}
+
+	COW_NODISCARD const_iterator lower_bound(const Key& key) const
+	{
+		return tree_.lower_bound(key);
+	}
+
+	COW_NODISCARD const_iterator upper_bound(const Key& key) const
+	{
+		return tree_.upper_bound(key);
+	}
+
+	COW_NODISCARD std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+	{
+		return {lower_bound(key), upper_bound(key)};
+	}
+
+	// iterators
+
+	COW_NODISCARD const_iterator begin() const noexcept
+	{
+		return tree_.begin();
+	}
+
+	COW_NODISCARD const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+
+	COW_NODISCARD const_iterator end() const noexcept
+	{
+		return tree_.end();
+	}
+
+	COW_NODISCARD const_iterator cend() const noexcept
+	{
+		return end();
+	}
+
+	COW_NODISCARD const_reverse_iterator rbegin() const noexcept
+	{
+		return const_reverse_iterator{end()};
+	}
+
+	COW_NODISCARD const_reverse_iterator crbegin() const noexcept
+	{
+		return rbegin();
+	}
+
+	COW_NODISCARD const_reverse_iterator rend() const noexcept
+	{
+		return const_reverse_iterator{begin()};
+	}
+
+	COW_NODISCARD const_reverse_iterator crend() const noexcept
+	{
+		return rend();
+	}
+
+	// capacity
+
+	COW_NODISCARD bool empty() const noexcept
+	{
+		return tree_.size() == 0;
+	}
+
+	COW_NODISCARD size_type size() const noexcept
+	{
+		return tree_.size();
+	}
+
+	// modifiers
+
+	bool insert(const value_type& value)
+	{
+		if (contains(value.first))
+			return false;
+
+		tree_.insert_missing(value_type{value});
+		return true;
+	}
+
+	bool insert(value_type&& value)
+	{
+		return tree_.insert(std::move(value), false);
+	}
+
+	template<typename K, typename V>
+	bool set(K&& key, V&& value)
+	{
+		return tree_.insert(value_type{std::forward<K>(key), std::forward<V>(value)}, true);
+	}
+
+	COW_NODISCARD write_session<T> write(const Key& key)
+	{
+		if (!contains(key))
+			throw std::out_of_range{"cow::ordered_map::write"};
+
+		return detail::write_session_access::make(tree_.mutable_value(key).second);
+	}
+
+	template<typename F>
+	decltype(auto) modify(const Key& key, F&& f)
+	{
+		return std::forward<F>(f)(*write(key));
+	}
+
+	size_type erase(const Key& key)
+	{
+		return tree_.erase(key) ? 1 : 0;
+	}
+
+	void clear() noexcept
+	{
+		tree_.clear();
+	}
+
+	void swap(ordered_map& other) noexcept
+	{
+		tree_.swap(other.tree_);
+	}
+
+	// observers
+
+	COW_NODISCARD key_compare key_comp() const
+	{
+		return tree_.compare();
+	}
+
+	COW_NODISCARD bool shares_storage_with(const ordered_map& other) const noexcept
+	{
+		return tree_.shares_storage_with(other.tree_);
+	}
+
+	// relational operations
+
+	COW_NODISCARD friend bool operator==(const ordered_map& lhs, const ordered_map& rhs)
+	{
+		if (lhs.size() != rhs.size())
+			return false;
+		if (lhs.shares_storage_with(rhs))
+			return true;
+
+		return std::equal(lhs.begin(), lhs.end(), rhs.begin());
+	}
+
+	COW_NODISCARD friend bool operator!=(const ordered_map& lhs, const ordered_map& rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+	COW_NODISCARD friend bool operator<(const ordered_map& lhs, const ordered_map& rhs)
+	{
+		if (lhs.shares_storage_with(rhs))
+			return false;
+
+		return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	}
+
+	COW_NODISCARD friend bool operator>(const ordered_map& lhs, const ordered_map& rhs)
+	{
+		return rhs < lhs;
+	}
+
+	COW_NODISCARD friend bool operator<=(const ordered_map& lhs, const ordered_map& rhs)
+	{
+		return !(rhs < lhs);
+	}
+
+	COW_NODISCARD friend bool operator>=(const ordered_map& lhs, const ordered_map& rhs)
+	{
+		return !(lhs < rhs);
+	}
+
+private:
+	tree_type tree_;
+};
+
+// specialized algorithms
+
+template<typename Key, typename T, typename Compare, std::size_t NodeSize, typename Storage>
+void swap(
+	ordered_map<Key, T, Compare, NodeSize, Storage>& lhs, ordered_map<Key, T, Compare, NodeSize, Storage>& rhs) noexcept
+{
+	lhs.swap(rhs);
+}
+
+} // namespace cow
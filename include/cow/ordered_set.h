@@ -0,0 +1,374 @@
+#pragma once
+#include "detail/btree.h"
+#include "detail/compatibility/compile_features.h"
+#include "storage.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+/*
+synopsis
+
+namespace cow {
+
+/// Set of the keys ordered in a wide B+ tree, it shares the nodes between the copies like `ordered_map`. The copy of
+/// the set is O(1), the modifications copy only the shared nodes on the path to the changed key and the siblings which
+/// are merged with them or give them keys. The lookups, the iteration and the range scans do not copy nodes. The
+/// references to the keys and the iterators are invalidated by any modification.
+template<
+	typename Key,
+	typename Compare = std::less<Key>,
+	std::size_t NodeSize = detail::default_node_size<Key>::value,
+	typename Storage = intrusive_storage>
+class ordered_set {
+public:
+	using key_type = Key;
+	using value_type = Key;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using key_compare = Compare;
+	using value_compare = Compare;
+	using reference = const Key&;
+	using const_reference = const Key&;
+	class const_iterator; // bidirectional iterator
+	using iterator = const_iterator;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using reverse_iterator = const_reverse_iterator;
+
+	// constructors
+
+	ordered_set();
+	template<typename InputIt>
+	ordered_set(InputIt first, InputIt last);
+	ordered_set(std::initializer_list<Key> ilist);
+
+	ordered_set(const ordered_set& other);
+	ordered_set(ordered_set&& other);
+
+	ordered_set& operator=(const ordered_set& other);
+	ordered_set& operator=(ordered_set&& other);
+
+	~ordered_set();
+
+	// lookup
+
+	size_type count(const Key& key) const;
+	bool contains(const Key& key) const;
+	const_iterator lower_bound(const Key& key) const;
+	const_iterator upper_bound(const Key& key) const;
+	std::pair<const_iterator, const_iterator> equal_range(const Key& key) const;
+
+	// iterators
+
+	const_iterator begin() const noexcept;
+	const_iterator cbegin() const noexcept;
+	const_iterator end() const noexcept;
+	const_iterator cend() const noexcept;
+	const_reverse_iterator rbegin() const noexcept;
+	const_reverse_iterator crbegin() const noexcept;
+	const_reverse_iterator rend() const noexcept;
+	const_reverse_iterator crend() const noexcept;
+
+	// capacity
+
+	bool empty() const noexcept;
+	size_type size() const noexcept;
+
+	// modifiers
+	// The shared nodes are not copied if the modification does not change the set.
+
+	/// \return true if the key is inserted.
+	bool insert(const Key& key);
+	bool insert(Key&& key);
+	/// \return The number of the removed keys (0 or 1).
+	size_type erase(const Key& key);
+
+	void clear() noexcept;
+	void swap(ordered_set& other) noexcept;
+
+	// observers
+
+	key_compare key_comp() const;
+	value_compare value_comp() const;
+	/// \return true if the sets share the tree, so they are equal.
+	bool shares_storage_with(const ordered_set& other) const noexcept;
+};
+
+// relational operations
+// The sets which share the tree are equal without comparison of keys.
+
+template<typename Key, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator==(
+	const ordered_set<Key, Compare, NodeSize, Storage>& lhs, const ordered_set<Key, Compare, NodeSize, Storage>& rhs);
+template<typename Key, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator!=(
+	const ordered_set<Key, Compare, NodeSize, Storage>& lhs, const ordered_set<Key, Compare, NodeSize, Storage>& rhs);
+template<typename Key, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator<(
+	const ordered_set<Key, Compare, NodeSize, Storage>& lhs, const ordered_set<Key, Compare, NodeSize, Storage>& rhs);
+template<typename Key, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator>(
+	const ordered_set<Key, Compare, NodeSize, Storage>& lhs, const ordered_set<Key, Compare, NodeSize, Storage>& rhs);
+template<typename Key, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator<=(
+	const ordered_set<Key, Compare, NodeSize, Storage>& lhs, const ordered_set<Key, Compare, NodeSize, Storage>& rhs);
+template<typename Key, typename Compare, std::size_t NodeSize, typename Storage>
+bool operator>=(
+	const ordered_set<Key, Compare, NodeSize, Storage>& lhs, const ordered_set<Key, Compare, NodeSize, Storage>& rhs);
+
+// specialized algorithms
+
+template<typename Key, typename Compare, std::size_t NodeSize, typename Storage>
+void swap(
+	ordered_set<Key, Compare, NodeSize, Storage>& lhs, ordered_set<Key, Compare, NodeSize, Storage>& rhs) noexcept;
+
+} // namespace cow
+*/
+
+namespace cow {
+
+template<
+	typename Key,
+	typename Compare = std::less<Key>,
+	std::size_t NodeSize = detail::default_node_size<Key>::value,
+	typename Storage = intrusive_storage>
+class ordered_set {
+	static_assert(!std::is_reference<Key>::value, "Instantiation of ordered_set with a reference type is ill-formed");
+	static_assert(
+		std::is_destructible<Key>::value, "Instantiation of ordered_set with a non-destructible type is ill-formed");
+
+	struct key_of_value {
+		const Key& operator()(const Key& value) const noexcept
+		{
+			return value;
+		}
+	};
+
+	using tree_type = detail::btree<Key, Key, key_of_value, Compare, NodeSize, Storage>;
+
+public:
+	using key_type = Key;
+	using value_type = Key;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using key_compare = Compare;
+	using value_compare = Compare;
+	using reference = const Key&;
+	using const_reference = const Key&;
+	using const_iterator = typename tree_type::const_iterator;
+	using iterator = const_iterator;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using reverse_iterator = const_reverse_iterator;
+
+	// constructors
+
+	ordered_set() = default;
+
+	template<
+		typename InputIt,
+		typename = std::enable_if_t<std::is_convertible<
+			typename std::iterator_traits<InputIt>::iterator_category, std::input_iterator_tag>::value>>
+	ordered_set(InputIt first, const InputIt last)
+	{
+		for (; first != last; ++first)
+			insert(*first);
+	}
+
+	ordered_set(const std::initializer_list<Key> ilist)
+		: ordered_set(ilist.begin(), ilist.end())
+	{}
+
+	ordered_set(const ordered_set&) = default;
+	ordered_set(ordered_set&&) noexcept = default;
+
+	ordered_set& operator=(const ordered_set&) = default;
+	ordered_set& operator=(ordered_set&&) noexcept = default;
+
+	~ordered_set() = default;
+
+	// lookup
+
+	COW_NODISCARD size_type count(const Key& key) const
+	{
+		return tree_.find(key) != nullptr ? 1 : 0;
+	}
+
+	COW_NODISCARD bool contains(const Key& key) const
+	{
+		return tree_.find(key) != nullptr;
+	}
+
+	COW_NODISCARD const_iterator lower_bound(const Key& key) const
+	{
+		return tree_.lower_bound(key);
+	}
+
+	COW_NODISCARD const_iterator upper_bound(const Key& key) const
+	{
+		return tree_.upper_bound(key);
+	}
+
+	COW_NODISCARD std::pair<const_iterator, const_iterator> equal_range(const Key& key) const
+	{
+		return {lower_bound(key), upper_bound(key)};
+	}
+
+	// iterators
+
+	COW_NODISCARD const_iterator begin() const noexcept
+	{
+		return tree_.begin();
+	}
+
+	COW_NODISCARD const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+
+	COW_NODISCARD const_iterator end() const noexcept
+	{
+		return tree_.end();
+	}
+
+	COW_NODISCARD const_iterator cend() const noexcept
+	{
+		return end();
+	}
+
+	COW_NODISCARD const_reverse_iterator rbegin() const noexcept
+	{
+		return const_reverse_iterator{end()};
+	}
+
+	COW_NODISCARD const_reverse_iterator crbegin() const noexcept
+	{
+		return rbegin();
+	}
+
+	COW_NODISCARD const_reverse_iterator rend() const noexcept
+	{
+		return const_reverse_iterator{begin()};
+	}
+
+	COW_NODISCARD const_reverse_iterator crend() const noexcept
+	{
+		return rend();
+	}
+
+	// capacity
+
+	COW_NODISCARD bool empty() const noexcept
+	{
+		return tree_.size() == 0;
+	}
+
+	COW_NODISCARD size_type size() const noexcept
+	{
+		return tree_.size();
+	}
+
+	// modifiers
+
+	bool insert(const Key& key)
+	{
+		if (contains(key))
+			return false;
+
+		tree_.insert_missing(Key{key});
+		return true;
+	}
+
+	bool insert(Key&& key)
+	{
+		return tree_.insert(std::move(key), false);
+	}
+
+	size_type erase(const Key& key)
+	{
+		return tree_.erase(key) ? 1 : 0;
+	}
+
+	void clear() noexcept
+	{
+		tree_.clear();
+	}
+
+	void swap(ordered_set& other) noexcept
+	{
+		tree_.swap(other.tree_);
+	}
+
+	// observers
+
+	COW_NODISCARD key_compare key_comp() const
+	{
+		return tree_.compare();
+	}
+
+	COW_NODISCARD value_compare value_comp() const
+	{
+		return tree_.compare();
+	}
+
+	COW_NODISCARD bool shares_storage_with(const ordered_set& other) const noexcept
+	{
+		return tree_.shares_storage_with(other.tree_);
+	}
+
+	// relational operations
+
+	COW_NODISCARD friend bool operator==(const ordered_set& lhs, const ordered_set& rhs)
+	{
+		if (lhs.size() != rhs.size())
+			return false;
+		if (lhs.shares_storage_with(rhs))
+			return true;
+
+		return std::equal(lhs.begin(), lhs.end(), rhs.begin());
+	}
+
+	COW_NODISCARD friend bool operator!=(const ordered_set& lhs, const ordered_set& rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+	COW_NODISCARD friend bool operator<(const ordered_set& lhs, const ordered_set& rhs)
+	{
+		if (lhs.shares_storage_with(rhs))
+			return false;
+
+		return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	}
+
+	COW_NODISCARD friend bool operator>(const ordered_set& lhs, const ordered_set& rhs)
+	{
+		return rhs < lhs;
+	}
+
+	COW_NODISCARD friend bool operator<=(const ordered_set& lhs, const ordered_set& rhs)
+	{
+		return !(rhs < lhs);
+	}
+
+	COW_NODISCARD friend bool operator>=(const ordered_set& lhs, const ordered_set& rhs)
+	{
+		return !(lhs < rhs);
+	}
+
+private:
+	tree_type tree_;
+};
+
+// specialized algorithms
+
+template<typename Key, typename Compare, std::size_t NodeSize, typename Storage>
+void swap(ordered_set<Key, Compare, NodeSize, Storage>& lhs, ordered_set<Key, Compare, NodeSize, Storage>& rhs) noexcept
+{
+	lhs.swap(rhs);
+}
+
+} // namespace cow
@@ -0,0 +1,70 @@
+#pragma once
+#include "detail/compatibility/compile_features.h"
+#include "storage.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/*
+synopsis
+
+namespace cow {
+
+/// The object runs the thread which periodically destroys the values retired to `reclamation_domain::global()`.
+class background_reclaimer {
+public:
+	/// Starts the thread.
+	/// \param interval Pause between the collections of retired values.
+	explicit background_reclaimer(std::chrono::milliseconds interval = std::chrono::milliseconds{10});
+	background_reclaimer(const background_reclaimer&) = delete;
+	background_reclaimer& operator=(const background_reclaimer&) = delete;
+
+	/// Stops the thread and destroys the values which are retired at the moment.
+	~background_reclaimer();
+};
+
+} // namespace cow
+*/
+
+namespace cow {
+
+class background_reclaimer {
+public:
+	explicit background_reclaimer(const std::chrono::milliseconds interval = std::chrono::milliseconds{10})
+		: thread_{&background_reclaimer::run, this, interval}
+	{}
+
+	background_reclaimer(const background_reclaimer&) = delete;
+	background_reclaimer& operator=(const background_reclaimer&) = delete;
+
+	~background_reclaimer()
+	{
+		{
+			const std::lock_guard<std::mutex> lock{mutex_};
+			stopped_ = true;
+		}
+		stop_.notify_one();
+		thread_.join();
+		reclamation_domain::global().collect();
+	}
+
+private:
+	void run(const std::chrono::milliseconds interval)
+	{
+		std::unique_lock<std::mutex> lock{mutex_};
+		while (!stop_.wait_for(lock, interval, [this]() { return stopped_; })) {
+			lock.unlock();
+			reclamation_domain::global().collect();
+			lock.lock();
+		}
+	}
+
+	std::mutex mutex_;
+	std::condition_variable stop_;
+	bool stopped_ = false;
+	// the thread is the last member, so it starts after the other members are initialized
+	std::thread thread_;
+};
+
+} // namespace cow
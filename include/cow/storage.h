@@ -0,0 +1,233 @@
+#pragma once
+#include "detail/biased_ref_count.h"
+#include "detail/block_pool.h"
+#include "detail/compatibility/compile_features.h"
+#include "detail/deferred_ref_count.h"
+#include "detail/hash_cache.h"
+#include "detail/hybrid_ptr.h"
+#include "detail/intrusive_ptr.h"
+#include "detail/ref_count.h"
+#include "detail/sharded_ptr.h"
+#include "detail/shared_ptr_adapter.h"
+#include "detail/snapshot_ref_count.h"
+#include <cstddef>
+#include <memory>
+
+#ifdef COW_CPP_LIB_MEMORY_RESOURCE
+#include <memory_resource>
+#endif
+
+/*
+synopsis
+
+namespace cow {
+
+/// Storage policy which keeps the shared value in `std::shared_ptr`.
+/// The value can be shared between `optional` objects for base and derived classes.
+struct shared_ptr_storage;
+
+/// If the value is true, the hash of the shared value of type T is computed once and kept in the storage (if
+/// the storage policy supports it) until the only owner of the value changes it. The template can be specialized.
+template<typename T>
+struct cache_hash : std::false_type {};
+
+/// Reference counter which can be used by several threads at once.
+class atomic_ref_count;
+
+/// Reference counter without synchronization. It is faster than `atomic_ref_count`, but all `optional` objects which
+/// share a value must be used by one thread.
+class plain_ref_count;
+
+/// Reference counter for values which are mostly copied by the thread which created them. The thread changes its own
+/// part of the counter without atomic operations, other threads change the shared part atomically.
+class biased_ref_count {
+public:
+	/// Merges the counters of the current thread which were released by other threads. It is done automatically when
+	/// the thread releases a reference or finishes, so it is needed only if the thread stops using the counters
+	/// for a long time.
+	static void merge_queued() noexcept;
+};
+
+/// The queue of shared values which are released by all their owners but are not destroyed yet.
+class reclamation_domain {
+public:
+	/// \return The domain of all `deferred_ref_count` counters.
+	static reclamation_domain& global() noexcept;
+
+	/// Destroys the retired values including the values retired by the destructors of the destroyed values.
+	/// It can be called by any thread, for example at a quiescent point or by `background_reclaimer`. The references
+	/// to the snapshots of `atomic_optional` released by the calling thread are subtracted before.
+	/// \return The number of destroyed values.
+	std::size_t collect() noexcept;
+
+	/// \return true if there are values waiting for destruction.
+	bool has_retired() const noexcept;
+};
+
+/// Thread-safe reference counter which retires the value to `reclamation_domain::global()` when the last reference is
+/// released, so the thread which releases it does not run the destructor of the value and does not free its memory.
+/// The thread which loads the value from `atomic_optional` keeps the references it releases to the value and reuses
+/// them for the next loads of the same value. They are subtracted when the thread loads another value, calls
+/// `reclamation_domain::collect()` or finishes.
+class deferred_ref_count;
+
+/// Thread-safe reference counter of the values loaded from `atomic_optional`. The thread which loads the value keeps
+/// the references it releases to the value and reuses them for the next loads of the same value, so the threads which
+/// repeatedly load and release the same value do not change the counter. The kept references are subtracted when
+/// the thread loads another value, calls `release_kept()` or finishes, so the value can outlive its last owner until
+/// then.
+class snapshot_ref_count {
+public:
+	/// Subtracts the references kept by the current thread.
+	static void release_kept() noexcept;
+};
+
+/// Reference counter `RefCount` followed by the padding of the cache line size. The shared value does not share the
+/// cache line with the counter, so the threads which read the value are not slowed down by the threads which copy it.
+template<typename RefCount>
+class cache_line_padded : public RefCount {};
+
+/// Storage policy which keeps the shared value and its reference counter in one allocation.
+/// `optional` objects with this policy have the size of a pointer.
+/// The allocator is kept in the allocation too and is used for the copies of the value made on write.
+/// \tparam RefCount Type of the reference counter.
+/// \tparam Allocator Allocator of the shared value. It is rebound to the type of the allocation. The default constructed
+///                   allocator is used for values which are not created with an allocator.
+template<typename RefCount, typename Allocator = std::allocator<char>>
+struct basic_intrusive_storage;
+
+/// Stateless allocator which keeps freed objects of type T in the cache of the thread which freed them and reuses
+/// them for the next allocations of this thread. The cache keeps up to `CacheSize` objects, the excess is moved to
+/// the depot shared by all threads where empty caches of other threads take the objects from. The cache of
+/// a finished thread is moved to the depot too. Arrays are allocated by `operator new`.
+template<typename T, std::size_t CacheSize = 64>
+class pool_allocator {
+public:
+	using value_type = T;
+
+	template<typename U>
+	struct rebind {
+		using other = pool_allocator<U, CacheSize>;
+	};
+
+	T* allocate(std::size_t n);
+	void deallocate(T* p, std::size_t n) noexcept;
+
+	/// Returns the memory of freed objects of all types cached by the current thread and by the depots to the system.
+	static void trim() noexcept;
+};
+
+/// Storage policy which can be used by several threads at once. It is used by default.
+using intrusive_storage = basic_intrusive_storage<atomic_ref_count>;
+
+/// Storage policy for values which are used by one thread only.
+using single_thread_storage = basic_intrusive_storage<plain_ref_count>;
+
+/// Storage policy for values which are mostly copied by the thread which created them.
+using biased_storage = basic_intrusive_storage<biased_ref_count>;
+
+/// Storage policy for short-lived values. The shared blocks are allocated by `pool_allocator`.
+using pooled_storage = basic_intrusive_storage<atomic_ref_count, pool_allocator<char>>;
+
+/// Storage policy for large values which must not be destroyed by the thread which releases them.
+using deferred_storage = basic_intrusive_storage<deferred_ref_count>;
+
+/// Storage policy for values which are published by `atomic_optional` and loaded by many threads. It is the default
+/// storage of `atomic_optional`.
+using snapshot_storage = basic_intrusive_storage<snapshot_ref_count>;
+
+/// Storage policy for values which are read by many threads while other threads copy them.
+/// It keeps additional 64 bytes per value.
+using padded_storage = basic_intrusive_storage<cache_line_padded<atomic_ref_count>>;
+
+/// Storage policy for values which are copied by many threads at once. The reference counter is split into
+/// `ShardCount` shards in separate cache lines and each thread changes the shard chosen by its number. The shared
+/// part of the counter is changed only when a shard becomes empty or stops being empty, so the threads do not
+/// contend if each of them keeps at least one copy of the value. The shards are read only to check if the value is
+/// unique. The value keeps about 64 bytes per shard and `optional` objects with this policy have the size of two
+/// pointers.
+template<std::size_t ShardCount = 64>
+struct basic_sharded_storage;
+
+using sharded_storage = basic_sharded_storage<>;
+
+/// Storage policy which keeps the value inside the `optional` object while the object is its only owner. The first
+/// copy puts a copy of the value to the block of `SharedStorage` and the next copies share this block, so the values
+/// which are never copied are not allocated. The copied object keeps its own value, so the references to it are valid
+/// until the object is changed, and the block is published atomically, so the object can be copied by several threads
+/// at once. The value type must be nothrow move constructible. `optional` objects with this policy have the size of
+/// the value and two pointers.
+template<typename SharedStorage = intrusive_storage>
+struct basic_hybrid_storage;
+
+using hybrid_storage = basic_hybrid_storage<>;
+
+#if __cpp_lib_memory_resource
+namespace pmr {
+
+/// Storage policy which allocates shared values from `std::pmr::memory_resource`.
+using intrusive_storage = basic_intrusive_storage<atomic_ref_count, std::pmr::polymorphic_allocator<std::byte>>;
+
+} // namespace pmr
+#endif
+
+} // namespace cow
+*/
+
+namespace cow {
+
+// A storage policy provides the alias template `pointer<T>` to the type which owns a shared value of type T.
+
+struct shared_ptr_storage {
+	template<typename T>
+	using pointer = detail::shared_ptr_adapter<T>;
+};
+
+using detail::atomic_ref_count;
+using detail::plain_ref_count;
+using detail::biased_ref_count;
+using detail::cache_line_padded;
+using detail::pool_allocator;
+using detail::deferred_ref_count;
+using detail::snapshot_ref_count;
+using detail::reclamation_domain;
+
+template<typename RefCount, typename Allocator = std::allocator<char>>
+struct basic_intrusive_storage {
+	template<typename T>
+	using pointer = detail::intrusive_ptr<T, RefCount, Allocator>;
+};
+
+using intrusive_storage = basic_intrusive_storage<atomic_ref_count>;
+using single_thread_storage = basic_intrusive_storage<plain_ref_count>;
+using biased_storage = basic_intrusive_storage<biased_ref_count>;
+using pooled_storage = basic_intrusive_storage<atomic_ref_count, pool_allocator<char>>;
+using deferred_storage = basic_intrusive_storage<deferred_ref_count>;
+using snapshot_storage = basic_intrusive_storage<snapshot_ref_count>;
+using padded_storage = basic_intrusive_storage<cache_line_padded<atomic_ref_count>>;
+
+template<std::size_t ShardCount = 64>
+struct basic_sharded_storage {
+	template<typename T>
+	using pointer = detail::sharded_ptr<T, ShardCount>;
+};
+
+using sharded_storage = basic_sharded_storage<>;
+
+template<typename SharedStorage = intrusive_storage>
+struct basic_hybrid_storage {
+	template<typename T>
+	using pointer = detail::hybrid_ptr<T, typename SharedStorage::template pointer<T>>;
+};
+
+using hybrid_storage = basic_hybrid_storage<>;
+
+#ifdef COW_CPP_LIB_MEMORY_RESOURCE
+namespace pmr {
+
+using intrusive_storage = basic_intrusive_storage<atomic_ref_count, std::pmr::polymorphic_allocator<std::byte>>;
+
+} // namespace pmr
+#endif
+
+} // namespace cow
@@ -0,0 +1,750 @@
+#pragma once
+#include "detail/compatibility/compile_features.h"
+#include "detail/string_buffer.h"
+#include "optional.h"
+#include "storage.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#ifdef COW_CPP_LIB_STRING_VIEW
+#include <string_view>
+#endif
+
+/*
+synopsis
+
+namespace cow {
+
+/// String which shares its characters between copies. Short strings (up to `inline_capacity` characters, 15 for
+/// `char`) are kept inside the object. Longer strings are kept in one allocation with the reference counter `RefCount`,
+/// the size and the capacity before the characters. The copy of a long string shares the allocation, the characters
+/// are copied when the string is changed while it is shared. The object has the size of `std::shared_ptr`, so
+/// `optional<basic_string>` keeps it inline.
+template<typename CharT, typename Traits = std::char_traits<CharT>, typename RefCount = atomic_ref_count>
+class basic_string {
+public:
+	using traits_type = Traits;
+	using value_type = CharT;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = const CharT&;
+	using const_reference = const CharT&;
+	using pointer = const CharT*;
+	using const_pointer = const CharT*;
+	using iterator = const CharT*;
+	using const_iterator = const CharT*;
+
+	static constexpr size_type inline_capacity = 2 * sizeof(void*) / sizeof(CharT) - 1;
+
+	// constructors
+
+	basic_string() noexcept;
+	basic_string(const CharT* s);
+	basic_string(const CharT* s, size_type count);
+	basic_string(size_type count, CharT ch);
+	basic_string(std::initializer_list<CharT> ilist);
+	template<typename Allocator>
+	basic_string(const std::basic_string<CharT, Traits, Allocator>& s);
+	explicit basic_string(std::basic_string_view<CharT, Traits> s); // since C++17
+
+	basic_string(const basic_string& other) noexcept;
+	basic_string(basic_string&& other) noexcept;
+
+	basic_string& operator=(const basic_string& other) noexcept;
+	basic_string& operator=(basic_string&& other) noexcept;
+	basic_string& operator=(const CharT* s);
+
+	~basic_string();
+
+	// element access
+
+	const CharT& operator[](size_type pos) const noexcept;
+	const CharT& at(size_type pos) const;
+	const CharT& front() const noexcept;
+	const CharT& back() const noexcept;
+	const CharT* data() const noexcept;
+	const CharT* c_str() const noexcept;
+
+	/// \return The characters which are not shared with other strings. The string must not be copied while
+	///         the pointer is used.
+	CharT* mutable_data();
+
+	operator std::basic_string_view<CharT, Traits>() const noexcept; // since C++17
+	std::basic_string<CharT, Traits> str() const;
+
+	// iterators
+
+	const_iterator begin() const noexcept;
+	const_iterator cbegin() const noexcept;
+	const_iterator end() const noexcept;
+	const_iterator cend() const noexcept;
+
+	// capacity
+
+	bool empty() const noexcept;
+	size_type size() const noexcept;
+	size_type length() const noexcept;
+	size_type max_size() const noexcept;
+	size_type capacity() const noexcept;
+	void reserve(size_type new_capacity);
+
+	// operations
+
+	void set(size_type pos, CharT ch);
+	void clear() noexcept;
+	void push_back(CharT ch);
+	void pop_back();
+	basic_string& append(const CharT* s, size_type count);
+	basic_string& append(const CharT* s);
+	basic_string& append(size_type count, CharT ch);
+	basic_string& append(const basic_string& s);
+	basic_string& operator+=(const basic_string& s);
+	basic_string& operator+=(const CharT* s);
+	basic_string& operator+=(CharT ch);
+	void resize(size_type count, CharT ch = CharT());
+	basic_string substr(size_type pos = 0, size_type count = size_type(-1)) const;
+	int compare(const basic_string& s) const noexcept;
+	int compare(const CharT* s) const;
+	void swap(basic_string& other) noexcept;
+
+	// observers
+
+	/// \return true if the strings share the allocation, so they are equal.
+	bool shares_storage_with(const basic_string& other) const noexcept;
+};
+
+using string = basic_string<char>;
+using wstring = basic_string<wchar_t>;
+using u16string = basic_string<char16_t>;
+using u32string = basic_string<char32_t>;
+
+/// The copy of `basic_string` is as cheap as the copy of `std::shared_ptr`.
+template<typename CharT, typename Traits, typename RefCount>
+struct allow_inplace_placement<basic_string<CharT, Traits, RefCount>> : std::true_type {};
+
+// relational operations
+// The strings which share the allocation are equal without comparison of characters.
+// The operators ==, !=, <, >, <=, >= compare `basic_string` with `basic_string` and with `const CharT*`.
+
+template<typename CharT, typename Traits, typename RefCount>
+basic_string<CharT, Traits, RefCount> operator+(
+	basic_string<CharT, Traits, RefCount> lhs, const basic_string<CharT, Traits, RefCount>& rhs);
+template<typename CharT, typename Traits, typename RefCount>
+basic_string<CharT, Traits, RefCount> operator+(basic_string<CharT, Traits, RefCount> lhs, const CharT* rhs);
+
+template<typename CharT, typename Traits, typename RefCount>
+std::basic_ostream<CharT, Traits>& operator<<(
+	std::basic_ostream<CharT, Traits>& os, const basic_string<CharT, Traits, RefCount>& s);
+
+template<typename CharT, typename Traits, typename RefCount>
+void swap(basic_string<CharT, Traits, RefCount>& lhs, basic_string<CharT, Traits, RefCount>& rhs) noexcept;
+
+} // namespace cow
+
+namespace std {
+
+template<typename CharT, typename Traits, typename RefCount>
+struct hash<cow::basic_string<CharT, Traits, RefCount>>;
+
+} // namespace std
+*/
+
+namespace cow {
+
+template<typename CharT, typename Traits = std::char_traits<CharT>, typename RefCount = atomic_ref_count>
+class basic_string {
+	using buffer_type = detail::string_buffer<CharT, RefCount>;
+
+	// The inline string is kept in `chars_`, the last character is the number of free characters, so it is also
+	// the terminating null character of the full string. The long string keeps the pointer to the buffer at
+	// the beginning of `chars_` and `heap_tag` in the last character.
+	static constexpr std::size_t inline_length = 2 * sizeof(void*) / sizeof(CharT);
+
+	static_assert(inline_length * sizeof(CharT) == 2 * sizeof(void*), "The size of CharT must divide the object size");
+
+public:
+	using traits_type = Traits;
+	using value_type = CharT;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = const CharT&;
+	using const_reference = const CharT&;
+	using pointer = const CharT*;
+	using const_pointer = const CharT*;
+	using iterator = const CharT*;
+	using const_iterator = const CharT*;
+
+	static constexpr size_type inline_capacity = inline_length - 1;
+
+	// constructors
+
+	basic_string() noexcept
+	{
+		set_inline_size(0);
+	}
+
+	basic_string(const CharT* const s) // NOLINT: Allow implicit conversion
+		: basic_string(s, Traits::length(s))
+	{}
+
+	basic_string(const CharT* const s, const size_type count)
+		: basic_string(uninitialized_t{}, count)
+	{
+		Traits::copy(raw_data(), s, count);
+	}
+
+	basic_string(const size_type count, const CharT ch)
+		: basic_string(uninitialized_t{}, count)
+	{
+		Traits::assign(raw_data(), count, ch);
+	}
+
+	basic_string(const std::initializer_list<CharT> ilist)
+		: basic_string(ilist.begin(), ilist.size())
+	{}
+
+	template<typename Allocator>
+	basic_string(const std::basic_string<CharT, Traits, Allocator>& s) // NOLINT: Allow implicit conversion
+		: basic_string(s.data(), s.size())
+	{}
+
+#ifdef COW_CPP_LIB_STRING_VIEW
+	explicit basic_string(const std::basic_string_view<CharT, Traits> s)
+		: basic_string(s.data(), s.size())
+	{}
+#endif
+
+	basic_string(const basic_string& other) noexcept
+	{
+		std::memcpy(chars_, other.chars_, sizeof(chars_));
+		if (!is_inline())
+			buffer()->add_ref();
+	}
+
+	basic_string(basic_string&& other) noexcept
+	{
+		std::memcpy(chars_, other.chars_, sizeof(chars_));
+		other.set_inline_size(0);
+	}
+
+	basic_string& operator=(const basic_string& other) noexcept
+	{
+		basic_string{other}.swap(*this);
+		return *this;
+	}
+
+	basic_string& operator=(basic_string&& other) noexcept
+	{
+		basic_string{std::move(other)}.swap(*this);
+		return *this;
+	}
+
+	basic_string& operator=(const CharT* const s)
+	{
+		basic_string{s}.swap(*this);
+		return *this;
+	}
+
+	~basic_string()
+	{
+		if (!is_inline())
+			buffer()->release();
+	}
+
+	// element access
+
+	COW_NODISCARD const CharT& operator[](const size_type pos) const noexcept
+	{
+		return data()[pos];
+	}
+
+	COW_NODISCARD const CharT& at(const size_type pos) const
+	{
+		if (pos >= size())
+			throw std::out_of_range{"cow::basic_string::at"};
+
+		return data()[pos];
+	}
+
+	COW_NODISCARD const CharT& front() const noexcept
+	{
+		return data()[0];
+	}
+
+	COW_NODISCARD const CharT& back() const noexcept
+	{
+		return data()[size() - 1];
+	}
+
+	COW_NODISCARD const CharT* data() const noexcept
+	{
+		return is_inline() ? chars_ : buffer()->data();
+	}
+
+	COW_NODISCARD const CharT* c_str() const noexcept
+	{
+		return data();
+	}
+
+	COW_NODISCARD CharT* mutable_data()
+	{
+		if (!is_inline() && !buffer()->unique())
+			basic_string{data(), size()}.swap(*this);
+
+		return raw_data();
+	}
+
+#ifdef COW_CPP_LIB_STRING_VIEW
+	operator std::basic_string_view<CharT, Traits>() const noexcept // NOLINT: Allow implicit conversion
+	{
+		return {data(), size()};
+	}
+#endif
+
+	COW_NODISCARD std::basic_string<CharT, Traits> str() const
+	{
+		return {data(), size()};
+	}
+
+	// iterators
+
+	COW_NODISCARD const_iterator begin() const noexcept
+	{
+		return data();
+	}
+
+	COW_NODISCARD const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+
+	COW_NODISCARD const_iterator end() const noexcept
+	{
+		return data() + size();
+	}
+
+	COW_NODISCARD const_iterator cend() const noexcept
+	{
+		return end();
+	}
+
+	// capacity
+
+	COW_NODISCARD bool empty() const noexcept
+	{
+		return size() == 0;
+	}
+
+	COW_NODISCARD size_type size() const noexcept
+	{
+		return is_inline() ? inline_capacity - static_cast<size_type>(chars_[inline_capacity]) : buffer()->size();
+	}
+
+	COW_NODISCARD size_type length() const noexcept
+	{
+		return size();
+	}
+
+	COW_NODISCARD size_type max_size() const noexcept
+	{
+		return buffer_type::max_capacity();
+	}
+
+	COW_NODISCARD size_type capacity() const noexcept
+	{
+		return is_inline() ? inline_capacity : buffer()->capacity();
+	}
+
+	void reserve(const size_type new_capacity)
+	{
+		if (new_capacity > capacity())
+			reallocate(new_capacity, 0, [](CharT*) {});
+	}
+
+	// operations
+
+	void set(const size_type pos, const CharT ch)
+	{
+		Traits::assign(mutable_data()[pos], ch);
+	}
+
+	// the unique buffer is kept for the next characters
+	void clear() noexcept
+	{
+		if (is_inline())
+			set_inline_size(0);
+		else if (buffer()->unique())
+			buffer()->set_size(0);
+		else
+			basic_string{}.swap(*this);
+	}
+
+	void push_back(const CharT ch)
+	{
+		append(1, ch);
+	}
+
+	void pop_back()
+	{
+		resize(size() - 1);
+	}
+
+	// `s` may point to the characters of this string
+	basic_string& append(const CharT* const s, const size_type count)
+	{
+		append_with(count, [s, count](CharT* const to) { Traits::move(to, s, count); });
+		return *this;
+	}
+
+	basic_string& append(const CharT* const s)
+	{
+		return append(s, Traits::length(s));
+	}
+
+	basic_string& append(const size_type count, const CharT ch)
+	{
+		append_with(count, [count, ch](CharT* const to) { Traits::assign(to, count, ch); });
+		return *this;
+	}
+
+	basic_string& append(const basic_string& s)
+	{
+		return append(s.data(), s.size());
+	}
+
+	basic_string& operator+=(const basic_string& s)
+	{
+		return append(s);
+	}
+
+	basic_string& operator+=(const CharT* const s)
+	{
+		return append(s);
+	}
+
+	basic_string& operator+=(const CharT ch)
+	{
+		return append(1, ch);
+	}
+
+	void resize(const size_type count, const CharT ch = CharT())
+	{
+		const size_type size = this->size();
+		if (count > size)
+			append(count - size, ch);
+		else if (is_inline() || buffer()->unique())
+			set_size(count);
+		else
+			basic_string{data(), count}.swap(*this);
+	}
+
+	COW_NODISCARD basic_string substr(const size_type pos = 0, const size_type count = static_cast<size_type>(-1)) const
+	{
+		const size_type size = this->size();
+		if (pos > size)
+			throw std::out_of_range{"cow::basic_string::substr"};
+
+		if (pos == 0 && count >= size)
+			return *this;
+
+		return {data() + pos, std::min(count, size - pos)};
+	}
+
+	COW_NODISCARD int compare(const basic_string& s) const noexcept
+	{
+		if (shares_storage_with(s))
+			return 0;
+
+		return compare(s.data(), s.size());
+	}
+
+	COW_NODISCARD int compare(const CharT* const s) const
+	{
+		return compare(s, Traits::length(s));
+	}
+
+	void swap(basic_string& other) noexcept
+	{
+		CharT chars[inline_length];
+		std::memcpy(chars, chars_, sizeof(chars_));
+		std::memcpy(chars_, other.chars_, sizeof(chars_));
+		std::memcpy(other.chars_, chars, sizeof(chars_));
+	}
+
+	// observers
+
+	COW_NODISCARD bool shares_storage_with(const basic_string& other) const noexcept
+	{
+		return !is_inline() && !other.is_inline() && buffer() == other.buffer();
+	}
+
+	// relational operations
+
+	COW_NODISCARD friend bool operator==(const basic_string& lhs, const basic_string& rhs) noexcept
+	{
+		return lhs.size() == rhs.size() && lhs.compare(rhs) == 0;
+	}
+
+	COW_NODISCARD friend bool operator!=(const basic_string& lhs, const basic_string& rhs) noexcept
+	{
+		return !(lhs == rhs);
+	}
+
+	COW_NODISCARD friend bool operator<(const basic_string& lhs, const basic_string& rhs) noexcept
+	{
+		return lhs.compare(rhs) < 0;
+	}
+
+	COW_NODISCARD friend bool operator>(const basic_string& lhs, const basic_string& rhs) noexcept
+	{
+		return lhs.compare(rhs) > 0;
+	}
+
+	COW_NODISCARD friend bool operator<=(const basic_string& lhs, const basic_string& rhs) noexcept
+	{
+		return lhs.compare(rhs) <= 0;
+	}
+
+	COW_NODISCARD friend bool operator>=(const basic_string& lhs, const basic_string& rhs) noexcept
+	{
+		return lhs.compare(rhs) >= 0;
+	}
+
+	COW_NODISCARD friend bool operator==(const basic_string& lhs, const CharT* const rhs)
+	{
+		return lhs.compare(rhs) == 0;
+	}
+
+	COW_NODISCARD friend bool operator==(const CharT* const lhs, const basic_string& rhs)
+	{
+		return rhs.compare(lhs) == 0;
+	}
+
+	COW_NODISCARD friend bool operator!=(const basic_string& lhs, const CharT* const rhs)
+	{
+		return lhs.compare(rhs) != 0;
+	}
+
+	COW_NODISCARD friend bool operator!=(const CharT* const lhs, const basic_string& rhs)
+	{
+		return rhs.compare(lhs) != 0;
+	}
+
+	COW_NODISCARD friend bool operator<(const basic_string& lhs, const CharT* const rhs)
+	{
+		return lhs.compare(rhs) < 0;
+	}
+
+	COW_NODISCARD friend bool operator<(const CharT* const lhs, const basic_string& rhs)
+	{
+		return rhs.compare(lhs) > 0;
+	}
+
+	COW_NODISCARD friend bool operator>(const basic_string& lhs, const CharT* const rhs)
+	{
+		return lhs.compare(rhs) > 0;
+	}
+
+	COW_NODISCARD friend bool operator>(const CharT* const lhs, const basic_string& rhs)
+	{
+		return rhs.compare(lhs) < 0;
+	}
+
+	COW_NODISCARD friend bool operator<=(const basic_string& lhs, const CharT* const rhs)
+	{
+		return lhs.compare(rhs) <= 0;
+	}
+
+	COW_NODISCARD friend bool operator<=(const CharT* const lhs, const basic_string& rhs)
+	{
+		return rhs.compare(lhs) >= 0;
+	}
+
+	COW_NODISCARD friend bool operator>=(const basic_string& lhs, const CharT* const rhs)
+	{
+		return lhs.compare(rhs) >= 0;
+	}
+
+	COW_NODISCARD friend bool operator>=(const CharT* const lhs, const basic_string& rhs)
+	{
+		return rhs.compare(lhs) <= 0;
+	}
+
+private:
+	struct uninitialized_t {};
+
+	static constexpr CharT heap_tag = static_cast<CharT>(inline_length);
+
+	// the string of `count` characters which must be written to `raw_data()`
+	basic_string(uninitialized_t, const size_type count)
+	{
+		if (count <= inline_capacity) {
+			set_inline_size(count);
+			return;
+		}
+
+		if (count > buffer_type::max_capacity())
+			throw std::length_error{"cow::basic_string"};
+
+		buffer_type* const buffer = buffer_type::allocate(count);
+		buffer->set_size(count);
+		set_buffer(buffer);
+	}
+
+	COW_NODISCARD bool is_inline() const noexcept
+	{
+		return chars_[inline_capacity] != heap_tag;
+	}
+
+	COW_NODISCARD buffer_type* buffer() const noexcept
+	{
+		buffer_type* buffer = nullptr;
+		std::memcpy(&buffer, chars_, sizeof(buffer));
+		return buffer;
+	}
+
+	void set_buffer(buffer_type* const buffer) noexcept
+	{
+		std::memcpy(chars_, &buffer, sizeof(buffer));
+		chars_[inline_capacity] = heap_tag;
+	}
+
+	void set_inline_size(const size_type size) noexcept
+	{
+		chars_[size] = CharT();
+		chars_[inline_capacity] = static_cast<CharT>(inline_capacity - size);
+	}
+
+	void set_size(const size_type size) noexcept
+	{
+		if (is_inline())
+			set_inline_size(size);
+		else
+			buffer()->set_size(size);
+	}
+
+	// the characters without the check of sharing
+	COW_NODISCARD CharT* raw_data() noexcept
+	{
+		return is_inline() ? chars_ : buffer()->data();
+	}
+
+	COW_NODISCARD int compare(const CharT* const s, const size_type count) const noexcept
+	{
+		const size_type size = this->size();
+		const int result = Traits::compare(data(), s, std::min(size, count));
+		if (result != 0)
+			return result;
+
+		return size < count ? -1 : size > count ? 1 : 0;
+	}
+
+	// Moves the characters to the new buffer of `new_capacity` characters and appends `count` characters written by
+	// `write`. The old characters are released after `write`, so it can read them.
+	template<typename Write>
+	void reallocate(const size_type new_capacity, const size_type count, Write write)
+	{
+		const size_type size = this->size();
+		basic_string result{uninitialized_t{}, new_capacity};
+		CharT* const to = result.raw_data();
+		Traits::copy(to, data(), size);
+		write(to + size);
+		result.set_size(size + count);
+		result.swap(*this);
+	}
+
+	template<typename Write>
+	void append_with(const size_type count, Write write)
+	{
+		const size_type size = this->size();
+		if (count > max_size() - size)
+			throw std::length_error{"cow::basic_string::append"};
+
+		const size_type new_size = size + count;
+		if (is_inline() ? new_size <= inline_capacity : buffer()->unique() && new_size <= buffer()->capacity()) {
+			write(raw_data() + size);
+			set_size(new_size);
+			return;
+		}
+
+		// the capacity of the growing string is doubled, the copy of the shared string gets the exact capacity
+		size_type new_capacity = new_size;
+		if (new_size > capacity())
+			new_capacity = std::max(new_size, std::min(2 * capacity(), max_size()));
+		reallocate(new_capacity, count, std::move(write));
+	}
+
+	alignas(void*) CharT chars_[inline_length]{};
+};
+
+#ifndef __cpp_inline_variables
+template<typename CharT, typename Traits, typename RefCount>
+constexpr typename basic_string<CharT, Traits, RefCount>::size_type basic_string<CharT, Traits, RefCount>::inline_capacity;
+#endif
+
+using string = basic_string<char>;
+using wstring = basic_string<wchar_t>;
+using u16string = basic_string<char16_t>;
+using u32string = basic_string<char32_t>;
+
+template<typename CharT, typename Traits, typename RefCount>
+struct allow_inplace_placement<basic_string<CharT, Traits, RefCount>> : std::true_type {};
+
+template<typename CharT, typename Traits, typename RefCount>
+COW_NODISCARD basic_string<CharT, Traits, RefCount> operator+(
+	basic_string<CharT, Traits, RefCount> lhs, const basic_string<CharT, Traits, RefCount>& rhs)
+{
+	lhs.append(rhs);
+	return lhs;
+}
+
+template<typename CharT, typename Traits, typename RefCount>
+COW_NODISCARD basic_string<CharT, Traits, RefCount> operator+(
+	basic_string<CharT, Traits, RefCount> lhs, const CharT* const rhs)
+{
+	lhs.append(rhs);
+	return lhs;
+}
+
+template<typename CharT, typename Traits, typename RefCount>
+std::basic_ostream<CharT, Traits>& operator<<(
+	std::basic_ostream<CharT, Traits>& os, const basic_string<CharT, Traits, RefCount>& s)
+{
+#ifdef COW_CPP_LIB_STRING_VIEW
+	return os << std::basic_string_view<CharT, Traits>{s};
+#else
+	return os << s.str();
+#endif
+}
+
+template<typename CharT, typename Traits, typename RefCount>
+void swap(basic_string<CharT, Traits, RefCount>& lhs, basic_string<CharT, Traits, RefCount>& rhs) noexcept
+{
+	lhs.swap(rhs);
+}
+
+} // namespace cow
+
+namespace std {
+
+template<typename CharT, typename Traits, typename RefCount>
+struct hash<cow::basic_string<CharT, Traits, RefCount>> {
+	std::size_t operator()(const cow::basic_string<CharT, Traits, RefCount>& s) const
+	{
+#ifdef COW_CPP_LIB_STRING_VIEW
+		return std::hash<std::basic_string_view<CharT, Traits>>{}(s);
+#else
+		return std::hash<std::basic_string<CharT, Traits>>{}(s.str());
+#endif
+	}
+};
+
+} // namespace std
@@ -0,0 +1,543 @@
+#pragma once
+#include "detail/chunk.h"
+#include "detail/compatibility/compile_features.h"
+#include "optional.h"
+#include "storage.h"
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+synopsis
+
+namespace cow {
+
+/// Sequence of values which shares its elements between copies. The elements are kept in chunks of `ChunkSize`
+/// values and the vector keeps a shared index of pointers to the chunks. The copy of the vector shares the index, so
+/// it is O(1). Writing an element copies only the index and the chunk of the element if they are shared, the other
+/// chunks stay shared with the copies of the vector. The index and the chunks are kept by the storage policy `Storage`.
+/// The references to the elements and the iterators are invalidated by any modification of the vector.
+template<typename T, std::size_t ChunkSize = about 1 KiB / sizeof(T), typename Storage = intrusive_storage>
+class vector {
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = const T&;
+	using const_reference = const T&;
+	class const_iterator; // random access iterator
+	using iterator = const_iterator;
+
+	static constexpr size_type chunk_size = ChunkSize;
+
+	// constructors
+
+	vector() noexcept;
+	vector(size_type count, const T& value);
+	template<typename InputIt>
+	vector(InputIt first, InputIt last);
+	vector(std::initializer_list<T> ilist);
+
+	vector(const vector& other) noexcept;
+	vector(vector&& other) noexcept;
+
+	vector& operator=(const vector& other) noexcept;
+	vector& operator=(vector&& other) noexcept;
+
+	~vector();
+
+	// element access
+
+	const T& operator[](size_type pos) const noexcept;
+	const T& at(size_type pos) const;
+	const T& front() const noexcept;
+	const T& back() const noexcept;
+
+	// iterators
+
+	const_iterator begin() const noexcept;
+	const_iterator cbegin() const noexcept;
+	const_iterator end() const noexcept;
+	const_iterator cend() const noexcept;
+
+	// capacity
+
+	bool empty() const noexcept;
+	size_type size() const noexcept;
+
+	// modifiers
+	// `pos` must be less than `size()`.
+
+	/// Gives mutable access to the element `pos`. The vector must not be copied while the session is used.
+	write_session<T> write(size_type pos);
+	template<typename F>
+	decltype(auto) modify(size_type pos, F&& f);
+	template<typename U>
+	void set(size_type pos, U&& value);
+
+	void push_back(const T& value);
+	void push_back(T&& value);
+	template<typename... Args>
+	const T& emplace_back(Args&&... args);
+	void pop_back();
+	void clear() noexcept;
+
+	void swap(vector& other) noexcept;
+
+	// observers
+
+	/// \return true if the vectors share the index of chunks, so they are equal.
+	bool shares_storage_with(const vector& other) const noexcept;
+};
+
+// relational operations
+// The shared chunks of the vectors are equal without comparison of values.
+
+template<typename T, std::size_t ChunkSize, typename Storage>
+bool operator==(const vector<T, ChunkSize, Storage>& lhs, const vector<T, ChunkSize, Storage>& rhs);
+template<typename T, std::size_t ChunkSize, typename Storage>
+bool operator!=(const vector<T, ChunkSize, Storage>& lhs, const vector<T, ChunkSize, Storage>& rhs);
+template<typename T, std::size_t ChunkSize, typename Storage>
+bool operator<(const vector<T, ChunkSize, Storage>& lhs, const vector<T, ChunkSize, Storage>& rhs);
+template<typename T, std::size_t ChunkSize, typename Storage>
+bool operator>(const vector<T, ChunkSize, Storage>& lhs, const vector<T, ChunkSize, Storage>& rhs);
+template<typename T, std::size_t ChunkSize, typename Storage>
+bool operator<=(const vector<T, ChunkSize, Storage>& lhs, const vector<T, ChunkSize, Storage>& rhs);
+template<typename T, std::size_t ChunkSize, typename Storage>
+bool operator>=(const vector<T, ChunkSize, Storage>& lhs, const vector<T, ChunkSize, Storage>& rhs);
+
+// specialized algorithms
+
+template<typename T, std::size_t ChunkSize, typename Storage>
+void swap(vector<T, ChunkSize, Storage>& lhs, vector<T, ChunkSize, Storage>& rhs) noexcept;
+
+} // namespace cow
+*/
+
+namespace cow {
+
+template<typename T, std::size_t ChunkSize = detail::default_chunk_size<T>::value, typename Storage = intrusive_storage>
+class vector {
+	static_assert(
+		!std::is_reference<T>::value, "Instantiation of vector with a reference type is ill-formed");
+	static_assert(
+		std::is_destructible<T>::value, "Instantiation of vector with a non-destructible type is ill-formed");
+
+	using chunk_type = detail::chunk<T, ChunkSize>;
+	using chunk_pointer = typename Storage::template pointer<chunk_type>;
+	using index_type = std::vector<chunk_pointer>;
+	using index_pointer = typename Storage::template pointer<index_type>;
+
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = const T&;
+	using const_reference = const T&;
+
+	class const_iterator {
+		friend class vector;
+
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		const_iterator() noexcept = default;
+
+		COW_NODISCARD reference operator*() const noexcept
+		{
+			return element(*index_, pos_);
+		}
+
+		COW_NODISCARD pointer operator->() const noexcept
+		{
+			return std::addressof(**this);
+		}
+
+		COW_NODISCARD reference operator[](const difference_type n) const noexcept
+		{
+			return *(*this + n);
+		}
+
+		const_iterator& operator++() noexcept
+		{
+			++pos_;
+			return *this;
+		}
+
+		const_iterator operator++(int) noexcept
+		{
+			const_iterator result{*this};
+			++pos_;
+			return result;
+		}
+
+		const_iterator& operator--() noexcept
+		{
+			--pos_;
+			return *this;
+		}
+
+		const_iterator operator--(int) noexcept
+		{
+			const_iterator result{*this};
+			--pos_;
+			return result;
+		}
+
+		const_iterator& operator+=(const difference_type n) noexcept
+		{
+			pos_ = static_cast<size_type>(static_cast<difference_type>(pos_) + n);
+			return *this;
+		}
+
+		const_iterator& operator-=(const difference_type n) noexcept
+		{
+			return *this += -n;
+		}
+
+		COW_NODISCARD friend const_iterator operator+(const_iterator it, const difference_type n) noexcept
+		{
+			return it += n;
+		}
+
+		COW_NODISCARD friend const_iterator operator+(const difference_type n, const_iterator it) noexcept
+		{
+			return it += n;
+		}
+
+		COW_NODISCARD friend const_iterator operator-(const_iterator it, const difference_type n) noexcept
+		{
+			return it -= n;
+		}
+
+		COW_NODISCARD friend difference_type operator-(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return static_cast<difference_type>(lhs.pos_) - static_cast<difference_type>(rhs.pos_);
+		}
+
+		COW_NODISCARD friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ == rhs.pos_;
+		}
+
+		COW_NODISCARD friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ != rhs.pos_;
+		}
+
+		COW_NODISCARD friend bool operator<(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ < rhs.pos_;
+		}
+
+		COW_NODISCARD friend bool operator>(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ > rhs.pos_;
+		}
+
+		COW_NODISCARD friend bool operator<=(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ <= rhs.pos_;
+		}
+
+		COW_NODISCARD friend bool operator>=(const const_iterator& lhs, const const_iterator& rhs) noexcept
+		{
+			return lhs.pos_ >= rhs.pos_;
+		}
+
+	private:
+		const_iterator(const index_type* index, const size_type pos) noexcept
+			: index_{index}
+			, pos_{pos}
+		{}
+
+		const index_type* index_ = nullptr;
+		size_type pos_ = 0;
+	};
+
+	using iterator = const_iterator;
+
+	static constexpr size_type chunk_size = ChunkSize;
+
+	// constructors
+
+	vector() noexcept = default;
+
+	vector(const size_type count, const T& value)
+	{
+		for (size_type i = 0; i != count; ++i)
+			push_back(value);
+	}
+
+	template<
+		typename InputIt,
+		typename = std::enable_if_t<std::is_convertible<
+			typename std::iterator_traits<InputIt>::iterator_category, std::input_iterator_tag>::value>>
+	vector(InputIt first, const InputIt last)
+	{
+		for (; first != last; ++first)
+			emplace_back(*first);
+	}
+
+	vector(const std::initializer_list<T> ilist)
+		: vector(ilist.begin(), ilist.end())
+	{}
+
+	vector(const vector&) = default;
+
+	vector(vector&& other) noexcept
+		: index_{std::move(other.index_)}
+		, size_{other.size_}
+	{
+		other.index_.reset();
+		other.size_ = 0;
+	}
+
+	vector& operator=(const vector&) = default;
+
+	vector& operator=(vector&& other) noexcept
+	{
+		vector{std::move(other)}.swap(*this);
+		return *this;
+	}
+
+	~vector() = default;
+
+	// element access
+
+	COW_NODISCARD const T& operator[](const size_type pos) const noexcept
+	{
+		return element(*index_, pos);
+	}
+
+	COW_NODISCARD const T& at(const size_type pos) const
+	{
+		if (pos >= size_)
+			throw std::out_of_range{"cow::vector::at"};
+
+		return (*this)[pos];
+	}
+
+	COW_NODISCARD const T& front() const noexcept
+	{
+		return (*this)[0];
+	}
+
+	COW_NODISCARD const T& back() const noexcept
+	{
+		return (*this)[size_ - 1];
+	}
+
+	// iterators
+
+	COW_NODISCARD const_iterator begin() const noexcept
+	{
+		return const_iterator{index_.get(), 0};
+	}
+
+	COW_NODISCARD const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+
+	COW_NODISCARD const_iterator end() const noexcept
+	{
+		return const_iterator{index_.get(), size_};
+	}
+
+	COW_NODISCARD const_iterator cend() const noexcept
+	{
+		return end();
+	}
+
+	// capacity
+
+	COW_NODISCARD bool empty() const noexcept
+	{
+		return size_ == 0;
+	}
+
+	COW_NODISCARD size_type size() const noexcept
+	{
+		return size_;
+	}
+
+	// modifiers
+
+	COW_NODISCARD write_session<T> write(const size_type pos)
+	{
+		return detail::write_session_access::make(mutable_chunk(pos / ChunkSize)[pos % ChunkSize]);
+	}
+
+	template<typename F>
+	decltype(auto) modify(const size_type pos, F&& f)
+	{
+		return std::forward<F>(f)(*write(pos));
+	}
+
+	template<typename U>
+	void set(const size_type pos, U&& value)
+	{
+		*write(pos) = std::forward<U>(value);
+	}
+
+	void push_back(const T& value)
+	{
+		emplace_back(value);
+	}
+
+	void push_back(T&& value)
+	{
+		emplace_back(std::move(value));
+	}
+
+	// The new element is constructed before the index is changed, so `args` may refer to the elements of the vector.
+	template<typename... Args>
+	const T& emplace_back(Args&&... args)
+	{
+		if (size_ % ChunkSize != 0) {
+			const T& value = mutable_chunk(size_ / ChunkSize).emplace_back(std::forward<Args>(args)...);
+			++size_;
+			return value;
+		}
+
+		chunk_pointer chunk = chunk_pointer::make();
+		const T& value = (*chunk).emplace_back(std::forward<Args>(args)...);
+		mutable_index().push_back(std::move(chunk));
+		++size_;
+		return value;
+	}
+
+	void pop_back()
+	{
+		const size_type last = size_ - 1;
+		if (last % ChunkSize == 0)
+			mutable_index().pop_back();
+		else
+			mutable_chunk(last / ChunkSize).pop_back();
+
+		size_ = last;
+	}
+
+	void clear() noexcept
+	{
+		index_.reset();
+		size_ = 0;
+	}
+
+	void swap(vector& other) noexcept
+	{
+		index_.swap(other.index_);
+		std::swap(size_, other.size_);
+	}
+
+	// observers
+
+	COW_NODISCARD bool shares_storage_with(const vector& other) const noexcept
+	{
+		return index_ && index_.get() == other.index_.get();
+	}
+
+	// relational operations
+
+	COW_NODISCARD friend bool operator==(const vector& lhs, const vector& rhs)
+	{
+		if (lhs.size_ != rhs.size_)
+			return false;
+		if (lhs.size_ == 0 || lhs.shares_storage_with(rhs))
+			return true;
+
+		const index_type& lhs_index = *lhs.index_;
+		const index_type& rhs_index = *rhs.index_;
+		for (size_type i = 0; i != lhs_index.size(); ++i) {
+			const chunk_type& lhs_chunk = *lhs_index[i];
+			const chunk_type& rhs_chunk = *rhs_index[i];
+			if (std::addressof(lhs_chunk) == std::addressof(rhs_chunk))
+				continue;
+
+			for (size_type j = 0; j != lhs_chunk.size(); ++j) {
+				if (!(lhs_chunk[j] == rhs_chunk[j]))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	COW_NODISCARD friend bool operator!=(const vector& lhs, const vector& rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+	COW_NODISCARD friend bool operator<(const vector& lhs, const vector& rhs)
+	{
+		if (lhs.shares_storage_with(rhs))
+			return false;
+
+		return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	}
+
+	COW_NODISCARD friend bool operator>(const vector& lhs, const vector& rhs)
+	{
+		return rhs < lhs;
+	}
+
+	COW_NODISCARD friend bool operator<=(const vector& lhs, const vector& rhs)
+	{
+		return !(rhs < lhs);
+	}
+
+	COW_NODISCARD friend bool operator>=(const vector& lhs, const vector& rhs)
+	{
+		return !(lhs < rhs);
+	}
+
+private:
+	static const T& element(const index_type& index, const size_type pos) noexcept
+	{
+		return (*index[pos / ChunkSize])[pos % ChunkSize];
+	}
+
+	// the index which is not shared with other vectors
+	index_type& mutable_index()
+	{
+		if (!index_)
+			index_ = index_pointer::make();
+		else if (!index_.unique())
+			index_ = index_.make_similar(*index_);
+
+		return *index_;
+	}
+
+	// the chunk which is not shared with other vectors, only the index and this chunk are copied
+	chunk_type& mutable_chunk(const size_type n)
+	{
+		chunk_pointer& chunk = mutable_index()[n];
+		if (!chunk.unique())
+			chunk = chunk.make_similar(*chunk);
+
+		return *chunk;
+	}
+
+	index_pointer index_;
+	size_type size_ = 0;
+};
+
+// specialized algorithms
+
+template<typename T, std::size_t ChunkSize, typename Storage>
+void swap(vector<T, ChunkSize, Storage>& lhs, vector<T, ChunkSize, Storage>& rhs) noexcept
+{
+	lhs.swap(rhs);
+}
+
+} // namespace cow
@@ -0,0 +1,158 @@
+#include <cow/arena.h>
+#include <catch2/catch.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace cow {
+namespace test {
+namespace {
+
+// # tools
+bool is_aligned(const void* const p, const std::size_t alignment) noexcept
+{
+	return reinterpret_cast<std::uintptr_t>(p) % alignment == 0; // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+// # tests
+TEST_CASE("Testing class arena", "[arena]") {
+	SECTION("allocating memory") {
+		arena a{64};
+		void* const p1 = a.allocate(8, 8);
+		void* const p2 = a.allocate(8, 8);
+
+		CHECK(p1 != p2);
+		CHECK(is_aligned(p1, 8));
+		CHECK(is_aligned(p2, 8));
+		CHECK(a.capacity() > 64);
+	}
+	SECTION("allocating aligned memory") {
+		arena a{64};
+		static_cast<void>(a.allocate(1, 1));
+
+		CHECK(is_aligned(a.allocate(16, 16), 16));
+	}
+	SECTION("allocating memory larger than chunk") {
+		arena a{64};
+		static_cast<void>(a.allocate(8, 8));
+		const std::size_t capacity = a.capacity();
+		static_cast<void>(a.allocate(1000, 8));
+
+		CHECK(a.capacity() >= capacity + 1000);
+	}
+	SECTION("setting current arena") {
+		arena a1;
+		arena a2;
+		CHECK(arena::current() == nullptr);
+		{
+			const arena::scope s1{a1};
+			CHECK(arena::current() == &a1);
+			{
+				const arena::scope s2{a2};
+				CHECK(arena::current() == &a2);
+			}
+			CHECK(arena::current() == &a1);
+		}
+		CHECK(arena::current() == nullptr);
+	}
+}
+
+TEST_CASE("Testing arena storage", "[arena]") {
+	arena a{256};
+
+	SECTION("size of optional with arena storage") {
+		CHECK(sizeof(arena_optional<std::string>) == sizeof(void*));
+	}
+	SECTION("creating by make_optional in arena scope") {
+		const arena::scope s{a};
+		const arena_optional<std::string> v = make_optional<std::string, false, arena_storage>("value");
+
+		REQUIRE(v);
+		CHECK(*v == "value");
+		CHECK(a.capacity() != 0);
+	}
+	SECTION("creating by make_optional without arena") {
+		CHECK(arena_allocator<char>{}.get_arena() == nullptr);
+
+		const arena_optional<std::string> v = make_optional<std::string, false, arena_storage>("value");
+		arena_optional<std::string> copy = v;
+		{
+			// the copy made on write uses the allocator of the value which has no arena
+			const arena::scope s{a};
+			copy.modify([](std::string& value) { value += '!'; });
+		}
+
+		REQUIRE(v);
+		CHECK(*v == "value");
+		CHECK(*copy == "value!");
+		CHECK(a.capacity() == 0);
+
+		copy.reset();
+		CHECK_FALSE(copy);
+		CHECK(*v == "value");
+	}
+	SECTION("creating by allocator") {
+		const arena_optional<std::string> v{std::allocator_arg, arena_allocator<char>{&a}, in_place, "value"};
+
+		REQUIRE(v);
+		CHECK(*v == "value");
+		CHECK(a.capacity() != 0);
+	}
+	SECTION("copying on write to the same arena") {
+		arena_optional<std::string> v1{std::allocator_arg, arena_allocator<char>{&a}, in_place, "value"};
+		const arena_optional<std::string> v2 = v1;
+		const std::size_t capacity = a.capacity();
+		for (int i = 0; i != 10; ++i) {
+			const arena_optional<std::string> copy = v1;
+			v1.modify([](std::string& value) { value += '!'; });
+		}
+
+		CHECK(*v2 == "value");
+		CHECK(*v1 == "value!!!!!!!!!!");
+		CHECK(a.capacity() > capacity);
+	}
+}
+
+TEST_CASE("Testing monotonic arena storage", "[arena]") {
+	arena a{256};
+	const arena::scope s{a};
+
+	SECTION("size of optional with monotonic arena storage") {
+		CHECK(sizeof(monotonic_arena_optional<std::array<int, 4>>) == sizeof(void*));
+	}
+	SECTION("copying trivially destructible value on write after its copies are released") {
+		using optional_type = monotonic_arena_optional<std::array<int, 4>>;
+		optional_type v{in_place, std::array<int, 4>{{1, 2, 3, 4}}};
+		const std::array<int, 4>* const address = &*v;
+		(*v.write())[0] = 0;
+
+		CHECK(&*v == address);
+
+		{
+			const optional_type copy = v;
+		}
+		(*v.write())[0] = 5;
+
+		CHECK(&*v != address);
+		CHECK((*v)[0] == 5);
+		CHECK((*address)[0] == 0);
+	}
+	SECTION("releasing value with destructor") {
+		using optional_type = monotonic_arena_optional<std::string>;
+		optional_type v{in_place, "value"};
+		const std::string* const address = &*v;
+		{
+			const optional_type copy = v;
+		}
+		*v.write() += '!';
+
+		CHECK(&*v == address);
+		CHECK(*v == "value!");
+	}
+}
+
+} // namespace
+} // namespace test
+} // namespace cow
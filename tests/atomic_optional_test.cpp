@@ -0,0 +1,381 @@
+#include <cow/atomic_optional.h>
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cow {
+namespace test {
+namespace {
+
+// counts alive objects
+class counted {
+public:
+	explicit counted(const int value) noexcept
+		: value_{value}
+	{
+		++alive();
+	}
+
+	counted(const counted& other) noexcept
+		: value_{other.value_}
+	{
+		++alive();
+	}
+
+	counted& operator=(const counted& other) noexcept = default;
+
+	~counted()
+	{
+		--alive();
+	}
+
+	int get_value() const noexcept
+	{
+		return value_;
+	}
+
+	static std::atomic<int>& alive() noexcept
+	{
+		static std::atomic<int> count{0};
+		return count;
+	}
+
+private:
+	int value_;
+};
+
+// allocates all single objects in one slot, so a new block has the address of the destroyed one
+template<typename T>
+class reusing_allocator {
+public:
+	using value_type = T;
+
+	reusing_allocator() = default;
+
+	template<typename U>
+	reusing_allocator(const reusing_allocator<U>& /*other*/) noexcept // NOLINT: Allow implicit conversion
+	{}
+
+	T* allocate(const std::size_t n)
+	{
+		REQUIRE(n == 1);
+		REQUIRE(sizeof(T) <= sizeof(slot()));
+		REQUIRE_FALSE(used());
+		used() = true;
+		return static_cast<T*>(static_cast<void*>(&slot()));
+	}
+
+	void deallocate(T* /*p*/, std::size_t /*n*/) noexcept
+	{
+		used() = false;
+	}
+
+	template<typename U>
+	bool operator==(const reusing_allocator<U>& /*other*/) const noexcept
+	{
+		return true;
+	}
+
+	template<typename U>
+	bool operator!=(const reusing_allocator<U>& /*other*/) const noexcept
+	{
+		return false;
+	}
+
+private:
+	static std::aligned_storage_t<256, alignof(std::max_align_t)>& slot() noexcept
+	{
+		static std::aligned_storage_t<256, alignof(std::max_align_t)> storage;
+		return storage;
+	}
+
+	static bool& used() noexcept
+	{
+		static bool value = false;
+		return value;
+	}
+};
+
+// # tests
+
+TEST_CASE("Testing class atomic_optional", "[atomic_optional]") {
+	using optional_type = atomic_optional<counted>::value_type;
+
+	snapshot_ref_count::release_kept();
+	const int alive = counted::alive();
+
+	SECTION("creating by default constructor") {
+		const atomic_optional<counted> v;
+
+		CHECK_FALSE(v.load());
+		CHECK(v.is_lock_free());
+	}
+	SECTION("creating by optional") {
+		{
+			const atomic_optional<counted> v{optional_type{in_place, 5}};
+			const optional_type snapshot = v.load();
+
+			REQUIRE(snapshot);
+			CHECK(snapshot->get_value() == 5);
+		}
+		snapshot_ref_count::release_kept();
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("sharing value with snapshots") {
+		const optional_type value{in_place, 5};
+		const atomic_optional<counted> v{value};
+		const optional_type snapshot = v;
+
+		CHECK(snapshot.shares_storage_with(value));
+	}
+	SECTION("storing value") {
+		{
+			atomic_optional<counted> v{optional_type{in_place, 5}};
+			const optional_type snapshot = v.load();
+			v.store(optional_type{in_place, 6});
+
+			REQUIRE(snapshot);
+			CHECK(snapshot->get_value() == 5);
+			REQUIRE(v.load());
+			CHECK(v.load()->get_value() == 6);
+
+			v = nullopt;
+			CHECK_FALSE(v.load());
+		}
+		snapshot_ref_count::release_kept();
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("exchanging value") {
+		{
+			atomic_optional<counted> v{optional_type{in_place, 5}};
+			const optional_type previous = v.exchange(optional_type{in_place, 6});
+
+			REQUIRE(previous);
+			CHECK(previous->get_value() == 5);
+			CHECK(v.load()->get_value() == 6);
+		}
+		snapshot_ref_count::release_kept();
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("comparing and exchanging value") {
+		{
+			atomic_optional<counted> v{optional_type{in_place, 5}};
+			optional_type expected = v.load();
+
+			CHECK(v.compare_exchange(expected, optional_type{in_place, 6}));
+			CHECK(v.load()->get_value() == 6);
+			CHECK_FALSE(v.compare_exchange(expected, optional_type{in_place, 7}));
+			REQUIRE(expected);
+			CHECK(expected->get_value() == 6);
+			CHECK(v.compare_exchange(expected, nullopt));
+			CHECK_FALSE(v.load());
+		}
+		snapshot_ref_count::release_kept();
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("comparing and exchanging empty value") {
+		atomic_optional<counted> v;
+		optional_type expected;
+
+		CHECK(v.compare_exchange(expected, optional_type{in_place, 5}));
+		CHECK(v.load()->get_value() == 5);
+	}
+	SECTION("loading value by reusing released snapshots") {
+		{
+			atomic_optional<counted> v{optional_type{in_place, 5}};
+			int sum = 0;
+			for (int i = 0; i != 0x10000; ++i) {
+				const optional_type snapshot = v.load();
+				sum += snapshot ? snapshot->get_value() : 0;
+			}
+
+			CHECK(sum == 5 * 0x10000);
+
+			optional_type snapshot = v.load();
+			v.store(nullopt);
+			const counted* const address = &*snapshot;
+			*snapshot.write() = counted{6};
+
+			CHECK(&*snapshot == address);
+		}
+		// the thread keeps the references to the last loaded value
+		CHECK(counted::alive() == alive + 1);
+		snapshot_ref_count::release_kept();
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("destroying previous value by loading new one") {
+		atomic_optional<counted> v{optional_type{in_place, 5}};
+		static_cast<void>(v.load());
+		v.store(optional_type{in_place, 6});
+
+		CHECK(counted::alive() == alive + 2);
+		CHECK(v.load()->get_value() == 6);
+		CHECK(counted::alive() == alive + 1);
+	}
+	SECTION("releasing value at the address of the loaded value") {
+		using storage = basic_intrusive_storage<snapshot_ref_count, reusing_allocator<char>>;
+		using reused_optional_type = optional<counted, false, storage>;
+		const counted* address = nullptr;
+		{
+			const atomic_optional<counted, storage> v{reused_optional_type{in_place, 5}};
+			const reused_optional_type snapshot = v.load();
+			address = &*snapshot;
+		}
+		snapshot_ref_count::release_kept();
+		REQUIRE(counted::alive() == alive);
+
+		reused_optional_type value{in_place, 6};
+		REQUIRE(&*value == address);
+		value.reset();
+
+		// the thread does not keep the references to the new block which has the address of the loaded one
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("loading value with atomic reference counter") {
+		using counted_optional_type = optional<counted, false, intrusive_storage>;
+		{
+			atomic_optional<counted, intrusive_storage> v{counted_optional_type{in_place, 5}};
+			const counted_optional_type snapshot = v.load();
+			v.store(counted_optional_type{in_place, 6});
+
+			CHECK(snapshot->get_value() == 5);
+			CHECK(v.load()->get_value() == 6);
+		}
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("storing value with deferred storage") {
+		{
+			using deferred_optional_type = optional<counted, false, deferred_storage>;
+			atomic_optional<counted, deferred_storage> v{deferred_optional_type{in_place, 5}};
+			v.store(deferred_optional_type{in_place, 6});
+
+			CHECK(v.load()->get_value() == 6);
+			CHECK(counted::alive() == alive + 2);
+		}
+		static_cast<void>(reclamation_domain::global().collect());
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("loading value with deferred storage by reusing released snapshots") {
+		using deferred_optional_type = optional<counted, false, deferred_storage>;
+		{
+			atomic_optional<counted, deferred_storage> v{deferred_optional_type{in_place, 5}};
+			int sum = 0;
+			for (int i = 0; i != 0x10000; ++i) {
+				const deferred_optional_type snapshot = v.load();
+				sum += snapshot ? snapshot->get_value() : 0;
+			}
+
+			CHECK(sum == 5 * 0x10000);
+
+			deferred_optional_type snapshot = v.load();
+			static_cast<void>(v.load());
+			v.store(nullopt);
+			const counted* const address = &*snapshot;
+			*snapshot.write() = counted{6};
+
+			CHECK(&*snapshot == address);
+			CHECK(snapshot->get_value() == 6);
+		}
+		// the references released by the thread are subtracted by the collection
+		CHECK(counted::alive() == alive + 1);
+		static_cast<void>(reclamation_domain::global().collect());
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("releasing value of deferred storage at the address of the loaded value") {
+		using storage = basic_intrusive_storage<deferred_ref_count, reusing_allocator<char>>;
+		using deferred_optional_type = optional<counted, false, storage>;
+		const counted* address = nullptr;
+		{
+			const atomic_optional<counted, storage> v{deferred_optional_type{in_place, 5}};
+			const deferred_optional_type snapshot = v.load();
+			address = &*snapshot;
+		}
+		static_cast<void>(reclamation_domain::global().collect());
+		REQUIRE(counted::alive() == alive);
+
+		deferred_optional_type value{in_place, 6};
+		REQUIRE(&*value == address);
+		value.reset();
+
+		// the thread does not keep the references to the new block which has the address of the loaded one
+		CHECK(reclamation_domain::global().has_retired());
+		static_cast<void>(reclamation_domain::global().collect());
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("releasing snapshots of deferred storage by several threads") {
+		using deferred_optional_type = optional<counted, false, deferred_storage>;
+		{
+			atomic_optional<counted, deferred_storage> v{deferred_optional_type{in_place, 0}};
+			std::vector<std::thread> readers;
+			for (int i = 0; i != 4; ++i) {
+				readers.emplace_back([&v]() {
+					for (int j = 0; j != 1000; ++j)
+						static_cast<void>(v.load());
+				});
+			}
+			for (int i = 1; i <= 100; ++i)
+				v.store(deferred_optional_type{in_place, i});
+			for (std::thread& reader : readers)
+				reader.join();
+		}
+		static_cast<void>(reclamation_domain::global().collect());
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("loading value many times") {
+		{
+			atomic_optional<counted> v{optional_type{in_place, 5}};
+			std::vector<optional_type> snapshots;
+			for (int i = 0; i != 0x10000; ++i)
+				snapshots.push_back(v.load());
+
+			v.store(nullopt);
+			CHECK(counted::alive() == alive + 1);
+			snapshots.clear();
+		}
+		snapshot_ref_count::release_kept();
+		CHECK(counted::alive() == alive);
+	}
+	SECTION("loading and storing by several threads") {
+		constexpr int reader_count = 4;
+		constexpr int store_count = 1000;
+		{
+			atomic_optional<counted> v{optional_type{in_place, 0}};
+			std::atomic<bool> done{false};
+			std::atomic<bool> ordered{true};
+
+			std::vector<std::thread> readers;
+			for (int i = 0; i != reader_count; ++i) {
+				readers.emplace_back([&]() {
+					int previous = 0;
+					while (!done.load(std::memory_order_relaxed)) {
+						const optional_type snapshot = v.load();
+						if (!snapshot || snapshot->get_value() < previous)
+							ordered = false;
+						else
+							previous = snapshot->get_value();
+					}
+				});
+			}
+
+			for (int i = 1; i <= store_count; ++i)
+				v.store(optional_type{in_place, i});
+
+			done = true;
+			for (std::thread& reader : readers)
+				reader.join();
+
+			CHECK(ordered);
+			CHECK(v.load()->get_value() == store_count);
+		}
+		snapshot_ref_count::release_kept();
+		CHECK(counted::alive() == alive);
+	}
+}
+
+} // namespace
+} // namespace test
+} // namespace cow
@@ -0,0 +1,356 @@
+#include <cow/flex_vector.h>
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "tools/sequences.h"
+#include "tools/tracker.h"
+
+namespace cow {
+namespace test {
+namespace {
+
+// # tools
+// the nodes keep up to 4 values or children, so the small vectors have several levels
+using small_flex_vector = flex_vector<int, 2>;
+
+using tools::make_std_sequence;
+using tools::to_std_vector;
+
+const auto make_sequence = &tools::make_sequence<small_flex_vector>;
+
+// # tests
+TEST_CASE("Testing class flex_vector", "[flex_vector]") {
+	SECTION("default constructor") {
+		const small_flex_vector v;
+
+		CHECK(v.empty());
+		CHECK(v.size() == 0);
+		CHECK(v.begin() == v.end());
+	}
+	SECTION("constructors") {
+		const small_flex_vector v1(70, 7);
+		const std::vector<int> source = make_std_sequence(0, 70);
+		const small_flex_vector v2(source.begin(), source.end());
+		const small_flex_vector v3{1, 2, 3};
+
+		CHECK(to_std_vector(v1) == std::vector<int>(70, 7));
+		CHECK(to_std_vector(v2) == source);
+		CHECK(to_std_vector(v3) == std::vector<int>{1, 2, 3});
+	}
+	SECTION("push_back and element access") {
+		const small_flex_vector v = make_sequence(0, 100);
+
+		REQUIRE(v.size() == 100);
+		CHECK(to_std_vector(v) == make_std_sequence(0, 100));
+		CHECK(v.front() == 0);
+		CHECK(v.back() == 99);
+		CHECK(v.at(99) == 99);
+		CHECK_THROWS_AS(v.at(100), std::out_of_range);
+	}
+	SECTION("iterators") {
+		const small_flex_vector v = make_sequence(0, 100);
+		small_flex_vector::const_iterator it = v.begin();
+
+		CHECK(std::vector<int>(v.begin(), v.end()) == make_std_sequence(0, 100));
+		CHECK(std::distance(v.begin(), v.end()) == 100);
+		CHECK(*(it + 50) == 50);
+		CHECK(it[70] == 70);
+		it += 99;
+		CHECK(*it-- == 99);
+		CHECK(*it == 98);
+		CHECK(v.end() - it == 2);
+	}
+	SECTION("copying shares the tree") {
+		const small_flex_vector v1 = make_sequence(0, 100);
+		const small_flex_vector v2 = v1; // NOLINT(performance-unnecessary-copy-initialization)
+
+		CHECK(v1.shares_storage_with(v2));
+		CHECK(&v1[0] == &v2[0]);
+		CHECK(v1 == v2);
+	}
+	SECTION("writing copies only the path to the element") {
+		const small_flex_vector v1 = make_sequence(0, 100);
+		small_flex_vector v2 = v1;
+
+		v2.set(50, 500);
+
+		CHECK(v1[50] == 50);
+		CHECK(v2[50] == 500);
+		CHECK(&v1[51] != &v2[51]);
+		CHECK(&v1[0] == &v2[0]);
+		CHECK(&v1[99] == &v2[99]);
+		CHECK(v1 != v2);
+	}
+	SECTION("writing unique vector does not copy") {
+		small_flex_vector v = make_sequence(0, 100);
+		const int* const address = &v[50];
+
+		*v.write(50) = 500;
+		v.modify(60, [](int& value) { value *= 10; });
+
+		CHECK(&v[50] == address);
+		CHECK(v[50] == 500);
+		CHECK(v[60] == 600);
+	}
+	SECTION("push_back to copy does not change original") {
+		const small_flex_vector v1 = make_sequence(0, 64);
+		small_flex_vector v2 = v1;
+
+		v2.push_back(64);
+
+		CHECK(v1.size() == 64);
+		CHECK(to_std_vector(v2) == make_std_sequence(0, 65));
+		CHECK(&v1[0] == &v2[0]);
+	}
+	SECTION("push_back element of itself") {
+		small_flex_vector v = make_sequence(0, 4);
+		const small_flex_vector copy = v;
+
+		v.push_back(v[0]);
+		v.push_back(v[4]);
+
+		CHECK(to_std_vector(v) == std::vector<int>{0, 1, 2, 3, 0, 0});
+	}
+	SECTION("take") {
+		for (int count = 0; count <= 100; count += 7) {
+			const small_flex_vector v1 = make_sequence(0, 100);
+			small_flex_vector v2 = v1;
+
+			v2.take(static_cast<std::size_t>(count));
+
+			CHECK(to_std_vector(v2) == make_std_sequence(0, count));
+			CHECK(to_std_vector(v1) == make_std_sequence(0, 100));
+		}
+	}
+	SECTION("drop") {
+		for (int count = 0; count <= 100; count += 7) {
+			const small_flex_vector v1 = make_sequence(0, 100);
+			small_flex_vector v2 = v1;
+
+			v2.drop(static_cast<std::size_t>(count));
+
+			CHECK(to_std_vector(v2) == make_std_sequence(count, 100));
+			CHECK(to_std_vector(v1) == make_std_sequence(0, 100));
+		}
+	}
+	SECTION("slicing and changing the slice") {
+		small_flex_vector v = make_sequence(0, 100);
+		v.drop(13);
+		v.take(50);
+		v.set(0, -1);
+		v.push_back(-2);
+
+		std::vector<int> expected = make_std_sequence(13, 63);
+		expected[0] = -1;
+		expected.push_back(-2);
+		CHECK(to_std_vector(v) == expected);
+	}
+	SECTION("concat") {
+		for (int left = 0; left <= 70; left += 5) {
+			for (int right = 0; right <= 70; right += 9) {
+				const small_flex_vector v1 = make_sequence(0, left);
+				const small_flex_vector v2 = make_sequence(left, left + right);
+
+				const small_flex_vector v3 = v1 + v2;
+
+				CHECK(to_std_vector(v3) == make_std_sequence(0, left + right));
+				CHECK(to_std_vector(v1) == make_std_sequence(0, left));
+				CHECK(to_std_vector(v2) == make_std_sequence(left, left + right));
+			}
+		}
+	}
+	SECTION("concat shares the nodes") {
+		const small_flex_vector v1 = make_sequence(0, 64);
+		const small_flex_vector v2 = make_sequence(64, 128);
+
+		const small_flex_vector v3 = concat(v1, v2);
+
+		CHECK(&v3[0] == &v1[0]);
+		CHECK(&v3[127] == &v2[63]);
+	}
+	SECTION("repeated concat of slices") {
+		small_flex_vector v;
+		std::vector<int> expected;
+		const small_flex_vector source = make_sequence(0, 50);
+		for (int i = 0; i != 40; ++i) {
+			small_flex_vector slice = source;
+			slice.drop(static_cast<std::size_t>(i % 7));
+			slice.take(static_cast<std::size_t>(i % 11 + 1));
+			v = (i % 2 == 0) ? v + slice : slice + v;
+
+			const std::vector<int> part = make_std_sequence(i % 7, i % 7 + i % 11 + 1);
+			if (i % 2 == 0)
+				expected.insert(expected.end(), part.begin(), part.end());
+			else
+				expected.insert(expected.begin(), part.begin(), part.end());
+		}
+
+		CHECK(to_std_vector(v) == expected);
+
+		v.drop(5);
+		v.take(v.size() - 5);
+		v.push_back(-1);
+		expected.erase(expected.begin(), expected.begin() + 5);
+		expected.erase(expected.end() - 5, expected.end());
+		expected.push_back(-1);
+		CHECK(to_std_vector(v) == expected);
+	}
+	SECTION("appending itself") {
+		small_flex_vector v = make_sequence(0, 30);
+
+		v.append(v);
+
+		const std::vector<int> half = make_std_sequence(0, 30);
+		std::vector<int> expected = half;
+		expected.insert(expected.end(), half.begin(), half.end());
+		CHECK(to_std_vector(v) == expected);
+	}
+	SECTION("moving") {
+		small_flex_vector v1 = make_sequence(0, 10);
+		small_flex_vector v2 = std::move(v1);
+
+		CHECK(v1.empty()); // NOLINT(bugprone-use-after-move)
+		CHECK(v2.size() == 10);
+
+		v1 = std::move(v2);
+
+		CHECK(v1.size() == 10);
+	}
+	SECTION("iterators after moving and swapping") {
+		small_flex_vector v1 = make_sequence(0, 100);
+		small_flex_vector::const_iterator first = v1.begin();
+		const small_flex_vector::const_iterator last = v1.end();
+		small_flex_vector v2 = std::move(v1);
+
+		CHECK(std::vector<int>(first, last) == make_std_sequence(0, 100));
+
+		small_flex_vector v3 = make_sequence(0, 10);
+		swap(v2, v3);
+		first += 3;
+
+		CHECK(*first == 3);
+		CHECK(last[-1] == 99);
+		CHECK(std::vector<int>(first, last) == make_std_sequence(3, 100));
+	}
+	SECTION("relational operations") {
+		const small_flex_vector v1{1, 2, 3};
+		const small_flex_vector v2{1, 2, 4};
+		const small_flex_vector v3{1, 2};
+
+		CHECK(v1 == small_flex_vector{1, 2, 3});
+		CHECK(v1 != v2);
+		CHECK(v1 < v2);
+		CHECK(v3 < v1);
+		CHECK(v2 > v1);
+		CHECK(v1 <= v1);
+		CHECK(v1 >= v3);
+	}
+	SECTION("writing copies only the leaf of the element") {
+		flex_vector<tools::tracker, 1> v1;
+		for (int i = 0; i != 8; ++i)
+			v1.emplace_back(i);
+		flex_vector<tools::tracker, 1> v2 = v1;
+
+		v2.modify(5, [](tools::tracker& value) { value = tools::tracker{50}; });
+
+		CHECK(v1[5].get_value() == 5);
+		CHECK(v2[5].get_value() == 50);
+		CHECK(v2[4].get_copy_generation() == v1[4].get_copy_generation() + 1);
+		CHECK(v2[3].get_copy_generation() == v1[3].get_copy_generation());
+		CHECK(v2[6].get_copy_generation() == v1[6].get_copy_generation());
+	}
+	SECTION("dropping values of unique vector does not copy") {
+		flex_vector<tools::tracker, 1> v;
+		for (int i = 0; i != 8; ++i)
+			v.emplace_back(i);
+		const unsigned generation = v[3].get_copy_generation();
+
+		v.drop(3);
+
+		REQUIRE(v.size() == 5);
+		CHECK(v[0].get_value() == 3);
+		CHECK(v[0].get_copy_generation() == generation);
+	}
+	SECTION("vector of strings") {
+		flex_vector<std::string> v1{"a", "b"};
+		flex_vector<std::string> v2 = v1;
+
+		v2.write(0)->append("c");
+
+		CHECK(v1[0] == "a");
+		CHECK(v2[0] == "ac");
+	}
+}
+
+TEST_CASE("Testing class flex_vector_transient", "[flex_vector]") {
+	SECTION("building vector") {
+		small_flex_vector::transient_type t;
+		for (int i = 0; i != 100; ++i)
+			t.push_back(i);
+
+		CHECK(t.size() == 100);
+		CHECK(t[99] == 99);
+
+		const small_flex_vector v = t.persistent();
+
+		CHECK(t.empty());
+		CHECK(to_std_vector(v) == make_std_sequence(0, 100));
+	}
+	SECTION("transient does not change original") {
+		const small_flex_vector v1 = make_sequence(0, 10);
+		small_flex_vector::transient_type t = v1.transient();
+
+		t.push_back(10);
+		t.set(0, -1);
+		t.set(10, -2);
+		t.drop(1);
+		t.append(v1);
+
+		std::vector<int> expected = make_std_sequence(1, 10);
+		expected.push_back(-2);
+		const std::vector<int> tail = make_std_sequence(0, 10);
+		expected.insert(expected.end(), tail.begin(), tail.end());
+		CHECK(to_std_vector(t.persistent()) == expected);
+		CHECK(to_std_vector(v1) == make_std_sequence(0, 10));
+	}
+	SECTION("moving vector to transient") {
+		small_flex_vector v = make_sequence(0, 10);
+		small_flex_vector::transient_type t = std::move(v).transient();
+
+		t.take(5);
+
+		CHECK(to_std_vector(t.persistent()) == make_std_sequence(0, 5));
+	}
+}
+
+TEST_CASE("Testing flex_vector storage policies", "[flex_vector]") {
+	SECTION("shared_ptr storage") {
+		const flex_vector<int, 2, shared_ptr_storage> v1{1, 2, 3, 4, 5};
+		flex_vector<int, 2, shared_ptr_storage> v2 = v1 + v1;
+
+		v2.set(4, 50);
+
+		CHECK(v1[4] == 5);
+		CHECK(v2[4] == 50);
+		CHECK(v2.size() == 10);
+	}
+	SECTION("single thread storage") {
+		const flex_vector<int, 2, single_thread_storage> v1{1, 2, 3, 4, 5};
+		flex_vector<int, 2, single_thread_storage> v2 = v1;
+
+		v2.set(0, 10);
+		v2.drop(1);
+
+		CHECK(v1[0] == 1);
+		CHECK(v2[0] == 2);
+		CHECK(&v1[4] == &v2[3]);
+	}
+}
+
+} // namespace
+} // namespace test
+} // namespace cow
@@ -0,0 +1,309 @@
+#include <cow/map.h>
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "tools/sequences.h"
+#include "tools/tracker.h"
+
+namespace cow {
+namespace test {
+namespace {
+
+// # tools
+// the keys with the same remainder have the same hash, so the map of them keeps the collision nodes
+struct colliding_hash {
+	std::size_t operator()(const int key) const noexcept
+	{
+		return static_cast<std::size_t>(key % 4);
+	}
+};
+
+using int_map = map<int, int>;
+using colliding_map = map<int, int, colliding_hash>;
+
+using tools::make_squares;
+using tools::make_std_squares;
+
+template<typename Map>
+std::map<int, int> to_std_map(const Map& m)
+{
+	std::map<int, int> result;
+	for (const auto& entry : m)
+		result.insert(entry);
+	return result;
+}
+
+// # tests
+TEST_CASE("Testing class map", "[map]") {
+	SECTION("default constructor") {
+		const int_map m;
+
+		CHECK(m.empty());
+		CHECK(m.size() == 0);
+		CHECK(m.begin() == m.end());
+		CHECK(m.find(0) == nullptr);
+	}
+	SECTION("constructors") {
+		const int_map m1{{1, 10}, {2, 20}, {1, 30}};
+		const std::map<int, int> source = make_std_squares(100);
+		const int_map m2(source.begin(), source.end());
+
+		CHECK(to_std_map(m1) == std::map<int, int>{{1, 10}, {2, 20}});
+		CHECK(to_std_map(m2) == source);
+	}
+	SECTION("set and lookup") {
+		const int_map m = make_squares<int_map>(1000);
+
+		REQUIRE(m.size() == 1000);
+		CHECK(to_std_map(m) == make_std_squares(1000));
+		CHECK(*m.find(30) == 900);
+		CHECK(m.at(999) == 999 * 999);
+		CHECK(m.count(5) == 1);
+		CHECK(m.contains(0));
+		CHECK_FALSE(m.contains(1000));
+		CHECK(m.find(-1) == nullptr);
+		CHECK_THROWS_AS(m.at(1000), std::out_of_range);
+	}
+	SECTION("insert does not replace value") {
+		int_map m{{1, 10}};
+
+		CHECK_FALSE(m.insert({1, 20}));
+		CHECK(m.insert({2, 20}));
+		CHECK_FALSE(m.set(2, 30));
+		CHECK(m.set(3, 30));
+
+		CHECK(to_std_map(m) == std::map<int, int>{{1, 10}, {2, 30}, {3, 30}});
+	}
+	SECTION("erase") {
+		int_map m = make_squares<int_map>(1000);
+		std::map<int, int> expected = make_std_squares(1000);
+
+		for (int i = 0; i < 1000; i += 3) {
+			CHECK(m.erase(i) == 1);
+			expected.erase(i);
+		}
+		CHECK(m.erase(0) == 0);
+		CHECK(m.erase(1000) == 0);
+
+		CHECK(m.size() == expected.size());
+		CHECK(to_std_map(m) == expected);
+
+		for (int i = 0; i != 1000; ++i)
+			m.erase(i);
+
+		CHECK(m.empty());
+		CHECK(m.begin() == m.end());
+	}
+	SECTION("copying shares the trie") {
+		const int_map m1 = make_squares<int_map>(100);
+		const int_map m2 = m1; // NOLINT(performance-unnecessary-copy-initialization)
+
+		CHECK(m1.shares_storage_with(m2));
+		CHECK(m1.find(50) == m2.find(50));
+		CHECK(m1 == m2);
+	}
+	SECTION("changing copy copies only the path to the entry") {
+		const int_map m1 = make_squares<int_map>(1000);
+		int_map m2 = m1;
+
+		m2.set(500, -1);
+
+		CHECK(*m1.find(500) == 500 * 500);
+		CHECK(*m2.find(500) == -1);
+		CHECK(m1.find(500) != m2.find(500));
+		int shared = 0;
+		for (int i = 0; i != 1000; ++i)
+			shared += m1.find(i) == m2.find(i) ? 1 : 0;
+		CHECK(shared > 900);
+		CHECK(m1 != m2);
+	}
+	SECTION("changing unique map does not copy") {
+		int_map m = make_squares<int_map>(100);
+		const int* const address = m.find(50);
+
+		*m.write(50) = -1;
+		m.modify(60, [](int& value) { value = -2; });
+
+		CHECK(m.find(50) == address);
+		CHECK(m.at(50) == -1);
+		CHECK(m.at(60) == -2);
+		CHECK_THROWS_AS(m.write(100), std::out_of_range);
+	}
+	SECTION("changing copy does not change original") {
+		const int_map m1 = make_squares<int_map>(100);
+		int_map m2 = m1;
+
+		m2.set(100, 1);
+		m2.erase(0);
+		m2.modify(1, [](int& value) { ++value; });
+
+		CHECK(to_std_map(m1) == make_std_squares(100));
+		CHECK(m2.size() == 100);
+		CHECK(m2.at(1) == 2);
+		CHECK_FALSE(m2.contains(0));
+	}
+	SECTION("modification without changes does not copy") {
+		const int_map m1 = make_squares<int_map>(100);
+		int_map m2 = m1;
+
+		m2.insert({1, 10});
+		m2.erase(100);
+
+		CHECK(m1.shares_storage_with(m2));
+	}
+	SECTION("order of insertions does not change equality") {
+		int_map m1;
+		int_map m2;
+		for (int i = 0; i != 500; ++i) {
+			m1.set(i, i);
+			m2.set(499 - i, 499 - i);
+		}
+		m1.set(1000, 0);
+		m1.erase(1000);
+
+		CHECK(m1 == m2);
+
+		m2.set(250, 0);
+
+		CHECK(m1 != m2);
+	}
+	SECTION("colliding keys") {
+		colliding_map m = make_squares<colliding_map>(100);
+		const colliding_map copy = m;
+
+		CHECK(to_std_map(m) == make_std_squares(100));
+
+		m.set(40, -1);
+		for (int i = 0; i < 100; i += 2)
+			m.erase(i);
+
+		CHECK(to_std_map(copy) == make_std_squares(100));
+		CHECK(m.size() == 50);
+		CHECK_FALSE(m.contains(40));
+		CHECK(m.at(41) == 41 * 41);
+		CHECK(m != copy);
+
+		colliding_map reversed;
+		for (int i = 99; i >= 0; --i)
+			reversed.set(i, i * i);
+
+		CHECK(reversed == copy);
+	}
+	SECTION("moving") {
+		int_map m1 = make_squares<int_map>(10);
+		int_map m2 = std::move(m1);
+
+		CHECK(m1.empty()); // NOLINT(bugprone-use-after-move)
+		CHECK(m2.size() == 10);
+
+		m1 = std::move(m2);
+
+		CHECK(m1.size() == 10);
+	}
+	SECTION("clear and swap") {
+		int_map m1 = make_squares<int_map>(10);
+		int_map m2;
+
+		swap(m1, m2);
+
+		CHECK(m1.empty());
+		CHECK(m2.size() == 10);
+
+		m2.clear();
+
+		CHECK(m2.empty());
+		CHECK(m2.find(1) == nullptr);
+	}
+	SECTION("changing copy copies only the entries of the node") {
+		map<int, tools::tracker, colliding_hash> m1;
+		for (int i = 0; i != 8; ++i)
+			m1.set(i, tools::tracker{i});
+		map<int, tools::tracker, colliding_hash> m2 = m1;
+
+		m2.modify(5, [](tools::tracker& value) { value = tools::tracker{50}; });
+
+		CHECK(m1.at(5).get_value() == 5);
+		CHECK(m2.at(5).get_value() == 50);
+		CHECK(m2.at(1).get_copy_generation() == m1.at(1).get_copy_generation() + 1);
+		CHECK(m2.at(2).get_copy_generation() == m1.at(2).get_copy_generation());
+	}
+	SECTION("map of strings") {
+		map<std::string, std::string> m1{{"a", "b"}};
+		map<std::string, std::string> m2 = m1;
+
+		m2.write("a")->append("c");
+
+		CHECK(m1.at("a") == "b");
+		CHECK(m2.at("a") == "bc");
+	}
+}
+
+TEST_CASE("Testing class map_transient", "[map]") {
+	SECTION("building map") {
+		int_map::transient_type t;
+		for (int i = 0; i != 1000; ++i)
+			t.insert({i, i * i});
+
+		CHECK(t.size() == 1000);
+		CHECK(*t.find(999) == 999 * 999);
+
+		const int_map m = t.persistent();
+
+		CHECK(t.empty());
+		CHECK(to_std_map(m) == make_std_squares(1000));
+	}
+	SECTION("transient does not change original") {
+		const int_map m1 = make_squares<int_map>(100);
+		int_map::transient_type t = m1.transient();
+
+		CHECK_FALSE(t.insert({1, 10}));
+		CHECK(t.set(100, 100 * 100));
+		CHECK(t.erase(0) == 1);
+		CHECK(t.erase(0) == 0);
+		t.modify(2, [](int& value) { value = -1; });
+
+		std::map<int, int> expected = make_std_squares(101);
+		expected.erase(0);
+		expected[2] = -1;
+		CHECK(to_std_map(t.persistent()) == expected);
+		CHECK(to_std_map(m1) == make_std_squares(100));
+	}
+	SECTION("moving map to transient") {
+		int_map m = make_squares<int_map>(10);
+		int_map::transient_type t = std::move(m).transient();
+
+		t.erase(9);
+
+		CHECK(to_std_map(t.persistent()) == make_std_squares(9));
+	}
+}
+
+TEST_CASE("Testing map storage policies", "[map]") {
+	SECTION("shared_ptr storage") {
+		const map<int, int, std::hash<int>, std::equal_to<int>, shared_ptr_storage> m1{{1, 1}, {2, 2}};
+		map<int, int, std::hash<int>, std::equal_to<int>, shared_ptr_storage> m2 = m1;
+
+		m2.set(1, 10);
+
+		CHECK(m1.at(1) == 1);
+		CHECK(m2.at(1) == 10);
+	}
+	SECTION("single thread storage") {
+		const map<int, int, std::hash<int>, std::equal_to<int>, single_thread_storage> m1{{1, 1}, {2, 2}};
+		map<int, int, std::hash<int>, std::equal_to<int>, single_thread_storage> m2 = m1;
+
+		m2.erase(1);
+
+		CHECK(m1.size() == 2);
+		CHECK(m2.size() == 1);
+		CHECK(m1.at(1) == 1);
+		CHECK(m2.at(2) == 2);
+	}
+}
+
+} // namespace
+} // namespace test
+} // namespace cow
@@ -24,39 +24,54 @@ using cow::test::tools::explicit_tracker_constructible_struct;
 using cow::test::tools::relation_only_int;
 
 // # tests
-using use_shared_storage_type = std::false_type;
-using use_inline_storage_type = std::true_type;
-
-#if __cpp_lib_optional
-#define STORAGE_TYPES use_shared_storage_type, use_inline_storage_type
-#else
-#define STORAGE_TYPES use_shared_storage_type
-#endif
+template<bool UseInlineStorage, typename Storage, bool ShareDerived>
+struct storage_type {
+	static constexpr bool use_inline_storage = UseInlineStorage;
+	using storage = Storage;
+	// true if the value of an optional for derived class is shared with optional for base class
+	static constexpr bool share_derived = ShareDerived;
+};
+
+using use_shared_ptr_storage_type = storage_type<false, shared_ptr_storage, true>;
+using use_intrusive_storage_type = storage_type<false, intrusive_storage, false>;
+using use_single_thread_storage_type = storage_type<false, single_thread_storage, false>;
+using use_biased_storage_type = storage_type<false, biased_storage, false>;
+using use_sharded_storage_type = storage_type<false, basic_sharded_storage<4>, false>;
+using use_padded_storage_type = storage_type<false, padded_storage, false>;
+using use_pooled_storage_type = storage_type<false, pooled_storage, false>;
+using use_inline_storage_type = storage_type<true, intrusive_storage, false>;
+
+#define SHARED_STORAGE_TYPES \
+	use_shared_ptr_storage_type, use_intrusive_storage_type, use_single_thread_storage_type, use_biased_storage_type, \
+		use_sharded_storage_type, use_padded_storage_type, use_pooled_storage_type
+
+#define STORAGE_TYPES SHARED_STORAGE_TYPES, use_inline_storage_type
 
 TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
-	constexpr bool use_inline_storage = TestType::value;
+	constexpr bool use_inline_storage = TestType::use_inline_storage;
+	using storage = typename TestType::storage;
 
 	// ## class optional methods
 	// ### constructors
 
 	SECTION("creating using default constructor") {
-		const optional<tracker, use_inline_storage> v;
+		const optional<tracker, use_inline_storage, storage> v;
 
 		CHECK_FALSE(v);
 	}
 	SECTION("creating using nullopt") {
-		const optional<tracker, use_inline_storage> v(nullopt);
+		const optional<tracker, use_inline_storage, storage> v(nullopt);
 
 		CHECK_FALSE(v);
 	}
 	SECTION("creating using emplace constructor without arguments") {
-		const optional<tracker, use_inline_storage> v{in_place};
+		const optional<tracker, use_inline_storage, storage> v{in_place};
 
 		REQUIRE(v);
 		CHECK(v->get_generation() == 0u);
 	}
 	SECTION("creating using emplace constructor with one argument") {
-		const optional<tracker, use_inline_storage> v{in_place, 707};
+		const optional<tracker, use_inline_storage, storage> v{in_place, 707};
 
 		REQUIRE(v);
 		CHECK(v->get_value() == 707);
@@ -73,38 +88,38 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 			int p2;
 		};
 
-		const optional<test_struct, use_inline_storage> v{in_place, -1, 1};
+		const optional<test_struct, use_inline_storage, storage> v{in_place, -1, 1};
 
 		REQUIRE(v);
 		CHECK(v->p1 == -1);
 		CHECK(v->p2 == 1);
 	}
 	SECTION("creating using emplace constructor with initializer list") {
-		const optional<std::vector<int>, use_inline_storage> v{in_place, {1, 2, 3}};
+		const optional<std::vector<int>, use_inline_storage, storage> v{in_place, {1, 2, 3}};
 
 		REQUIRE(v);
 		CHECK(*v == std::vector<int>{1, 2, 3});
 	}
 	SECTION("creating by value") {
-		const optional<int, use_inline_storage> v{51};
+		const optional<int, use_inline_storage, storage> v{51};
 
 		REQUIRE(v);
 		CHECK(*v == 51);
 	}
 	SECTION("creating using implicit convertible value") {
-		const auto f = [](const optional<implicit_tracker_constructible_struct, use_inline_storage>& v) {
+		const auto f = [](const optional<implicit_tracker_constructible_struct, use_inline_storage, storage>& v) {
 			CHECK(v);
 		};
 		f(tracker{});
 	}
 	SECTION("creating using explicit convertible value") {
-		const optional<explicit_tracker_constructible_struct, use_inline_storage> v{tracker{}};
+		const optional<explicit_tracker_constructible_struct, use_inline_storage, storage> v{tracker{}};
 
 		CHECK(v);
 	}
 	SECTION("creating using copy constructor") {
-		const optional<tracker, use_inline_storage> v1{in_place, 9};
-		const optional<tracker, use_inline_storage> v2{v1};
+		const optional<tracker, use_inline_storage, storage> v1{in_place, 9};
+		const optional<tracker, use_inline_storage, storage> v2{v1};
 
 		REQUIRE(v1);
 		CHECK(v1->get_value() == 9);
@@ -115,51 +130,27 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v2->get_generation() == (use_inline_storage ? 1u : 0u));
 	}
 	SECTION("creating using copy constructor by empty value") {
-		const optional<tracker, use_inline_storage> v1;
-		const optional<tracker, use_inline_storage> v2{v1};
+		const optional<tracker, use_inline_storage, storage> v1;
+		const optional<tracker, use_inline_storage, storage> v2{v1};
 
 		CHECK_FALSE(v1);
 		CHECK_FALSE(v2);
 	}
 	SECTION("creating using move constructor") {
-		const optional<tracker, use_inline_storage> v{optional<tracker, use_inline_storage>{in_place, 11}};
+		const optional<tracker, use_inline_storage, storage> v{optional<tracker, use_inline_storage, storage>{in_place, 11}};
 
 		REQUIRE(v);
 		CHECK(v->get_value() == 11);
 		CHECK(v->get_generation() == 0u);
 	}
 	SECTION("creating using move constructor by empty value") {
-		const optional<tracker, use_inline_storage> v{optional<tracker, use_inline_storage>{}};
+		const optional<tracker, use_inline_storage, storage> v{optional<tracker, use_inline_storage, storage>{}};
 
 		CHECK_FALSE(v);
 	}
-	SECTION("creating by optional for derived class") {
-		const optional<derived_tracker, use_inline_storage> v1{in_place, 100};
-
-		const auto f = [generation = use_inline_storage ? 1u : 0u](const optional<tracker, use_inline_storage>& v) {
-			REQUIRE(v);
-			CHECK(v->get_value() == 100);
-			CHECK(v->get_generation() == generation);
-		};
-		f(v1);
-
-		REQUIRE(v1);
-		CHECK(v1->get_value() == 100);
-		CHECK(v1->get_generation() == 0u);
-	}
-	SECTION("creating by empty optional for derived class") {
-		const optional<derived_tracker, use_inline_storage> v1;
-
-		const auto f = [](const optional<tracker, use_inline_storage>& v) {
-			CHECK_FALSE(v);
-		};
-		f(v1);
-
-		CHECK_FALSE(v1);
-	}
 	SECTION("creating by implicit convertible optional") {
-		const optional<tracker, use_inline_storage> v1{in_place};
-		const optional<implicit_tracker_constructible_struct, use_inline_storage> v2{v1};
+		const optional<tracker, use_inline_storage, storage> v1{in_place};
+		const optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v2{v1};
 
 		REQUIRE(v1);
 		CHECK(v1->get_generation() == 0u);
@@ -168,15 +159,15 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v2->tracker_object.get_move_generation() == 0u);
 	}
 	SECTION("creating by empty implicit convertible optional") {
-		const optional<tracker, use_inline_storage> v1;
-		const optional<implicit_tracker_constructible_struct, use_inline_storage> v2{v1};
+		const optional<tracker, use_inline_storage, storage> v1;
+		const optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v2{v1};
 
 		CHECK_FALSE(v1);
 		CHECK_FALSE(v2);
 	}
 	SECTION("creating by explicit convertible optional") {
-		const optional<tracker, use_inline_storage> v1{in_place};
-		const optional<explicit_tracker_constructible_struct, use_inline_storage> v2{v1};
+		const optional<tracker, use_inline_storage, storage> v1{in_place};
+		const optional<explicit_tracker_constructible_struct, use_inline_storage, storage> v2{v1};
 
 		REQUIRE(v1);
 		CHECK(v1->get_generation() == 0u);
@@ -185,57 +176,41 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v2->tracker_object.get_move_generation() == 0u);
 	}
 	SECTION("creating by empty explicit convertible optional") {
-		const optional<tracker, use_inline_storage> v1;
-		const optional<explicit_tracker_constructible_struct, use_inline_storage> v2{v1};
+		const optional<tracker, use_inline_storage, storage> v1;
+		const optional<explicit_tracker_constructible_struct, use_inline_storage, storage> v2{v1};
 
 		CHECK_FALSE(v1);
 		CHECK_FALSE(v2);
 	}
-	SECTION("creating by r-value to optional for derived class") {
-		const auto f = [generation = use_inline_storage ? 1u : 0u](const optional<tracker, use_inline_storage>& v) {
-			REQUIRE(v);
-			CHECK(v->get_value() == 100);
-			CHECK(v->get_copy_generation() == 0u);
-			CHECK(v->get_move_generation() == generation);
-		};
-		f(optional<derived_tracker, use_inline_storage>{in_place, 100});
-	}
-	SECTION("creating by r-value to empty optional for derived class") {
-		const auto f = [](const optional<tracker, use_inline_storage>& v) {
-			CHECK_FALSE(v);
-		};
-		f(optional<derived_tracker, use_inline_storage>{});
-	}
 	SECTION("creating by r-value to implicit convertible optional") {
-		const optional<implicit_tracker_constructible_struct, use_inline_storage> v{
-			optional<tracker, use_inline_storage>{in_place}};
+		const optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v{
+			optional<tracker, use_inline_storage, storage>{in_place}};
 
 		REQUIRE(v);
 		CHECK(v->tracker_object.get_generation() == 1u);
 	}
 	SECTION("creating by r-value to empty implicit convertible optional") {
-		const optional<implicit_tracker_constructible_struct, use_inline_storage> v{
-			optional<tracker, use_inline_storage>{}};
+		const optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v{
+			optional<tracker, use_inline_storage, storage>{}};
 
 		CHECK_FALSE(v);
 	}
 	SECTION("creating by r-value to explicit convertible optional") {
-		const optional<explicit_tracker_constructible_struct, use_inline_storage> v{
-			optional<tracker, use_inline_storage>{in_place}};
+		const optional<explicit_tracker_constructible_struct, use_inline_storage, storage> v{
+			optional<tracker, use_inline_storage, storage>{in_place}};
 
 		REQUIRE(v);
 		CHECK(v->tracker_object.get_generation() == 1u);
 	}
 	SECTION("creating by r-value to empty explicit convertible optional") {
-		const optional<explicit_tracker_constructible_struct, use_inline_storage> v{
-			optional<tracker, use_inline_storage>{}};
+		const optional<explicit_tracker_constructible_struct, use_inline_storage, storage> v{
+			optional<tracker, use_inline_storage, storage>{}};
 
 		CHECK_FALSE(v);
 	}
-#if __cpp_lib_optional
 	SECTION("creating by optional with different storage") {
-		const optional<tracker, !use_inline_storage> v1{in_place};
-		const optional<tracker, use_inline_storage> v2{v1};
+		const optional<tracker, !use_inline_storage, storage> v1{in_place};
+		const optional<tracker, use_inline_storage, storage> v2{v1};
 
 		REQUIRE(v1);
 		CHECK(v1->get_generation() == 0u);
@@ -243,42 +218,41 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v2->get_generation() <= 2u);
 	}
 	SECTION("creating by empty optional with different storage") {
-		const optional<tracker, !use_inline_storage> v1;
-		const optional<tracker, use_inline_storage> v2{v1};
+		const optional<tracker, !use_inline_storage, storage> v1;
+		const optional<tracker, use_inline_storage, storage> v2{v1};
 
 		CHECK_FALSE(v1);
 		CHECK_FALSE(v2);
 	}
 	SECTION("creating by r-value to empty optional with different storage") {
-		const optional<tracker, use_inline_storage> v{optional<tracker, !use_inline_storage>{in_place}};
+		const optional<tracker, use_inline_storage, storage> v{optional<tracker, !use_inline_storage, storage>{in_place}};
 
 		REQUIRE(v);
 		CHECK(v->get_generation() <= 2u);
 	}
 	SECTION("creating by r-value to empty optional with different storage") {
-		const optional<tracker, use_inline_storage> v{optional<tracker, !use_inline_storage>{}};
+		const optional<tracker, use_inline_storage, storage> v{optional<tracker, !use_inline_storage, storage>{}};
 
 		CHECK_FALSE(v);
 	}
-#endif
 
 	// ### assignments
 
 	SECTION("assigning nullopt") {
-		optional<int, use_inline_storage> v{in_place, 1970};
+		optional<int, use_inline_storage, storage> v{in_place, 1970};
 		v = nullopt;
 
 		CHECK_FALSE(v);
 	}
 	SECTION("assigning nullopt to empty optional") {
-		optional<int, use_inline_storage> v;
+		optional<int, use_inline_storage, storage> v;
 		v = nullopt;
 
 		CHECK_FALSE(v);
 	}
 	SECTION("assigning optional (copy assignment)") {
-		const optional<tracker, use_inline_storage> v1{in_place, 9};
-		optional<tracker, use_inline_storage> v2{in_place, 10};
+		const optional<tracker, use_inline_storage, storage> v1{in_place, 9};
+		optional<tracker, use_inline_storage, storage> v2{in_place, 10};
 		v2 = v1;
 
 		REQUIRE(v1);
@@ -291,8 +265,8 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v2->get_move_generation() == 0u);
 	}
 	SECTION("assigning optional to empty destination (copy assignment)") {
-		const optional<tracker, use_inline_storage> v1{in_place, 9};
-		optional<tracker, use_inline_storage> v2;
+		const optional<tracker, use_inline_storage, storage> v1{in_place, 9};
+		optional<tracker, use_inline_storage, storage> v2;
 		v2 = v1;
 
 		REQUIRE(v1);
@@ -305,8 +279,8 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v2->get_move_generation() == 0u);
 	}
 	SECTION("moving optional (move assignment)") {
-		optional<tracker, use_inline_storage> v{in_place, 12};
-		v = optional<tracker, use_inline_storage>{in_place, 11};
+		optional<tracker, use_inline_storage, storage> v{in_place, 12};
+		v = optional<tracker, use_inline_storage, storage>{in_place, 11};
 
 		REQUIRE(v);
 		CHECK(v->get_value() == 11);
@@ -314,14 +288,14 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v->get_move_generation() == (use_inline_storage ? 1u : 0u));
 	}
 	SECTION("moving empty optional (move assignment)") {
-		optional<tracker, use_inline_storage> v{in_place, 11};
-		v = optional<tracker, use_inline_storage>{};
+		optional<tracker, use_inline_storage, storage> v{in_place, 11};
+		v = optional<tracker, use_inline_storage, storage>{};
 
 		CHECK_FALSE(v);
 	}
 	SECTION("moving optional to empty destination (move assignment)") {
-		optional<tracker, use_inline_storage> v;
-		v = optional<tracker, use_inline_storage>{in_place, 11};
+		optional<tracker, use_inline_storage, storage> v;
+		v = optional<tracker, use_inline_storage, storage>{in_place, 11};
 
 		REQUIRE(v);
 		CHECK(v->get_value() == 11);
@@ -329,30 +303,30 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v->get_move_generation() == (use_inline_storage ? 1u : 0u));
 	}
 	SECTION("moving empty optional (move assignment)") {
-		const optional<tracker, use_inline_storage> v1;
-		optional<tracker, use_inline_storage> v2{in_place, 9};
+		const optional<tracker, use_inline_storage, storage> v1;
+		optional<tracker, use_inline_storage, storage> v2{in_place, 9};
 		v2 = v1;
 
 		CHECK_FALSE(v1);
 		CHECK_FALSE(v2);
 	}
 	SECTION("assigning value") {
-		optional<implicit_tracker_constructible_struct, use_inline_storage> v{in_place, tracker{}};
+		optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v{in_place, tracker{}};
 		v = tracker{51};
 
 		REQUIRE(v);
 		CHECK(v->tracker_object.get_value() == 51);
 	}
 	SECTION("assigning value to empty optional") {
-		optional<explicit_tracker_constructible_struct, use_inline_storage> v;
+		optional<explicit_tracker_constructible_struct, use_inline_storage, storage> v;
 		v = explicit_tracker_constructible_struct{tracker{51}};
 
 		REQUIRE(v);
 		CHECK(v->tracker_object.get_value() == 51);
 	}
 	SECTION("assigning value to first optional") {
-		optional<implicit_tracker_constructible_struct, use_inline_storage> v1{in_place, tracker{3}};
-		optional<implicit_tracker_constructible_struct, use_inline_storage> v2 = v1;
+		optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v1{in_place, tracker{3}};
+		optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v2 = v1;
 		v1 = tracker{51};
 
 		REQUIRE(v1);
@@ -360,45 +334,9 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		REQUIRE(v2);
 		CHECK(v2->tracker_object.get_value() == 3);
 	}
-	SECTION("assigning optional for derived class") {
-		const optional<derived_tracker, use_inline_storage> v1{in_place, 100};
-		optional<tracker, use_inline_storage> v2{in_place, 101};
-		v2 = v1;
-
-		REQUIRE(v1);
-		CHECK(v1->get_value() == 100);
-		CHECK(v1->get_generation() == 0u);
-
-		REQUIRE(v2);
-		CHECK(v2->get_value() == 100);
-		CHECK(v2->get_copy_generation() == (use_inline_storage ? 1u : 0u));
-		CHECK(v2->get_move_generation() == 0u);
-	}
-	SECTION("assigning optional for derived class to empty optional") {
-		const optional<derived_tracker, use_inline_storage> v1{in_place, 100};
-		optional<tracker, use_inline_storage> v2;
-		v2 = v1;
-
-		REQUIRE(v1);
-		CHECK(v1->get_value() == 100);
-		CHECK(v1->get_generation() == 0u);
-
-		REQUIRE(v2);
-		CHECK(v2->get_value() == 100);
-		CHECK(v2->get_copy_generation() == (use_inline_storage ? 1u : 0u));
-		CHECK(v2->get_move_generation() == 0u);
-	}
-	SECTION("assigning empty optional for derived class") {
-		const optional<derived_tracker, use_inline_storage> v1;
-		optional<tracker, use_inline_storage> v2{in_place, 101};
-		v2 = v1;
-
-		CHECK_FALSE(v1);
-		CHECK_FALSE(v2);
-	}
 	SECTION("assigning implicit convertible optional") {
-		const optional<tracker, use_inline_storage> v1{in_place, 100};
-		optional<implicit_tracker_constructible_struct, use_inline_storage> v2{tracker{101}};
+		const optional<tracker, use_inline_storage, storage> v1{in_place, 100};
+		optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v2{tracker{101}};
 		v2 = v1;
 
 		REQUIRE(v1);
@@ -411,8 +349,8 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v2->tracker_object.get_move_generation() == 0u);
 	}
 	SECTION("assigning implicit convertible optional to empty optional") {
-		const optional<tracker, use_inline_storage> v1{in_place, 100};
-		optional<implicit_tracker_constructible_struct, use_inline_storage> v2;
+		const optional<tracker, use_inline_storage, storage> v1{in_place, 100};
+		optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v2;
 		v2 = v1;
 
 		REQUIRE(v1);
@@ -425,63 +363,38 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v2->tracker_object.get_move_generation() == 0u);
 	}
 	SECTION("assigning empty implicit convertible optional") {
-		const optional<tracker, use_inline_storage> v1;
-		optional<implicit_tracker_constructible_struct, use_inline_storage> v2{tracker{101}};
+		const optional<tracker, use_inline_storage, storage> v1;
+		optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v2{tracker{101}};
 		v2 = v1;
 
 		CHECK_FALSE(v1);
 		CHECK_FALSE(v2);
 	}
-	SECTION("moving optional for derived class") {
-		optional<tracker, use_inline_storage> v{in_place, 101};
-		v = optional<derived_tracker, use_inline_storage>{in_place, 100};
-
-		REQUIRE(v);
-		CHECK(v->get_value() == 100);
-		CHECK(v->get_copy_generation() == 0u);
-		CHECK(v->get_move_generation() == (use_inline_storage ? 1u : 0u));
-	}
-	SECTION("moving optional for derived class to empty optional") {
-		optional<tracker, use_inline_storage> v;
-		v = optional<derived_tracker, use_inline_storage>{in_place, 100};
-
-		REQUIRE(v);
-		CHECK(v->get_value() == 100);
-		CHECK(v->get_copy_generation() == 0u);
-		CHECK(v->get_move_generation() == (use_inline_storage ? 1u : 0u));
-	}
-	SECTION("moving empty optional for derived class") {
-		optional<tracker, use_inline_storage> v{in_place, 101};
-		v = optional<derived_tracker, use_inline_storage>{};
-
-		CHECK_FALSE(v);
-	}
 	SECTION("moving implicit convertible optional") {
-		optional<implicit_tracker_constructible_struct, use_inline_storage> v{tracker{101}};
-		v = optional<tracker, use_inline_storage>{in_place, 100};
+		optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v{tracker{101}};
+		v = optional<tracker, use_inline_storage, storage>{in_place, 100};
 
 		REQUIRE(v);
 		CHECK(v->tracker_object.get_value() == 100);
 		CHECK(v->tracker_object.get_generation() == 1u);
 	}
 	SECTION("moving implicit convertible optional to empty optional") {
-		optional<implicit_tracker_constructible_struct, use_inline_storage> v;
-		v = optional<tracker, use_inline_storage>{in_place, 100};
+		optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v;
+		v = optional<tracker, use_inline_storage, storage>{in_place, 100};
 
 		REQUIRE(v);
 		CHECK(v->tracker_object.get_value() == 100);
 		CHECK(v->tracker_object.get_generation() == 1u);
 	}
 	SECTION("moving empty implicit convertible optional") {
-		optional<implicit_tracker_constructible_struct, use_inline_storage> v{tracker{101}};
-		v = optional<tracker, use_inline_storage>{};
+		optional<implicit_tracker_constructible_struct, use_inline_storage, storage> v{tracker{101}};
+		v = optional<tracker, use_inline_storage, storage>{};
 
 		CHECK_FALSE(v);
 	}
-#if __cpp_lib_optional
 	SECTION("assigning optional with different storage") {
-		const optional<tracker, !use_inline_storage> v1{in_place, 100};
-		optional<tracker, use_inline_storage> v2{tracker{101}};
+		const optional<tracker, !use_inline_storage, storage> v1{in_place, 100};
+		optional<tracker, use_inline_storage, storage> v2{tracker{101}};
 		v2 = v1;
 
 		REQUIRE(v1);
@@ -494,8 +407,8 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v2->get_move_generation() == 0u);
 	}
 	SECTION("assigning optional with different storage to empty optional") {
-		const optional<tracker, !use_inline_storage> v1{in_place, 100};
-		optional<tracker, use_inline_storage> v2;
+		const optional<tracker, !use_inline_storage, storage> v1{in_place, 100};
+		optional<tracker, use_inline_storage, storage> v2;
 		v2 = v1;
 
 		REQUIRE(v1);
@@ -508,42 +421,41 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v2->get_move_generation() == 0u);
 	}
 	SECTION("assigning empty optional with different storage") {
-		const optional<tracker, !use_inline_storage> v1;
-		optional<tracker, use_inline_storage> v2{tracker{101}};
+		const optional<tracker, !use_inline_storage, storage> v1;
+		optional<tracker, use_inline_storage, storage> v2{tracker{101}};
 		v2 = v1;
 
 		CHECK_FALSE(v1);
 		CHECK_FALSE(v2);
 	}
 	SECTION("moving optional with different storage") {
-		optional<tracker, use_inline_storage> v{tracker{101}};
-		v = optional<tracker, !use_inline_storage>{in_place, 100};
+		optional<tracker, use_inline_storage, storage> v{tracker{101}};
+		v = optional<tracker, !use_inline_storage, storage>{in_place, 100};
 
 		REQUIRE(v);
 		CHECK(v->get_value() == 100);
 		CHECK(v->get_generation() == 1u);
 	}
 	SECTION("moving optional with different storage to empty optional") {
-		optional<tracker, use_inline_storage> v;
-		v = optional<tracker, !use_inline_storage>{in_place, 100};
+		optional<tracker, use_inline_storage, storage> v;
+		v = optional<tracker, !use_inline_storage, storage>{in_place, 100};
 
 		REQUIRE(v);
 		CHECK(v->get_value() == 100);
 		CHECK(v->get_generation() == 1u);
 	}
 	SECTION("moving empty optional with different storage") {
-		optional<tracker, use_inline_storage> v{tracker{101}};
-		v = optional<tracker, !use_inline_storage>{};
+		optional<tracker, use_inline_storage, storage> v{tracker{101}};
+		v = optional<tracker, !use_inline_storage, storage>{};
 
 		CHECK_FALSE(v);
 	}
-#endif
 
 	// ### method swap
 
 	SECTION("swapping optional objects") {
-		optional<int, use_inline_storage> v1 = 1;
-		optional<int, use_inline_storage> v2 = 2;
+		optional<int, use_inline_storage, storage> v1 = 1;
+		optional<int, use_inline_storage, storage> v2 = 2;
 
 		v1.swap(v2);
 
@@ -556,50 +468,71 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// ### observers
 
 	SECTION("calling has_value() for non-empty optional object") {
-		const optional<int, use_inline_storage> v{0};
+		const optional<int, use_inline_storage, storage> v{0};
 
 		CHECK(v.has_value());
 	}
 	SECTION("calling has_value() for empty optional object") {
-		const optional<int, use_inline_storage> v;
+		const optional<int, use_inline_storage, storage> v;
 
 		CHECK_FALSE(v.has_value());
 	}
+	SECTION("calling shares_storage_with() for copy") {
+		const optional<tracker, use_inline_storage, storage> v1{in_place, 3};
+		const optional<tracker, use_inline_storage, storage> v2 = v1;
+
+		CHECK(v1.shares_storage_with(v2) == !use_inline_storage);
+	}
+	SECTION("calling shares_storage_with() for different values") {
+		const optional<tracker, use_inline_storage, storage> v1{in_place, 3};
+		const optional<tracker, use_inline_storage, storage> v2{in_place, 3};
+
+		CHECK_FALSE(v1.shares_storage_with(v2));
+	}
 	SECTION("calling value() for non-empty optional object") {
-		const optional<int, use_inline_storage> v{3};
+		const optional<int, use_inline_storage, storage> v{3};
 
 		CHECK(v.value() == 3);
 	}
 	SECTION("calling value() for empty optional object") {
-		const optional<int, use_inline_storage> v;
+		const optional<int, use_inline_storage, storage> v;
 
 		CHECK_THROWS_AS(v.value(), bad_optional_access);
 	}
 	SECTION("calling value() for r-value reference to optional object") {
-		optional<tracker, use_inline_storage> v{in_place};
+		optional<tracker, use_inline_storage, storage> v{in_place};
 
 		const tracker t = std::move(v).value();
 		CHECK(t.get_generation() == 1u);
 	}
+	SECTION("calling value() for r-value shared optional object") {
+		optional<tracker, use_inline_storage, storage> v1{in_place};
+		const optional<tracker, use_inline_storage, storage> v2 = v1;
+
+		const tracker t = std::move(v1).value();
+		CHECK(t.get_copy_generation() == (use_inline_storage ? 0u : 1u));
+		REQUIRE(v2);
+		CHECK(v2->get_generation() == (use_inline_storage ? 1u : 0u));
+	}
 	SECTION("calling value() for r-value empty optional object") {
-		optional<tracker, use_inline_storage> v;
+		optional<tracker, use_inline_storage, storage> v;
 
 		CHECK_THROWS_AS(std::move(v).value(), bad_optional_access);
 	}
 	SECTION("calling value() for const r-value optional object") {
-		const optional<tracker, use_inline_storage> v{in_place};
+		const optional<tracker, use_inline_storage, storage> v{in_place};
 
 		const tracker t = std::move(v).value();
 		CHECK(t.get_copy_generation() == 1u);
 		CHECK(t.get_move_generation() == 0u);
 	}
 	SECTION("calling value() for const r-value empty optional object") {
-		const optional<tracker, use_inline_storage> v;
+		const optional<tracker, use_inline_storage, storage> v;
 
 		CHECK_THROWS_AS(std::move(v).value(), bad_optional_access);
 	}
 	SECTION("calling value_or_data() for optional object") {
-		const optional<tracker, use_inline_storage> v{in_place, 3};
+		const optional<tracker, use_inline_storage, storage> v{in_place, 3};
 
 		const tracker t = v.value_or(tracker{1});
 		CHECK(t.get_copy_generation() == 1u);
@@ -607,7 +540,7 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(t.get_value() == 3);
 	}
 	SECTION("calling value_or_data() for empty optional object") {
-		optional<tracker, use_inline_storage> v;
+		optional<tracker, use_inline_storage, storage> v;
 
 		const tracker t = v.value_or(tracker{1});
 		CHECK(t.get_value() == 1);
@@ -615,14 +548,14 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(t.get_move_generation() == 1u);
 	}
 	SECTION("calling value_or_data() for r-value optional object") {
-		optional<tracker, use_inline_storage> v{in_place, 3};
+		optional<tracker, use_inline_storage, storage> v{in_place, 3};
 
 		const tracker t = std::move(v).value_or(tracker{1});
 		CHECK(t.get_generation() == 1u);
 		CHECK(t.get_value() == 3);
 	}
 	SECTION("calling value_or_data() for r-value empty optional object") {
-		optional<tracker, use_inline_storage> v;
+		optional<tracker, use_inline_storage, storage> v;
 
 		const tracker t = std::move(v).value_or(tracker{1});
 		CHECK(t.get_value() == 1);
@@ -630,8 +563,8 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(t.get_move_generation() == 1u);
 	}
 	SECTION("calling value_or_data() for second r-value optional object") {
-		optional<tracker, use_inline_storage> v1{in_place, 3};
-		optional<tracker, use_inline_storage> v2 = v1;
+		optional<tracker, use_inline_storage, storage> v1{in_place, 3};
+		optional<tracker, use_inline_storage, storage> v2 = v1;
 
 		const tracker t = std::move(v2).value_or(tracker{1});
 		CHECK(t.get_generation() == (use_inline_storage ? 2u : 1u));
@@ -640,14 +573,188 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 
 	// ### modifiers
 
+	SECTION("calling write() for non-empty optional") {
+		optional<tracker, use_inline_storage, storage> v{in_place, 3};
+		const tracker* const address = &*v;
+		{
+			const write_session<tracker> w = v.write();
+			*w = tracker{5};
+			CHECK(&*w == address);
+		}
+
+		REQUIRE(v);
+		CHECK(v->get_value() == 5);
+	}
+	SECTION("calling write() for empty optional") {
+		optional<tracker, use_inline_storage, storage> v;
+
+		CHECK_THROWS_AS(v.write(), bad_optional_access);
+	}
+	SECTION("calling write() for shared optional") {
+		optional<tracker, use_inline_storage, storage> v1{in_place, 3};
+		const optional<tracker, use_inline_storage, storage> v2 = v1;
+		{
+			const write_session<tracker> w = v1.write();
+			*w = tracker{5};
+			w.get() = tracker{w->get_value() + 1};
+		}
+
+		REQUIRE(v1);
+		CHECK(v1->get_value() == 6);
+		REQUIRE(v2);
+		CHECK(v2->get_value() == 3);
+		CHECK(&*v1 != &*v2);
+	}
+	SECTION("calling modify() for non-empty optional") {
+		optional<tracker, use_inline_storage, storage> v{in_place, 3};
+		const tracker* const address = &*v;
+		const int result = v.modify([](tracker& t) {
+			t = tracker{t.get_value() + 2};
+			return t.get_value();
+		});
+
+		CHECK(result == 5);
+		REQUIRE(v);
+		CHECK(v->get_value() == 5);
+		CHECK(&*v == address);
+	}
+	SECTION("calling modify() for shared optional") {
+		optional<tracker, use_inline_storage, storage> v1{in_place, 3};
+		const optional<tracker, use_inline_storage, storage> v2 = v1;
+		v1.modify([](tracker& t) { t = tracker{t.get_value() + 2}; });
+
+		REQUIRE(v1);
+		CHECK(v1->get_value() == 5);
+		REQUIRE(v2);
+		CHECK(v2->get_value() == 3);
+	}
+	SECTION("calling modify() for empty optional") {
+		optional<tracker, use_inline_storage, storage> v;
+
+		CHECK_THROWS_AS(v.modify([](tracker&) {}), bad_optional_access);
+	}
+	SECTION("calling transform_inplace() for non-empty optional") {
+		optional<tracker, use_inline_storage, storage> v{in_place, 3};
+		v.transform_inplace([](tracker&& t) {
+			CHECK(t.get_copy_generation() == 0u);
+			return tracker{t.get_value() + 2};
+		});
+
+		REQUIRE(v);
+		CHECK(v->get_value() == 5);
+	}
+	SECTION("calling transform_inplace() for shared optional") {
+		optional<tracker, use_inline_storage, storage> v1{in_place, 3};
+		const optional<tracker, use_inline_storage, storage> v2 = v1;
+		v1.transform_inplace([generation = use_inline_storage ? 0u : 1u](tracker&& t) {
+			CHECK(t.get_copy_generation() == generation);
+			return tracker{t.get_value() + 2};
+		});
+
+		REQUIRE(v1);
+		CHECK(v1->get_value() == 5);
+		REQUIRE(v2);
+		CHECK(v2->get_value() == 3);
+	}
+	SECTION("calling transform_inplace() for empty optional") {
+		optional<tracker, use_inline_storage, storage> v;
+		v.transform_inplace([](tracker&& t) { return t; });
+
+		CHECK_FALSE(v);
+	}
+	SECTION("calling take() for non-empty optional") {
+		optional<tracker, use_inline_storage, storage> v{in_place, 3};
+		const tracker t = v.take();
+
+		CHECK_FALSE(v);
+		CHECK(t.get_value() == 3);
+		CHECK(t.get_copy_generation() == 0u);
+	}
+	SECTION("calling take() for shared optional") {
+		optional<tracker, use_inline_storage, storage> v1{in_place, 3};
+		const optional<tracker, use_inline_storage, storage> v2 = v1;
+		const tracker t = v1.take();
+
+		CHECK_FALSE(v1);
+		CHECK(t.get_value() == 3);
+		CHECK(t.get_copy_generation() == (use_inline_storage ? 0u : 1u));
+		REQUIRE(v2);
+		CHECK(v2->get_value() == 3);
+	}
+	SECTION("calling take() for empty optional") {
+		optional<tracker, use_inline_storage, storage> v;
+
+		CHECK_THROWS_AS(v.take(), bad_optional_access);
+	}
+#if __cpp_lib_optional
+	SECTION("calling release() for non-empty optional") {
+		optional<tracker, use_inline_storage, storage> v{in_place, 3};
+		const std::optional<tracker> t = v.release();
+
+		CHECK_FALSE(v);
+		REQUIRE(t);
+		CHECK(t->get_value() == 3);
+		CHECK(t->get_copy_generation() == 0u);
+	}
+	SECTION("calling release() for shared optional") {
+		optional<tracker, use_inline_storage, storage> v1{in_place, 3};
+		const optional<tracker, use_inline_storage, storage> v2 = v1;
+		const std::optional<tracker> t = v1.release();
+
+		CHECK_FALSE(v1);
+		REQUIRE(t);
+		CHECK(t->get_copy_generation() == (use_inline_storage ? 0u : 1u));
+		REQUIRE(v2);
+		CHECK(v2->get_value() == 3);
+	}
+	SECTION("calling release() for empty optional") {
+		optional<tracker, use_inline_storage, storage> v;
+
+		CHECK_FALSE(v.release());
+	}
+#endif
+	SECTION("calling emplace() for non-empty optional") {
+		optional<tracker, use_inline_storage, storage> v{in_place, 3};
+		const tracker& t = v.emplace(5);
+
+		REQUIRE(v);
+		CHECK(&t == &*v);
+		CHECK(v->get_value() == 5);
+		CHECK(v->get_generation() == 0u);
+	}
+	SECTION("calling emplace() for empty optional") {
+		optional<tracker, use_inline_storage, storage> v;
+		v.emplace(5);
+
+		REQUIRE(v);
+		CHECK(v->get_value() == 5);
+		CHECK(v->get_generation() == 0u);
+	}
+	SECTION("calling emplace() for shared optional") {
+		optional<tracker, use_inline_storage, storage> v1{in_place, 3};
+		const optional<tracker, use_inline_storage, storage> v2 = v1;
+		v1.emplace(5);
+
+		REQUIRE(v1);
+		CHECK(v1->get_value() == 5);
+		REQUIRE(v2);
+		CHECK(v2->get_value() == 3);
+	}
+	SECTION("calling emplace() with initializer list") {
+		optional<std::vector<int>, use_inline_storage, storage> v{in_place, {1, 2}};
+		v.emplace({3, 4, 5});
+
+		REQUIRE(v);
+		CHECK(*v == std::vector<int>{3, 4, 5});
+	}
 	SECTION("calling reset() for non-empty cow-optional") {
-		optional<tracker, use_inline_storage> v{3};
+		optional<tracker, use_inline_storage, storage> v{3};
 		v.reset();
 
 		CHECK_FALSE(v);
 	}
 	SECTION("calling reset() for empty cow-optional") {
-		optional<tracker, use_inline_storage> v;
+		optional<tracker, use_inline_storage, storage> v;
 		v.reset();
 
 		CHECK_FALSE(v);
@@ -658,38 +765,38 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator==
 
 	SECTION("calling operator==(empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(lhs == rhs);
 	}
 	SECTION("calling operator==(empty, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK_FALSE(lhs == rhs);
 	}
 	SECTION("calling operator==(non-empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(lhs == rhs);
 	}
 	SECTION("calling operator==(eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(lhs == rhs);
 	}
 	SECTION("calling operator==(lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK_FALSE(lhs == rhs);
 	}
 	SECTION("calling operator==(gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(lhs == rhs);
 	}
@@ -697,38 +804,38 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator!=
 
 	SECTION("calling operator!=(empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(lhs != rhs);
 	}
 	SECTION("calling operator!=(empty, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK(lhs != rhs);
 	}
 	SECTION("calling operator!=(non-empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(lhs != rhs);
 	}
 	SECTION("calling operator!=(eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(lhs != rhs);
 	}
 	SECTION("calling operator!=(lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK(lhs != rhs);
 	}
 	SECTION("calling operator!=(gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(lhs != rhs);
 	}
@@ -736,38 +843,38 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator<
 
 	SECTION("calling operator<(empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(lhs < rhs);
 	}
 	SECTION("calling operator<(empty, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK(lhs < rhs);
 	}
 	SECTION("calling operator<(non-empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(lhs < rhs);
 	}
 	SECTION("calling operator<(eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(lhs < rhs);
 	}
 	SECTION("calling operator<(lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK(lhs < rhs);
 	}
 	SECTION("calling operator<(gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(lhs < rhs);
 	}
@@ -775,38 +882,38 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator>
 
 	SECTION("calling operator>(empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(lhs > rhs);
 	}
 	SECTION("calling operator>(empty, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK_FALSE(lhs > rhs);
 	}
 	SECTION("calling operator>(non-empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(lhs > rhs);
 	}
 	SECTION("calling operator>(eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(lhs > rhs);
 	}
 	SECTION("calling operator>(lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK_FALSE(lhs > rhs);
 	}
 	SECTION("calling operator>(gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(lhs > rhs);
 	}
@@ -814,38 +921,38 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator<=
 
 	SECTION("calling operator<=(empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(lhs <= rhs);
 	}
 	SECTION("calling operator<=(empty, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK(lhs <= rhs);
 	}
 	SECTION("calling operator<=(non-empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(lhs <= rhs);
 	}
 	SECTION("calling operator<=(eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(lhs <= rhs);
 	}
 	SECTION("calling operator<=(lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK(lhs <= rhs);
 	}
 	SECTION("calling operator<=(gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(lhs <= rhs);
 	}
@@ -853,44 +960,44 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator>=
 
 	SECTION("calling operator>=(empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(lhs >= rhs);
 	}
 	SECTION("calling operator>=(empty, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK_FALSE(lhs >= rhs);
 	}
 	SECTION("calling operator>=(non-empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(lhs >= rhs);
 	}
 	SECTION("calling operator>=(non-empty, empty)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(lhs >= rhs);
 	}
 	SECTION("calling operator>=(eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(lhs >= rhs);
 	}
 	SECTION("calling operator>=(lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK_FALSE(lhs >= rhs);
 	}
 	SECTION("calling operator>=(gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(lhs >= rhs);
 	}
@@ -898,22 +1005,22 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator== with nullopt
 
 	SECTION("calling operator==(empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK(lhs == nullopt);
 	}
 	SECTION("calling operator==(nullopt, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(nullopt == rhs);
 	}
 	SECTION("calling operator==(non-empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
 
 		CHECK_FALSE(lhs == nullopt);
 	}
 	SECTION("calling operator==(nullopt, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK_FALSE(nullopt == rhs);
 	}
@@ -921,22 +1028,22 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator!= with nullopt
 
 	SECTION("calling operator!=(empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK_FALSE(lhs != nullopt);
 	}
 	SECTION("calling operator!=(nullopt, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(nullopt != rhs);
 	}
 	SECTION("calling operator!=(non-empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
 
 		CHECK(lhs != nullopt);
 	}
 	SECTION("calling operator!=(nullopt, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK(nullopt != rhs);
 	}
@@ -944,22 +1051,22 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator< with nullopt
 
 	SECTION("calling operator<(empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK_FALSE(lhs < nullopt);
 	}
 	SECTION("calling operator<(nullopt, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(nullopt < rhs);
 	}
 	SECTION("calling operator<(non-empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
 
 		CHECK_FALSE(lhs < nullopt);
 	}
 	SECTION("calling operator<(nullopt, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK(nullopt < rhs);
 	}
@@ -967,22 +1074,22 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator<= with nullopt
 
 	SECTION("calling operator<=(empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK(lhs <= nullopt);
 	}
 	SECTION("calling operator<=(nullopt, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(nullopt <= rhs);
 	}
 	SECTION("calling operator<=(non-empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
 
 		CHECK_FALSE(lhs <= nullopt);
 	}
 	SECTION("calling operator<=(nullopt, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK(nullopt <= rhs);
 	}
@@ -990,22 +1097,22 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator> with nullopt
 
 	SECTION("calling operator>(empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK_FALSE(lhs > nullopt);
 	}
 	SECTION("calling operator>(nullopt, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(nullopt > rhs);
 	}
 	SECTION("calling operator>(non-empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
 
 		CHECK(lhs > nullopt);
 	}
 	SECTION("calling operator>(nullopt, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK_FALSE(nullopt > rhs);
 	}
@@ -1013,22 +1120,22 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator>= with nullopt
 
 	SECTION("calling operator>=(empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK(lhs >= nullopt);
 	}
 	SECTION("calling operator>=(nullopt, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(nullopt >= rhs);
 	}
 	SECTION("calling operator>=(non-empty, nullopt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{0};
 
 		CHECK(lhs >= nullopt);
 	}
 	SECTION("calling operator>=(nullopt, non-empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs{0};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{0};
 
 		CHECK_FALSE(nullopt >= rhs);
 	}
@@ -1036,42 +1143,42 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator== with value
 
 	SECTION("calling operator==(empty, value)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK_FALSE(lhs == relation_only_int{0});
 	}
 	SECTION("calling operator==(value, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(relation_only_int{0} == rhs);
 	}
 	SECTION("calling operator==(eq, value_eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK(lhs == relation_only_int{1});
 	}
 	SECTION("calling operator==(value_eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(relation_only_int{1} == rhs);
 	}
 	SECTION("calling operator==(lt, value_gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK_FALSE(lhs == relation_only_int{2});
 	}
 	SECTION("calling operator==(value_gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(relation_only_int{2} == rhs);
 	}
 	SECTION("calling operator==(gt, value_lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
 
 		CHECK_FALSE(lhs == relation_only_int{1});
 	}
 	SECTION("calling operator==(value_lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK_FALSE(relation_only_int{1} == rhs);
 	}
@@ -1079,42 +1186,42 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator!= with value
 
 	SECTION("calling operator!=(empty, value)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK(lhs != relation_only_int{0});
 	}
 	SECTION("calling operator!=(value, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(relation_only_int{0} != rhs);
 	}
 	SECTION("calling operator!=(eq, value_eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK_FALSE(lhs != relation_only_int{1});
 	}
 	SECTION("calling operator!=(value_eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(relation_only_int{1} != rhs);
 	}
 	SECTION("calling operator!=(lt, value_gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK(lhs != relation_only_int{2});
 	}
 	SECTION("calling operator!=(value_gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(relation_only_int{2} != rhs);
 	}
 	SECTION("calling operator!=(gt, value_lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
 
 		CHECK(lhs != relation_only_int{1});
 	}
 	SECTION("calling operator!=(value_lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK(relation_only_int{1} != rhs);
 	}
@@ -1122,42 +1229,42 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator< with value
 
 	SECTION("calling operator<(empty, value)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK(lhs < relation_only_int{0});
 	}
 	SECTION("calling operator<(value, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(relation_only_int{0} < rhs);
 	}
 	SECTION("calling operator<(eq, value_eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK_FALSE(lhs < relation_only_int{1});
 	}
 	SECTION("calling operator<(value_eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(relation_only_int{1} < rhs);
 	}
 	SECTION("calling operator<(lt, value_gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK(lhs < relation_only_int{2});
 	}
 	SECTION("calling operator<(value_gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(relation_only_int{2} < rhs);
 	}
 	SECTION("calling operator<(gt, value_lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
 
 		CHECK_FALSE(lhs < relation_only_int{1});
 	}
 	SECTION("calling operator<(value_lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK(relation_only_int{1} < rhs);
 	}
@@ -1165,42 +1272,42 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator<= with value
 
 	SECTION("calling operator<=(empty, value)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK(lhs <= relation_only_int{0});
 	}
 	SECTION("calling operator<=(value, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK_FALSE(relation_only_int{0} <= rhs);
 	}
 	SECTION("calling operator<=(eq, value_eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK(lhs <= relation_only_int{1});
 	}
 	SECTION("calling operator<=(value_eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(relation_only_int{1} <= rhs);
 	}
 	SECTION("calling operator<=(lt, value_gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK(lhs <= relation_only_int{2});
 	}
 	SECTION("calling operator<=(value_gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(relation_only_int{2} <= rhs);
 	}
 	SECTION("calling operator<=(gt, value_lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
 
 		CHECK_FALSE(lhs <= relation_only_int{1});
 	}
 	SECTION("calling operator<=(value_lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK(relation_only_int{1} <= rhs);
 	}
@@ -1208,42 +1315,42 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator> with value
 
 	SECTION("calling operator>(empty, value)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK_FALSE(lhs > relation_only_int{0});
 	}
 	SECTION("calling operator>(value, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(relation_only_int{0} > rhs);
 	}
 	SECTION("calling operator>(eq, value_eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK_FALSE(lhs > relation_only_int{1});
 	}
 	SECTION("calling operator>(value_eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK_FALSE(relation_only_int{1} > rhs);
 	}
 	SECTION("calling operator>(lt, value_gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK_FALSE(lhs > relation_only_int{2});
 	}
 	SECTION("calling operator>(value_gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(relation_only_int{2} > rhs);
 	}
 	SECTION("calling operator>(gt, value_lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
 
 		CHECK(lhs > relation_only_int{1});
 	}
 	SECTION("calling operator>(value_lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK_FALSE(relation_only_int{1} > rhs);
 	}
@@ -1251,42 +1358,42 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// #### operator>= with value
 
 	SECTION("calling operator>=(empty, value)") {
-		const optional<relation_only_int, use_inline_storage> lhs;
+		const optional<relation_only_int, use_inline_storage, storage> lhs;
 
 		CHECK_FALSE(lhs >= relation_only_int{0});
 	}
 	SECTION("calling operator>=(value, empty)") {
-		const optional<relation_only_int, use_inline_storage> rhs;
+		const optional<relation_only_int, use_inline_storage, storage> rhs;
 
 		CHECK(relation_only_int{0} >= rhs);
 	}
 	SECTION("calling operator>=(eq, value_eq)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK(lhs >= relation_only_int{1});
 	}
 	SECTION("calling operator>=(value_eq, eq)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(relation_only_int{1} >= rhs);
 	}
 	SECTION("calling operator>=(lt, value_gt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{1};
 
 		CHECK_FALSE(lhs >= relation_only_int{2});
 	}
 	SECTION("calling operator>=(value_gt, lt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{1};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{1};
 
 		CHECK(relation_only_int{2} >= rhs);
 	}
 	SECTION("calling operator>=(gt, value_lt)") {
-		const optional<relation_only_int, use_inline_storage> lhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> lhs{2};
 
 		CHECK(lhs >= relation_only_int{1});
 	}
 	SECTION("calling operator>=(value_lt, gt)") {
-		const optional<relation_only_int, use_inline_storage> rhs{2};
+		const optional<relation_only_int, use_inline_storage, storage> rhs{2};
 
 		CHECK_FALSE(relation_only_int{1} >= rhs);
 	}
@@ -1294,8 +1401,8 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 	// ### specialized algorithms
 
 	SECTION("calling swap(optional, optional)") {
-		optional<tracker, use_inline_storage> v1{1};
-		optional<tracker, use_inline_storage> v2{2};
+		optional<tracker, use_inline_storage, storage> v1{1};
+		optional<tracker, use_inline_storage, storage> v2{2};
 
 		swap(v1, v2);
 
@@ -1305,7 +1412,8 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 		CHECK(v2->get_value() == 1);
 	}
 	SECTION("calling make_optional(value)") {
-		const optional<tracker, use_inline_storage> v = make_optional<tracker, use_inline_storage>(tracker{3});
+		const optional<tracker, use_inline_storage, storage> v =
+			make_optional<tracker, use_inline_storage, storage>(tracker{3});
 
 		REQUIRE(v);
 		CHECK(v->get_value() == 3);
@@ -1321,36 +1429,297 @@ TEMPLATE_TEST_CASE("Testing class optional", "[optional]", STORAGE_TYPES) {
 			int p2;
 		};
 
-		const optional<test_struct, use_inline_storage> v =
-			make_optional<test_struct, use_inline_storage>(-1, 1);
+		const optional<test_struct, use_inline_storage, storage> v =
+			make_optional<test_struct, use_inline_storage, storage>(-1, 1);
 
 		REQUIRE(v);
 		CHECK(v->p1 == -1);
 		CHECK(v->p2 == 1);
 	}
 	SECTION("calling make_optional<value_type>(initializer_list)") {
-		const optional<std::vector<int>, use_inline_storage> v =
-			make_optional<std::vector<int>, use_inline_storage>({1, 2, 3});
+		const optional<std::vector<int>, use_inline_storage, storage> v =
+			make_optional<std::vector<int>, use_inline_storage, storage>({1, 2, 3});
 
 		REQUIRE(v);
 		CHECK(*v == std::vector<int>{1, 2, 3});
 	}
 	SECTION("calling hash(nullopt)") {
-		const std::hash<optional<int, use_inline_storage>> hash;
+		const std::hash<optional<int, use_inline_storage, storage>> hash;
 
 		CHECK(hash(nullopt) == 0);
 	}
 	SECTION("calling hash(optional)") {
-		using optional_type = optional<int, use_inline_storage>;
+		using optional_type = optional<int, use_inline_storage, storage>;
 		const std::hash<optional_type> hash;
 
 		CHECK(hash(optional_type{546}) != 0);
 	}
 }
 
+// ## conversion of optional for derived class
+
+// only shared_ptr storage shares the derived value, inline storage copies it like std::optional
+TEMPLATE_TEST_CASE(
+	"Testing conversion of optional for derived class", "[optional]", use_shared_ptr_storage_type,
+	use_inline_storage_type) {
+	constexpr bool use_inline_storage = TestType::use_inline_storage;
+	using storage = typename TestType::storage;
+	constexpr unsigned derived_generation = TestType::share_derived ? 0u : 1u;
+
+	SECTION("creating by optional for derived class") {
+		const optional<derived_tracker, use_inline_storage, storage> v1{in_place, 100};
+
+		const auto f = [generation = derived_generation](const optional<tracker, use_inline_storage, storage>& v) {
+			REQUIRE(v);
+			CHECK(v->get_value() == 100);
+			CHECK(v->get_generation() == generation);
+		};
+		f(v1);
+
+		REQUIRE(v1);
+		CHECK(v1->get_value() == 100);
+		CHECK(v1->get_generation() == 0u);
+	}
+	SECTION("creating by empty optional for derived class") {
+		const optional<derived_tracker, use_inline_storage, storage> v1;
+
+		const auto f = [](const optional<tracker, use_inline_storage, storage>& v) {
+			CHECK_FALSE(v);
+		};
+		f(v1);
+
+		CHECK_FALSE(v1);
+	}
+	SECTION("creating by r-value to optional for derived class") {
+		const auto f = [generation = derived_generation](const optional<tracker, use_inline_storage, storage>& v) {
+			REQUIRE(v);
+			CHECK(v->get_value() == 100);
+			CHECK(v->get_copy_generation() == 0u);
+			CHECK(v->get_move_generation() == generation);
+		};
+		f(optional<derived_tracker, use_inline_storage, storage>{in_place, 100});
+	}
+	SECTION("creating by r-value to empty optional for derived class") {
+		const auto f = [](const optional<tracker, use_inline_storage, storage>& v) {
+			CHECK_FALSE(v);
+		};
+		f(optional<derived_tracker, use_inline_storage, storage>{});
+	}
+	SECTION("assigning optional for derived class") {
+		const optional<derived_tracker, use_inline_storage, storage> v1{in_place, 100};
+		optional<tracker, use_inline_storage, storage> v2{in_place, 101};
+		v2 = v1;
+
+		REQUIRE(v1);
+		CHECK(v1->get_value() == 100);
+		CHECK(v1->get_generation() == 0u);
+
+		REQUIRE(v2);
+		CHECK(v2->get_value() == 100);
+		CHECK(v2->get_copy_generation() == derived_generation);
+		CHECK(v2->get_move_generation() == 0u);
+	}
+	SECTION("assigning optional for derived class to empty optional") {
+		const optional<derived_tracker, use_inline_storage, storage> v1{in_place, 100};
+		optional<tracker, use_inline_storage, storage> v2;
+		v2 = v1;
+
+		REQUIRE(v1);
+		CHECK(v1->get_value() == 100);
+		CHECK(v1->get_generation() == 0u);
+
+		REQUIRE(v2);
+		CHECK(v2->get_value() == 100);
+		CHECK(v2->get_copy_generation() == derived_generation);
+		CHECK(v2->get_move_generation() == 0u);
+	}
+	SECTION("assigning empty optional for derived class") {
+		const optional<derived_tracker, use_inline_storage, storage> v1;
+		optional<tracker, use_inline_storage, storage> v2{in_place, 101};
+		v2 = v1;
+
+		CHECK_FALSE(v1);
+		CHECK_FALSE(v2);
+	}
+	SECTION("moving optional for derived class") {
+		optional<tracker, use_inline_storage, storage> v{in_place, 101};
+		v = optional<derived_tracker, use_inline_storage, storage>{in_place, 100};
+
+		REQUIRE(v);
+		CHECK(v->get_value() == 100);
+		CHECK(v->get_copy_generation() == 0u);
+		CHECK(v->get_move_generation() == derived_generation);
+	}
+	SECTION("moving optional for derived class to empty optional") {
+		optional<tracker, use_inline_storage, storage> v;
+		v = optional<derived_tracker, use_inline_storage, storage>{in_place, 100};
+
+		REQUIRE(v);
+		CHECK(v->get_value() == 100);
+		CHECK(v->get_copy_generation() == 0u);
+		CHECK(v->get_move_generation() == derived_generation);
+	}
+	SECTION("moving empty optional for derived class") {
+		optional<tracker, use_inline_storage, storage> v{in_place, 101};
+		v = optional<derived_tracker, use_inline_storage, storage>{};
+
+		CHECK_FALSE(v);
+	}
+}
+
+// the storages which cannot share the value of the derived class do not convert it, the copy would slice it
+TEMPLATE_TEST_CASE("Testing optional for derived class with shared storages", "[optional]", SHARED_STORAGE_TYPES) {
+	using storage = typename TestType::storage;
+	using base_optional = optional<tracker, false, storage>;
+	using derived_optional = optional<derived_tracker, false, storage>;
+	constexpr bool share_derived = TestType::share_derived;
+
+	SECTION("creating by optional for derived class") {
+		CHECK(std::is_constructible<base_optional, const derived_optional&>::value == share_derived);
+		CHECK(std::is_convertible<const derived_optional&, base_optional>::value == share_derived);
+	}
+	SECTION("creating by r-value to optional for derived class") {
+		CHECK(std::is_constructible<base_optional, derived_optional&&>::value == share_derived);
+		CHECK(std::is_convertible<derived_optional&&, base_optional>::value == share_derived);
+	}
+	SECTION("assigning optional for derived class") {
+		CHECK(std::is_assignable<base_optional&, const derived_optional&>::value == share_derived);
+		CHECK(std::is_assignable<base_optional&, derived_optional&&>::value == share_derived);
+	}
+	SECTION("creating by optional for same class with different storage policy") {
+		CHECK(std::is_convertible<const optional<tracker, false, shared_ptr_storage>&, base_optional>::value);
+	}
+}
+
+// ## storage policies
+
+TEST_CASE("Testing storage policies", "[optional]") {
+	SECTION("size of optional with intrusive storage") {
+		CHECK(sizeof(optional<tracker, false, intrusive_storage>) == sizeof(void*));
+	}
+	SECTION("size of optional with shared_ptr storage") {
+		CHECK(sizeof(optional<tracker, false, shared_ptr_storage>) == sizeof(std::shared_ptr<tracker>));
+	}
+	SECTION("size of optional with single thread storage") {
+		CHECK(sizeof(optional<tracker, false, single_thread_storage>) == sizeof(void*));
+	}
+	SECTION("size of optional with padded storage") {
+		CHECK(sizeof(optional<tracker, false, padded_storage>) == sizeof(void*));
+	}
+	SECTION("size of optional with inline storage") {
+		CHECK(sizeof(optional<int, true>) == 2 * sizeof(int));
+	}
+	SECTION("optional with inline storage of trivially copyable type is trivially copyable") {
+		CHECK(std::is_trivially_copy_constructible<optional<int, true>>::value);
+		CHECK(std::is_trivially_copy_assignable<optional<int, true>>::value);
+		CHECK(std::is_trivially_destructible<optional<int, true>>::value);
+	}
+	SECTION("creating by optional with different storage policy") {
+		const optional<tracker, false, intrusive_storage> v1{in_place, 5};
+		const optional<tracker, false, single_thread_storage> v2 = v1;
+
+		REQUIRE(v2);
+		CHECK(v2->get_value() == 5);
+		CHECK(v2->get_copy_generation() == 1u);
+	}
+	SECTION("intrusive storage is used by default") {
+		CHECK(std::is_same<optional<tracker, false>, optional<tracker, false, intrusive_storage>>::value);
+	}
+}
+
+// ## allow_inplace_placement
+
+#if defined(COW_CPP_LIB_IS_AGGREGATE) || defined(COW_HAS_BUILTIN_IS_AGGREGATE)
+struct pointer_aggregate {
+	std::shared_ptr<tracker> pointer;
+};
+
+struct nested_aggregate {
+	pointer_aggregate inner;
+	int value;
+};
+
+struct array_aggregate {
+	std::shared_ptr<tracker> pointers[2];
+	char value;
+};
+
+struct tracker_aggregate {
+	std::shared_ptr<tracker> pointer;
+	tracker value;
+};
+
+struct nested_tracker_aggregate {
+	tracker_aggregate inner;
+};
+
+struct const_aggregate {
+	const std::shared_ptr<tracker> pointer;
+};
+
+// it can be constructed from any value like `std::variant`
+struct converting_struct {
+	template<typename U>
+	converting_struct(U&& /*value*/) noexcept // NOLINT: Allow implicit conversion
+	{}
+
+	converting_struct(const converting_struct& /*other*/) noexcept {}
+	converting_struct& operator=(const converting_struct& /*other*/) noexcept { return *this; }
+};
+
+struct converting_aggregate {
+	converting_struct value;
+};
+
+TEST_CASE("Testing struct allow_inplace_placement", "[optional]") {
+	SECTION("aggregate of inline placeable fields") {
+		CHECK(allow_inplace_placement<pointer_aggregate>::value);
+		CHECK(use_inline_storage_v<pointer_aggregate>);
+	}
+	SECTION("aggregate of aggregate fields") {
+		CHECK(allow_inplace_placement<nested_aggregate>::value);
+	}
+	SECTION("aggregate with array field") {
+		CHECK(allow_inplace_placement<array_aggregate>::value);
+	}
+	SECTION("aggregate with non-trivially copyable field") {
+		CHECK_FALSE(allow_inplace_placement<tracker_aggregate>::value);
+	}
+	SECTION("aggregate of aggregate with non-trivially copyable field") {
+		CHECK_FALSE(allow_inplace_placement<nested_tracker_aggregate>::value);
+	}
+	SECTION("aggregate with field constructible from any value") {
+		CHECK_FALSE(allow_inplace_placement<converting_aggregate>::value);
+	}
+	SECTION("non-assignable aggregate") {
+		CHECK_FALSE(allow_inplace_placement<const_aggregate>::value);
+	}
+#if __cpp_aggregate_bases
+	SECTION("aggregate with base class") {
+		struct derived_aggregate : pointer_aggregate {
+			int value;
+		};
+		struct derived_tracker_aggregate : pointer_aggregate {
+			tracker value;
+		};
+
+		CHECK(allow_inplace_placement<derived_aggregate>::value);
+		CHECK_FALSE(allow_inplace_placement<derived_tracker_aggregate>::value);
+	}
+#endif
+	SECTION("copying optional with aggregate") {
+		const optional<pointer_aggregate> v1{pointer_aggregate{std::make_shared<tracker>(3)}};
+		const optional<pointer_aggregate> v2 = v1;
+
+		REQUIRE(v2);
+		CHECK(v2->pointer == v1->pointer);
+		CHECK_FALSE(v1.shares_storage_with(v2));
+	}
+}
+#endif
+
 // ## cow_use_inline_storage
 
-#if __cpp_lib_optional
 TEST_CASE("Testing struct cow_use_inline_storage", "[optional]") {
 	SECTION("char data type") {
 		CHECK(use_inline_storage_v<char>);
@@ -1380,7 +1749,79 @@ TEST_CASE("Testing struct cow_use_inline_storage", "[optional]") {
 		CHECK(use_inline_storage_v<std::tuple<char&>>);
 	}
 }
-#endif
+
+// ## select_storage
+
+struct tuned_struct {
+	int value;
+};
+
+struct alignas(32) over_aligned_struct {
+	char value;
+};
+
+struct uninspected_struct {
+	char value[64];
+};
+
+} // namespace
+} // namespace test
+
+template<>
+struct select_storage<test::tuned_struct> {
+	using type = pooled_storage;
+};
+
+// it is not defined, so select_storage must not instantiate it for the big type
+template<>
+struct allow_inplace_placement<test::uninspected_struct>;
+
+namespace test {
+namespace {
+
+TEST_CASE("Testing struct select_storage", "[optional]") {
+	SECTION("small trivially copyable data type") {
+		CHECK(std::is_same<select_storage_t<char>, inline_storage>::value);
+	}
+	SECTION("non-trivially copyable data type") {
+		CHECK(std::is_same<select_storage_t<tracker>, intrusive_storage>::value);
+	}
+	SECTION("big object data type with increased size limit") {
+		CHECK(std::is_same<select_storage_t<std::array<char, 64>>, intrusive_storage>::value);
+		CHECK(std::is_same<select_storage_t<std::array<char, 64>, 64>, inline_storage>::value);
+	}
+	SECTION("big data type is not inspected") {
+		CHECK(std::is_same<select_storage_t<uninspected_struct>, intrusive_storage>::value);
+	}
+	SECTION("over-aligned data type") {
+		CHECK(std::is_same<select_storage_t<over_aligned_struct, 64>, intrusive_storage>::value);
+		CHECK(std::is_same<select_storage_t<over_aligned_struct, 64, 32>, inline_storage>::value);
+	}
+	SECTION("data type with specialized policy") {
+		CHECK_FALSE(use_inline_storage_v<tuned_struct>);
+		CHECK(std::is_same<optional<tuned_struct>, optional<tuned_struct, false, pooled_storage>>::value);
+		CHECK(std::is_same<decltype(make_optional(tuned_struct{1})), optional<tuned_struct>>::value);
+
+		const optional<tuned_struct> v1{tuned_struct{2}};
+		const optional<tuned_struct> v2 = v1;
+
+		REQUIRE(v2);
+		CHECK(v2->value == 2);
+		CHECK(&*v1 == &*v2);
+	}
+	SECTION("basic_optional with inline storage") {
+		CHECK(std::is_same<basic_optional<int, inline_storage>, optional<int, true>>::value);
+	}
+	SECTION("basic_optional with shared storage") {
+		CHECK(std::is_same<basic_optional<tracker, pooled_storage>, optional<tracker, false, pooled_storage>>::value);
+	}
+	SECTION("basic_optional with selected storage") {
+		CHECK(std::is_same<basic_optional<int>, optional<int>>::value);
+		CHECK(std::is_same<basic_optional<tracker>, optional<tracker>>::value);
+		CHECK(std::is_same<basic_optional<std::array<char, 64>, select_storage_t<std::array<char, 64>, 64>>,
+			optional<std::array<char, 64>, true>>::value);
+	}
+}
 
 } // namespace
 } // namespace test
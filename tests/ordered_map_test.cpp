@@ -0,0 +1,325 @@
+#include <cow/ordered_map.h>
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "tools/sequences.h"
+#include "tools/tracker.h"
+
+namespace cow {
+namespace test {
+namespace {
+
+// # tools
+// the nodes keep up to 4 entries or children, so the small maps have several levels
+using small_ordered_map = ordered_map<int, int, std::less<int>, 4>;
+
+using tools::make_std_squares;
+using tools::to_std_vector;
+
+const auto make_squares = &tools::make_squares<small_ordered_map>;
+
+// # tests
+TEST_CASE("Testing class ordered_map", "[ordered_map]") {
+	SECTION("default constructor") {
+		const small_ordered_map m;
+
+		CHECK(m.empty());
+		CHECK(m.size() == 0);
+		CHECK(m.begin() == m.end());
+		CHECK(m.find(0) == nullptr);
+		CHECK(m.lower_bound(0) == m.end());
+	}
+	SECTION("size of ordered_map") {
+		CHECK(sizeof(ordered_map<int, int>) <= 4 * sizeof(void*));
+	}
+	SECTION("constructors") {
+		const small_ordered_map m1{{2, 20}, {1, 10}, {2, 30}};
+		const std::map<int, int> source = make_std_squares(100);
+		const small_ordered_map m2(source.begin(), source.end());
+
+		CHECK(to_std_vector(m1) == to_std_vector(std::map<int, int>{{1, 10}, {2, 20}}));
+		CHECK(to_std_vector(m2) == to_std_vector(source));
+	}
+	SECTION("set and lookup") {
+		small_ordered_map m;
+		for (int i = 0; i != 300; ++i)
+			m.set((i * 7919) % 300, 0);
+		for (int i = 0; i != 300; ++i)
+			m.set(i, i * i);
+
+		REQUIRE(m.size() == 300);
+		CHECK(to_std_vector(m) == to_std_vector(make_std_squares(300)));
+		CHECK(*m.find(30) == 900);
+		CHECK(m.at(299) == 299 * 299);
+		CHECK(m.count(5) == 1);
+		CHECK(m.contains(0));
+		CHECK_FALSE(m.contains(300));
+		CHECK(m.find(-1) == nullptr);
+		CHECK_THROWS_AS(m.at(300), std::out_of_range);
+	}
+	SECTION("insert does not replace value") {
+		small_ordered_map m{{1, 10}};
+
+		CHECK_FALSE(m.insert({1, 20}));
+		CHECK(m.insert({2, 20}));
+		CHECK_FALSE(m.set(2, 30));
+		CHECK(m.set(3, 30));
+
+		CHECK(to_std_vector(m) == to_std_vector(std::map<int, int>{{1, 10}, {2, 30}, {3, 30}}));
+	}
+	SECTION("erase") {
+		small_ordered_map m = make_squares(300);
+		std::map<int, int> expected = make_std_squares(300);
+
+		for (int i = 0; i < 300; i += 3) {
+			CHECK(m.erase(i) == 1);
+			expected.erase(i);
+		}
+		CHECK(m.erase(0) == 0);
+		CHECK(m.erase(300) == 0);
+
+		CHECK(m.size() == expected.size());
+		CHECK(to_std_vector(m) == to_std_vector(expected));
+
+		for (int i = 299; i >= 0; --i)
+			m.erase(i);
+
+		CHECK(m.empty());
+		CHECK(m.begin() == m.end());
+	}
+	SECTION("iterators") {
+		const small_ordered_map m = make_squares(100);
+		small_ordered_map::const_iterator it = m.begin();
+
+		CHECK(std::distance(m.begin(), m.end()) == 100);
+		CHECK(it->first == 0);
+		CHECK((++it)->first == 1);
+		CHECK((--it)->first == 0);
+		CHECK(std::prev(m.end())->first == 99);
+		CHECK(std::next(m.begin(), 50)->first == 50);
+		CHECK(std::prev(std::next(m.begin(), 50))->first == 49);
+
+		std::vector<int> reversed;
+		for (auto rit = m.rbegin(); rit != m.rend(); ++rit)
+			reversed.push_back(rit->first);
+
+		REQUIRE(reversed.size() == 100);
+		CHECK(reversed.front() == 99);
+		CHECK(reversed.back() == 0);
+		CHECK(std::is_sorted(reversed.rbegin(), reversed.rend()));
+	}
+	SECTION("range scans") {
+		small_ordered_map m;
+		for (int i = 0; i != 100; ++i)
+			m.set(i * 2, i);
+
+		CHECK(m.lower_bound(10)->first == 10);
+		CHECK(m.lower_bound(11)->first == 12);
+		CHECK(m.upper_bound(10)->first == 12);
+		CHECK(m.lower_bound(198)->first == 198);
+		CHECK(m.upper_bound(198) == m.end());
+		CHECK(m.lower_bound(-5) == m.begin());
+
+		std::vector<int> keys;
+		for (auto it = m.lower_bound(51); it != m.upper_bound(71); ++it)
+			keys.push_back(it->first);
+
+		CHECK(keys == std::vector<int>{52, 54, 56, 58, 60, 62, 64, 66, 68, 70});
+
+		const auto range = m.equal_range(40);
+
+		CHECK(std::distance(range.first, range.second) == 1);
+		CHECK(m.equal_range(41).first == m.equal_range(41).second);
+	}
+	SECTION("range scan does not copy") {
+		const small_ordered_map m1 = make_squares(100);
+		const small_ordered_map m2 = m1; // NOLINT(performance-unnecessary-copy-initialization)
+
+		int sum = 0;
+		for (auto it = m2.lower_bound(10); it != m2.upper_bound(20); ++it)
+			sum += it->second;
+
+		CHECK(sum > 0);
+		CHECK(m1.shares_storage_with(m2));
+		CHECK(&*m1.lower_bound(10) == &*m2.lower_bound(10));
+	}
+	SECTION("copying shares the tree") {
+		const small_ordered_map m1 = make_squares(100);
+		const small_ordered_map m2 = m1; // NOLINT(performance-unnecessary-copy-initialization)
+
+		CHECK(m1.shares_storage_with(m2));
+		CHECK(m1.find(50) == m2.find(50));
+		CHECK(m1 == m2);
+	}
+	SECTION("changing copy copies only the path to the entry") {
+		const small_ordered_map m1 = make_squares(300);
+		small_ordered_map m2 = m1;
+
+		m2.set(150, -1);
+
+		CHECK(*m1.find(150) == 150 * 150);
+		CHECK(*m2.find(150) == -1);
+		CHECK(m1.find(0) == m2.find(0));
+		CHECK(m1.find(299) == m2.find(299));
+		int shared = 0;
+		for (int i = 0; i != 300; ++i)
+			shared += m1.find(i) == m2.find(i) ? 1 : 0;
+		CHECK(shared > 290);
+		CHECK(m1 != m2);
+	}
+	SECTION("changing unique map does not copy") {
+		small_ordered_map m = make_squares(100);
+		const int* const address = m.find(50);
+
+		*m.write(50) = -1;
+		m.modify(60, [](int& value) { value = -2; });
+
+		CHECK(m.find(50) == address);
+		CHECK(m.at(50) == -1);
+		CHECK(m.at(60) == -2);
+		CHECK_THROWS_AS(m.write(100), std::out_of_range);
+	}
+	SECTION("changing copy does not change original") {
+		const small_ordered_map m1 = make_squares(100);
+		small_ordered_map m2 = m1;
+
+		for (int i = 0; i < 100; i += 2)
+			m2.erase(i);
+		m2.set(100, 1);
+		m2.modify(1, [](int& value) { ++value; });
+
+		CHECK(to_std_vector(m1) == to_std_vector(make_std_squares(100)));
+		CHECK(m2.size() == 51);
+		CHECK(m2.begin()->first == 1);
+		CHECK(m2.at(1) == 2);
+	}
+	SECTION("modification without changes does not copy") {
+		const small_ordered_map m1 = make_squares(100);
+		small_ordered_map m2 = m1;
+
+		m2.insert({1, 10});
+		m2.erase(100);
+
+		CHECK(m1.shares_storage_with(m2));
+	}
+	SECTION("moving") {
+		small_ordered_map m1 = make_squares(10);
+		small_ordered_map m2 = std::move(m1);
+
+		CHECK(m1.empty()); // NOLINT(bugprone-use-after-move)
+		CHECK(m2.size() == 10);
+
+		m1 = std::move(m2);
+
+		CHECK(m1.size() == 10);
+	}
+	SECTION("iterators after moving and swapping") {
+		small_ordered_map m1 = make_squares(100);
+		small_ordered_map::const_iterator first = m1.begin();
+		small_ordered_map::const_iterator last = m1.end();
+		small_ordered_map m2 = std::move(m1);
+
+		CHECK(std::distance(first, last) == 100);
+		CHECK(std::prev(last)->first == 99);
+
+		small_ordered_map m3 = make_squares(10);
+		swap(m2, m3);
+		first = std::next(first, 3);
+
+		CHECK(first->first == 3);
+		CHECK(std::distance(first, last) == 97);
+		CHECK(std::prev(last)->first == 99);
+	}
+	SECTION("clear and swap") {
+		small_ordered_map m1 = make_squares(10);
+		small_ordered_map m2;
+
+		swap(m1, m2);
+
+		CHECK(m1.empty());
+		CHECK(m2.size() == 10);
+
+		m2.clear();
+
+		CHECK(m2.empty());
+		CHECK(m2.find(1) == nullptr);
+	}
+	SECTION("relational operations") {
+		const small_ordered_map m1{{1, 1}, {2, 2}};
+		const small_ordered_map m2{{1, 1}, {2, 3}};
+		const small_ordered_map m3{{1, 1}};
+
+		CHECK(m1 == small_ordered_map{{2, 2}, {1, 1}});
+		CHECK(m1 != m2);
+		CHECK(m1 < m2);
+		CHECK(m3 < m1);
+		CHECK(m2 > m1);
+		CHECK(m1 <= m1);
+		CHECK(m1 >= m3);
+	}
+	SECTION("custom order") {
+		ordered_map<int, int, std::greater<int>, 4> m;
+		for (int i = 0; i != 20; ++i)
+			m.set(i, i);
+
+		CHECK(m.begin()->first == 19);
+		CHECK(m.lower_bound(10)->first == 10);
+		CHECK(m.upper_bound(10)->first == 9);
+	}
+	SECTION("changing copy copies only the entries of the leaf") {
+		ordered_map<int, tools::tracker, std::less<int>, 4> m1;
+		for (int i = 0; i != 8; ++i)
+			m1.set(i, tools::tracker{i});
+		ordered_map<int, tools::tracker, std::less<int>, 4> m2 = m1;
+
+		m2.modify(7, [](tools::tracker& value) { value = tools::tracker{70}; });
+
+		CHECK(m1.at(7).get_value() == 7);
+		CHECK(m2.at(7).get_value() == 70);
+		CHECK(m2.at(6).get_copy_generation() == m1.at(6).get_copy_generation() + 1);
+		CHECK(m2.at(0).get_copy_generation() == m1.at(0).get_copy_generation());
+	}
+	SECTION("map of strings") {
+		ordered_map<std::string, std::string> m1{{"b", "b"}, {"a", "a"}};
+		ordered_map<std::string, std::string> m2 = m1;
+
+		m2.write("a")->append("c");
+
+		CHECK(m1.at("a") == "a");
+		CHECK(m2.at("a") == "ac");
+		CHECK(m2.begin()->first == "a");
+	}
+}
+
+TEST_CASE("Testing ordered_map storage policies", "[ordered_map]") {
+	SECTION("shared_ptr storage") {
+		const ordered_map<int, int, std::less<int>, 4, shared_ptr_storage> m1{{1, 1}, {2, 2}};
+		ordered_map<int, int, std::less<int>, 4, shared_ptr_storage> m2 = m1;
+
+		m2.set(1, 10);
+
+		CHECK(m1.at(1) == 1);
+		CHECK(m2.at(1) == 10);
+	}
+	SECTION("single thread storage") {
+		const ordered_map<int, int, std::less<int>, 4, single_thread_storage> m1{{1, 1}, {2, 2}};
+		ordered_map<int, int, std::less<int>, 4, single_thread_storage> m2 = m1;
+
+		m2.erase(1);
+
+		CHECK(m1.size() == 2);
+		CHECK(m2.size() == 1);
+		CHECK(m2.at(2) == 2);
+	}
+}
+
+} // namespace
+} // namespace test
+} // namespace cow
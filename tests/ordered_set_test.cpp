@@ -0,0 +1,131 @@
+#include <cow/ordered_set.h>
+#include <catch2/catch.hpp>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "tools/sequences.h"
+
+namespace cow {
+namespace test {
+namespace {
+
+// # tools
+// the nodes keep up to 4 keys or children, so the small sets have several levels
+using small_ordered_set = ordered_set<int, std::less<int>, 4>;
+
+using tools::make_std_sequence;
+using tools::to_std_vector;
+
+const auto make_sequence = &tools::make_sequence<small_ordered_set>;
+
+// # tests
+TEST_CASE("Testing class ordered_set", "[ordered_set]") {
+	SECTION("default constructor") {
+		const small_ordered_set s;
+
+		CHECK(s.empty());
+		CHECK(s.size() == 0);
+		CHECK(s.begin() == s.end());
+		CHECK_FALSE(s.contains(0));
+	}
+	SECTION("constructors") {
+		const small_ordered_set s1{3, 1, 2, 1};
+		const std::vector<int> source = make_std_sequence(0, 100);
+		const small_ordered_set s2(source.rbegin(), source.rend());
+
+		CHECK(to_std_vector(s1) == std::vector<int>{1, 2, 3});
+		CHECK(to_std_vector(s2) == source);
+	}
+	SECTION("insert and erase") {
+		small_ordered_set s;
+		std::set<int> expected;
+		for (int i = 0; i != 500; ++i) {
+			const int key = (i * 7919) % 300;
+			CHECK(s.insert(key) == expected.insert(key).second);
+			if (i % 3 == 0) {
+				const int removed = (i * 104729) % 300;
+				CHECK(s.erase(removed) == expected.erase(removed));
+			}
+		}
+
+		CHECK(s.size() == expected.size());
+		CHECK(to_std_vector(s) == std::vector<int>(expected.begin(), expected.end()));
+	}
+	SECTION("range scans") {
+		const small_ordered_set s = make_sequence(0, 100);
+
+		CHECK(*s.lower_bound(10) == 10);
+		CHECK(*s.upper_bound(10) == 11);
+		CHECK(s.upper_bound(99) == s.end());
+		CHECK(std::distance(s.lower_bound(20), s.lower_bound(40)) == 20);
+		CHECK(*std::prev(s.end()) == 99);
+		CHECK(*s.rbegin() == 99);
+		CHECK(std::distance(s.equal_range(5).first, s.equal_range(5).second) == 1);
+	}
+	SECTION("copying shares the tree") {
+		const small_ordered_set s1 = make_sequence(0, 100);
+		small_ordered_set s2 = s1;
+
+		CHECK(s1.shares_storage_with(s2));
+		CHECK(s1 == s2);
+
+		s2.erase(50);
+		s2.insert(100);
+
+		CHECK(to_std_vector(s1) == make_std_sequence(0, 100));
+		CHECK(s2.size() == 100);
+		CHECK_FALSE(s2.contains(50));
+		CHECK(&*s1.begin() == &*s2.begin());
+		CHECK(s1 != s2);
+	}
+	SECTION("modification without changes does not copy") {
+		const small_ordered_set s1 = make_sequence(0, 100);
+		small_ordered_set s2 = s1;
+
+		s2.insert(1);
+		s2.erase(100);
+
+		CHECK(s1.shares_storage_with(s2));
+	}
+	SECTION("relational operations") {
+		const small_ordered_set s1{1, 2, 3};
+		const small_ordered_set s2{1, 2, 4};
+		const small_ordered_set s3{1, 2};
+
+		CHECK(s1 == small_ordered_set{3, 2, 1});
+		CHECK(s1 != s2);
+		CHECK(s1 < s2);
+		CHECK(s3 < s1);
+		CHECK(s2 > s1);
+		CHECK(s1 <= s1);
+		CHECK(s1 >= s3);
+	}
+	SECTION("moving and swap") {
+		small_ordered_set s1 = make_sequence(0, 10);
+		small_ordered_set s2 = std::move(s1);
+
+		CHECK(s1.empty()); // NOLINT(bugprone-use-after-move)
+		CHECK(s2.size() == 10);
+
+		swap(s1, s2);
+
+		CHECK(s1.size() == 10);
+		CHECK(s2.empty());
+	}
+	SECTION("set of strings") {
+		ordered_set<std::string> s1{"b", "a"};
+		ordered_set<std::string> s2 = s1;
+
+		s2.insert("c");
+
+		CHECK(s1.size() == 2);
+		CHECK(*std::prev(s2.end()) == "c");
+	}
+}
+
+} // namespace
+} // namespace test
+} // namespace cow
@@ -0,0 +1,805 @@
+#include <cow/optional.h>
+#include <cow/reclamation.h>
+#include <cow/storage.h>
+#include "tools/tracker.h"
+#include <catch2/catch.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef COW_CPP_LIB_MEMORY_RESOURCE
+#include <memory_resource>
+#endif
+
+namespace cow {
+namespace test {
+namespace {
+
+// # tools
+using cow::test::tools::tracker;
+
+// # tests
+class destruction_counter {
+public:
+	explicit destruction_counter(std::atomic<int>& counter) noexcept
+		: counter_{&counter}
+	{}
+
+	destruction_counter(const destruction_counter& other) = default;
+	destruction_counter& operator=(const destruction_counter& other) = default;
+
+	~destruction_counter()
+	{
+		counter_->fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<int>* counter_;
+};
+
+struct allocation_statistics {
+	int allocations = 0;
+	int deallocations = 0;
+};
+
+template<typename T>
+class counting_allocator {
+	template<typename>
+	friend class counting_allocator;
+
+public:
+	using value_type = T;
+
+	counting_allocator() noexcept
+		: statistics_{&default_statistics()}
+	{}
+
+	explicit counting_allocator(allocation_statistics& statistics) noexcept
+		: statistics_{&statistics}
+	{}
+
+	template<typename U>
+	counting_allocator(const counting_allocator<U>& other) noexcept // NOLINT: Allow implicit conversion
+		: statistics_{other.statistics_}
+	{}
+
+	T* allocate(const std::size_t n)
+	{
+		++statistics_->allocations;
+		return std::allocator<T>{}.allocate(n);
+	}
+
+	void deallocate(T* const p, const std::size_t n) noexcept
+	{
+		++statistics_->deallocations;
+		std::allocator<T>{}.deallocate(p, n);
+	}
+
+	template<typename U>
+	bool operator==(const counting_allocator<U>& other) const noexcept
+	{
+		return statistics_ == other.statistics_;
+	}
+
+	template<typename U>
+	bool operator!=(const counting_allocator<U>& other) const noexcept
+	{
+		return !(*this == other);
+	}
+
+	static allocation_statistics& default_statistics() noexcept
+	{
+		static allocation_statistics statistics;
+		return statistics;
+	}
+
+private:
+	allocation_statistics* statistics_;
+};
+
+struct throwing_value {
+	explicit throwing_value(const bool throws)
+	{
+		if (throws)
+			throw std::runtime_error{"throwing_value"};
+	}
+};
+
+// counts calls of std::hash
+struct hashed_value {
+	int value;
+
+	static int& hash_calls() noexcept
+	{
+		static int calls = 0;
+		return calls;
+	}
+
+	static int& comparisons() noexcept
+	{
+		static int calls = 0;
+		return calls;
+	}
+};
+
+bool operator==(const hashed_value& lhs, const hashed_value& rhs) noexcept
+{
+	++hashed_value::comparisons();
+	return lhs.value == rhs.value;
+}
+
+bool operator!=(const hashed_value& lhs, const hashed_value& rhs) noexcept
+{
+	++hashed_value::comparisons();
+	return lhs.value != rhs.value;
+}
+
+bool operator<(const hashed_value& lhs, const hashed_value& rhs) noexcept
+{
+	++hashed_value::comparisons();
+	return lhs.value < rhs.value;
+}
+
+// the string which is emptied by the move
+struct hashed_string {
+	std::string value;
+};
+
+bool operator==(const hashed_string& lhs, const hashed_string& rhs) noexcept
+{
+	return lhs.value == rhs.value;
+}
+
+} // namespace
+} // namespace test
+
+template<>
+struct cache_hash<test::hashed_value> : std::true_type {};
+
+template<>
+struct cache_hash<test::hashed_string> : std::true_type {};
+
+} // namespace cow
+
+namespace std {
+
+template<>
+struct hash<cow::test::hashed_value> {
+	std::size_t operator()(const cow::test::hashed_value& v) const noexcept
+	{
+		++cow::test::hashed_value::hash_calls();
+		return std::hash<int>{}(v.value);
+	}
+};
+
+template<>
+struct hash<cow::test::hashed_string> {
+	std::size_t operator()(const cow::test::hashed_string& v) const noexcept
+	{
+		return std::hash<std::string>{}(v.value);
+	}
+};
+
+} // namespace std
+
+namespace cow {
+namespace test {
+namespace {
+
+// returns true if the value was assigned without a new allocation, that is `v` was the only owner of its value
+template<typename Optional>
+bool assign_in_place(Optional& v, const typename Optional::value_type& value)
+{
+	const auto* const address = &*v;
+	v = value;
+	return &*v == address;
+}
+
+// ## biased_storage
+
+TEST_CASE("Testing biased storage", "[storage]") {
+	using optional_type = optional<destruction_counter, false, biased_storage>;
+	constexpr int thread_count = 4;
+	constexpr int copy_count = 100;
+
+	std::atomic<int> destructions{0};
+	std::atomic<int> value_destructions{0};
+	const destruction_counter value{value_destructions};
+
+	SECTION("size of optional with biased storage") {
+		CHECK(sizeof(optional_type) == sizeof(void*));
+	}
+	SECTION("copying and releasing by the owner thread") {
+		{
+			optional_type v1{in_place, destructions};
+			{
+				const optional_type v2 = v1;
+				CHECK_FALSE(assign_in_place(v1, value));
+			}
+			CHECK(assign_in_place(v1, value));
+		}
+		CHECK(destructions == 1);
+	}
+	SECTION("releasing copies by other threads") {
+		{
+			const optional_type v1{in_place, destructions};
+			std::vector<std::thread> threads;
+			for (int i = 0; i != thread_count; ++i) {
+				std::vector<optional_type> copies(copy_count, v1);
+				threads.emplace_back([copies = std::move(copies)]() mutable {
+					for (int j = 0; j != copy_count; ++j) {
+						const optional_type copy = copies.back();
+						copies.pop_back();
+					}
+				});
+			}
+			for (std::thread& thread : threads)
+				thread.join();
+
+			CHECK(destructions == 0);
+		}
+		CHECK(destructions == 1);
+	}
+	SECTION("releasing the last reference by other thread") {
+		optional_type v1{in_place, destructions};
+		optional_type v2 = v1;
+		v1.reset();
+		std::thread{[v = std::move(v2)]() mutable { v.reset(); }}.join();
+
+		CHECK(destructions == 0);
+		biased_ref_count::merge_queued();
+		CHECK(destructions == 1);
+	}
+	SECTION("releasing references after the owner thread has finished") {
+		std::vector<optional_type> copies;
+		std::thread{[&]() {
+			const optional_type v1{in_place, destructions};
+			copies.assign(copy_count, v1);
+		}}.join();
+
+		CHECK(destructions == 0);
+		std::vector<std::thread> threads;
+		for (optional_type& copy : copies)
+			threads.emplace_back([v = std::move(copy)]() mutable { v.reset(); });
+		for (std::thread& thread : threads)
+			thread.join();
+
+		CHECK(destructions == 1);
+	}
+	SECTION("uniqueness of the value released by the owner thread") {
+		optional_type v1;
+		std::thread{[&]() {
+			const optional_type v2{in_place, destructions};
+			v1 = v2;
+		}}.join();
+
+		CHECK(assign_in_place(v1, value));
+	}
+}
+
+// ## sharded_storage
+
+TEST_CASE("Testing sharded storage", "[storage]") {
+	using optional_type = optional<destruction_counter, false, basic_sharded_storage<4>>;
+	constexpr int thread_count = 8;
+	constexpr int copy_count = 100;
+
+	std::atomic<int> destructions{0};
+	const destruction_counter value{destructions};
+
+	SECTION("size of optional with sharded storage") {
+		CHECK(sizeof(optional_type) == 2 * sizeof(void*));
+	}
+	SECTION("copying and releasing by several threads") {
+		{
+			const optional_type v1{in_place, destructions};
+			std::vector<std::thread> threads;
+			for (int i = 0; i != thread_count; ++i) {
+				threads.emplace_back([&v1]() {
+					for (int j = 0; j != copy_count; ++j)
+						static_cast<void>(optional_type{v1});
+				});
+			}
+			for (std::thread& thread : threads)
+				thread.join();
+
+			CHECK(destructions == 0);
+		}
+		CHECK(destructions == 1);
+	}
+	SECTION("releasing copies by other threads") {
+		optional_type v1{in_place, destructions};
+		std::vector<optional_type> copies(copy_count, v1);
+		std::vector<std::thread> threads;
+		for (optional_type& copy : copies)
+			threads.emplace_back([v = std::move(copy)]() mutable { v.reset(); });
+		for (std::thread& thread : threads)
+			thread.join();
+
+		CHECK(destructions == 0);
+		CHECK(assign_in_place(v1, value));
+	}
+	SECTION("uniqueness of the value shared with other threads") {
+		optional_type v1{in_place, destructions};
+		optional_type v2;
+		std::thread{[&]() { v2 = v1; }}.join();
+
+		CHECK_FALSE(assign_in_place(v1, value));
+		v2.reset();
+		CHECK(assign_in_place(v1, value));
+	}
+	SECTION("releasing the last reference by other thread") {
+		optional_type v1{in_place, destructions};
+		std::thread{[v = std::move(v1)]() mutable { v.reset(); }}.join();
+
+		CHECK(destructions == 1);
+	}
+}
+
+// ## pooled_storage
+
+TEST_CASE("Testing pooled storage", "[storage]") {
+	using optional_type = optional<destruction_counter, false, pooled_storage>;
+	constexpr int value_count = 1000;
+
+	std::atomic<int> destructions{0};
+
+	SECTION("size of optional with pooled storage") {
+		CHECK(sizeof(optional_type) == sizeof(void*));
+	}
+	SECTION("reusing memory of released value") {
+		optional_type v1{in_place, destructions};
+		const void* const address = &*v1;
+		v1.reset();
+		const optional_type v2{in_place, destructions};
+
+		CHECK(&*v2 == address);
+	}
+	SECTION("releasing values created by other thread") {
+		std::vector<optional_type> values;
+		std::thread{[&]() {
+			for (int i = 0; i != value_count; ++i)
+				values.emplace_back(in_place, destructions);
+		}}.join();
+		values.clear();
+		CHECK(destructions == value_count);
+
+		std::thread{[&]() {
+			for (int i = 0; i != value_count; ++i)
+				values.emplace_back(in_place, destructions);
+			values.clear();
+		}}.join();
+		CHECK(destructions == 2 * value_count);
+	}
+	SECTION("trimming cached memory") {
+		optional_type{in_place, destructions}.reset();
+		pool_allocator<destruction_counter>::trim();
+		const optional_type v{in_place, destructions};
+
+		CHECK(destructions == 1);
+	}
+}
+
+// ## hybrid_storage
+
+TEST_CASE("Testing hybrid storage", "[storage]") {
+	using shared_storage = basic_intrusive_storage<atomic_ref_count, counting_allocator<char>>;
+	using optional_type = optional<tracker, false, basic_hybrid_storage<shared_storage>>;
+
+	const allocation_statistics& statistics = counting_allocator<char>::default_statistics();
+	const int allocations = statistics.allocations;
+	const int deallocations = statistics.deallocations;
+
+	SECTION("size of optional with hybrid storage") {
+		using value_type = std::array<char, 32>;
+		CHECK(sizeof(optional<value_type, false, hybrid_storage>) == sizeof(value_type) + 2 * sizeof(void*));
+	}
+	SECTION("changing value of the only owner without allocation") {
+		optional_type v{in_place, 1};
+		v = tracker{2};
+		v.emplace(3);
+
+		REQUIRE(v);
+		CHECK(v->get_value() == 3);
+		CHECK(statistics.allocations == allocations);
+	}
+	SECTION("sharing value on the first copy") {
+		const optional_type v1{in_place, 4};
+		const optional_type v2 = v1;
+		const optional_type v3 = v1;
+
+		REQUIRE(v3);
+		CHECK(v3->get_value() == 4);
+		CHECK(v3->get_copy_generation() == 1u);
+		CHECK(v2.shares_storage_with(v3));
+		CHECK(statistics.allocations == allocations + 1);
+	}
+	SECTION("keeping references to the own value after copy") {
+		const optional_type v1{in_place, 4};
+		const tracker& value = *v1;
+		const optional_type v2 = v1;
+
+		CHECK(&*v1 == &value);
+		CHECK(value.get_value() == 4);
+		CHECK(v2->get_value() == 4);
+	}
+	SECTION("copying own value by several threads") {
+		const optional_type v{in_place, 4};
+		const tracker* const address = &*v;
+		std::vector<optional_type> copies(4);
+		std::vector<std::thread> threads;
+		for (optional_type& copy : copies)
+			threads.emplace_back([&v, &copy]() { copy = v; });
+		for (std::thread& thread : threads)
+			thread.join();
+
+		CHECK(&*v == address);
+		for (const optional_type& copy : copies)
+			CHECK(copy.shares_storage_with(copies.front()));
+		CHECK(statistics.allocations == allocations + 1);
+	}
+	SECTION("changing own value of the only owner after its copies are released") {
+		optional_type v{in_place, 4};
+		{
+			const optional_type copy = v;
+		}
+		const tracker* const address = &*v;
+		v = tracker{5};
+		const optional_type copy = v;
+
+		CHECK(&*v == address);
+		CHECK(copy->get_value() == 5);
+	}
+	SECTION("copying on write after sharing") {
+		optional_type v1{in_place, 5};
+		const optional_type v2 = v1;
+		v1 = tracker{6};
+
+		REQUIRE(v1);
+		REQUIRE(v2);
+		CHECK(v1->get_value() == 6);
+		CHECK(v2->get_value() == 5);
+		CHECK_FALSE(v1.shares_storage_with(v2));
+		CHECK(statistics.allocations == allocations + 1);
+	}
+	SECTION("moving value of the only owner") {
+		optional_type v1{in_place, 7};
+		const optional_type v2 = std::move(v1);
+
+		REQUIRE(v2);
+		CHECK(v2->get_value() == 7);
+		CHECK(statistics.allocations == allocations);
+	}
+	SECTION("swapping own and shared values") {
+		optional_type v1{in_place, 8};
+		optional_type v2{in_place, 9};
+		const optional_type v3 = v2;
+		v1.swap(v2);
+
+		REQUIRE(v1);
+		REQUIRE(v2);
+		CHECK(v1->get_value() == 9);
+		CHECK(v2->get_value() == 8);
+		CHECK(optional_type{v1}.shares_storage_with(v3));
+	}
+	SECTION("taking value of the only owner") {
+		optional_type v{in_place, 10};
+
+		CHECK(v.take().get_value() == 10);
+		CHECK_FALSE(v);
+	}
+	SECTION("releasing shared value") {
+		{
+			const optional_type v1{in_place, 11};
+			const optional_type v2 = v1;
+		}
+		CHECK(statistics.deallocations == deallocations + 1);
+	}
+	SECTION("emplacing throwing value") {
+		optional<throwing_value, false, hybrid_storage> v{in_place, false};
+
+		CHECK_THROWS_AS(v.emplace(true), std::runtime_error);
+		CHECK_FALSE(v);
+	}
+}
+
+// ## deferred_storage
+
+TEST_CASE("Testing deferred storage", "[storage]") {
+	using optional_type = optional<destruction_counter, false, deferred_storage>;
+
+	reclamation_domain& domain = reclamation_domain::global();
+	static_cast<void>(domain.collect());
+	std::atomic<int> destructions{0};
+
+	SECTION("releasing the last reference") {
+		optional_type v1{in_place, destructions};
+		const optional_type v2 = v1;
+		v1.reset();
+
+		CHECK_FALSE(domain.has_retired());
+		CHECK(destructions == 0);
+	}
+	SECTION("collecting retired values") {
+		optional_type{in_place, destructions}.reset();
+
+		CHECK(destructions == 0);
+		CHECK(domain.has_retired());
+		CHECK(domain.collect() == 1);
+		CHECK(destructions == 1);
+		CHECK_FALSE(domain.has_retired());
+	}
+	SECTION("collecting values retired by destructors of retired values") {
+		using nested_type = optional<optional_type, false, deferred_storage>;
+		nested_type{in_place, in_place, destructions}.reset();
+
+		CHECK(domain.collect() == 2);
+		CHECK(destructions == 1);
+	}
+	SECTION("assigning to the only owner of the value") {
+		optional_type v{in_place, destructions};
+
+		CHECK(assign_in_place(v, destruction_counter{destructions}));
+		CHECK_FALSE(domain.has_retired());
+	}
+	SECTION("collecting values released by other threads") {
+		{
+			const background_reclaimer reclaimer{std::chrono::milliseconds{1}};
+			std::vector<std::thread> threads;
+			for (int i = 0; i != 4; ++i)
+				threads.emplace_back([v = optional_type{in_place, destructions}]() mutable { v.reset(); });
+			for (std::thread& thread : threads)
+				thread.join();
+		}
+		CHECK(destructions == 4);
+		CHECK_FALSE(domain.has_retired());
+	}
+}
+
+// ## allocators
+
+TEST_CASE("Testing storage with allocator", "[storage]") {
+	using optional_type = optional<tracker, false, basic_intrusive_storage<atomic_ref_count, counting_allocator<char>>>;
+
+	allocation_statistics statistics;
+	const counting_allocator<char> allocator{statistics};
+
+	SECTION("creating by allocator") {
+		{
+			const optional_type v1{std::allocator_arg, allocator, in_place, 5};
+			const optional_type v2 = v1;
+
+			REQUIRE(v2);
+			CHECK(v2->get_value() == 5);
+			CHECK(statistics.allocations == 1);
+		}
+		CHECK(statistics.deallocations == 1);
+	}
+	SECTION("copying on write by the same allocator") {
+		{
+			optional_type v1{std::allocator_arg, allocator, in_place, 5};
+			const optional_type v2 = v1;
+			v1 = tracker{6};
+
+			CHECK(v1->get_value() == 6);
+			CHECK(v2->get_value() == 5);
+			CHECK(statistics.allocations == 2);
+		}
+		CHECK(statistics.deallocations == 2);
+	}
+	SECTION("assigning to the only owner of the value") {
+		optional_type v1{std::allocator_arg, allocator, in_place, 5};
+		v1 = tracker{6};
+
+		CHECK(v1->get_value() == 6);
+		CHECK(statistics.allocations == 1);
+	}
+	SECTION("assigning to empty optional by the default allocator") {
+		const allocation_statistics default_statistics = counting_allocator<char>::default_statistics();
+		optional_type v1;
+		v1 = tracker{5};
+
+		CHECK(v1->get_value() == 5);
+		CHECK(statistics.allocations == 0);
+		CHECK(counting_allocator<char>::default_statistics().allocations == default_statistics.allocations + 1);
+	}
+	SECTION("emplacing to the only owner of the value") {
+		optional_type v1{std::allocator_arg, allocator, in_place, 5};
+		const tracker* const address = &*v1;
+		v1.emplace(6);
+
+		CHECK(v1->get_value() == 6);
+		CHECK(&*v1 == address);
+		CHECK(statistics.allocations == 1);
+	}
+	SECTION("emplacing to shared value by the same allocator") {
+		{
+			optional_type v1{std::allocator_arg, allocator, in_place, 5};
+			const optional_type v2 = v1;
+			v1.emplace(6);
+
+			CHECK(v1->get_value() == 6);
+			CHECK(v2->get_value() == 5);
+			CHECK(statistics.allocations == 2);
+		}
+		CHECK(statistics.deallocations == 2);
+	}
+	SECTION("emplacing throwing value") {
+		using throwing_optional_type =
+			optional<throwing_value, false, basic_intrusive_storage<atomic_ref_count, counting_allocator<char>>>;
+
+		throwing_optional_type v1{std::allocator_arg, allocator, in_place, false};
+
+		CHECK_THROWS_AS(v1.emplace(true), std::runtime_error);
+		CHECK_FALSE(v1);
+		CHECK(statistics.allocations == 1);
+		CHECK(statistics.deallocations == 1);
+	}
+	SECTION("size of optional with stateful allocator") {
+		CHECK(sizeof(optional_type) == sizeof(void*));
+	}
+}
+
+#ifdef COW_CPP_LIB_MEMORY_RESOURCE
+TEST_CASE("Testing pmr optional", "[storage]") {
+	std::array<std::byte, 256> buffer{};
+	std::pmr::monotonic_buffer_resource resource{buffer.data(), buffer.size(), std::pmr::null_memory_resource()};
+
+	SECTION("allocating from memory resource") {
+		pmr::optional<tracker> v1{std::allocator_arg, &resource, in_place, 5};
+		const pmr::optional<tracker> v2 = v1;
+		v1 = tracker{6};
+
+		const auto in_buffer = [&buffer](const tracker* p) {
+			const auto address = reinterpret_cast<const std::byte*>(p); // NOLINT
+			return address >= buffer.data() && address < buffer.data() + buffer.size();
+		};
+		CHECK(in_buffer(&*v1));
+		CHECK(in_buffer(&*v2));
+		CHECK(&*v1 != &*v2);
+	}
+	SECTION("size of pmr optional") {
+		CHECK(sizeof(pmr::optional<tracker>) == sizeof(void*));
+	}
+}
+#endif
+
+// ## hash caching
+
+TEMPLATE_TEST_CASE(
+	"Testing hash caching",
+	"[storage]",
+	intrusive_storage,
+	single_thread_storage,
+	biased_storage,
+	hybrid_storage,
+	shared_ptr_storage) {
+	using optional_type = optional<hashed_value, false, TestType>;
+	constexpr int recalculations = std::is_same<TestType, shared_ptr_storage>::value ? 1 : 0;
+
+	const std::hash<optional_type> hash;
+	const int calls = hashed_value::hash_calls();
+
+	SECTION("hashing shared value") {
+		optional_type v1{in_place, hashed_value{5}};
+		const optional_type v2 = v1;
+
+		CHECK(hash(v1) == std::hash<int>{}(5));
+		CHECK(hash(v2) == std::hash<int>{}(5));
+		CHECK(hashed_value::hash_calls() == calls + 1 + recalculations);
+	}
+	SECTION("hashing changed value") {
+		optional_type v1{in_place, hashed_value{5}};
+		CHECK(hash(v1) == std::hash<int>{}(5));
+
+		v1 = hashed_value{6};
+		CHECK(hash(v1) == std::hash<int>{}(6));
+
+		v1.emplace(hashed_value{7});
+		CHECK(hash(v1) == std::hash<int>{}(7));
+
+		v1.write()->value = 8;
+		CHECK(hash(v1) == std::hash<int>{}(8));
+
+		v1.modify([](hashed_value& v) { v.value = 9; });
+		CHECK(hash(v1) == std::hash<int>{}(9));
+
+		v1.transform_inplace([](hashed_value&& v) { return hashed_value{v.value + 1}; });
+		CHECK(hash(v1) == std::hash<int>{}(10));
+	}
+	SECTION("hashing copy of shared value") {
+		optional_type v1{in_place, hashed_value{5}};
+		const optional_type v2 = v1;
+		CHECK(hash(v2) == std::hash<int>{}(5));
+
+		v1.write()->value = 6;
+		CHECK(hash(v1) == std::hash<int>{}(6));
+		CHECK(hash(v2) == std::hash<int>{}(5));
+		CHECK(hashed_value::hash_calls() == calls + 2 + recalculations);
+	}
+}
+
+TEST_CASE("Testing hash caching of values moved to other storage", "[storage]") {
+	using source_type = optional<hashed_string, false, intrusive_storage>;
+	using target_type = optional<hashed_string, false, single_thread_storage>;
+
+	const std::hash<source_type> hash;
+	const source_type empty{in_place, hashed_string{}};
+	source_type source{in_place, hashed_string{std::string(100, 'a')}};
+	static_cast<void>(hash(empty));
+	static_cast<void>(hash(source));
+
+	SECTION("move constructor") {
+		const target_type target{std::move(source)};
+
+		CHECK(target->value == std::string(100, 'a'));
+	}
+	SECTION("move assignment") {
+		target_type target{in_place, hashed_string{"b"}};
+		target = std::move(source);
+
+		CHECK(target->value == std::string(100, 'a'));
+	}
+
+	REQUIRE(source->value.empty()); // NOLINT(bugprone-use-after-move)
+	CHECK(hash(source) == hash(empty));
+	CHECK(source == empty);
+}
+
+// ## comparison
+
+TEMPLATE_TEST_CASE(
+	"Testing comparison of shared values", "[storage]", intrusive_storage, single_thread_storage, shared_ptr_storage) {
+	using optional_type = optional<hashed_value, false, TestType>;
+	constexpr bool cache_hash = !std::is_same<TestType, shared_ptr_storage>::value;
+
+	const int comparisons = hashed_value::comparisons();
+
+	SECTION("comparing objects which share value") {
+		const optional_type v1{in_place, hashed_value{5}};
+		const optional_type v2 = v1;
+
+		REQUIRE(v1.shares_storage_with(v2));
+		CHECK(v1 == v2);
+		CHECK_FALSE(v1 != v2);
+		CHECK_FALSE(v1 < v2);
+		CHECK(hashed_value::comparisons() == comparisons);
+	}
+	SECTION("comparing objects with different cached hashes") {
+		const optional_type v1{in_place, hashed_value{5}};
+		const optional_type v2{in_place, hashed_value{6}};
+		const std::hash<optional_type> hash;
+		static_cast<void>(hash(v1));
+		static_cast<void>(hash(v2));
+
+		CHECK_FALSE(v1.shares_storage_with(v2));
+		CHECK_FALSE(v1 == v2);
+		CHECK(v1 != v2);
+		CHECK(hashed_value::comparisons() == comparisons + (cache_hash ? 0 : 2));
+	}
+	SECTION("comparing objects with equal values") {
+		const optional_type v1{in_place, hashed_value{5}};
+		const optional_type v2{in_place, hashed_value{5}};
+
+		CHECK_FALSE(v1.shares_storage_with(v2));
+		CHECK(v1 == v2);
+		CHECK(hashed_value::comparisons() == comparisons + 1);
+	}
+	SECTION("calling shares_storage_with() for empty objects") {
+		const optional_type v1;
+		const optional_type v2 = v1;
+
+		CHECK_FALSE(v1.shares_storage_with(v2));
+	}
+}
+
+} // namespace
+} // namespace test
+} // namespace cow
@@ -0,0 +1,379 @@
+#include <cow/string.h>
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef COW_CPP_LIB_STRING_VIEW
+#include <string_view>
+#endif
+
+namespace {
+
+// the blocks allocated by `operator new` are counted while the flag is set
+thread_local bool counting_blocks = false;
+thread_local std::ptrdiff_t counted_blocks = 0;
+
+} // namespace
+
+void* operator new(const std::size_t size)
+{
+	void* const memory = std::malloc(size == 0 ? 1 : size); // NOLINT(cppcoreguidelines-no-malloc)
+	if (memory == nullptr)
+		throw std::bad_alloc{};
+
+	if (counting_blocks)
+		++counted_blocks;
+	return memory;
+}
+
+void operator delete(void* const memory) noexcept
+{
+	if (memory != nullptr && counting_blocks)
+		--counted_blocks;
+	std::free(memory); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+void operator delete(void* const memory, std::size_t /*size*/) noexcept
+{
+	::operator delete(memory);
+}
+
+namespace cow {
+namespace test {
+namespace {
+
+// # tools
+const char* const short_text = "short";
+const char* const long_text = "the text which is longer than the inline capacity";
+
+/// Reference counter which cannot be created, like `biased_ref_count` which fails to allocate the record of its thread.
+struct throwing_ref_count : atomic_ref_count {
+	throwing_ref_count()
+	{
+		throw std::bad_alloc{};
+	}
+};
+
+/// \return The number of blocks allocated by `operator new` in `f` and not freed.
+template<typename F>
+std::ptrdiff_t count_kept_blocks(F f)
+{
+	counted_blocks = 0;
+	counting_blocks = true;
+	f();
+	counting_blocks = false;
+	return counted_blocks;
+}
+
+// # tests
+TEST_CASE("Testing class basic_string", "[string]") {
+	SECTION("size of string") {
+		CHECK(sizeof(string) == sizeof(std::shared_ptr<char>));
+		CHECK(sizeof(u16string) == sizeof(std::shared_ptr<char>));
+		CHECK(string::inline_capacity + 0 == 2 * sizeof(void*) - 1);
+	}
+	SECTION("default constructor") {
+		const string s;
+
+		CHECK(s.empty());
+		CHECK(s.size() == 0);
+		CHECK(s.c_str()[0] == '\0');
+		CHECK(s.begin() == s.end());
+	}
+	SECTION("constructors") {
+		const string s1{short_text};
+		const string s2{long_text};
+		const string s3(3, 'a');
+		const string s4{std::string{long_text}};
+		const string s5{'a', 'b'};
+		const string s6{long_text, 3};
+
+		CHECK(s1.str() == short_text);
+		CHECK(s2.str() == long_text);
+		CHECK(s3 == "aaa");
+		CHECK(s4 == long_text);
+		CHECK(s5 == "ab");
+		CHECK(s6 == "the");
+		CHECK(s2.c_str()[s2.size()] == '\0');
+	}
+	SECTION("inline string does not allocate buffer") {
+		const string s1{short_text};
+		const string s2 = s1; // NOLINT(performance-unnecessary-copy-initialization)
+
+		CHECK(s1.capacity() == string::inline_capacity + 0);
+		CHECK_FALSE(s1.shares_storage_with(s2));
+		CHECK(s2 == short_text);
+	}
+	SECTION("string of inline capacity") {
+		const std::string text(string::inline_capacity, 'x');
+		const string s{text};
+
+		CHECK(s.size() == text.size());
+		CHECK(s.capacity() == string::inline_capacity + 0);
+		CHECK(s.c_str()[s.size()] == '\0');
+		CHECK(s == text.c_str());
+	}
+	SECTION("copying long string shares buffer") {
+		const string s1{long_text};
+		const string s2 = s1; // NOLINT(performance-unnecessary-copy-initialization)
+
+		CHECK(s1.shares_storage_with(s2));
+		CHECK(s1.data() == s2.data());
+		CHECK(s1 == s2);
+	}
+	SECTION("changing shared string copies characters") {
+		const string s1{long_text};
+		string s2 = s1;
+
+		s2.set(0, 'T');
+
+		CHECK_FALSE(s1.shares_storage_with(s2));
+		CHECK(s1 == long_text);
+		CHECK(s2[0] == 'T');
+		CHECK(s2.str().substr(1) == std::string{long_text}.substr(1));
+	}
+	SECTION("changing unique string does not copy characters") {
+		string s{long_text};
+		const char* const data = s.data();
+
+		s.set(0, 'T');
+		s.mutable_data()[1] = 'H';
+		s.pop_back();
+
+		CHECK(s.data() == data);
+		CHECK(s[0] == 'T');
+		CHECK(s[1] == 'H');
+		CHECK(s.size() == std::string{long_text}.size() - 1);
+	}
+	SECTION("append") {
+		string s{short_text};
+		std::string expected{short_text};
+
+		for (int i = 0; i != 20; ++i) {
+			s += long_text;
+			s += 'x';
+			s.append(2, 'y');
+			expected += long_text;
+			expected += 'x';
+			expected.append(2, 'y');
+		}
+
+		CHECK(s.str() == expected);
+		CHECK(s.capacity() >= s.size());
+	}
+	SECTION("append to shared string") {
+		const string s1{long_text};
+		string s2 = s1;
+
+		s2.push_back('!');
+
+		CHECK(s1 == long_text);
+		CHECK(s2 == (std::string{long_text} + '!').c_str());
+	}
+	SECTION("append itself") {
+		string s1{short_text};
+		string s2{long_text};
+
+		s1.append(s1);
+		s2.append(s2.data(), s2.size());
+
+		CHECK(s1 == (std::string{short_text} + short_text).c_str());
+		CHECK(s2 == (std::string{long_text} + long_text).c_str());
+	}
+	SECTION("resize") {
+		string s1{long_text};
+		const string s2 = s1;
+
+		s1.resize(3);
+		CHECK(s1 == "the");
+		CHECK(s2 == long_text);
+
+		s1.resize(5, '.');
+		CHECK(s1 == "the..");
+	}
+	SECTION("clear") {
+		string s1{long_text};
+		const string s2 = s1;
+
+		s1.clear();
+
+		CHECK(s1.empty());
+		CHECK(s2 == long_text);
+	}
+	SECTION("reserve") {
+		string s;
+
+		s.reserve(100);
+
+		CHECK(s.capacity() >= 100);
+		CHECK(s.empty());
+	}
+	SECTION("substr") {
+		const string s{long_text};
+
+		CHECK(s.substr(4, 4) == "text");
+		CHECK(s.substr().shares_storage_with(s));
+		CHECK(s.substr(s.size()).empty());
+		CHECK_THROWS_AS(s.substr(s.size() + 1), std::out_of_range);
+	}
+	SECTION("element access") {
+		const string s{short_text};
+
+		CHECK(s.front() == 's');
+		CHECK(s.back() == 't');
+		CHECK(s.at(1) == 'h');
+		CHECK_THROWS_AS(s.at(5), std::out_of_range);
+	}
+	SECTION("moving") {
+		string s1{long_text};
+		string s2 = std::move(s1);
+
+		CHECK(s1.empty()); // NOLINT(bugprone-use-after-move)
+		CHECK(s2 == long_text);
+
+		s1 = std::move(s2);
+
+		CHECK(s1 == long_text);
+	}
+	SECTION("assignment") {
+		string s1{short_text};
+		const string s2{long_text};
+
+		s1 = s2;
+		CHECK(s1.shares_storage_with(s2));
+
+		s1 = short_text;
+		CHECK(s1 == short_text);
+	}
+	SECTION("swap") {
+		string s1{short_text};
+		string s2{long_text};
+
+		swap(s1, s2);
+
+		CHECK(s1 == long_text);
+		CHECK(s2 == short_text);
+	}
+	SECTION("relational operations") {
+		const string s1{"abc"};
+		const string s2{"abd"};
+		const string s3{"ab"};
+
+		CHECK(s1 == string{"abc"});
+		CHECK(s1 != s2);
+		CHECK(s1 < s2);
+		CHECK(s3 < s1);
+		CHECK(s2 > s1);
+		CHECK(s1 <= s1);
+		CHECK(s1 >= s3);
+		CHECK("abc" == s1);
+		CHECK(s1 != "ab");
+		CHECK("ab" < s1);
+		CHECK(s1 > "ab");
+		CHECK(s1 <= "abc");
+		CHECK("abd" >= s1);
+	}
+	SECTION("concatenation") {
+		const string s1{short_text};
+		const string s2{long_text};
+
+		CHECK(s1 + s2 == (std::string{short_text} + long_text).c_str());
+		CHECK(s1 + "!" == "short!");
+	}
+	SECTION("output") {
+		std::ostringstream os;
+
+		os << string{long_text};
+
+		CHECK(os.str() == long_text);
+	}
+	SECTION("hash") {
+		CHECK(std::hash<string>{}(string{long_text}) == std::hash<string>{}(string{long_text}));
+	}
+	SECTION("wide string") {
+		const wstring s1{L"the wide text which is longer than the inline capacity"};
+		wstring s2 = s1;
+
+		s2 += L'!';
+
+		CHECK(s1.size() + 1 == s2.size());
+		CHECK(s2.back() == L'!');
+	}
+#ifdef COW_CPP_LIB_STRING_VIEW
+	SECTION("string_view") {
+		const string s{long_text};
+		const std::string_view view = s;
+
+		CHECK(view.data() == s.data());
+		CHECK(view == long_text);
+		CHECK(string{view} == long_text);
+		CHECK(std::hash<string>{}(s) == std::hash<std::string_view>{}(view));
+	}
+#endif
+}
+
+TEST_CASE("Testing optional of basic_string", "[string]") {
+	SECTION("optional keeps string inline") {
+		CHECK(use_inline_storage_v<string>);
+		CHECK(sizeof(optional<string>) <= 3 * sizeof(void*));
+	}
+	SECTION("copying optional shares buffer") {
+		const optional<string> o1{long_text};
+		optional<string> o2 = o1;
+
+		CHECK(o1->shares_storage_with(*o2));
+
+		o2.modify([](string& s) { s += '!'; });
+
+		CHECK(*o1 == long_text);
+		CHECK(o2->size() == o1->size() + 1);
+	}
+}
+
+TEST_CASE("Testing basic_string reference counters", "[string]") {
+	SECTION("single thread counter") {
+		using single_thread_string = basic_string<char, std::char_traits<char>, plain_ref_count>;
+		const single_thread_string s1{long_text};
+		single_thread_string s2 = s1;
+
+		CHECK(s1.shares_storage_with(s2));
+		s2.set(0, 'T');
+		CHECK(s1 == long_text);
+	}
+	SECTION("padded counter") {
+		using padded_string = basic_string<char, std::char_traits<char>, cache_line_padded<atomic_ref_count>>;
+		const padded_string s1{long_text};
+		padded_string s2 = s1;
+
+		s2 += '!';
+		CHECK(s1 == long_text);
+		CHECK(s2.size() == s1.size() + 1);
+	}
+	SECTION("throwing counter") {
+		using throwing_string = basic_string<char, std::char_traits<char>, throwing_ref_count>;
+		const throwing_string s1{short_text};
+		bool thrown = false;
+		const std::ptrdiff_t kept_blocks = count_kept_blocks([&thrown]() {
+			try {
+				static_cast<void>(throwing_string{long_text});
+			}
+			catch (const std::bad_alloc&) {
+				thrown = true;
+			}
+		});
+
+		CHECK(s1 == short_text);
+		CHECK(thrown);
+		CHECK(kept_blocks == 0);
+	}
+}
+
+} // namespace
+} // namespace test
+} // namespace cow
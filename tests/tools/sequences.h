@@ -0,0 +1,77 @@
+#pragma once
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace cow {
+namespace test {
+namespace tools {
+
+namespace detail {
+
+// the sequence containers take the values by `push_back`, the sets take them by `insert`
+template<typename Container, typename T>
+auto append(Container& container, T&& value, int /*preferred*/) -> decltype(container.push_back(std::forward<T>(value)))
+{
+	return container.push_back(std::forward<T>(value));
+}
+
+template<typename Container, typename T>
+void append(Container& container, T&& value, long /*fallback*/)
+{
+	container.insert(std::forward<T>(value));
+}
+
+// the copies of the entries of `std::map` have mutable keys, so they are compared with the entries of cow maps
+template<typename T>
+struct value_copy {
+	using type = T;
+};
+
+template<typename Key, typename T>
+struct value_copy<std::pair<const Key, T>> {
+	using type = std::pair<Key, T>;
+};
+
+} // namespace detail
+
+/// \return The container with the values [first, last) in ascending order.
+template<typename Container>
+Container make_sequence(const int first, const int last)
+{
+	Container result;
+	for (int i = first; i != last; ++i)
+		detail::append(result, i, 0);
+	return result;
+}
+
+inline std::vector<int> make_std_sequence(const int first, const int last)
+{
+	return make_sequence<std::vector<int>>(first, last);
+}
+
+/// \return The map with the entries `{i, i * i}` for i in [0, count).
+template<typename Map>
+Map make_squares(const int count)
+{
+	Map result;
+	for (int i = 0; i != count; ++i)
+		result.insert({i, i * i});
+	return result;
+}
+
+inline std::map<int, int> make_std_squares(const int count)
+{
+	return make_squares<std::map<int, int>>(count);
+}
+
+/// \return The values of the container in the order of its iterators.
+template<typename Container>
+std::vector<typename detail::value_copy<typename Container::value_type>::type> to_std_vector(const Container& container)
+{
+	return {container.begin(), container.end()};
+}
+
+} // namespace tools
+} // namespace test
+} // namespace cow
@@ -0,0 +1,233 @@
+#include <cow/vector.h>
+#include <catch2/catch.hpp>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "tools/sequences.h"
+#include "tools/tracker.h"
+
+namespace cow {
+namespace test {
+namespace {
+
+// # tools
+using small_vector = vector<int, 4>;
+
+const auto make_sequence = &tools::make_sequence<small_vector>;
+
+// # tests
+TEST_CASE("Testing class vector", "[vector]") {
+	SECTION("default constructor") {
+		const small_vector v;
+
+		CHECK(v.empty());
+		CHECK(v.size() == 0);
+		CHECK(v.begin() == v.end());
+	}
+	SECTION("constructors") {
+		const small_vector v1(6, 7);
+		const std::vector<int> source{1, 2, 3, 4, 5, 6};
+		const small_vector v2(source.begin(), source.end());
+		const small_vector v3{1, 2, 3};
+
+		CHECK(std::vector<int>(v1.begin(), v1.end()) == std::vector<int>(6, 7));
+		CHECK(std::vector<int>(v2.begin(), v2.end()) == source);
+		CHECK(std::vector<int>(v3.begin(), v3.end()) == std::vector<int>{1, 2, 3});
+	}
+	SECTION("push_back and element access") {
+		const small_vector v = make_sequence(0, 10);
+
+		REQUIRE(v.size() == 10);
+		for (std::size_t i = 0; i != v.size(); ++i)
+			CHECK(v[i] == static_cast<int>(i));
+		CHECK(v.front() == 0);
+		CHECK(v.back() == 9);
+		CHECK(v.at(9) == 9);
+		CHECK_THROWS_AS(v.at(10), std::out_of_range);
+	}
+	SECTION("iterators") {
+		const small_vector v = make_sequence(0, 10);
+		small_vector::const_iterator it = v.begin();
+
+		CHECK(std::distance(v.begin(), v.end()) == 10);
+		CHECK(*(it + 5) == 5);
+		CHECK(it[7] == 7);
+		it += 9;
+		CHECK(*it-- == 9);
+		CHECK(*it == 8);
+		CHECK(v.end() - it == 2);
+		CHECK(it < v.end());
+	}
+	SECTION("copying shares the chunks") {
+		const small_vector v1 = make_sequence(0, 10);
+		const small_vector v2 = v1; // NOLINT(performance-unnecessary-copy-initialization)
+
+		CHECK(v1.shares_storage_with(v2));
+		CHECK(&v1[0] == &v2[0]);
+		CHECK(v1 == v2);
+	}
+	SECTION("writing detaches only the chunk of the element") {
+		const small_vector v1 = make_sequence(0, 10);
+		small_vector v2 = v1;
+
+		v2.set(5, 50);
+
+		CHECK_FALSE(v1.shares_storage_with(v2));
+		CHECK(v1[5] == 5);
+		CHECK(v2[5] == 50);
+		CHECK(&v1[4] != &v2[4]);
+		CHECK(&v1[0] == &v2[0]);
+		CHECK(&v1[8] == &v2[8]);
+		CHECK(v1 != v2);
+	}
+	SECTION("writing unique vector does not copy") {
+		small_vector v = make_sequence(0, 10);
+		const int* const address = &v[5];
+
+		*v.write(5) = 50;
+		v.modify(6, [](int& value) { value *= 10; });
+
+		CHECK(&v[5] == address);
+		CHECK(v[5] == 50);
+		CHECK(v[6] == 60);
+	}
+	SECTION("modifying returns the result of function") {
+		small_vector v = make_sequence(0, 3);
+
+		CHECK(v.modify(2, [](int& value) { return value++; }) == 2);
+		CHECK(v[2] == 3);
+	}
+	SECTION("push_back to copy does not change original") {
+		const small_vector v1 = make_sequence(0, 6);
+		small_vector v2 = v1;
+
+		v2.push_back(6);
+		v2.push_back(7);
+		v2.push_back(8);
+
+		CHECK(v1.size() == 6);
+		CHECK(v2.size() == 9);
+		CHECK(v2.back() == 8);
+		CHECK(&v1[0] == &v2[0]);
+	}
+	SECTION("push_back element of itself") {
+		small_vector v = make_sequence(0, 4);
+		const small_vector copy = v;
+
+		v.push_back(v[0]);
+		v.push_back(v[4]);
+
+		CHECK(v.size() == 6);
+		CHECK(v[4] == 0);
+		CHECK(v[5] == 0);
+	}
+	SECTION("pop_back") {
+		const small_vector v1 = make_sequence(0, 6);
+		small_vector v2 = v1;
+
+		v2.pop_back();
+		v2.pop_back();
+		v2.pop_back();
+
+		CHECK(v1.size() == 6);
+		CHECK(v1.back() == 5);
+		CHECK(v2.size() == 3);
+		CHECK(v2.back() == 2);
+		CHECK(v2 == make_sequence(0, 3));
+	}
+	SECTION("clear") {
+		small_vector v = make_sequence(0, 6);
+
+		v.clear();
+
+		CHECK(v.empty());
+		v.push_back(1);
+		CHECK(v.size() == 1);
+	}
+	SECTION("moving") {
+		small_vector v1 = make_sequence(0, 6);
+		small_vector v2 = std::move(v1);
+
+		CHECK(v1.empty()); // NOLINT(bugprone-use-after-move)
+		CHECK(v2.size() == 6);
+
+		v1 = std::move(v2);
+
+		CHECK(v1.size() == 6);
+	}
+	SECTION("swap") {
+		small_vector v1 = make_sequence(0, 6);
+		small_vector v2 = make_sequence(0, 2);
+
+		swap(v1, v2);
+
+		CHECK(v1.size() == 2);
+		CHECK(v2.size() == 6);
+	}
+	SECTION("relational operations") {
+		const small_vector v1{1, 2, 3};
+		const small_vector v2{1, 2, 4};
+		const small_vector v3{1, 2};
+
+		CHECK(v1 == small_vector{1, 2, 3});
+		CHECK(v1 != v2);
+		CHECK(v1 < v2);
+		CHECK(v3 < v1);
+		CHECK(v2 > v1);
+		CHECK(v1 <= v1);
+		CHECK(v1 >= v3);
+	}
+	SECTION("copying only detached chunk") {
+		vector<tools::tracker, 2> v1;
+		for (int i = 0; i != 6; ++i)
+			v1.emplace_back(i);
+		vector<tools::tracker, 2> v2 = v1;
+
+		v2.modify(3, [](tools::tracker& value) { value = tools::tracker{30}; });
+
+		CHECK(v1[3].get_value() == 3);
+		CHECK(v2[3].get_value() == 30);
+		CHECK(v2[0].get_copy_generation() == v1[0].get_copy_generation());
+		CHECK(v2[2].get_copy_generation() == v1[2].get_copy_generation() + 1);
+		CHECK(v2[5].get_copy_generation() == v1[5].get_copy_generation());
+	}
+	SECTION("vector of strings") {
+		vector<std::string> v1{"a", "b"};
+		vector<std::string> v2 = v1;
+
+		v2.write(0)->append("c");
+
+		CHECK(v1[0] == "a");
+		CHECK(v2[0] == "ac");
+	}
+}
+
+TEST_CASE("Testing vector storage policies", "[vector]") {
+	SECTION("shared_ptr storage") {
+		const vector<int, 4, shared_ptr_storage> v1{1, 2, 3, 4, 5};
+		vector<int, 4, shared_ptr_storage> v2 = v1;
+
+		v2.set(4, 50);
+
+		CHECK(v1[4] == 5);
+		CHECK(v2[4] == 50);
+		CHECK(&v1[0] == &v2[0]);
+	}
+	SECTION("single thread storage") {
+		const vector<int, 4, single_thread_storage> v1{1, 2, 3, 4, 5};
+		vector<int, 4, single_thread_storage> v2 = v1;
+
+		v2.set(0, 10);
+
+		CHECK(v1[0] == 1);
+		CHECK(v2[0] == 10);
+		CHECK(&v1[4] == &v2[4]);
+	}
+}
+
+} // namespace
+} // namespace test
+} // namespace cow